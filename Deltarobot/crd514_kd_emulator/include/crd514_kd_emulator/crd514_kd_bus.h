@@ -0,0 +1,80 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           crd514_kd_bus.h
+// Description:    the 3 emulated crd514-kd's on one rs485 bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <crd514_kd_emulator/crd514_kd_slave.h>
+
+namespace crd514_kd_emulator
+{
+    /**
+     * @brief the motor controllers of the deltarobot, slaves 1-3, answering modbus rtu requests
+     *
+     * supports the functions modbus_ctrl uses (read holding registers, write single and multiple registers)
+     * and diagnostics. writes to address 0 are broadcast to all slaves and are not answered,
+     * requests for other addresses are ignored.
+     **/
+    class crd514_kd_bus
+    {
+        private:
+            std::vector<crd514_kd_slave> slaves;
+
+            void exception(const uint8_t* request, uint8_t code, std::vector<uint8_t>& response);
+
+        public:
+            enum
+            {
+                BROADCAST = 0,
+                SLAVES = 3
+            };
+
+            crd514_kd_bus(void);
+
+            /**
+             * @brief executes a request with a valid crc
+             * @param response output parameter, the response including crc, cleared if the request is not answered
+             * @param now time the request was received
+             * @return true if the request is answered
+             **/
+            bool handle(const std::vector<uint8_t>& request, std::vector<uint8_t>& response, double now);
+
+            /// @param address 1-3
+            inline crd514_kd_slave& get_slave(int address) { return slaves[address - 1]; }
+    };
+}
@@ -0,0 +1,125 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           crd514_kd_slave.h
+// Description:    emulated crd514-kd motor controller
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <stdint.h>
+
+namespace crd514_kd_emulator
+{
+    /**
+     * @brief registers and motion of one emulated crd514-kd
+     *
+     * the registers of huniplacer/CRD514_KD.h behave like they do for steppermotor3: the operation data (OP_*)
+     * is stored, a rising START edge in CMD_1 moves the motor with a trapezoidal profile, STOP and
+     * clearing EXCITEMENT_ON stop it at once and STATUS_1 reports READY, MOVE and ALARM. 32-bit registers
+     * hold the upper word at their address and the lower word at the next one. other registers are stored
+     * without effect. times are seconds since the start of the emulator.
+     **/
+    class crd514_kd_slave
+    {
+        private:
+            int address;
+            std::map<uint16_t, uint16_t> registers;
+
+            bool alarm;
+            /// @brief position while the motor stands still, in steps
+            int32_t position;
+
+            bool moving;
+            double start_time;
+            double duration;
+            /// @brief time the injected alarm of the current motion goes off, negative if none
+            double alarm_time;
+            int32_t from;
+            int32_t to;
+            /// @brief steps/s and steps/s^2
+            double speed;
+            double acceleration;
+            double deceleration;
+            double peak;
+
+            unsigned long motion_count;
+            unsigned long alarm_count;
+            std::set<unsigned long> alarm_motions;
+            double alarm_probability;
+
+            uint16_t get_register(uint16_t address) const;
+            int32_t get_register32(uint16_t address) const;
+
+            /// @brief ends the current motion if it finished or its alarm went off before now
+            void update(double now);
+
+            /// @brief position of the current motion at time t
+            int32_t position_at(double t) const;
+
+            void start(double now);
+            void halt(double now);
+
+        public:
+            /// @param address slave address, 1-3
+            crd514_kd_slave(int address);
+
+            inline int get_address(void) const { return address; }
+
+            /**
+             * @brief reads a 16-bit register
+             * @param now time of the request
+             **/
+            uint16_t read(uint16_t address, double now);
+
+            /**
+             * @brief writes a 16-bit register, CMD_1, RESET_ALARM and CLEAR_COUNTER act on edges
+             * @param now time of the request
+             **/
+            void write(uint16_t address, uint16_t value, double now);
+
+            /**
+             * @brief makes the motor raise an alarm halfway its n-th motion
+             * @param motion number of the motion, counting from 1
+             **/
+            void inject_alarm(unsigned long motion);
+
+            /// @brief chance (0-1) that a motion is cut short by an alarm at a random point
+            void set_alarm_probability(double probability);
+
+            int32_t get_position(double now);
+            inline unsigned long get_motion_count(void) const { return motion_count; }
+            inline unsigned long get_alarm_count(void) const { return alarm_count; }
+    };
+}
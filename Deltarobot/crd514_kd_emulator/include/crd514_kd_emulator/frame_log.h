@@ -0,0 +1,116 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           frame_log.h
+// Description:    timestamped log and statistics of the frames on the bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#pragma once
+
+#include <map>
+#include <cstdio>
+#include <cstddef>
+#include <stdint.h>
+
+namespace crd514_kd_emulator
+{
+    /**
+     * @brief minimum, mean and maximum of the silences between frames, in seconds
+     **/
+    struct gap_stats
+    {
+        unsigned long count;
+        double sum;
+        double min;
+        double max;
+
+        gap_stats(void) : count(0), sum(0), min(0), max(0) { }
+
+        void add(double gap);
+        inline double mean(void) const { return count == 0 ? 0 : sum / count; }
+    };
+
+    /**
+     * @brief logs every frame on the bus and keeps the statistics modbus_ctrl's timing shows up in
+     *
+     * a frame is logged when it is complete: a request when its last byte was received, a response when it was
+     * sent. the gap before a request is split by what came before it: a response (the write interval of the
+     * master), a broadcast (the response timeout the master waits plus its write interval) or a request
+     * that was not answered.
+     **/
+    class frame_log
+    {
+        private:
+            /// @brief NULL if frames are not logged
+            FILE* out;
+
+            bool has_previous;
+            double previous_time;
+            enum previous_frame
+            {
+                RESPONSE,
+                BROADCAST,
+                UNANSWERED
+            } previous;
+
+            std::map<int, unsigned long> requests;
+            unsigned long responses;
+            unsigned long broadcasts;
+            unsigned long exceptions;
+            unsigned long crc_errors;
+            unsigned long incomplete;
+
+            gap_stats after_response;
+            gap_stats after_broadcast;
+            gap_stats after_unanswered;
+            gap_stats turnaround;
+
+            void print_frame(double t, double gap, const char* direction, const uint8_t* data, size_t length, bool request);
+
+        public:
+            /// @param out stream the frames are logged to, NULL to only keep statistics
+            frame_log(FILE* out);
+
+            /**
+             * @brief a request with a valid crc
+             * @param answered true if a response follows
+             **/
+            void request(double t, const uint8_t* data, size_t length, bool answered);
+
+            void response(double t, const uint8_t* data, size_t length);
+
+            /// @brief bytes that were dropped: a crc error or a frame that did not complete before the silence
+            void dropped(double t, const uint8_t* data, size_t length, bool crc_error);
+
+            void print_summary(FILE* out) const;
+    };
+}
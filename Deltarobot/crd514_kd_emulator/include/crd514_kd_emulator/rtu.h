@@ -0,0 +1,89 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           rtu.h
+// Description:    modbus rtu framing
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace crd514_kd_emulator
+{
+    /**
+     * @brief helpers for modbus rtu frames: slave address, function code, data and a crc16 (low byte first)
+     **/
+    namespace rtu
+    {
+        enum functions
+        {
+            READ_HOLDING_REGISTERS = 0x03,
+            WRITE_SINGLE_REGISTER = 0x06,
+            DIAGNOSTICS = 0x08,
+            WRITE_MULTIPLE_REGISTERS = 0x10
+        };
+
+        enum exceptions
+        {
+            ILLEGAL_FUNCTION = 0x01,
+            ILLEGAL_DATA_VALUE = 0x03
+        };
+
+        uint16_t crc16(const uint8_t* data, size_t length);
+
+        /// @return true if the last 2 bytes of the frame are the crc16 of the rest
+        bool check_crc(const uint8_t* data, size_t length);
+
+        void append_crc(std::vector<uint8_t>& frame);
+
+        /**
+         * @brief the length of the request that begins at data
+         * @param length number of bytes received so far
+         * @return length in bytes, 0 if more bytes are needed to know it, -1 if the function is not supported
+         **/
+        int request_length(const uint8_t* data, size_t length);
+
+        /// @brief seconds a frame takes on the wire (8N1), excluding the silence that ends it
+        double frame_time(size_t bytes, long baudrate);
+
+        inline uint16_t get_u16(const uint8_t* data) { return (uint16_t)((data[0] << 8) | data[1]); }
+
+        inline void put_u16(std::vector<uint8_t>& frame, uint16_t value)
+        {
+            frame.push_back((uint8_t)(value >> 8));
+            frame.push_back((uint8_t)(value & 0xFF));
+        }
+    }
+}
@@ -0,0 +1,161 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           crd514_kd_bus.cpp
+// Description:    the 3 emulated crd514-kd's on one rs485 bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <crd514_kd_emulator/crd514_kd_bus.h>
+#include <crd514_kd_emulator/rtu.h>
+
+namespace crd514_kd_emulator
+{
+    crd514_kd_bus::crd514_kd_bus(void) :
+        slaves()
+    {
+        for(int address = 1; address <= SLAVES; address++)
+        {
+            slaves.push_back(crd514_kd_slave(address));
+        }
+    }
+
+    void crd514_kd_bus::exception(const uint8_t* request, uint8_t code, std::vector<uint8_t>& response)
+    {
+        response.push_back(request[0]);
+        response.push_back(request[1] | 0x80);
+        response.push_back(code);
+        rtu::append_crc(response);
+    }
+
+    bool crd514_kd_bus::handle(const std::vector<uint8_t>& request, std::vector<uint8_t>& response, double now)
+    {
+        response.clear();
+
+        const uint8_t* r = &request[0];
+        int address = r[0];
+        if(address > SLAVES)
+        {
+            return false;
+        }
+
+        int first = address == BROADCAST ? 1 : address;
+        int last = address == BROADCAST ? SLAVES : address;
+
+        switch(r[1])
+        {
+            case rtu::READ_HOLDING_REGISTERS:
+            {
+                uint16_t start = rtu::get_u16(r + 2);
+                uint16_t quantity = rtu::get_u16(r + 4);
+                if(address == BROADCAST)
+                {
+                    return false;
+                }
+                if(quantity < 1 || quantity > 125)
+                {
+                    exception(r, rtu::ILLEGAL_DATA_VALUE, response);
+                    return true;
+                }
+
+                response.push_back(r[0]);
+                response.push_back(r[1]);
+                response.push_back((uint8_t)(2 * quantity));
+                for(uint16_t i = 0; i < quantity; i++)
+                {
+                    rtu::put_u16(response, get_slave(address).read(start + i, now));
+                }
+                rtu::append_crc(response);
+                return true;
+            }
+
+            case rtu::WRITE_SINGLE_REGISTER:
+            {
+                for(int a = first; a <= last; a++)
+                {
+                    get_slave(a).write(rtu::get_u16(r + 2), rtu::get_u16(r + 4), now);
+                }
+                if(address == BROADCAST)
+                {
+                    return false;
+                }
+                response.assign(request.begin(), request.end());
+                return true;
+            }
+
+            case rtu::WRITE_MULTIPLE_REGISTERS:
+            {
+                uint16_t start = rtu::get_u16(r + 2);
+                uint16_t quantity = rtu::get_u16(r + 4);
+                if(quantity < 1 || quantity > 123 || r[6] != 2 * quantity)
+                {
+                    if(address == BROADCAST)
+                    {
+                        return false;
+                    }
+                    exception(r, rtu::ILLEGAL_DATA_VALUE, response);
+                    return true;
+                }
+
+                for(int a = first; a <= last; a++)
+                {
+                    for(uint16_t i = 0; i < quantity; i++)
+                    {
+                        get_slave(a).write(start + i, rtu::get_u16(r + 7 + 2 * i), now);
+                    }
+                }
+                if(address == BROADCAST)
+                {
+                    return false;
+                }
+                response.assign(request.begin(), request.begin() + 6);
+                rtu::append_crc(response);
+                return true;
+            }
+
+            case rtu::DIAGNOSTICS:
+                if(address == BROADCAST)
+                {
+                    return false;
+                }
+                response.assign(request.begin(), request.end());
+                return true;
+
+            default:
+                if(address == BROADCAST)
+                {
+                    return false;
+                }
+                exception(r, rtu::ILLEGAL_FUNCTION, response);
+                return true;
+        }
+    }
+}
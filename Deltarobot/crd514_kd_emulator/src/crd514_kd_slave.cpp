@@ -0,0 +1,289 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           crd514_kd_slave.cpp
+// Description:    emulated crd514-kd motor controller
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <crd514_kd_emulator/crd514_kd_slave.h>
+#include <huniplacer/CRD514_KD.h>
+
+#include <cmath>
+#include <cstdlib>
+
+namespace crd514_kd_emulator
+{
+    crd514_kd_slave::crd514_kd_slave(int address) :
+        address(address),
+        registers(),
+        alarm(false),
+        position(0),
+        moving(false),
+        start_time(0),
+        duration(0),
+        alarm_time(-1),
+        from(0),
+        to(0),
+        speed(0),
+        acceleration(0),
+        deceleration(0),
+        peak(0),
+        motion_count(0),
+        alarm_count(0),
+        alarm_motions(),
+        alarm_probability(0)
+    {
+    }
+
+    uint16_t crd514_kd_slave::get_register(uint16_t address) const
+    {
+        std::map<uint16_t, uint16_t>::const_iterator it = registers.find(address);
+        return it == registers.end() ? 0 : it->second;
+    }
+
+    int32_t crd514_kd_slave::get_register32(uint16_t address) const
+    {
+        return (int32_t)(((uint32_t)get_register(address) << 16) | get_register(address + 1));
+    }
+
+    void crd514_kd_slave::update(double now)
+    {
+        if(!moving)
+        {
+            return;
+        }
+
+        if(alarm_time >= 0 && now >= alarm_time)
+        {
+            position = position_at(alarm_time);
+            moving = false;
+            alarm = true;
+            alarm_count++;
+        }
+        else if(now >= start_time + duration)
+        {
+            position = to;
+            moving = false;
+        }
+    }
+
+    int32_t crd514_kd_slave::position_at(double t) const
+    {
+        double elapsed = t - start_time;
+        if(elapsed <= 0)
+        {
+            return from;
+        }
+        if(elapsed >= duration)
+        {
+            return to;
+        }
+
+        double distance = fabs((double)to - from);
+        double acc_time = peak / acceleration;
+        double dec_time = peak / deceleration;
+        double travelled;
+        if(elapsed < acc_time)
+        {
+            travelled = 0.5 * acceleration * elapsed * elapsed;
+        }
+        else if(elapsed < duration - dec_time)
+        {
+            travelled = 0.5 * acceleration * acc_time * acc_time + peak * (elapsed - acc_time);
+        }
+        else
+        {
+            double remaining = duration - elapsed;
+            travelled = distance - 0.5 * deceleration * remaining * remaining;
+        }
+        return from + (int32_t)(to < from ? -floor(travelled) : floor(travelled));
+    }
+
+    void crd514_kd_slave::start(double now)
+    {
+        motion_count++;
+
+        int32_t target = get_register32(crd514_kd::registers::OP_POS);
+        if(get_register(crd514_kd::registers::OP_POSMODE) != 1) //incremental
+        {
+            target += position;
+        }
+
+        //software overtravel
+        if((registers.count(crd514_kd::registers::CFG_POSLIMIT_POSITIVE) &&
+            target > get_register32(crd514_kd::registers::CFG_POSLIMIT_POSITIVE)) ||
+           (registers.count(crd514_kd::registers::CFG_POSLIMIT_NEGATIVE) &&
+            target < get_register32(crd514_kd::registers::CFG_POSLIMIT_NEGATIVE)))
+        {
+            alarm = true;
+            alarm_count++;
+            return;
+        }
+
+        //the units steppermotor3::motion_float_to_int writes: steps/s and 1e9 / (steps/s^2)
+        uint32_t acc = (uint32_t)get_register32(crd514_kd::registers::OP_ACC);
+        uint32_t dec = (uint32_t)get_register32(crd514_kd::registers::OP_DEC);
+        speed = (uint32_t)get_register32(crd514_kd::registers::OP_SPEED);
+        if(speed < 1)
+        {
+            speed = 1;
+        }
+        acceleration = acc == 0 ? 1e12 : 1e9 / acc;
+        deceleration = dec == 0 ? 1e12 : 1e9 / dec;
+
+        from = position;
+        to = target;
+        double distance = fabs((double)to - from);
+        double acc_distance = speed * speed / (2 * acceleration);
+        double dec_distance = speed * speed / (2 * deceleration);
+        if(acc_distance + dec_distance <= distance)
+        {
+            peak = speed;
+            duration = speed / acceleration + (distance - acc_distance - dec_distance) / speed + speed / deceleration;
+        }
+        else
+        {
+            peak = sqrt(2 * distance * acceleration * deceleration / (acceleration + deceleration));
+            duration = distance == 0 ? 0 : peak / acceleration + peak / deceleration;
+        }
+
+        alarm_time = -1;
+        if(alarm_motions.count(motion_count))
+        {
+            alarm_time = now + duration / 2;
+        }
+        else if(alarm_probability > 0 && drand48() < alarm_probability)
+        {
+            alarm_time = now + drand48() * duration;
+        }
+
+        start_time = now;
+        moving = true;
+        update(now);
+    }
+
+    void crd514_kd_slave::halt(double now)
+    {
+        update(now);
+        if(moving)
+        {
+            position = position_at(now);
+            moving = false;
+        }
+    }
+
+    uint16_t crd514_kd_slave::read(uint16_t address, double now)
+    {
+        if(address != crd514_kd::registers::STATUS_1)
+        {
+            return get_register(address);
+        }
+
+        update(now);
+        uint16_t status_1 = 0;
+        if(alarm)
+        {
+            status_1 |= crd514_kd::status1_bits::ALARM;
+        }
+        if(moving)
+        {
+            status_1 |= crd514_kd::status1_bits::MOVE;
+        }
+        else if(!alarm && (get_register(crd514_kd::registers::CMD_1) & crd514_kd::cmd1_bits::EXCITEMENT_ON))
+        {
+            status_1 |= crd514_kd::status1_bits::READY;
+        }
+        return status_1;
+    }
+
+    void crd514_kd_slave::write(uint16_t address, uint16_t value, double now)
+    {
+        uint16_t previous = get_register(address);
+        update(now);
+
+        switch(address)
+        {
+            case crd514_kd::registers::STATUS_1:
+                //read only
+                return;
+
+            case crd514_kd::registers::CMD_1:
+                registers[address] = value;
+                if(!(value & crd514_kd::cmd1_bits::EXCITEMENT_ON) || (value & crd514_kd::cmd1_bits::STOP))
+                {
+                    halt(now);
+                }
+                else if((value & crd514_kd::cmd1_bits::START) && !(previous & crd514_kd::cmd1_bits::START) &&
+                        !alarm && !moving)
+                {
+                    start(now);
+                }
+                return;
+
+            case crd514_kd::registers::RESET_ALARM:
+                registers[address] = value;
+                if(value && !previous)
+                {
+                    alarm = false;
+                }
+                return;
+
+            case crd514_kd::registers::CLEAR_COUNTER:
+                registers[address] = value;
+                if(value && !previous && !moving)
+                {
+                    position = 0;
+                }
+                return;
+
+            default:
+                registers[address] = value;
+                return;
+        }
+    }
+
+    void crd514_kd_slave::inject_alarm(unsigned long motion)
+    {
+        alarm_motions.insert(motion);
+    }
+
+    void crd514_kd_slave::set_alarm_probability(double probability)
+    {
+        alarm_probability = probability;
+    }
+
+    int32_t crd514_kd_slave::get_position(double now)
+    {
+        update(now);
+        return moving ? position_at(now) : position;
+    }
+}
@@ -0,0 +1,218 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           frame_log.cpp
+// Description:    timestamped log and statistics of the frames on the bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <crd514_kd_emulator/frame_log.h>
+#include <crd514_kd_emulator/rtu.h>
+
+namespace crd514_kd_emulator
+{
+    void gap_stats::add(double gap)
+    {
+        if(count == 0 || gap < min)
+        {
+            min = gap;
+        }
+        if(count == 0 || gap > max)
+        {
+            max = gap;
+        }
+        sum += gap;
+        count++;
+    }
+
+    frame_log::frame_log(FILE* out) :
+        out(out),
+        has_previous(false),
+        previous_time(0),
+        previous(RESPONSE),
+        requests(),
+        responses(0),
+        broadcasts(0),
+        exceptions(0),
+        crc_errors(0),
+        incomplete(0)
+    {
+    }
+
+    void frame_log::print_frame(double t, double gap, const char* direction, const uint8_t* data, size_t length, bool request)
+    {
+        if(out == NULL)
+        {
+            return;
+        }
+
+        fprintf(out, "%12.6f %+10.3f ms %s", t, gap * 1000, direction);
+        for(size_t i = 0; i < length; i++)
+        {
+            fprintf(out, " %02x", data[i]);
+        }
+
+        //decoded, without crc
+        if(length >= 4)
+        {
+            int function = data[1];
+            fprintf(out, "  ; slave %d ", data[0]);
+            if(function & 0x80)
+            {
+                fprintf(out, "exception %02x function %02x", data[2], function & 0x7F);
+            }
+            else if(function == rtu::READ_HOLDING_REGISTERS && request && length == 8)
+            {
+                fprintf(out, "read %04x x%d", rtu::get_u16(data + 2), rtu::get_u16(data + 4));
+            }
+            else if(function == rtu::READ_HOLDING_REGISTERS && !request)
+            {
+                fprintf(out, "=");
+                for(size_t i = 3; i + 1 < length - 2; i += 2)
+                {
+                    fprintf(out, " %04x", rtu::get_u16(data + i));
+                }
+            }
+            else if(function == rtu::WRITE_SINGLE_REGISTER && length == 8)
+            {
+                fprintf(out, "write %04x = %04x", rtu::get_u16(data + 2), rtu::get_u16(data + 4));
+            }
+            else if(function == rtu::WRITE_MULTIPLE_REGISTERS && request && length > 9)
+            {
+                fprintf(out, "write %04x =", rtu::get_u16(data + 2));
+                for(size_t i = 7; i + 1 < length - 2; i += 2)
+                {
+                    fprintf(out, " %04x", rtu::get_u16(data + i));
+                }
+            }
+            else if(function == rtu::WRITE_MULTIPLE_REGISTERS && length == 8)
+            {
+                fprintf(out, "wrote %04x x%d", rtu::get_u16(data + 2), rtu::get_u16(data + 4));
+            }
+            else
+            {
+                fprintf(out, "function %02x", function);
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    void frame_log::request(double t, const uint8_t* data, size_t length, bool answered)
+    {
+        double gap = has_previous ? t - previous_time : 0;
+        if(has_previous)
+        {
+            switch(previous)
+            {
+                case RESPONSE: after_response.add(gap); break;
+                case BROADCAST: after_broadcast.add(gap); break;
+                case UNANSWERED: after_unanswered.add(gap); break;
+            }
+        }
+
+        bool broadcast = data[0] == 0;
+        print_frame(t, gap, broadcast ? "rx*" : "rx ", data, length, true);
+
+        requests[data[1]]++;
+        if(broadcast)
+        {
+            broadcasts++;
+        }
+        has_previous = true;
+        previous_time = t;
+        previous = broadcast ? BROADCAST : answered ? RESPONSE : UNANSWERED;
+    }
+
+    void frame_log::response(double t, const uint8_t* data, size_t length)
+    {
+        double gap = t - previous_time;
+        turnaround.add(gap);
+        print_frame(t, gap, "tx ", data, length, false);
+
+        responses++;
+        if(data[1] & 0x80)
+        {
+            exceptions++;
+        }
+        previous_time = t;
+        previous = RESPONSE;
+    }
+
+    void frame_log::dropped(double t, const uint8_t* data, size_t length, bool crc_error)
+    {
+        double gap = has_previous ? t - previous_time : 0;
+        if(out != NULL)
+        {
+            fprintf(out, "%12.6f %+10.3f ms %s", t, gap * 1000, crc_error ? "crc" : "inc");
+            for(size_t i = 0; i < length; i++)
+            {
+                fprintf(out, " %02x", data[i]);
+            }
+            fprintf(out, "\n");
+        }
+
+        if(crc_error)
+        {
+            crc_errors++;
+        }
+        else
+        {
+            incomplete++;
+        }
+        has_previous = true;
+        previous_time = t;
+        previous = UNANSWERED;
+    }
+
+    void frame_log::print_summary(FILE* out) const
+    {
+        unsigned long total = 0;
+        for(std::map<int, unsigned long>::const_iterator it = requests.begin(); it != requests.end(); it++)
+        {
+            total += it->second;
+        }
+
+        fprintf(out, "%lu requests (%lu broadcast), %lu responses (%lu exceptions), %lu crc errors, %lu incomplete frames\n",
+            total, broadcasts, responses, exceptions, crc_errors, incomplete);
+        for(std::map<int, unsigned long>::const_iterator it = requests.begin(); it != requests.end(); it++)
+        {
+            fprintf(out, "  function %02x: %lu\n", it->first, it->second);
+        }
+
+        const char* names[] = { "request after response", "request after broadcast", "request after unanswered", "response after request" };
+        const gap_stats* stats[] = { &after_response, &after_broadcast, &after_unanswered, &turnaround };
+        for(int i = 0; i < 4; i++)
+        {
+            fprintf(out, "  %-26s n=%-7lu min=%9.3f ms  mean=%9.3f ms  max=%9.3f ms\n",
+                names[i], stats[i]->count, stats[i]->min * 1000, stats[i]->mean() * 1000, stats[i]->max * 1000);
+        }
+    }
+}
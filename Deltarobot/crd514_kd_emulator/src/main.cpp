@@ -0,0 +1,313 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           main.cpp
+// Description:    emulates the crd514-kd motor controllers on a pseudo terminal
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <huniplacer/CRD514_KD.h>
+#include <crd514_kd_emulator/rtu.h>
+#include <crd514_kd_emulator/crd514_kd_bus.h>
+#include <crd514_kd_emulator/frame_log.h>
+
+using namespace crd514_kd_emulator;
+
+static volatile sig_atomic_t running = 1;
+
+static void stop_running(int)
+{
+	running = 0;
+}
+
+static struct timespec start_time;
+
+/// @brief seconds since the emulator started
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec - start_time.tv_sec) + (ts.tv_nsec - start_time.tv_nsec) * 1e-9;
+}
+
+static void sleep_until(double t)
+{
+	double delta = t - now();
+	if(delta > 0)
+	{
+		struct timespec ts;
+		ts.tv_sec = (time_t)delta;
+		ts.tv_nsec = (long)((delta - ts.tv_sec) * 1e9);
+		nanosleep(&ts, NULL);
+	}
+}
+
+static bool write_all(int fd, const std::vector<uint8_t>& data)
+{
+	size_t written = 0;
+	while(written < data.size())
+	{
+		ssize_t n = write(fd, &data[written], data.size() - written);
+		if(n < 0 && errno != EINTR)
+		{
+			return false;
+		}
+		written += n < 0 ? 0 : n;
+	}
+	return true;
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"usage: %s [-b baudrate] [-d response delay us] [-l link] [-o log file] [-q] [-a slave:motion]... [-r alarm probability] [-s seed]\n"
+		"  -l  creates a symlink to the pseudo terminal, e.g. /tmp/ttyCRD514\n"
+		"  -q  only print the statistics, not every frame\n"
+		"  -a  raise an alarm halfway the given motion (counting from 1) of a slave\n"
+		"  -r  chance that a motion is cut short by an alarm\n", name);
+}
+
+int main(int argc, char** argv)
+{
+	long baudrate = crd514_kd::rtu_config::BAUDRATE;
+	double response_delay = 0;
+	const char* link_path = NULL;
+	const char* log_path = NULL;
+	bool quiet = false;
+	crd514_kd_bus bus;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) { baudrate = atol(argv[++i]); }
+		else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc) { response_delay = atof(argv[++i]) / 1000000; }
+		else if(strcmp(argv[i], "-l") == 0 && i + 1 < argc) { link_path = argv[++i]; }
+		else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) { log_path = argv[++i]; }
+		else if(strcmp(argv[i], "-q") == 0) { quiet = true; }
+		else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+		{
+			double probability = atof(argv[++i]);
+			for(int address = 1; address <= crd514_kd_bus::SLAVES; address++)
+			{
+				bus.get_slave(address).set_alarm_probability(probability);
+			}
+		}
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) { srand48(atol(argv[++i])); }
+		else if(strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+		{
+			int address;
+			unsigned long motion;
+			if(sscanf(argv[++i], "%d:%lu", &address, &motion) != 2 || address < 1 || address > crd514_kd_bus::SLAVES || motion < 1)
+			{
+				usage(argv[0]);
+				return 1;
+			}
+			bus.get_slave(address).inject_alarm(motion);
+		}
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	//pseudo terminal pair, the slave side is what modbus_new_rtu opens
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+	const char* device = ptsname(master);
+
+	//keep the slave side open, so the pair survives the master (libmodbus) closing and reopening it
+	int slave = open(device, O_RDWR | O_NOCTTY);
+	if(slave < 0)
+	{
+		perror(device);
+		return 1;
+	}
+	struct termios tio;
+	tcgetattr(slave, &tio);
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, B115200);
+	cfsetospeed(&tio, B115200);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	if(link_path != NULL)
+	{
+		unlink(link_path);
+		if(symlink(device, link_path) != 0)
+		{
+			perror(link_path);
+			return 1;
+		}
+	}
+
+	FILE* log_file = quiet ? NULL : stdout;
+	if(!quiet && log_path != NULL)
+	{
+		log_file = fopen(log_path, "w");
+		if(log_file == NULL)
+		{
+			perror(log_path);
+			return 1;
+		}
+	}
+	if(log_file != NULL)
+	{
+		//so the log can be followed during a soak test
+		setvbuf(log_file, NULL, _IOLBF, 0);
+	}
+	frame_log log(log_file);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop_running;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	fprintf(stderr, "crd514-kd slaves 1-%d on %s%s%s, %ld baud\n", (int)crd514_kd_bus::SLAVES, device,
+		link_path != NULL ? " -> " : "", link_path != NULL ? link_path : "", baudrate);
+
+	//a pty delivers a frame at once but in bursts, so the silence that ends a frame is taken generously
+	const double silence = std::max(rtu::frame_time(4, baudrate), 0.02);
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> response;
+	double last_byte = 0;
+	while(running)
+	{
+		struct pollfd p;
+		p.fd = master;
+		p.events = POLLIN;
+		p.revents = 0;
+		int r = poll(&p, 1, 10);
+		double t = now();
+		if(r > 0 && (p.revents & POLLIN))
+		{
+			uint8_t data[256];
+			ssize_t n = read(master, data, sizeof(data));
+			if(n > 0)
+			{
+				buffer.insert(buffer.end(), data, data + n);
+				last_byte = t;
+			}
+		}
+
+		while(!buffer.empty())
+		{
+			int length = rtu::request_length(&buffer[0], buffer.size());
+			if(length < 0)
+			{
+				//unsupported function: the frame ends at the silence
+				if(t - last_byte < silence)
+				{
+					break;
+				}
+				length = buffer.size();
+			}
+			if(length == 0 || buffer.size() < (size_t)length)
+			{
+				break;
+			}
+
+			std::vector<uint8_t> request(buffer.begin(), buffer.begin() + length);
+			buffer.erase(buffer.begin(), buffer.begin() + length);
+
+			if(!rtu::check_crc(&request[0], request.size()))
+			{
+				//everything up to the next silence belongs to the broken frame
+				request.insert(request.end(), buffer.begin(), buffer.end());
+				buffer.clear();
+				log.dropped(t, &request[0], request.size(), true);
+				break;
+			}
+
+			bool answered = bus.handle(request, response, t);
+			log.request(t, &request[0], request.size(), answered);
+			if(answered)
+			{
+				//request and response take their time on the wire, the pty would deliver them at once
+				sleep_until(t + rtu::frame_time(request.size(), baudrate) + response_delay + rtu::frame_time(response.size(), baudrate));
+				if(!write_all(master, response))
+				{
+					perror("write");
+				}
+				log.response(now(), &response[0], response.size());
+			}
+		}
+
+		if(!buffer.empty() && t - last_byte >= silence)
+		{
+			log.dropped(t, &buffer[0], buffer.size(), false);
+			buffer.clear();
+		}
+	}
+
+	double t = now();
+	if(log_file != NULL)
+	{
+		fflush(log_file);
+	}
+	log.print_summary(stderr);
+	for(int address = 1; address <= crd514_kd_bus::SLAVES; address++)
+	{
+		crd514_kd_slave& s = bus.get_slave(address);
+		fprintf(stderr, "  slave %d: %lu motions, %lu alarms, position %d steps\n",
+			address, s.get_motion_count(), s.get_alarm_count(), s.get_position(t));
+	}
+
+	if(log_file != NULL && log_file != stdout)
+	{
+		fclose(log_file);
+	}
+	if(link_path != NULL)
+	{
+		unlink(link_path);
+	}
+	close(slave);
+	close(master);
+	return 0;
+}
@@ -0,0 +1,102 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        crd514_kd_emulator
+// File:           rtu.cpp
+// Description:    modbus rtu framing
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <crd514_kd_emulator/rtu.h>
+
+namespace crd514_kd_emulator
+{
+    namespace rtu
+    {
+        uint16_t crc16(const uint8_t* data, size_t length)
+        {
+            uint16_t crc = 0xFFFF;
+            for(size_t i = 0; i < length; i++)
+            {
+                crc ^= data[i];
+                for(int bit = 0; bit < 8; bit++)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+                }
+            }
+            return crc;
+        }
+
+        bool check_crc(const uint8_t* data, size_t length)
+        {
+            if(length < 4)
+            {
+                return false;
+            }
+            uint16_t crc = crc16(data, length - 2);
+            return data[length - 2] == (crc & 0xFF) && data[length - 1] == (crc >> 8);
+        }
+
+        void append_crc(std::vector<uint8_t>& frame)
+        {
+            uint16_t crc = crc16(&frame[0], frame.size());
+            frame.push_back((uint8_t)(crc & 0xFF));
+            frame.push_back((uint8_t)(crc >> 8));
+        }
+
+        int request_length(const uint8_t* data, size_t length)
+        {
+            if(length < 2)
+            {
+                return 0;
+            }
+
+            switch(data[1])
+            {
+                case READ_HOLDING_REGISTERS:
+                case WRITE_SINGLE_REGISTER:
+                case DIAGNOSTICS:
+                    return 8;
+
+                case WRITE_MULTIPLE_REGISTERS:
+                    //address, function, first register, quantity, byte count, data, crc
+                    return length < 7 ? 0 : 9 + data[6];
+
+                default:
+                    return -1;
+            }
+        }
+
+        double frame_time(size_t bytes, long baudrate)
+        {
+            return bytes * 10.0 / baudrate;
+        }
+    }
+}
@@ -0,0 +1,156 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer
+// File:           dispatch_stats.h
+// Description:    dispatch latency statistics of the motion thread
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+
+namespace huniplacer
+{
+	/**
+	 * @brief fixed size statistics of a latency, in microseconds
+	 *
+	 * adding a sample never allocates, so it can be used from the motion thread.
+	 **/
+    class latency_stats
+    {
+        public:
+            enum
+            {
+                /// @brief bucket i counts latencies in [2^(i-1), 2^i) us, bucket 0 counts 0 us, the last bucket everything above
+                BUCKETS = 24
+            };
+
+            unsigned long count;
+            long long min_us;
+            long long max_us;
+            double sum_us;
+            double sum_sq_us;
+            unsigned long histogram[BUCKETS];
+
+            latency_stats(void)
+            {
+                reset();
+            }
+
+            void reset(void)
+            {
+                count = 0;
+                min_us = 0;
+                max_us = 0;
+                sum_us = 0;
+                sum_sq_us = 0;
+                memset(histogram, 0, sizeof(histogram));
+            }
+
+            void add(long long us)
+            {
+                if(us < 0)
+                {
+                    us = 0;
+                }
+                if(count == 0 || us < min_us) { min_us = us; }
+                if(count == 0 || us > max_us) { max_us = us; }
+                count++;
+                sum_us += us;
+                sum_sq_us += (double)us * us;
+
+                int bucket = 0;
+                while(us > 0 && bucket < BUCKETS - 1)
+                {
+                    us >>= 1;
+                    bucket++;
+                }
+                histogram[bucket]++;
+            }
+
+            double mean(void) const
+            {
+                return count == 0 ? 0 : sum_us / count;
+            }
+
+            /**
+             * @brief the jitter of the latency
+             * @return standard deviation in microseconds
+             **/
+            double jitter(void) const
+            {
+                if(count == 0)
+                {
+                    return 0;
+                }
+                double m = mean();
+                double variance = sum_sq_us / count - m * m;
+                return variance > 0 ? sqrt(variance) : 0;
+            }
+
+            /**
+             * @brief estimate a percentile from the histogram
+             * @param p fraction (0-1)
+             * @return upper bound of the bucket that holds the percentile, in microseconds
+             **/
+            long long percentile(double p) const
+            {
+                unsigned long target = (unsigned long)ceil(p * count);
+                unsigned long seen = 0;
+                for(int i = 0; i < BUCKETS; i++)
+                {
+                    seen += histogram[i];
+                    if(seen >= target && seen > 0)
+                    {
+                        long long upper = i == 0 ? 0 : (1LL << i) - 1;
+                        return upper < max_us ? upper : max_us;
+                    }
+                }
+                return max_us;
+            }
+    };
+
+    /**
+     * @brief timing of the motions dispatched by steppermotor3's motion thread
+     **/
+    struct dispatch_stats
+    {
+        /// @brief from the moment a motion could be taken (pushed and the previous motion started) until the motion thread took it
+        latency_stats pickup;
+
+        /// @brief from the moment all motor controllers reported ready until START was broadcast, this is the dwell time added between two motions
+        latency_stats start;
+
+        /// @brief number of milliseconds moveto waited because the motion ring was full
+        unsigned long ring_full;
+
+        dispatch_stats(void) : pickup(), start(), ring_full(0) { }
+    };
+}
@@ -43,7 +43,10 @@
 #include <huniplacer/modbus_ctrl.h>
 #include <huniplacer/modbus_exception.h>
 #include <huniplacer/motion.h>
+#include <huniplacer/motion_ring.h>
+#include <huniplacer/dispatch_stats.h>
 #include <huniplacer/point3.h>
 #include <huniplacer/steppermotor3.h>
+#include <huniplacer/simulated_motor3.h>
 #include <huniplacer/motor3_exception.h>
 #include <huniplacer/effector_boundaries.h>
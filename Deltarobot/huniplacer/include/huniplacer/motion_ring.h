@@ -0,0 +1,160 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer
+// File:           motion_ring.h
+// Description:    lock-free single producer single consumer ring of motions
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <huniplacer/motion.h>
+
+namespace huniplacer
+{
+	/// @brief a motion together with the time it was handed to the motion thread
+    struct timed_motion
+    {
+        motionf mf;
+        /// @brief utils::time_now_us() when the motion was pushed
+        long long pushed_us;
+    };
+
+    /**
+     * @brief lock-free ring of motions for exactly one producer and one consumer thread
+     *
+     * all slots are allocated by the constructor, push and pop never allocate, lock or block.
+     * both indices only grow, the slot of an index is index & mask.
+     * uses gcc's __sync_synchronize as memory barrier.
+     **/
+    class motion_ring
+    {
+        private:
+            std::vector<timed_motion> slots;
+            size_t mask;
+
+            /// @brief only written by the producer
+            volatile size_t write_index;
+            /// @brief only written by the consumer
+            volatile size_t read_index;
+
+            /// @brief written by the producer, the consumer skips to it
+            volatile size_t discard_index;
+            volatile unsigned long discard_requests;
+            /// @brief only written by the consumer
+            volatile unsigned long discards_handled;
+
+        public:
+            /**
+             * @brief constructor
+             * @param capacity number of motions, rounded up to a power of 2
+             **/
+            motion_ring(size_t capacity) :
+                slots(), mask(0),
+                write_index(0), read_index(0),
+                discard_index(0), discard_requests(0), discards_handled(0)
+            {
+                size_t size = 1;
+                while(size < capacity)
+                {
+                    size <<= 1;
+                }
+                slots.resize(size);
+                mask = size - 1;
+            }
+
+            /**
+             * @brief add a motion, called by the producer only
+             * @return false if the ring is full
+             **/
+            bool push(const timed_motion& tm)
+            {
+                size_t w = write_index;
+                if(w - read_index > mask)
+                {
+                    return false;
+                }
+                slots[w & mask] = tm;
+                __sync_synchronize(); //slot before index
+                write_index = w + 1;
+                return true;
+            }
+
+            /**
+             * @brief take the oldest motion, called by the consumer only
+             * @param tm output parameter, the motion gets stored here
+             * @return false if the ring is empty
+             **/
+            bool pop(timed_motion& tm)
+            {
+                unsigned long requests = discard_requests;
+                if(requests != discards_handled)
+                {
+                    __sync_synchronize(); //request before index
+                    size_t d = discard_index;
+                    if(d > read_index)
+                    {
+                        read_index = d;
+                    }
+                    discards_handled = requests;
+                }
+
+                size_t r = read_index;
+                if(r == write_index)
+                {
+                    return false;
+                }
+                __sync_synchronize(); //index before slot
+                tm = slots[r & mask];
+                __sync_synchronize(); //slot before index
+                read_index = r + 1;
+                return true;
+            }
+
+            /**
+             * @brief drop all motions pushed so far, called by the producer only
+             * @note the consumer drops them on its next pop
+             **/
+            void discard(void)
+            {
+                discard_index = write_index;
+                __sync_synchronize(); //index before request
+                discard_requests = discard_requests + 1;
+            }
+
+            bool empty(void) const
+            {
+                return read_index == write_index;
+            }
+
+            inline size_t capacity(void) const { return mask + 1; }
+    };
+}
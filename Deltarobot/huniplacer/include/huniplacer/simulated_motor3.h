@@ -0,0 +1,267 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer
+// File:           simulated_motor3.h
+// Description:    timing model of the 3 steppermotors and their modbus rtu bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+#include <boost/thread.hpp>
+
+#include <huniplacer/motion.h>
+#include <huniplacer/imotor3.h>
+#include <huniplacer/CRD514_KD.h>
+
+namespace huniplacer
+{
+    /**
+     * @brief settings of simulated_motor3
+     **/
+    struct simulation_config
+    {
+        /// @brief simulated seconds per real second, 0 runs as fast as possible
+        double time_scale;
+        /// @brief bits per second of the simulated rs485 bus (8N1, 10 bits per byte)
+        long baudrate;
+        /// @brief seconds a slave takes before it answers a request
+        double response_delay;
+        /// @brief seconds a broadcast blocks the bus, libmodbus waits the whole response timeout for an answer that never comes
+        double broadcast_wait;
+
+        simulation_config(double time_scale = 1, long baudrate = crd514_kd::rtu_config::BAUDRATE,
+            double response_delay = 0, double broadcast_wait = 0.150) :
+            time_scale(time_scale), baudrate(baudrate), response_delay(response_delay), broadcast_wait(broadcast_wait) { }
+    };
+
+    /**
+     * @brief timeline of one motion executed by simulated_motor3, times in simulated seconds
+     **/
+    struct simulated_move
+    {
+        unsigned long index;
+        /// @brief moveto was called
+        double queued;
+        /// @brief the motion thread took the motion and started writing it
+        double dispatched;
+        /// @brief the motor controllers reported ready for the motion
+        double ready;
+        /// @brief the START broadcast reached the motor controllers
+        double start;
+        /// @brief the motion thread finished the CMD_1 broadcasts and can take the next motion
+        double released;
+        /// @brief the last motor stopped
+        double end;
+
+        double from[3];
+        double to[3];
+        /// @brief speed, acceleration and deceleration as the motor controllers execute them (rad/s, rad/s^2)
+        double speed[3];
+        double acceleration[3];
+        double deceleration[3];
+        /// @brief time each motor stopped
+        double axis_end[3];
+
+        /// @brief modbus frames (requests and responses) sent to execute the motion
+        unsigned int frames;
+        /// @brief the motion was cut short or dropped by stop()
+        bool stopped;
+    };
+
+    /**
+     * @brief implementation of imotor3 that simulates the timing of steppermotor3 instead of moving motors
+     *
+     * every motion is planned the moment it is pushed: the modbus frames steppermotor3 would send
+     * (register writes that are not shadowed, STATUS_1 polls until the previous motion is done and the
+     * CMD_1 broadcasts) are timed at the configured baudrate with the write intervals of modbus_ctrl,
+     * after which every motor follows a trapezoidal (or triangular) speed profile. wait_for_idle sleeps
+     * until the simulated clock passes the end of the motions, or advances the clock at once when
+     * time_scale is 0. the simulated motors have no deviation, the angles are the angles of the motors.
+     **/
+    class simulated_motor3 : public imotor3
+    {
+        private:
+            simulation_config config;
+            double min_angle;
+            double max_angle;
+            volatile bool powered_on;
+
+            boost::mutex state_mutex;
+
+            /// @brief simulated seconds at wall_start
+            double clock_offset;
+            long long wall_start;
+
+            /// @brief angles of the last pushed motion
+            double planned_angles[3];
+            /// @brief time each motor finishes the last pushed motion
+            double axis_end[3];
+            /// @brief time the motion thread finishes the last pushed motion
+            double executor_free;
+            /// @brief earliest time modbus_ctrl allows the next request
+            double bus_free;
+            unsigned long frame_count;
+
+            /// @brief 32-bit register values as the motor controllers have them, by slave << 16 | address
+            std::map<uint32_t, uint32_t> shadow_registers;
+
+            std::vector<simulated_move> timeline;
+            unsigned long move_count;
+
+            /**
+             * @brief bus state from before a motion that waits for the motion thread,
+             * restored when stop() drops the motion before any of its frames were sent
+             **/
+            struct pending_move
+            {
+                unsigned long index;
+                /// @brief when the motion thread takes the motion
+                double dispatched;
+                double bus_free;
+                unsigned long frame_count;
+                std::map<uint32_t, uint32_t> shadow_registers;
+            };
+            std::deque<pending_move> pending;
+
+            /// @note needs state_mutex to be locked
+            double now(void);
+
+            /**
+             * @brief sleeps until the simulated clock reaches target, or advances the clock to target when time_scale is 0
+             * @param timeout milliseconds of real time (0 means infinite)
+             * @return false if timed out, true otherwise
+             * @note locks state_mutex
+             **/
+            bool wait_until(double target, long timeout);
+
+            /// @brief seconds a frame of the given size takes, including the silence that ends it
+            double frame_time(unsigned int bytes) const;
+
+            /**
+             * @brief a request answered by a slave
+             * @return the time the response was received
+             **/
+            double bus_unicast(double t, unsigned int request_bytes, unsigned int response_bytes, unsigned int& frames);
+
+            /**
+             * @brief a request sent to all slaves
+             * @param received output parameter, the time the slaves received the request
+             * @return the time modbus_ctrl returns
+             **/
+            double bus_broadcast(double t, double& received, unsigned int& frames);
+
+            /// @brief the write steppermotor3 does with modbus_ctrl::write_u32
+            double bus_write_u32(double t, crd514_kd::slaves::t slave, uint16_t address, uint32_t value, bool use_shadow, unsigned int& frames);
+
+            /**
+             * @brief the STATUS_1 polls of steppermotor3::wait_till_ready
+             * @return the time all motors reported ready
+             **/
+            double bus_wait_till_ready(double t, unsigned int& frames);
+
+            /**
+             * @brief plans a motion behind the motions that were pushed before it
+             * @note needs state_mutex to be locked
+             **/
+            void push_motion(const motionf& mf);
+
+            /// @brief angle of a motor at time t, while executing move
+            static double position(const simulated_move& move, int axis, double t);
+
+            /**
+             * @brief the time a motor takes for a motion
+             * @param peak output parameter, the highest speed reached
+             **/
+            static double profile_time(double distance, double speed, double acceleration, double deceleration, double& peak);
+
+        public:
+            simulated_motor3(double min_angle, double max_angle, const simulation_config& config = simulation_config());
+            virtual ~simulated_motor3(void);
+
+            void moveto(const motionf& mf, bool async = true);
+            void moveto_within(const motionf& mf, double time, bool async);
+
+            /**
+             * @brief stops the motors where they are at the end of the STOP broadcast and drops the motions that were not started
+             **/
+            void stop(void);
+
+            /**
+             * @brief waits like steppermotor3::wait_for_idle: returns at once if the motion thread is idle,
+             * otherwise polls STATUS_1 until the motors are ready once the motion thread is done
+             * @param timeout milliseconds of real time, ignored when time_scale is 0
+             **/
+            bool wait_for_idle(long timeout = 0);
+
+            /// @return true if the motion thread is idle and the motors stand still
+            bool is_idle(void);
+
+            void power_off(void);
+            void power_on(void);
+            bool is_powerd_on(void);
+            void override_current_angles(double* angles);
+
+            /**
+             * @brief lets time pass on the simulated clock, for work done besides the motors (a gripper for instance)
+             * @param seconds simulated seconds
+             **/
+            void simulate_delay(double seconds);
+
+            /// @brief the simulated clock in seconds, starts at 0
+            double get_time(void);
+
+            /// @brief number of modbus frames sent so far
+            unsigned long get_frame_count(void);
+
+            /**
+             * @brief copies the timeline of the motions pushed so far
+             * @param out output parameter, the motions get stored here
+             **/
+            void get_timeline(std::vector<simulated_move>& out);
+
+            /**
+             * @brief writes the timeline of the motions pushed so far as csv, one line per motion
+             * @param out the stream that is written to
+             **/
+            void write_timeline(std::ostream& out);
+
+            void clear_timeline(void);
+
+            inline double get_min_angle(void) const { return min_angle; }
+            inline double get_max_angle(void) const { return max_angle; }
+    };
+}
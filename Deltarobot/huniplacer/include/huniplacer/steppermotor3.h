@@ -35,9 +35,12 @@
 #pragma once
 
 #include <queue>
+#include <semaphore.h>
 #include <boost/thread.hpp>
 
 #include <huniplacer/motion.h>
+#include <huniplacer/motion_ring.h>
+#include <huniplacer/dispatch_stats.h>
 #include <huniplacer/modbus_exception.h>
 #include <huniplacer/modbus_ctrl.h>
 #include <huniplacer/imotor3.h>
@@ -47,11 +50,31 @@ namespace huniplacer
 	/// @brief exception handler to which modbus_exception's will be passed that occur in motion_thread
     typedef void (*motion_thread_exception_handler)(std::exception& ex);
 
+    /**
+     * @brief settings of the real-time motion executor of steppermotor3
+     *
+     * the executor takes motions from a preallocated lock-free ring instead of the mutex protected queue,
+     * and does not allocate or print between two motions. it does lock modbus_mutex for every motion
+     * (only contended by stop and wait_for_idle) and idle_mutex when the ring runs empty.
+     **/
+    struct realtime_executor_config
+    {
+        /// @brief number of motions the ring holds, rounded up to a power of 2
+        size_t ring_size;
+        /// @brief SCHED_FIFO priority (1-99) of the motion thread, 0 keeps the default scheduler
+        int priority;
+        /// @brief lock all current and future pages of the process in memory (mlockall)
+        bool lock_memory;
+
+        realtime_executor_config(size_t ring_size = 256, int priority = 0, bool lock_memory = false) :
+            ring_size(ring_size), priority(priority), lock_memory(lock_memory) { }
+    };
+
     /// @brief implementation of imotor3 for steppermotors
     class steppermotor3 : public imotor3
     {
         private:
-            std::queue<motionf> motion_queue;
+            std::queue<timed_motion> motion_queue;
             bool thread_running;
             double current_angles[3];
             double deviation[3];
@@ -73,6 +96,21 @@ namespace huniplacer
             
             volatile bool powered_on;
 
+            /// @brief NULL unless the real-time executor is used
+            motion_ring* ring;
+            /// @brief posted for every motion pushed into ring
+            sem_t ring_sem;
+            int realtime_priority;
+            volatile bool realtime_active;
+            volatile unsigned long ring_full_count;
+
+            /// @brief only used by the motion thread
+            dispatch_stats stats;
+            /// @brief copy of stats for other threads, guarded by stats_sequence (odd while written)
+            dispatch_stats published_stats;
+            volatile unsigned long stats_sequence;
+            volatile bool stats_reset_requested;
+
             /**
              * @brief function passed to motion_thread
              * @param owner pointer to object that start the thread
@@ -81,6 +119,35 @@ namespace huniplacer
              * @note signals queue_empty_flag
              **/
             static void motion_thread_func(steppermotor3* owner);
+
+            /**
+             * @brief function passed to motion_thread when the real-time executor is used
+             * @param owner pointer to object that start the thread
+             * @note waits on ring_sem when the ring is empty
+             * @note signals idle_cond when the ring becomes empty
+             * @note locks modbus_mutex for every motion and idle_mutex when the ring becomes empty
+             **/
+            static void realtime_thread_func(steppermotor3* owner);
+
+            /**
+             * @brief writes a motion to the motor controllers and starts it once they are ready
+             * @note needs modbus_mutex to be locked
+             * @return microseconds between the controllers reporting ready and the START broadcast
+             **/
+            long long dispatch_motion(motioni& mi);
+
+            /**
+             * @brief adds the latencies of a dispatched motion to stats and publishes them
+             * @param pickup_us see dispatch_stats::pickup
+             * @param start_us see dispatch_stats::start, negative if the motion was not started
+             **/
+            void record_dispatch(long long pickup_us, long long start_us);
+
+            /**
+             * @brief hands a motion to the motion thread
+             * @note waits while the ring of the real-time executor is full
+             **/
+            void push_motion(const motionf& mf);
         
             void wait_till_ready(void);
             
@@ -92,7 +159,11 @@ namespace huniplacer
             void motion_float_to_int(motioni& mi, const motionf& mf);
         
         public:
-            steppermotor3(modbus_t* context, double min_angle, double max_angle, motion_thread_exception_handler exhandler, const double* deviation);
+            /**
+             * @brief constructor
+             * @param executor settings of the real-time executor, NULL to use the mutex protected motion queue
+             **/
+            steppermotor3(modbus_t* context, double min_angle, double max_angle, motion_thread_exception_handler exhandler, const double* deviation, const realtime_executor_config* executor = NULL);
             virtual ~steppermotor3(void);
             
             /**
@@ -127,6 +198,24 @@ namespace huniplacer
 
             bool is_powerd_on(void);
 
+            /**
+             * @brief copies the dispatch timing of the motions executed so far
+             * @param out output parameter, the statistics get stored here
+             * @note never blocks the motion thread
+             **/
+            void get_dispatch_stats(dispatch_stats& out);
+
+            /**
+             * @brief clears the dispatch timing, takes effect at the next dispatched motion
+             **/
+            void reset_dispatch_stats(void);
+
+            /// @brief true if the real-time executor is used
+            inline bool is_realtime(void) const { return ring != NULL; }
+
+            /// @brief true if the motion thread runs with the requested SCHED_FIFO priority
+            inline bool is_realtime_scheduled(void) const { return realtime_active; }
+
             inline double get_min_angle(void) const { return min_angle; }
             inline double get_max_angle(void) const { return max_angle; }
             void set_min_angle(double min_angle);
@@ -52,6 +52,12 @@ namespace huniplacer
     	 **/
         long time_now(void);
 
+        /**
+         * @brief get the time of a monotonic clock in microseconds
+         * @return time in microseconds, only meaningful compared to other calls
+         **/
+        long long time_now_us(void);
+
         /**
          * @brief sleep for X milliseconds
          * @param ms time in milliseconds
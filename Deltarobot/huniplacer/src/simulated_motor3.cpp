@@ -0,0 +1,622 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer
+// File:           simulated_motor3.cpp
+// Description:    timing model of the 3 steppermotors and their modbus rtu bus
+// Author:         agent
+// Notes:          -
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+
+
+#include <huniplacer/simulated_motor3.h>
+#include <huniplacer/motor3_exception.h>
+#include <huniplacer/utils.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+namespace huniplacer
+{
+    namespace
+    {
+        //same as modbus_ctrl
+        const double WRITE_INTERVAL_UNICAST = 0.008;
+        const double WRITE_INTERVAL_BROADCAST = 0.016;
+
+        //rtu frame sizes in bytes, including address and crc
+        enum
+        {
+            WRITE_REGISTER_SIZE = 8,   //function 6, request and response
+            WRITE_REGISTERS_SIZE = 13, //function 16 with 2 registers, request
+            WRITE_REGISTERS_RESPONSE_SIZE = 8,
+            READ_REGISTER_SIZE = 8,    //function 3 with 1 register, request
+            READ_REGISTER_RESPONSE_SIZE = 7
+        };
+
+        //operating speed range of the crd514-kd in steps per second
+        const double MIN_STEP_SPEED = 1;
+        const double MAX_STEP_SPEED = 500000;
+
+        double clamp(double value, double min, double max)
+        {
+            //also catches nan, which is what moveto_within gives for a motion that doesn't move
+            if(!(value >= min))
+            {
+                return min;
+            }
+            return value > max ? max : value;
+        }
+    }
+
+    simulated_motor3::simulated_motor3(double min_angle, double max_angle, const simulation_config& config) :
+        config(config),
+        min_angle(min_angle),
+        max_angle(max_angle),
+        powered_on(false),
+        clock_offset(0),
+        wall_start(utils::time_now_us()),
+        executor_free(0),
+        bus_free(0),
+        frame_count(0),
+        shadow_registers(),
+        timeline(),
+        move_count(0),
+        pending()
+    {
+        for(int i = 0; i < 3; i++)
+        {
+            planned_angles[i] = 0;
+            axis_end[i] = 0;
+        }
+    }
+
+    simulated_motor3::~simulated_motor3(void)
+    {
+    }
+
+    double simulated_motor3::now(void)
+    {
+        if(config.time_scale > 0)
+        {
+            return clock_offset + (utils::time_now_us() - wall_start) * 1e-6 * config.time_scale;
+        }
+        return clock_offset;
+    }
+
+    bool simulated_motor3::wait_until(double target, long timeout)
+    {
+        if(config.time_scale <= 0)
+        {
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            clock_offset = std::max(clock_offset, target);
+            return true;
+        }
+
+        long long timeout_end = utils::time_now_us() + (long long)timeout * 1000;
+        while(true)
+        {
+            long long remaining_us;
+            {
+                boost::lock_guard<boost::mutex> lock(state_mutex);
+                remaining_us = (long long)((target - now()) / config.time_scale * 1e6);
+            }
+            if(remaining_us <= 0)
+            {
+                return true;
+            }
+            if(timeout > 0)
+            {
+                long long left_us = timeout_end - utils::time_now_us();
+                if(left_us <= 0)
+                {
+                    return false;
+                }
+                remaining_us = std::min(remaining_us, left_us);
+            }
+            boost::this_thread::sleep(boost::posix_time::microseconds(remaining_us));
+        }
+    }
+
+    double simulated_motor3::frame_time(unsigned int bytes) const
+    {
+        //8N1: 10 bits per byte, a frame ends with 3.5 characters of silence
+        return (bytes + 3.5) * 10.0 / config.baudrate;
+    }
+
+    double simulated_motor3::bus_unicast(double t, unsigned int request_bytes, unsigned int response_bytes, unsigned int& frames)
+    {
+        double begin = std::max(t, bus_free);
+        double end = begin + frame_time(request_bytes) + config.response_delay + frame_time(response_bytes);
+        bus_free = end + WRITE_INTERVAL_UNICAST;
+        frames += 2;
+        frame_count += 2;
+        return end;
+    }
+
+    double simulated_motor3::bus_broadcast(double t, double& received, unsigned int& frames)
+    {
+        double begin = std::max(t, bus_free);
+        received = begin + frame_time(WRITE_REGISTER_SIZE);
+        double end = received + config.broadcast_wait;
+        bus_free = end + WRITE_INTERVAL_BROADCAST;
+        frames += 1;
+        frame_count += 1;
+        return end;
+    }
+
+    double simulated_motor3::bus_write_u32(double t, crd514_kd::slaves::t slave, uint16_t address, uint32_t value, bool use_shadow, unsigned int& frames)
+    {
+        uint32_t key = ((uint32_t)slave << 16) | address;
+        if(use_shadow)
+        {
+            std::map<uint32_t, uint32_t>::iterator it = shadow_registers.find(key);
+            if(it != shadow_registers.end())
+            {
+                bool skip_up = (it->second >> 16) == (value >> 16);
+                bool skip_lo = (it->second & 0xFFFF) == (value & 0xFFFF);
+                if(skip_up && skip_lo)
+                {
+                    return t;
+                }
+                else if(skip_up || skip_lo) //write only one half
+                {
+                    it->second = value;
+                    return bus_unicast(t, WRITE_REGISTER_SIZE, WRITE_REGISTER_SIZE, frames);
+                }
+            }
+            shadow_registers[key] = value;
+        }
+        return bus_unicast(t, WRITE_REGISTERS_SIZE, WRITE_REGISTERS_RESPONSE_SIZE, frames);
+    }
+
+    double simulated_motor3::bus_wait_till_ready(double t, unsigned int& frames)
+    {
+        const double poll_period =
+            frame_time(READ_REGISTER_SIZE) + config.response_delay + frame_time(READ_REGISTER_RESPONSE_SIZE) + WRITE_INTERVAL_UNICAST;
+
+        for(int i = 0; i < 3; i++)
+        {
+            //a controller answers not ready to the polls it receives before its motor stops
+            double begin = std::max(t, bus_free);
+            double received = begin + frame_time(READ_REGISTER_SIZE);
+            if(received < axis_end[i])
+            {
+                unsigned long polls = (unsigned long)ceil((axis_end[i] - received) / poll_period);
+                bus_free = begin + polls * poll_period;
+                frames += 2 * polls;
+                frame_count += 2 * polls;
+            }
+            t = bus_unicast(t, READ_REGISTER_SIZE, READ_REGISTER_RESPONSE_SIZE, frames);
+        }
+        return t;
+    }
+
+    double simulated_motor3::profile_time(double distance, double speed, double acceleration, double deceleration, double& peak)
+    {
+        if(distance <= 0)
+        {
+            peak = 0;
+            return 0;
+        }
+
+        double acc_distance = speed * speed / (2 * acceleration);
+        double dec_distance = speed * speed / (2 * deceleration);
+        if(acc_distance + dec_distance <= distance)
+        {
+            //trapezoid: accelerate, cruise at speed, decelerate
+            peak = speed;
+            return speed / acceleration + (distance - acc_distance - dec_distance) / speed + speed / deceleration;
+        }
+
+        //triangle: the motor has to decelerate before it reaches speed
+        peak = sqrt(2 * distance * acceleration * deceleration / (acceleration + deceleration));
+        return peak / acceleration + peak / deceleration;
+    }
+
+    double simulated_motor3::position(const simulated_move& move, int axis, double t)
+    {
+        double distance = fabs(move.to[axis] - move.from[axis]);
+        double direction = move.to[axis] < move.from[axis] ? -1 : 1;
+        double acceleration = move.acceleration[axis];
+        double deceleration = move.deceleration[axis];
+
+        double peak;
+        double duration = profile_time(distance, move.speed[axis], acceleration, deceleration, peak);
+        double elapsed = t - move.start;
+        if(elapsed <= 0)
+        {
+            return move.from[axis];
+        }
+        if(elapsed >= duration)
+        {
+            return move.to[axis];
+        }
+
+        double acc_time = peak / acceleration;
+        double dec_time = peak / deceleration;
+        double travelled;
+        if(elapsed < acc_time)
+        {
+            travelled = 0.5 * acceleration * elapsed * elapsed;
+        }
+        else if(elapsed < duration - dec_time)
+        {
+            travelled = 0.5 * acceleration * acc_time * acc_time + peak * (elapsed - acc_time);
+        }
+        else
+        {
+            double remaining = duration - elapsed;
+            travelled = distance - 0.5 * deceleration * remaining * remaining;
+        }
+        return move.from[axis] + direction * travelled;
+    }
+
+    void simulated_motor3::push_motion(const motionf& mf)
+    {
+        static const crd514_kd::slaves::t slaves[] =
+            { crd514_kd::slaves::MOTOR_1, crd514_kd::slaves::MOTOR_2, crd514_kd::slaves::MOTOR_3 };
+
+        simulated_move move;
+        move.index = move_count++;
+        move.queued = now();
+        move.dispatched = std::max(move.queued, executor_free);
+        move.frames = 0;
+        move.stopped = false;
+
+        //drop the saved bus state of motions the motion thread has taken
+        while(!pending.empty() && pending.front().dispatched <= move.queued)
+        {
+            pending.pop_front();
+        }
+        if(move.dispatched > move.queued)
+        {
+            pending_move saved;
+            saved.index = move.index;
+            saved.dispatched = move.dispatched;
+            saved.bus_free = bus_free;
+            saved.frame_count = frame_count;
+            saved.shadow_registers = shadow_registers;
+            pending.push_back(saved);
+        }
+
+        //the values steppermotor3::motion_float_to_int gives the motor controllers
+        int32_t position[3];
+        uint32_t speed[3];
+        uint32_t acceleration[3];
+        uint32_t deceleration[3];
+        for(int i = 0; i < 3; i++)
+        {
+            position[i] = (int32_t)(mf.angles[i] / crd514_kd::MOTOR_STEP_ANGLE);
+            speed[i] = (uint32_t)clamp(mf.speed[i] / crd514_kd::MOTOR_STEP_ANGLE, MIN_STEP_SPEED, MAX_STEP_SPEED);
+            acceleration[i] = (uint32_t)clamp(crd514_kd::MOTOR_STEP_ANGLE * 1000000000.0 / mf.acceleration[i], 1, 0xFFFFFFFFu);
+            deceleration[i] = (uint32_t)clamp(crd514_kd::MOTOR_STEP_ANGLE * 1000000000.0 / mf.deceleration[i], 1, 0xFFFFFFFFu);
+        }
+
+        //the writes of steppermotor3::dispatch_motion, speed and position of motor 2 are not shadowed
+        double t = move.dispatched;
+        for(int i = 0; i < 3; i++)
+        {
+            bool use_shadow = slaves[i] != crd514_kd::slaves::MOTOR_2;
+            t = bus_write_u32(t, slaves[i], crd514_kd::registers::OP_SPEED, speed[i], use_shadow, move.frames);
+            t = bus_write_u32(t, slaves[i], crd514_kd::registers::OP_POS, (uint32_t)position[i], use_shadow, move.frames);
+            t = bus_write_u32(t, slaves[i], crd514_kd::registers::OP_ACC, acceleration[i], true, move.frames);
+            t = bus_write_u32(t, slaves[i], crd514_kd::registers::OP_DEC, deceleration[i], true, move.frames);
+        }
+
+        move.ready = bus_wait_till_ready(t, move.frames);
+        t = bus_broadcast(move.ready, move.start, move.frames); //EXCITEMENT_ON
+        t = bus_broadcast(t, move.start, move.frames);          //EXCITEMENT_ON | START
+        double received;
+        move.released = bus_broadcast(t, received, move.frames); //EXCITEMENT_ON
+        executor_free = move.released;
+
+        move.end = move.start;
+        for(int i = 0; i < 3; i++)
+        {
+            move.from[i] = planned_angles[i];
+            move.to[i] = position[i] * crd514_kd::MOTOR_STEP_ANGLE;
+            move.speed[i] = speed[i] * crd514_kd::MOTOR_STEP_ANGLE;
+            move.acceleration[i] = crd514_kd::MOTOR_STEP_ANGLE * 1000000000.0 / acceleration[i];
+            move.deceleration[i] = crd514_kd::MOTOR_STEP_ANGLE * 1000000000.0 / deceleration[i];
+
+            double peak;
+            move.axis_end[i] = move.start +
+                profile_time(fabs(move.to[i] - move.from[i]), move.speed[i], move.acceleration[i], move.deceleration[i], peak);
+            move.end = std::max(move.end, move.axis_end[i]);
+
+            axis_end[i] = move.axis_end[i];
+            planned_angles[i] = move.to[i];
+        }
+
+        timeline.push_back(move);
+    }
+
+    void simulated_motor3::moveto(const motionf& mf, bool async)
+    {
+        if(!powered_on)
+        {
+            throw motor3_exception("motor drivers are not powered on");
+        }
+
+        if(mf.angles[0] <= min_angle || mf.angles[1] <= min_angle || mf.angles[2] <= min_angle ||
+           mf.angles[0] >= max_angle || mf.angles[1] >= max_angle || mf.angles[2] >= max_angle)
+        {
+            throw std::out_of_range("one or more angles out of range");
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            push_motion(mf);
+        }
+
+        if(!async)
+        {
+            wait_for_idle();
+        }
+    }
+
+    void simulated_motor3::moveto_within(const motionf& mf, double time, bool async)
+    {
+        if(!powered_on)
+        {
+            throw motor3_exception("motor drivers are not powered on");
+        }
+
+        if(mf.angles[0] <= min_angle || mf.angles[1] <= min_angle || mf.angles[2] <= min_angle ||
+           mf.angles[0] >= max_angle || mf.angles[1] >= max_angle || mf.angles[2] >= max_angle)
+        {
+            throw std::out_of_range("one or more angles out of range");
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            motionf newmf = mf;
+            newmf.speed[0] = fabs(planned_angles[0] - mf.angles[0]) / time;
+            newmf.speed[1] = fabs(planned_angles[1] - mf.angles[1]) / time;
+            newmf.speed[2] = fabs(planned_angles[2] - mf.angles[2]) / time;
+            push_motion(newmf);
+        }
+
+        if(!async)
+        {
+            wait_for_idle();
+        }
+    }
+
+    void simulated_motor3::stop(void)
+    {
+        if(!powered_on)
+        {
+            throw motor3_exception("motor drivers are not powered on");
+        }
+
+        boost::unique_lock<boost::mutex> lock(state_mutex);
+        double t = now();
+
+        //the motions the motion thread did not take yet are dropped, their frames were never sent
+        size_t first_dropped = timeline.size();
+        while(first_dropped > 0 && timeline[first_dropped - 1].dispatched > t)
+        {
+            first_dropped--;
+        }
+        if(first_dropped < timeline.size())
+        {
+            while(!pending.empty() && pending.front().index < timeline[first_dropped].index)
+            {
+                pending.pop_front();
+            }
+            if(!pending.empty() && pending.front().index == timeline[first_dropped].index)
+            {
+                bus_free = pending.front().bus_free;
+                frame_count = pending.front().frame_count;
+                shadow_registers = pending.front().shadow_registers;
+            }
+            for(int i = 0; i < 3; i++)
+            {
+                planned_angles[i] = timeline[first_dropped].from[i];
+            }
+            timeline.erase(timeline.begin() + first_dropped, timeline.end());
+        }
+        pending.clear();
+
+        //steppermotor3::stop waits for the modbus mutex, which the motion thread holds until it released a motion
+        double issued = t;
+        if(!timeline.empty() && timeline.back().released > t)
+        {
+            issued = timeline.back().released;
+        }
+
+        //STOP, 0, EXCITEMENT_ON
+        unsigned int frames = 0;
+        double stopped_at;
+        double received;
+        double end = bus_broadcast(issued, stopped_at, frames);
+        end = bus_broadcast(end, received, frames);
+        end = bus_broadcast(end, received, frames);
+        executor_free = issued;
+
+        if(!timeline.empty())
+        {
+            simulated_move& move = timeline.back();
+            move.frames += frames;
+            if(move.end > stopped_at)
+            {
+                move.stopped = true;
+                move.end = move.start;
+                for(int i = 0; i < 3; i++)
+                {
+                    if(move.axis_end[i] > stopped_at)
+                    {
+                        move.to[i] = position(move, i, stopped_at);
+                        move.axis_end[i] = stopped_at;
+                    }
+                    move.end = std::max(move.end, move.axis_end[i]);
+                    planned_angles[i] = move.to[i];
+                }
+            }
+        }
+
+        for(int i = 0; i < 3; i++)
+        {
+            axis_end[i] = std::min(axis_end[i], stopped_at);
+        }
+
+        //like steppermotor3, return once the broadcasts are sent
+        lock.unlock();
+        wait_until(end, 0);
+    }
+
+    bool simulated_motor3::wait_for_idle(long timeout)
+    {
+        if(!powered_on)
+        {
+            throw motor3_exception("motor drivers are not powered on");
+        }
+
+        double target;
+        {
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            if(executor_free <= now())
+            {
+                return true;
+            }
+
+            //the motion thread goes idle after it released the last motion, then the motors are polled
+            unsigned int frames = 0;
+            target = bus_wait_till_ready(executor_free, frames);
+            if(!timeline.empty())
+            {
+                timeline.back().frames += frames;
+            }
+        }
+
+        return wait_until(target, timeout);
+    }
+
+    bool simulated_motor3::is_idle(void)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        double t = now();
+        return executor_free <= t && axis_end[0] <= t && axis_end[1] <= t && axis_end[2] <= t;
+    }
+
+    void simulated_motor3::power_off(void)
+    {
+        if(powered_on)
+        {
+            stop();
+            powered_on = false;
+        }
+    }
+
+    void simulated_motor3::power_on(void)
+    {
+        if(!powered_on)
+        {
+            //steppermotor3 clears the position counters of the motor controllers
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            planned_angles[0] = planned_angles[1] = planned_angles[2] = 0;
+            powered_on = true;
+        }
+    }
+
+    bool simulated_motor3::is_powerd_on(void)
+    {
+        return powered_on;
+    }
+
+    void simulated_motor3::override_current_angles(double* angles)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        planned_angles[0] = angles[0];
+        planned_angles[1] = angles[1];
+        planned_angles[2] = angles[2];
+    }
+
+    void simulated_motor3::simulate_delay(double seconds)
+    {
+        if(config.time_scale <= 0)
+        {
+            boost::lock_guard<boost::mutex> lock(state_mutex);
+            clock_offset += seconds;
+            return;
+        }
+        boost::this_thread::sleep(boost::posix_time::microseconds((long long)(seconds / config.time_scale * 1e6)));
+    }
+
+    double simulated_motor3::get_time(void)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        return now();
+    }
+
+    unsigned long simulated_motor3::get_frame_count(void)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        return frame_count;
+    }
+
+    void simulated_motor3::get_timeline(std::vector<simulated_move>& out)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        out = timeline;
+    }
+
+    void simulated_motor3::write_timeline(std::ostream& out)
+    {
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        out << "move,queued,dispatched,ready,start,released,end,"
+               "from1,from2,from3,to1,to2,to3,speed1,speed2,speed3,end1,end2,end3,frames,stopped\n";
+        for(size_t n = 0; n < timeline.size(); n++)
+        {
+            const simulated_move& move = timeline[n];
+            out << move.index << ',' << move.queued << ',' << move.dispatched << ',' << move.ready << ','
+                << move.start << ',' << move.released << ',' << move.end;
+            for(int i = 0; i < 3; i++) { out << ',' << move.from[i]; }
+            for(int i = 0; i < 3; i++) { out << ',' << move.to[i]; }
+            for(int i = 0; i < 3; i++) { out << ',' << move.speed[i]; }
+            for(int i = 0; i < 3; i++) { out << ',' << move.axis_end[i]; }
+            out << ',' << move.frames << ',' << (move.stopped ? 1 : 0) << '\n';
+        }
+    }
+
+    void simulated_motor3::clear_timeline(void)
+    {
+        //motions in progress stay, stop() needs them
+        boost::lock_guard<boost::mutex> lock(state_mutex);
+        double t = now();
+        size_t done = 0;
+        while(done < timeline.size() && timeline[done].released <= t && timeline[done].end <= t)
+        {
+            done++;
+        }
+        timeline.erase(timeline.begin(), timeline.begin() + done);
+    }
+}
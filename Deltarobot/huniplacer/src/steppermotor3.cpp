@@ -37,7 +37,11 @@
 #include <cstdio>
 #include <cmath>
 #include <cstdlib>
+#include <cerrno>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 #include <huniplacer/utils.h>
 #include <huniplacer/CRD514_KD.h>
@@ -46,7 +50,7 @@
 
 namespace huniplacer
 {
-    steppermotor3::steppermotor3(modbus_t* context, double min_angle, double max_angle, motion_thread_exception_handler exhandler, const double* deviation) :
+    steppermotor3::steppermotor3(modbus_t* context, double min_angle, double max_angle, motion_thread_exception_handler exhandler, const double* deviation, const realtime_executor_config* executor) :
         imotor3(),
         motion_queue(),
         thread_running(true),
@@ -57,15 +61,38 @@ namespace huniplacer
         min_angle(min_angle), max_angle(max_angle),
         modbus(context),
         exhandler(exhandler),
-        powered_on(false)
+        powered_on(false),
+        ring(NULL),
+        realtime_priority(0),
+        realtime_active(false),
+        ring_full_count(0),
+        stats(), published_stats(),
+        stats_sequence(0),
+        stats_reset_requested(false)
     {
     	//set deviation
     	this->deviation[0] = deviation[0];
     	this->deviation[1] = deviation[1];
     	this->deviation[2] = deviation[2];
 
-        //start motion thread
-        motion_thread = new boost::thread(motion_thread_func, this);
+    	if(executor == NULL)
+    	{
+    		//start motion thread
+    		motion_thread = new boost::thread(motion_thread_func, this);
+    		return;
+    	}
+
+    	ring = new motion_ring(executor->ring_size);
+    	sem_init(&ring_sem, 0, 0);
+    	realtime_priority = executor->priority;
+
+    	if(executor->lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    	{
+    		fprintf(stderr, "steppermotor3: mlockall failed, memory is not locked\n");
+    	}
+
+    	//start motion thread
+    	motion_thread = new boost::thread(realtime_thread_func, this);
     }
 
     steppermotor3::~steppermotor3(void)
@@ -81,10 +108,21 @@ namespace huniplacer
         {
         }
 
+        if(ring != NULL)
+        {
+        	sem_post(&ring_sem); //wake the real-time executor
+        }
+
         idle_cond.notify_all(); //its destructor will fail if threads are still waiting
         motion_thread->join();
         delete motion_thread;
 
+        if(ring != NULL)
+        {
+        	sem_destroy(&ring_sem);
+        	delete ring;
+        }
+
         if(powered_on)
         {
         	wait_till_ready();
@@ -111,6 +149,7 @@ namespace huniplacer
 
         try
         {
+            long long free_since = time_now_us();
             while(owner->thread_running)
             {
                 owner->queue_mutex.lock();
@@ -118,7 +157,9 @@ namespace huniplacer
                 if(!owner->motion_queue.empty())
                 {
                     //get motion, convert and pop
-                    motionf& mf = owner->motion_queue.front();
+                    timed_motion& tm = owner->motion_queue.front();
+                    long long pickup_us = time_now_us() - std::max(tm.pushed_us, free_since);
+                    motionf& mf = tm.mf;
                     printf("angles: %lf, %lf, %lf\n", mf.angles[0], mf.angles[1], mf.angles[2]);
                     fflush(stdout);
                     motioni mi;
@@ -129,47 +170,20 @@ namespace huniplacer
                     		mi.angles[0], mi.angles[1], mi.angles[2],
                     		mi.speed[0], mi.speed[1], mi.speed[2]
                     );*/
-                    if(mi.speed[0] == 0)
-                    	mi.speed[0] = 1;
-
-                    if(mi.speed[1] == 0)
-                    	mi.speed[1] = 1;
-
-                    if(mi.speed[2] == 0)
-                    	mi.speed[2] = 1;
-
 
                     owner->motion_queue.pop();
                     
                     owner->queue_mutex.unlock();
                     
+                    long long start_us = -1;
                     if(owner->powered_on)
                     {
-
-						//write motion
 						boost::lock_guard<boost::mutex> lock(owner->modbus_mutex);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_SPEED, mi.speed[0], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_POS, mi.angles[0], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_ACC, mi.acceleration[0], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_DEC, mi.deceleration[0], true);
-
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_SPEED, mi.speed[1], false);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_POS, mi.angles[1], false);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_ACC, mi.acceleration[1], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_DEC, mi.deceleration[1], true);
-
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_SPEED, mi.speed[2], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_POS, mi.angles[2], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_ACC, mi.acceleration[2], true);
-						owner->modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_DEC, mi.deceleration[2], true);
-
-						//execute motion
-						owner->wait_till_ready();
-
-						owner->modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON);
-						owner->modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON | crd514_kd::cmd1_bits::START);
-						owner->modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON);
+						start_us = owner->dispatch_motion(mi);
                     }
+
+                    owner->record_dispatch(pickup_us, start_us);
+                    free_since = time_now_us();
                 }
                 else //empty
                 {
@@ -201,6 +215,153 @@ namespace huniplacer
         }
     }
 
+    void steppermotor3::realtime_thread_func(steppermotor3* owner)
+    {
+    	using namespace utils;
+
+    	if(owner->realtime_priority > 0)
+    	{
+    		sched_param param;
+    		param.sched_priority = owner->realtime_priority;
+    		owner->realtime_active = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    		if(!owner->realtime_active)
+    		{
+    			fprintf(stderr, "steppermotor3: SCHED_FIFO priority %d was not granted, using the default scheduler\n", owner->realtime_priority);
+    		}
+    	}
+
+        try
+        {
+        	//nothing between two motions allocates or prints. modbus_mutex is taken per motion,
+        	//it is only contended while stop or wait_for_idle use the bus. idle_mutex is only
+        	//taken when the ring is empty, to set idle without racing push_motion
+            long long free_since = time_now_us();
+            while(owner->thread_running)
+            {
+            	timed_motion tm;
+            	if(!owner->ring->pop(tm))
+            	{
+            		//empty, set idle bool unless a motion was pushed meanwhile
+            		owner->idle_mutex.lock();
+            		if(owner->ring->empty())
+            		{
+            			owner->idle = true;
+            		}
+            		owner->idle_mutex.unlock();
+            		owner->idle_cond.notify_all();
+
+            		//wait for the next push
+            		while(sem_wait(&owner->ring_sem) != 0 && errno == EINTR) { }
+            		continue;
+            	}
+
+            	long long pickup_us = time_now_us() - std::max(tm.pushed_us, free_since);
+            	motioni mi;
+            	owner->motion_float_to_int(mi, tm.mf);
+
+            	long long start_us = -1;
+            	if(owner->powered_on)
+            	{
+            		boost::lock_guard<boost::mutex> lock(owner->modbus_mutex);
+            		start_us = owner->dispatch_motion(mi);
+            	}
+
+            	owner->record_dispatch(pickup_us, start_us);
+            	free_since = time_now_us();
+            }
+        }
+        catch(boost::thread_interrupted& ex)
+        {
+        }
+        catch(std::exception& ex)
+        {
+            if(owner->exhandler != NULL){
+            	owner->exhandler(ex);
+            }
+        }
+    }
+
+    long long steppermotor3::dispatch_motion(motioni& mi)
+    {
+        if(mi.speed[0] == 0)
+        	mi.speed[0] = 1;
+
+        if(mi.speed[1] == 0)
+        	mi.speed[1] = 1;
+
+        if(mi.speed[2] == 0)
+        	mi.speed[2] = 1;
+
+        //write motion
+        modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_SPEED, mi.speed[0], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_POS, mi.angles[0], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_ACC, mi.acceleration[0], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_1, crd514_kd::registers::OP_DEC, mi.deceleration[0], true);
+
+        modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_SPEED, mi.speed[1], false);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_POS, mi.angles[1], false);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_ACC, mi.acceleration[1], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_2, crd514_kd::registers::OP_DEC, mi.deceleration[1], true);
+
+        modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_SPEED, mi.speed[2], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_POS, mi.angles[2], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_ACC, mi.acceleration[2], true);
+        modbus.write_u32(crd514_kd::slaves::MOTOR_3, crd514_kd::registers::OP_DEC, mi.deceleration[2], true);
+
+        //execute motion
+        wait_till_ready();
+        long long ready_us = utils::time_now_us();
+
+        modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON);
+        modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON | crd514_kd::cmd1_bits::START);
+        long long start_us = utils::time_now_us() - ready_us;
+        modbus.write_u16(crd514_kd::slaves::BROADCAST, crd514_kd::registers::CMD_1, crd514_kd::cmd1_bits::EXCITEMENT_ON);
+        return start_us;
+    }
+
+    void steppermotor3::record_dispatch(long long pickup_us, long long start_us)
+    {
+    	if(stats_reset_requested)
+    	{
+    		stats = dispatch_stats();
+    		stats_reset_requested = false;
+    	}
+
+    	stats.pickup.add(pickup_us);
+    	if(start_us >= 0)
+    	{
+    		stats.start.add(start_us);
+    	}
+
+    	//publish, readers retry while stats_sequence is odd or changed
+    	stats_sequence = stats_sequence + 1;
+    	__sync_synchronize();
+    	published_stats = stats;
+    	__sync_synchronize();
+    	stats_sequence = stats_sequence + 1;
+    }
+
+    void steppermotor3::get_dispatch_stats(dispatch_stats& out)
+    {
+    	unsigned long sequence;
+    	do
+    	{
+    		sequence = stats_sequence;
+    		__sync_synchronize();
+    		out = published_stats;
+    		__sync_synchronize();
+    	}
+    	while((sequence & 1) || sequence != stats_sequence);
+
+    	out.ring_full = ring_full_count;
+    }
+
+    void steppermotor3::reset_dispatch_stats(void)
+    {
+    	stats_reset_requested = true;
+    	ring_full_count = 0;
+    }
+
     void steppermotor3::wait_till_ready(void)
     {
     	static const crd514_kd::slaves::t slaves[] =
@@ -235,16 +396,7 @@ namespace huniplacer
             throw std::out_of_range("one or more angles out of range");
         }
 
-    	//push motion
-        queue_mutex.lock();
-        motion_queue.push(mf);
-        queue_mutex.unlock();
-
-        //unset idle bool
-		idle_mutex.lock();
-		idle = false;
-		idle_mutex.unlock();
-		idle_cond.notify_all();
+        push_motion(mf);
         
         if(!async)
         {
@@ -256,6 +408,43 @@ namespace huniplacer
         current_angles[2] = mf.angles[2] + deviation[2];
     }
 
+    void steppermotor3::push_motion(const motionf& mf)
+    {
+        timed_motion tm;
+        tm.mf = mf;
+
+        if(ring != NULL)
+        {
+        	//push and unset idle bool together, so the motion thread can't set idle in between
+        	boost::unique_lock<boost::mutex> lock(idle_mutex);
+        	tm.pushed_us = utils::time_now_us();
+        	while(!ring->push(tm))
+        	{
+        		ring_full_count++;
+        		lock.unlock();
+        		utils::sleep(1);
+        		lock.lock();
+        		tm.pushed_us = utils::time_now_us();
+        	}
+        	idle = false;
+        	lock.unlock();
+        	sem_post(&ring_sem);
+        	return;
+        }
+
+    	//push motion
+        tm.pushed_us = utils::time_now_us();
+        queue_mutex.lock();
+        motion_queue.push(tm);
+        queue_mutex.unlock();
+
+        //unset idle bool
+		idle_mutex.lock();
+		idle = false;
+		idle_mutex.unlock();
+		idle_cond.notify_all();
+    }
+
     void steppermotor3::stop(void)
     {
     	if(!powered_on)
@@ -263,6 +452,13 @@ namespace huniplacer
 			throw motor3_exception("motor drivers are not powered on");
 		}
 
+    	if(ring != NULL)
+    	{
+    		//drop the motions before the motion thread can start another one
+    		boost::lock_guard<boost::mutex> lock(idle_mutex);
+    		ring->discard();
+    	}
+
     	boost::lock_guard<boost::mutex> queue_lock(queue_mutex);
         boost::lock_guard<boost::mutex> modbus_lock(modbus_mutex);
         
@@ -373,16 +569,7 @@ namespace huniplacer
             throw std::out_of_range("one or more angles out of range");
         }
 
-    	//push motion
-        queue_mutex.lock();
-        motion_queue.push(newmf);
-        queue_mutex.unlock();
-
-        //unset idle bool
-		idle_mutex.lock();
-		idle = false;
-		idle_mutex.unlock();
-		idle_cond.notify_all();
+        push_motion(newmf);
 
         current_angles[0] = newmf.angles[0] + deviation[0];
         current_angles[1] = newmf.angles[1] + deviation[1];
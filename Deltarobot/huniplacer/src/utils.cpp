@@ -34,6 +34,8 @@
 
 #include <huniplacer/utils.h>
 
+#include <time.h>
+
 namespace huniplacer
 {
     namespace utils
@@ -45,6 +47,13 @@ namespace huniplacer
             return duration.total_milliseconds();
         }
         
+        long long time_now_us(void)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        }
+
         void sleep(long ms)
         {
             boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
@@ -0,0 +1,178 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer_executor_test
+// File:           fake_modbus.cpp
+// Description:    in-process stand-in for libmodbus that simulates three CRD514-KD drivers
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "fake_modbus.h"
+
+extern "C"
+{
+	#include <modbus/modbus.h>
+}
+
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <huniplacer/CRD514_KD.h>
+#include <huniplacer/utils.h>
+
+using namespace huniplacer;
+
+struct _modbus
+{
+	int slave;
+	long request_us;
+	long motion_us;
+	/// @brief utils::time_now_us() until which a motor is busy, index 0 is unused
+	long long busy_until[4];
+	/// @brief true after the first START
+	bool started;
+};
+
+namespace fake_modbus
+{
+	static long request_us = 1000;
+	static long motion_us = 20000;
+	static latency_stats dwell_stats;
+
+	void configure(long request, long motion)
+	{
+		request_us = request;
+		motion_us = motion;
+	}
+
+	latency_stats& dwell(void)
+	{
+		return dwell_stats;
+	}
+
+	static void request(modbus_t* ctx)
+	{
+		usleep(ctx->request_us);
+	}
+
+	static long long all_ready_time(modbus_t* ctx)
+	{
+		long long t = ctx->busy_until[1];
+		for(int i = 2; i <= 3; i++)
+		{
+			if(ctx->busy_until[i] > t)
+			{
+				t = ctx->busy_until[i];
+			}
+		}
+		return t;
+	}
+
+	static void write(modbus_t* ctx, int address, uint16_t value)
+	{
+		if(address != crd514_kd::registers::CMD_1 || !(value & crd514_kd::cmd1_bits::START))
+		{
+			return;
+		}
+
+		long long now = utils::time_now_us();
+		long long ready = all_ready_time(ctx);
+		if(ctx->started && ready <= now)
+		{
+			dwell_stats.add(now - ready);
+		}
+
+		for(int i = 1; i <= 3; i++)
+		{
+			if(ctx->slave == crd514_kd::slaves::BROADCAST || ctx->slave == i)
+			{
+				ctx->busy_until[i] = now + ctx->motion_us;
+			}
+		}
+		ctx->started = true;
+	}
+}
+
+extern "C"
+{
+	modbus_t* modbus_new_rtu(const char*, int, char, int, int)
+	{
+		modbus_t* ctx = (modbus_t*)calloc(1, sizeof(modbus_t));
+		ctx->request_us = fake_modbus::request_us;
+		ctx->motion_us = fake_modbus::motion_us;
+		ctx->started = false;
+		return ctx;
+	}
+
+	int modbus_connect(modbus_t*) { return 0; }
+	void modbus_close(modbus_t*) { }
+	void modbus_free(modbus_t* ctx) { free(ctx); }
+
+	void modbus_get_byte_timeout(modbus_t*, struct timeval* timeout) { timeout->tv_sec = 0; timeout->tv_usec = 0; }
+	void modbus_set_byte_timeout(modbus_t*, const struct timeval*) { }
+	void modbus_get_response_timeout(modbus_t*, struct timeval* timeout) { timeout->tv_sec = 0; timeout->tv_usec = 0; }
+	void modbus_set_response_timeout(modbus_t*, const struct timeval*) { }
+
+	const char* modbus_strerror(int) { return "fake modbus error"; }
+
+	int modbus_set_slave(modbus_t* ctx, int slave)
+	{
+		ctx->slave = slave;
+		return 0;
+	}
+
+	int modbus_write_register(modbus_t* ctx, int address, int value)
+	{
+		fake_modbus::request(ctx);
+		fake_modbus::write(ctx, address, (uint16_t)value);
+		return 1;
+	}
+
+	int modbus_write_registers(modbus_t* ctx, int address, int count, const uint16_t* data)
+	{
+		fake_modbus::request(ctx);
+		for(int i = 0; i < count; i++)
+		{
+			fake_modbus::write(ctx, address + i, data[i]);
+		}
+		return count;
+	}
+
+	int modbus_read_registers(modbus_t* ctx, int address, int count, uint16_t* data)
+	{
+		fake_modbus::request(ctx);
+		long long now = utils::time_now_us();
+		for(int i = 0; i < count; i++)
+		{
+			data[i] = 0;
+			if(address + i == crd514_kd::registers::STATUS_1 && ctx->slave >= 1 && ctx->slave <= 3 && ctx->busy_until[ctx->slave] <= now)
+			{
+				data[i] = crd514_kd::status1_bits::READY;
+			}
+		}
+		return count;
+	}
+}
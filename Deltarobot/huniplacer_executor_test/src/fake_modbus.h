@@ -0,0 +1,59 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer_executor_test
+// File:           fake_modbus.h
+// Description:    in-process stand-in for libmodbus that simulates three CRD514-KD drivers
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <huniplacer/dispatch_stats.h>
+
+/**
+ * @brief the functions of libmodbus that huniplacer uses, implemented without a serial port
+ *
+ * this program does not link libmodbus, modbus_new_rtu returns a simulated bus instead.
+ * every request takes request_us, a START broadcast makes the three motors busy for motion_us.
+ * STATUS_1 reports READY when a motor is not busy.
+ **/
+namespace fake_modbus
+{
+	/**
+	 * @brief configure the simulated bus, applies to contexts created afterwards
+	 * @param request_us time a request takes on the bus
+	 * @param motion_us time a motion takes
+	 **/
+	void configure(long request_us, long motion_us);
+
+	/**
+	 * @brief time between the last motor becoming ready and the next START broadcast, as seen by the bus
+	 * @note only START broadcasts that came after the motors were ready are counted
+	 **/
+	huniplacer::latency_stats& dwell(void);
+}
@@ -0,0 +1,116 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer_executor_test
+// File:           main.cpp
+// Description:    measures the dispatch jitter of steppermotor3 against a simulated modbus
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <huniplacer/huniplacer.h>
+
+#include "fake_modbus.h"
+
+using namespace huniplacer;
+
+static void exhandler(std::exception& ex)
+{
+	fprintf(stderr, "motion thread: %s\n", ex.what());
+}
+
+static void print_latency(const char* name, const latency_stats& stats)
+{
+	printf("  %-8s n=%-6lu mean=%9.1f us  jitter=%8.1f us  p50<=%7lld us  p99<=%7lld us  min=%7lld us  max=%7lld us\n",
+		name, stats.count, stats.mean(), stats.jitter(),
+		stats.percentile(0.5), stats.percentile(0.99), stats.min_us, stats.max_us);
+}
+
+/**
+ * @brief executes motions between two positions and prints the dispatch timing
+ * @param executor NULL for the motion queue
+ **/
+static void run(const char* name, int motions, const realtime_executor_config* executor)
+{
+	fake_modbus::dwell().reset();
+
+	double deviation[3] = { 0, 0, 0 };
+	modbus_t* context = modbus_new_rtu("/dev/null", crd514_kd::rtu_config::BAUDRATE, crd514_kd::rtu_config::PARITY,
+		crd514_kd::rtu_config::DATA_BITS, crd514_kd::rtu_config::STOP_BITS);
+	steppermotor3 motors(context, measures::MOTOR_ROT_MIN, measures::MOTOR_ROT_MAX, exhandler, deviation, executor);
+	motors.power_on();
+
+	long t0 = utils::time_now();
+	for(int i = 0; i < motions; i++)
+	{
+		double angle = utils::rad(i % 2 == 0 ? 10 : 20);
+		motionf mf(angle, angle, angle, 1, 1, 1, 360, 360, 360, 360, 360, 360);
+		motors.moveto(mf, true);
+	}
+	motors.wait_for_idle();
+	long t1 = utils::time_now();
+
+	dispatch_stats stats;
+	motors.get_dispatch_stats(stats);
+
+	printf("%s: %d motions in %ld ms%s\n", name, motions, t1 - t0,
+		executor != NULL && executor->priority > 0 && !motors.is_realtime_scheduled() ? " (SCHED_FIFO not granted)" : "");
+	print_latency("pickup", stats.pickup);
+	print_latency("start", stats.start);
+	print_latency("dwell", fake_modbus::dwell());
+	printf("  waited %lu ms for a full ring\n", stats.ring_full);
+}
+
+int main(int argc, char** argv)
+{
+	int motions = 200;
+	long request_us = 1000;
+	long motion_us = 20000;
+	realtime_executor_config config(256, 0, false);
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) { motions = atoi(argv[++i]); }
+		else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) { request_us = atol(argv[++i]); }
+		else if(strcmp(argv[i], "-m") == 0 && i + 1 < argc) { motion_us = atol(argv[++i]); }
+		else if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) { config.priority = atoi(argv[++i]); }
+		else if(strcmp(argv[i], "-l") == 0) { config.lock_memory = true; }
+		else
+		{
+			fprintf(stderr, "usage: %s [-n motions] [-r request us] [-m motion us] [-p SCHED_FIFO priority] [-l]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	fake_modbus::configure(request_us, motion_us);
+
+	//the motion queue prints every motion, keep it apart from the results
+	fflush(stdout);
+	run("queue", motions, NULL);
+	run("realtime", motions, &config);
+	return 0;
+}
@@ -0,0 +1,153 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        huniplacer_simulation_test
+// File:           main.cpp
+// Description:    measures the pick and place cycle time of deltarobot on simulated_motor3
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <huniplacer/huniplacer.h>
+
+using namespace huniplacer;
+
+//the pick and place motions of the crate demo (cratedemo/CrateDemo.cpp), heights in mm, speeds in mm/s
+static const double SAFE_HEIGHT = -160.0;
+static const double GRIP_HEIGHT = -198.0 + 5.3 + 9.7; //table, crate bottom, ball
+static const double SPEED = 123;
+static const double GRIPPED_SPEED = 36;
+static const double GRIP_TIME = 0.5;
+static const double RELEASE_TIME = 0.2;
+static const double CONTAINER_DISTANCE = 2 * 5.25 + 0.5;
+
+/**
+ * @brief moves to a point above p and down to p, as one moveTo service call of deltarobotnode
+ **/
+static void move_down(deltarobot& robot, const point3& p)
+{
+	robot.moveto(point3(p.x, p.y, SAFE_HEIGHT), SPEED);
+	robot.moveto(p, SPEED);
+	robot.wait_for_idle();
+}
+
+static void move_up(deltarobot& robot, const point3& p, double speed)
+{
+	robot.moveto(point3(p.x, p.y, SAFE_HEIGHT), speed);
+	robot.wait_for_idle();
+}
+
+/// @brief location of a ball in a 4x4 crate centered at x, y
+static point3 container(double x, double y, int index)
+{
+	return point3(
+		x + (index % 4 - 1.5) * CONTAINER_DISTANCE,
+		y + (index / 4 - 1.5) * CONTAINER_DISTANCE,
+		GRIP_HEIGHT);
+}
+
+int main(int argc, char** argv)
+{
+	int balls = 16;
+	const char* timeline_path = NULL;
+	simulation_config config(0);
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc) { balls = atoi(argv[++i]); }
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) { config.time_scale = atof(argv[++i]); }
+		else if(strcmp(argv[i], "-b") == 0 && i + 1 < argc) { config.broadcast_wait = atof(argv[++i]) / 1000; }
+		else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc) { config.response_delay = atof(argv[++i]) / 1000000; }
+		else if(strcmp(argv[i], "-o") == 0 && i + 1 < argc) { timeline_path = argv[++i]; }
+		else
+		{
+			fprintf(stderr, "usage: %s [-n balls] [-s time scale] [-b broadcast wait ms] [-r response delay us] [-o timeline.csv]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	inverse_kinematics_impl kinematics(
+		measures::BASE,
+		measures::HIP,
+		measures::EFFECTOR,
+		measures::ANKLE,
+		measures::HIP_ANKLE_ANGLE_MAX);
+
+	simulated_motor3 motors(measures::MOTOR_ROT_MIN, measures::MOTOR_ROT_MAX, config);
+	deltarobot robot(kinematics, motors);
+	robot.generate_boundaries(2);
+	robot.power_on();
+
+	//the effector starts at the location deltarobot assumes
+	motionf home;
+	kinematics.point_to_motion(point3(0, 0, -161.9), home);
+	motors.override_current_angles(home.angles);
+
+	long long t0 = utils::time_now_us();
+	double start = motors.get_time();
+	double previous = start;
+	for(int i = 0; i < balls; i++)
+	{
+		point3 from = container(-30, 0, i % 16);
+		point3 to = container(30, 0, i % 16);
+
+		move_down(robot, from);
+		motors.simulate_delay(GRIP_TIME);
+		move_up(robot, from, GRIPPED_SPEED);
+		move_down(robot, to);
+		motors.simulate_delay(RELEASE_TIME);
+		move_up(robot, to, SPEED);
+
+		double now = motors.get_time();
+		printf("ball %2d: %7.3f s\n", i, now - previous);
+		previous = now;
+	}
+	long long t1 = utils::time_now_us();
+
+	std::vector<simulated_move> timeline;
+	motors.get_timeline(timeline);
+	double moving = 0;
+	double overhead = 0;
+	for(size_t n = 0; n < timeline.size(); n++)
+	{
+		moving += timeline[n].end - timeline[n].start;
+		overhead += timeline[n].start - timeline[n].dispatched;
+	}
+
+	double total = motors.get_time() - start;
+	printf("%d balls in %.3f s simulated (%.1f ms real), %.3f s per ball\n", balls, total, (t1 - t0) / 1000.0, total / balls);
+	printf("%lu motions: %.3f s moving, %.3f s from dispatch to START, %lu modbus frames\n",
+		(unsigned long)timeline.size(), moving, overhead, motors.get_frame_count());
+
+	if(timeline_path != NULL)
+	{
+		std::ofstream out(timeline_path);
+		motors.write_timeline(out);
+	}
+	return 0;
+}
@@ -68,6 +68,11 @@ public:
 	 * @return the location of the object on index.
 	 */
 	virtual datatypes::point3f getContentGripLocation(size_t index) const = 0;
+	/**
+	 * Returns a copy of the crate, which shares the content with this crate.
+	 * @return the copy, owned by the caller
+	 */
+	virtual Crate* clone() const = 0;
 	/**
 	 * Remove the content on location index.
 	 * @param index
@@ -94,6 +99,10 @@ public:
 	datatypes::point2f position;
 	float angle;
 	bool moving;
+	/**
+	 * Changes with every update of position, angle or moving.
+	 */
+	unsigned long version;
 protected:
 	datatypes::size3f size;
 	std::vector<CrateContent*>& data;
@@ -41,8 +41,10 @@
 #include <cratedemo/MoveAction.hpp>
 #include <cratedemo/Crate.hpp>
 #include <cratedemo/Environment.hpp>
+#include <cratedemo/CrateMirror.hpp>
 #include <ros/ros.h>
 #include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
 
 //delta node messages & services
 #include <deltarobotnode/error.h>
@@ -57,10 +59,19 @@
 
 namespace cratedemo
 {
-typedef std::map<std::string, Crate*> CrateMap;
+typedef boost::shared_ptr<Crate> CratePtr;
+typedef std::map<std::string, CratePtr> CrateMap;
+typedef boost::shared_ptr<const CrateMap> ConstCrateMapPtr;
 
 /**
  * Framework for a demo with crates.
+ *
+ * The crates are versioned records that are copied on write: a crate event copies the crate,
+ * changes the copy and publishes a new map of crates. A published crate is never changed, so
+ * the action thread reads the crates without locks and does not block crate events while the
+ * robot moves. After every move the action thread checks that the version of the crate it moved
+ * to is still the current one, and moves again if the crate moved in the meantime.
+ * The content of the crates is shared between the versions of a crate.
  */
 class CrateDemo
 {
@@ -77,13 +88,25 @@ private:
 	ros::ServiceClient getCrateClient;
 	ros::Subscriber crateEventSub;
 	ros::Subscriber visionErrorSub;
+	CrateMirror crateMirror;
 
 	std::queue<MoveAction> actionQueue;
 	CrateContentMap& crateContentMap;
 
 	volatile bool threadRunning;
 	boost::mutex actionQueueMutex;
+	/**
+	 * Serializes the writers of the crate map and changes to the content of the crates, never held while the robot moves.
+	 */
 	boost::recursive_mutex crateMapMutex;
+	unsigned long nextVersion;
+	volatile unsigned int retriedMotions;
+
+	/**
+	 * Only held to copy or replace the pointer to the published crates.
+	 */
+	boost::mutex cratesPtrMutex;
+	ConstCrateMapPtr crates;
 
 	volatile bool idle;
 	boost::mutex idleMutex;
@@ -91,10 +114,16 @@ private:
 
 	boost::mutex waitMutex;
 	boost::condition_variable waitCondition;
+	unsigned long changeCount;
 
 	boost::thread* actionThread;
 protected:
-	CrateMap crates;
+	/**
+	 * Returns the crates as they are now. The map and its crates are not changed afterwards,
+	 * later events publish a new map.
+	 * @return the published crates
+	 */
+	ConstCrateMapPtr getCrates(void);
 private:
 	//crate event handling methods
 	void handleNewCrate(const vision::CrateMsg& msg);
@@ -103,9 +132,33 @@ private:
 	void handleCrateMoving(const vision::CrateMsg& msg);
 
 	/**
+	 * Replaces the published crates and wakes the action thread.
 	 * @note needs crateMapMutex to be locked
 	 */
-	Crate* waitForCrate(const std::string& name);
+	void publishCrates(const CrateMap& newCrates);
+	/**
+	 * Publishes a new version of a crate.
+	 * @note needs crateMapMutex to be locked
+	 * @return the new version
+	 */
+	CratePtr updateCrate(const Crate& crate, const datatypes::point2f& position, float angle, bool moving);
+	/**
+	 * @return a number that changes with every published crate map
+	 */
+	unsigned long getChangeCount(void);
+	/**
+	 * Waits until the crates are published again after getChangeCount returned since.
+	 */
+	void waitForChange(unsigned long since);
+	/**
+	 * Waits until a crate exists and stands still.
+	 * @return the current version of the crate
+	 */
+	CratePtr waitForCrate(const std::string& name);
+	/**
+	 * @return true if crate is still the current version of the crate
+	 */
+	bool isCurrent(const CratePtr& crate);
 	datatypes::point3f getCrateContentGripLocation(const Crate& crate, size_t index);
 
 	static void staticActionThreadFunc(CrateDemo* obj);
@@ -124,9 +177,14 @@ protected:
 		const std::string& getCrate,
 		const std::string& visionEvents,
 		const std::string& visionError,
-		CrateContentMap& crateContentMap);
+		CrateContentMap& crateContentMap,
+		const std::string& crateSnapshot = "crateSnapshot");
 
 public:
+	/**
+	 * Adds the crates the vision node tracks and updates the known ones.
+	 * Uses the snapshot topic, the crateRefresh service only if no snapshot arrives within a second.
+	 */
 	void getAllCrates(void);
 	/**
 	 *Deconstructor
@@ -148,6 +206,10 @@ public:
 	virtual void onVisionError(int errCode, const std::string& errStr) = 0;
 
 	void moveObject(Crate& crateFrom, size_t indexFrom ,Crate& crateTo, size_t indexTo);
+	/**
+	 * @return the amount of motions that were repeated because their crate moved during the motion
+	 */
+	unsigned int getRetriedMotions(void);
 	void crateEventCb(const vision::CrateEventMsg::ConstPtr& msg);
 	void deltaErrorCb(const deltarobotnode::error::ConstPtr& msg);
 	void visionErrorCb(const vision::error::ConstPtr& msg);
@@ -0,0 +1,130 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        cratedemo
+// File:           CrateMirror.hpp
+// Description:    Local copy of the crates tracked by the vision node, fed by its snapshot topic.
+// Author:         agent
+// Notes:
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <boost/thread.hpp>
+
+#include <vision/CrateSnapshotMsg.h>
+
+namespace cratedemo
+{
+/**
+ * Local copy of the crates tracked by the vision node.
+ * The mirror follows the crateSnapshot topic on its own callback queue and thread, so it is
+ * up to date without service calls and without depending on the spinning of the node.
+ * A delta is only applied on top of the snapshot it was made for; after a lost message the
+ * mirror is out of sync until the next full snapshot.
+ */
+class CrateMirror
+{
+public:
+	/**
+	 * A crate as the vision node tracks it
+	 */
+	struct MirroredCrate
+	{
+		std::string name;
+		int state;
+		float x, y, angle;
+	};
+
+	/**
+	 * Subscribes to the snapshot topic and starts the thread that receives the snapshots.
+	 * @param hNode node handle to subscribe with
+	 * @param snapshotTopic the crateSnapshot topic of the vision node
+	 */
+	CrateMirror(ros::NodeHandle& hNode, const std::string& snapshotTopic);
+	/**
+	 * Stops receiving snapshots.
+	 */
+	~CrateMirror();
+
+	/**
+	 * Applies a snapshot to the mirror.
+	 * @param msg a full snapshot, or a delta on top of the last applied snapshot
+	 */
+	void apply(const vision::CrateSnapshotMsg& msg);
+
+	/**
+	 * Waits until the mirror holds a complete state.
+	 * @param timeout the maximum time to wait in seconds
+	 * @return true if the mirror is in sync
+	 */
+	bool waitForSync(double timeout);
+	/**
+	 * @return false before the first full snapshot and after a lost snapshot was noticed
+	 */
+	bool isSynced(void);
+
+	/**
+	 * @param name the name of the crate
+	 * @param result receives the crate
+	 * @return true if the crate is tracked
+	 */
+	bool getCrate(const std::string& name, MirroredCrate& result);
+	std::vector<MirroredCrate> getAllCrates(void);
+
+	/**
+	 * @return the sequence number of the frame of the last applied snapshot
+	 */
+	uint32_t getSequence(void);
+	/**
+	 * @return the capture time of the frame of the last applied snapshot
+	 */
+	ros::Time getStamp(void);
+
+private:
+	ros::CallbackQueue queue;
+	ros::Subscriber snapshotSub;
+	volatile bool threadRunning;
+	boost::thread* spinThread;
+
+	boost::mutex mutex;
+	boost::condition_variable syncCondition;
+	std::map<std::string, MirroredCrate> crates;
+	bool synced;
+	uint32_t sequence;
+	ros::Time stamp;
+
+	void snapshotCb(const vision::CrateSnapshotMsg::ConstPtr& msg);
+	void spinThreadFunc(void);
+};
+}
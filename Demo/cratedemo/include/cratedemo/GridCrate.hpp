@@ -73,6 +73,7 @@ public:
 
 	virtual datatypes::point3f getContainerLocation(size_t index) const;
 	virtual datatypes::point3f getContentGripLocation(size_t index) const;
+	virtual Crate* clone() const;
 
 private:
 	size_t gridWidth;
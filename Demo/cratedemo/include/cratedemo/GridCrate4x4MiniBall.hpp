@@ -73,6 +73,10 @@ public:
 				DISTANCE_TO_NEXT,
 				RADIUS_OF_BALL_CONTAINER,
 				BOTTOM_THICKNESS) {}
+
+	virtual Crate* clone() const {
+		return new GridCrate4x4MiniBall(*this);
+	}
 };
 
 }
@@ -50,6 +50,7 @@ Crate::Crate(
 		position(position),
 		angle(angle),
 		moving(moving),
+		version(0),
 		size(size),
 		data(crateContent) {
 }
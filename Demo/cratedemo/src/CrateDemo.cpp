@@ -62,7 +62,8 @@ CrateDemo::CrateDemo(
 	const std::string& getCrate,
 	const std::string& visionEvents,
 	const std::string& visionError,
-	CrateContentMap& crateContentMap) :
+	CrateContentMap& crateContentMap,
+	const std::string& crateSnapshot) :
 		gripperClient( hNode.serviceClient<deltarobotnode::gripper>(deltaGrip) ),
 		motionClient( hNode.serviceClient<deltarobotnode::motionSrv>(deltaMotion) ),
 		checkClient( hNode.serviceClient<deltarobotnode::motionSrv>(checkMotion) ),
@@ -72,24 +73,89 @@ CrateDemo::CrateDemo(
 		getCrateClient(hNode.serviceClient<vision::getCrate>(getCrate)),
 		crateEventSub(hNode.subscribe(visionEvents, 1000, &CrateDemo::crateEventCb, this)),
 		visionErrorSub(hNode.subscribe(visionError, 1000, &CrateDemo::visionErrorCb, this)),
+		crateMirror(hNode, crateSnapshot),
 		crateContentMap(crateContentMap),
-		threadRunning(true) {
+		threadRunning(true),
+		nextVersion(0),
+		retriedMotions(0),
+		crates(new CrateMap),
+		changeCount(0) {
 	actionThread = new boost::thread(staticActionThreadFunc, this);
 }
 
-Crate* CrateDemo::waitForCrate(const std::string& name)
+ConstCrateMapPtr CrateDemo::getCrates(void)
 {
-	CrateMap::iterator it = crates.find(name);
-	while(it == crates.end() || it->second->moving)
+	boost::lock_guard<boost::mutex> lock(cratesPtrMutex);
+	return crates;
+}
+
+void CrateDemo::publishCrates(const CrateMap& newCrates)
+{
+	ConstCrateMapPtr published(new CrateMap(newCrates));
+	cratesPtrMutex.lock();
+	crates = published;
+	cratesPtrMutex.unlock();
+
+	waitMutex.lock();
+	changeCount++;
+	waitMutex.unlock();
+	waitCondition.notify_all();
+}
+
+CratePtr CrateDemo::updateCrate(const Crate& crate, const datatypes::point2f& position, float angle, bool moving)
+{
+	CratePtr c(crate.clone());
+	c->position = position;
+	c->angle = angle;
+	c->moving = moving;
+	c->version = ++nextVersion;
+
+	CrateMap newCrates(*getCrates());
+	newCrates[c->getName()] = c;
+	publishCrates(newCrates);
+	return c;
+}
+
+unsigned long CrateDemo::getChangeCount(void)
+{
+	boost::lock_guard<boost::mutex> lock(waitMutex);
+	return changeCount;
+}
+
+void CrateDemo::waitForChange(unsigned long since)
+{
+	boost::unique_lock<boost::mutex> lock(waitMutex);
+	while(changeCount == since)
 	{
-		crateMapMutex.unlock();
-		boost::unique_lock<boost::mutex> lock(waitMutex);
 		waitCondition.wait(lock);
-		crateMapMutex.lock();
-		it = crates.find(name);
 	}
+}
+
+CratePtr CrateDemo::waitForCrate(const std::string& name)
+{
+	for(;;)
+	{
+		unsigned long since = getChangeCount();
+		ConstCrateMapPtr current = getCrates();
+		CrateMap::const_iterator it = current->find(name);
+		if(it != current->end() && !it->second->moving)
+		{
+			return it->second;
+		}
+		waitForChange(since);
+	}
+}
+
+bool CrateDemo::isCurrent(const CratePtr& crate)
+{
+	ConstCrateMapPtr current = getCrates();
+	CrateMap::const_iterator it = current->find(crate->getName());
+	return it != current->end() && it->second->version == crate->version;
+}
 
-	return it->second;
+unsigned int CrateDemo::getRetriedMotions(void)
+{
+	return retriedMotions;
 }
 
 datatypes::point3f CrateDemo::getCrateContentGripLocation(const Crate& crate, size_t index)
@@ -137,14 +203,14 @@ void CrateDemo::actionThreadFunc(void)
 //					exit(EXIT_FAILURE);
 //				}
 
-				Crate* crateFrom;
+				CratePtr crateFrom;
 				datatypes::point3f posFrom;
 
-				//move to source
+				//move to source, the crates are not locked while the robot moves
 				MotionWrapper motionToSource;
 				for(;;)
 				{
-					crateMapMutex.lock();
+					unsigned long since = getChangeCount();
 					//wait for source crate
 					crateFrom = waitForCrate(action.getStrFrom());
 					//get source location
@@ -157,11 +223,17 @@ void CrateDemo::actionThreadFunc(void)
 					//if object in crate is not reachable, then wait for movement and check again
 					if (!motionToSource.callService(motionClient))
 					{
-						crateMapMutex.unlock();
 						ROS_INFO("Cannot reach source location. Waiting till robot can reach it.");
-						boost::unique_lock<boost::mutex> lock(waitMutex);
-						waitCondition.wait(lock);
-
+						waitForChange(since);
+					}
+					else if(!isCurrent(crateFrom))
+					{
+						//the crate moved while the robot moved to it
+						ROS_INFO("Source crate moved during the motion. Moving to it again.");
+						retriedMotions++;
+						MotionWrapper motionUp;
+						motionUp.addMotion(datatypes::point3f(posFrom.x, posFrom.y, SAFE_HEIGHT), 123);
+						motionUp.callService(motionClient);
 					}
 					else
 					{
@@ -170,6 +242,7 @@ void CrateDemo::actionThreadFunc(void)
 				}
 
 				//remove content from source crate
+				crateMapMutex.lock();
 				CrateContent* content = crateFrom->get(action.getIndexFrom());
 				crateFrom->remove(action.getIndexFrom());
 				crateMapMutex.unlock();
@@ -186,17 +259,17 @@ void CrateDemo::actionThreadFunc(void)
 				motionToSourceUp.addMotion(datatypes::point3f(posFrom.x, posFrom.y, SAFE_HEIGHT), 36);
 				motionToSourceUp.callService(motionClient);
 
-				Crate* crateTo;
+				CratePtr crateTo;
 				datatypes::point3f posTo;
 
 				//move to destination
 				MotionWrapper motionToDestination;
 				for(;;)
 				{
-					crateMapMutex.lock();
-					//wait for source crate
+					unsigned long since = getChangeCount();
+					//wait for destination crate
 					crateTo = waitForCrate(action.getStrTo());
-					//get source location
+					//get destination location
 					posTo = crateTo->getContainerLocation(action.getIndexTo()) + content->getGripPoint();
 
 					motionToDestination = MotionWrapper();
@@ -206,10 +279,17 @@ void CrateDemo::actionThreadFunc(void)
 					//if drop location in crate is not reachable, then wait for movement and check again
 					if (!motionToDestination.callService(motionClient))
 					{
-						crateMapMutex.unlock();
 						ROS_INFO("Cannot reach destination location. Waiting till robot can reach it.");
-						boost::unique_lock<boost::mutex> lock(waitMutex);
-						waitCondition.wait(lock);
+						waitForChange(since);
+					}
+					else if(!isCurrent(crateTo))
+					{
+						//the crate moved while the robot moved to it, do not drop next to it
+						ROS_INFO("Destination crate moved during the motion. Moving to it again.");
+						retriedMotions++;
+						MotionWrapper motionUp;
+						motionUp.addMotion(datatypes::point3f(posTo.x, posTo.y, SAFE_HEIGHT), 123);
+						motionUp.callService(motionClient);
 					}
 					else
 					{
@@ -219,9 +299,8 @@ void CrateDemo::actionThreadFunc(void)
 
 				try
 				{
-					posTo = crateTo->getContainerLocation(action.getIndexTo()) + content->getGripPoint();
+					boost::lock_guard<boost::recursive_mutex> lock(crateMapMutex);
 					crateTo->put(action.getIndexTo(), content);
-					crateMapMutex.unlock();
 				}
 				catch(LocationIsFullException& ex)
 				{
@@ -341,8 +420,6 @@ void CrateDemo::crateEventCb(const vision::CrateEventMsg::ConstPtr& msg)
 	case OUT: handleCrateRemoved(msg->crate); break;
 	default: assert(0 && "unknown crate event"); break;
 	}
-
-	waitCondition.notify_all();
 }
 
 void CrateDemo::handleNewCrate(const vision::CrateMsg& msg)
@@ -357,8 +434,11 @@ void CrateDemo::handleNewCrate(const vision::CrateMsg& msg)
 		return;
 	}
 
-	Crate* crate = new GridCrate4x4MiniBall(msg.name, it->second,datatypes::point2f(msg.x,msg.y),msg.angle, moving);
-	crates.insert(std::pair<std::string, Crate*>(crate->getName(), crate));
+	CratePtr crate(new GridCrate4x4MiniBall(msg.name, it->second,datatypes::point2f(msg.x,msg.y),msg.angle, moving));
+	crate->version = ++nextVersion;
+	CrateMap newCrates(*getCrates());
+	newCrates[crate->getName()] = crate;
+	publishCrates(newCrates);
 
 	onNewCrate(*crate);
 	crateMapMutex.unlock();
@@ -367,17 +447,20 @@ void CrateDemo::handleNewCrate(const vision::CrateMsg& msg)
 void CrateDemo::handleCrateRemoved(const vision::CrateMsg& msg)
 {
 	crateMapMutex.lock();
-	std::map<std::string, Crate*>::iterator result = crates.find(msg.name);
+	CrateMap newCrates(*getCrates());
+	CrateMap::iterator result = newCrates.find(msg.name);
 
-	if(result == crates.end()){
+	if(result == newCrates.end()){
 		ROS_WARN("CrateRemoved: Crate didn't exist, remove action ignored: %s", msg.name.c_str());
 		crateMapMutex.unlock();
 		return;
 	}
 
-	onCrateRemoved(*(result->second));
-	delete result->second;
-	crates.erase(result);
+	//the action thread may still hold this version, it is deleted with its last reference
+	CratePtr crate = result->second;
+	newCrates.erase(result);
+	publishCrates(newCrates);
+	onCrateRemoved(*crate);
 
 	crateMapMutex.unlock();
 }
@@ -385,9 +468,10 @@ void CrateDemo::handleCrateRemoved(const vision::CrateMsg& msg)
 void CrateDemo::handleCrateMoved(const vision::CrateMsg& msg)
 {
 	crateMapMutex.lock();
-	CrateMap::iterator res = crates.find(msg.name);
+	ConstCrateMapPtr current = getCrates();
+	CrateMap::const_iterator res = current->find(msg.name);
 
-	if(res == crates.end()){
+	if(res == current->end()){
 		ROS_WARN("CrateMoved: Crate didn't exist, move action ignored: %s", msg.name.c_str());
 		crateMapMutex.unlock();
 		return;
@@ -415,10 +499,7 @@ void CrateDemo::handleCrateMoved(const vision::CrateMsg& msg)
 		}
 	}
 */
-	Crate* c = res->second;
-	c->position = datatypes::point2f(msg.x,msg.y);
-	c->angle = msg.angle;
-	c->moving = false;
+	CratePtr c = updateCrate(*(res->second), datatypes::point2f(msg.x,msg.y), msg.angle, false);
 	onCrateMove(*c);
 	crateMapMutex.unlock();
 }
@@ -427,9 +508,10 @@ void CrateDemo::handleCrateMoving(const vision::CrateMsg& msg)
 {
 
 	crateMapMutex.lock();
-	CrateMap::iterator res = crates.find(msg.name);
+	ConstCrateMapPtr current = getCrates();
+	CrateMap::const_iterator res = current->find(msg.name);
 
-	if(res == crates.end()){
+	if(res == current->end()){
 		ROS_WARN("CrateMoving: Crate didn't exist, moving action ignored: %s", msg.name.c_str());
 		crateMapMutex.unlock();
 		return;
@@ -456,25 +538,39 @@ void CrateDemo::handleCrateMoving(const vision::CrateMsg& msg)
 	}
 */
 
-	Crate* c = res->second;
-	c->moving = true;
+	const Crate& c = *(res->second);
+	updateCrate(c, c.position, c.angle, true);
 	crateMapMutex.unlock();
 }
 
 void CrateDemo::getAllCrates(void){
-	vision::getAllCrates allCrates;
-	crateRefreshClient.call(allCrates);
-
+	std::vector<vision::CrateMsg> allCrates;
+	if(crateMirror.waitForSync(1.0)){
+		std::vector<CrateMirror::MirroredCrate> mirrored = crateMirror.getAllCrates();
+		for(std::vector<CrateMirror::MirroredCrate>::iterator it = mirrored.begin(); it != mirrored.end(); ++it){
+			vision::CrateMsg msg;
+			msg.name = it->name;
+			msg.x = it->x;
+			msg.y = it->y;
+			msg.angle = it->angle;
+			allCrates.push_back(msg);
+		}
+	}else{
+		//a vision node without the snapshot topic
+		vision::getAllCrates srv;
+		crateRefreshClient.call(srv);
+		allCrates = srv.response.crates;
+	}
 
-	for(unsigned int i = 0; i < allCrates.response.crates.size(); i++){
+	for(unsigned int i = 0; i < allCrates.size(); i++){
 		crateMapMutex.lock();
-		CrateMap::iterator it = crates.find(allCrates.response.crates.at(i).name);
-		if(it == crates.end()){
-			handleNewCrate(allCrates.response.crates.at(i));
+		ConstCrateMapPtr current = getCrates();
+		CrateMap::const_iterator it = current->find(allCrates.at(i).name);
+		if(it == current->end()){
+			handleNewCrate(allCrates.at(i));
 		}else{
-			it->second->position.x = allCrates.response.crates.at(i).x;
-			it->second->position.y = allCrates.response.crates.at(i).y;
-			it->second->angle = allCrates.response.crates.at(i).angle;
+			const Crate& c = *(it->second);
+			updateCrate(c, datatypes::point2f(allCrates.at(i).x, allCrates.at(i).y), allCrates.at(i).angle, c.moving);
 		}
 		crateMapMutex.unlock();
 	}
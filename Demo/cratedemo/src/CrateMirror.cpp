@@ -0,0 +1,155 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        cratedemo
+// File:           CrateMirror.cpp
+// Description:    Local copy of the crates tracked by the vision node, fed by its snapshot topic.
+// Author:         agent
+// Notes:
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+#include <cratedemo/CrateMirror.hpp>
+
+namespace cratedemo
+{
+
+CrateMirror::CrateMirror(ros::NodeHandle& hNode, const std::string& snapshotTopic) :
+		threadRunning(true),
+		synced(false),
+		sequence(0)
+{
+	ros::SubscribeOptions options = ros::SubscribeOptions::create<vision::CrateSnapshotMsg>(
+			snapshotTopic, 100, boost::bind(&CrateMirror::snapshotCb, this, _1), ros::VoidConstPtr(), &queue);
+	snapshotSub = hNode.subscribe(options);
+	spinThread = new boost::thread(boost::bind(&CrateMirror::spinThreadFunc, this));
+}
+
+CrateMirror::~CrateMirror()
+{
+	threadRunning = false;
+	spinThread->join();
+	delete spinThread;
+	snapshotSub.shutdown();
+}
+
+void CrateMirror::spinThreadFunc(void)
+{
+	while(threadRunning && ros::ok())
+	{
+		queue.callAvailable(ros::WallDuration(0.1));
+	}
+}
+
+void CrateMirror::snapshotCb(const vision::CrateSnapshotMsg::ConstPtr& msg)
+{
+	apply(*msg);
+}
+
+void CrateMirror::apply(const vision::CrateSnapshotMsg& msg)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	if(msg.full)
+	{
+		crates.clear();
+		synced = true;
+	}
+	else if(!synced || msg.baseSeq != sequence)
+	{
+		//a snapshot in between is lost, only a full one helps now
+		if(synced) ROS_WARN("CrateMirror: missed a snapshot before %u, waiting for a full one", msg.seq);
+		synced = false;
+		return;
+	}
+
+	for(size_t i = 0; i < msg.crates.size() && i < msg.states.size(); i++)
+	{
+		MirroredCrate& crate = crates[msg.crates[i].name];
+		crate.name = msg.crates[i].name;
+		crate.state = msg.states[i];
+		crate.x = msg.crates[i].x;
+		crate.y = msg.crates[i].y;
+		crate.angle = msg.crates[i].angle;
+	}
+	for(size_t i = 0; i < msg.removed.size(); i++)
+	{
+		crates.erase(msg.removed[i]);
+	}
+	sequence = msg.seq;
+	stamp = msg.stamp;
+	syncCondition.notify_all();
+}
+
+bool CrateMirror::waitForSync(double timeout)
+{
+	boost::unique_lock<boost::mutex> lock(mutex);
+	boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds((long)(timeout * 1e6));
+	while(!synced)
+	{
+		if(!syncCondition.timed_wait(lock, deadline)) return synced;
+	}
+	return true;
+}
+
+bool CrateMirror::isSynced(void)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	return synced;
+}
+
+bool CrateMirror::getCrate(const std::string& name, MirroredCrate& result)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	std::map<std::string, MirroredCrate>::iterator it = crates.find(name);
+	if(!synced || it == crates.end()) return false;
+	result = it->second;
+	return true;
+}
+
+std::vector<CrateMirror::MirroredCrate> CrateMirror::getAllCrates(void)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	std::vector<MirroredCrate> result;
+	for(std::map<std::string, MirroredCrate>::iterator it = crates.begin(); it != crates.end(); ++it)
+	{
+		result.push_back(it->second);
+	}
+	return result;
+}
+
+uint32_t CrateMirror::getSequence(void)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	return sequence;
+}
+
+ros::Time CrateMirror::getStamp(void)
+{
+	boost::lock_guard<boost::mutex> lock(mutex);
+	return stamp;
+}
+
+}
@@ -78,6 +78,10 @@ datatypes::point3f GridCrate::getContainerLocation(size_t index) const {
 	return location3D;
 }
 
+Crate* GridCrate::clone() const {
+	return new GridCrate(*this);
+}
+
 datatypes::point3f GridCrate::getContentGripLocation(size_t index) const {
 	if (data.at(index) == NULL) {
 		throw cratedemo::LocationIsEmptyException();
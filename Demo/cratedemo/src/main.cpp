@@ -30,11 +30,12 @@ public:
 	void onNewCrate(Crate& crate) {
 		ROS_INFO("onNewCrate called %s, on location:\tx:\t%f\ty:\t%f",crate.getName().c_str(),crate.position.x,crate.position.y);
 
-		CrateMap::iterator it1 = crates.find("GC4x4MB_1");
-		if(it1 == crates.end()) { return; }
+		ConstCrateMapPtr crates = getCrates();
+		CrateMap::const_iterator it1 = crates->find("GC4x4MB_1");
+		if(it1 == crates->end()) { return; }
 
-		CrateMap::iterator it2 = crates.find("GC4x4MB_2");
-		if(it2 == crates.end()) { return; }
+		CrateMap::const_iterator it2 = crates->find("GC4x4MB_2");
+		if(it2 == crates->end()) { return; }
 
 		for(size_t i = 0; i < 4*4; i++)
 		{
@@ -0,0 +1,263 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        cratedemo
+// File:           crateEventStress.cpp
+// Description:    Replays crate events at a high rate while the action thread moves the robot.
+// Author:         agent
+// Notes:
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+
+#include <ros/ros.h>
+#include <boost/thread.hpp>
+#include <cratedemo/CrateDemo.hpp>
+#include <cratedemo/MiniBall.hpp>
+
+using namespace cratedemo;
+
+/**
+ * Stress test for the crate map of CrateDemo.
+ * The node serves fake delta robot services, of which the motion service takes motionTime ms
+ * per point, and publishes MOVED events for noise crates at eventRate events per second.
+ * Meanwhile the action thread moves the balls of crate "source" to crate "destination", which
+ * are moved every crateMoveInterval ms to make the action thread move again.
+ * The sequence number of every noise event is put in its y, the time between publishing the
+ * event and onCrateMove is the latency. The test fails if the largest latency exceeds maxLatency ms,
+ * which happens when crate events have to wait for a motion.
+ */
+
+static const std::string NOISE = "noise";
+
+class StressDemo : public CrateDemo
+{
+public:
+	StressDemo(ros::NodeHandle& hNode, CrateContentMap& crateContentMap, size_t events) :
+			CrateDemo(hNode,
+				"stressGrip",
+				"stressStop",
+				"stressMotion",
+				"stressCheck",
+				"stressDeltaError",
+				"stressGetAllCrates",
+				"stressGetCrate",
+				"stressCrateEvent",
+				"stressVisionError",
+				crateContentMap,
+				"stressCrateSnapshot"),
+			sent(events),
+			latencies(),
+			started(false) {
+	}
+
+	void onNewCrate(Crate& crate) {
+		if(!started && (crate.getName() == "source" || crate.getName() == "destination")) {
+			ConstCrateMapPtr crates = getCrates();
+			CrateMap::const_iterator from = crates->find("source");
+			CrateMap::const_iterator to = crates->find("destination");
+			if(from == crates->end() || to == crates->end()) { return; }
+
+			started = true;
+			for(size_t i = 0; i < 4*4; i++) {
+				moveObject(*(from->second), i, *(to->second), i);
+			}
+		}
+	}
+
+	void onCrateMove(Crate& crate) {
+		if(crate.getName().compare(0, NOISE.size(), NOISE) != 0) { return; }
+
+		ros::WallTime now = ros::WallTime::now();
+		size_t seq = (size_t)crate.position.y;
+		boost::lock_guard<boost::mutex> lock(latencyMutex);
+		if(seq < sent.size()) {
+			latencies.push_back((now - sent[seq]).toSec() * 1000.0);
+		}
+	}
+
+	void onCrateRemoved(Crate&) {}
+	void onDeltaError(int, const std::string&) {}
+	void onVisionError(int, const std::string&) {}
+
+	void setSent(size_t seq, const ros::WallTime& time) {
+		boost::lock_guard<boost::mutex> lock(latencyMutex);
+		sent[seq] = time;
+	}
+
+	std::vector<double> getLatencies(void) {
+		boost::lock_guard<boost::mutex> lock(latencyMutex);
+		return latencies;
+	}
+
+private:
+	boost::mutex latencyMutex;
+	std::vector<ros::WallTime> sent;
+	std::vector<double> latencies;
+	bool started;
+};
+
+static int motionTime;
+
+static bool motionCb(deltarobotnode::motionSrv::Request& req, deltarobotnode::motionSrv::Response& res) {
+	boost::this_thread::sleep(boost::posix_time::milliseconds(motionTime * req.motions.x.size()));
+	res.succeeded = true;
+	return true;
+}
+
+static bool gripperCb(deltarobotnode::gripper::Request&, deltarobotnode::gripper::Response&) {
+	return true;
+}
+
+static bool stopCb(deltarobotnode::stop::Request&, deltarobotnode::stop::Response& res) {
+	res.succeeded = true;
+	return true;
+}
+
+static std::vector<CrateContent*> createContent(bool full) {
+	std::vector<CrateContent*> content;
+	for(size_t i = 0; i < 4*4; i++) {
+		content.push_back(full ? new MiniBall(Color::BLUE) : NULL);
+	}
+	return content;
+}
+
+static void publish(ros::Publisher& pub, int event, const std::string& name, float x, float y, float angle) {
+	vision::CrateEventMsg msg;
+	msg.event = event;
+	msg.crate.name = name;
+	msg.crate.x = x;
+	msg.crate.y = y;
+	msg.crate.angle = angle;
+	pub.publish(msg);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+	if(sorted.empty()) { return 0; }
+	return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+int main(int argc, char** argv) {
+	enum { IN = 1, OUT, MOVING, MOVED };
+
+	ros::init(argc, argv, "crateEventStress");
+	ros::NodeHandle nodeHandle;
+	ros::NodeHandle privateHandle("~");
+
+	int eventRate, noiseCrates, crateMoveInterval;
+	double duration, maxLatency;
+	privateHandle.param("eventRate", eventRate, 1000);
+	privateHandle.param("noiseCrates", noiseCrates, 20);
+	privateHandle.param("motionTime", motionTime, 200);
+	privateHandle.param("crateMoveInterval", crateMoveInterval, 1500);
+	privateHandle.param("duration", duration, 20.0);
+	privateHandle.param("maxLatency", maxLatency, 50.0);
+
+	ros::ServiceServer motionServer = nodeHandle.advertiseService("stressMotion", motionCb);
+	ros::ServiceServer checkServer = nodeHandle.advertiseService("stressCheck", motionCb);
+	ros::ServiceServer gripperServer = nodeHandle.advertiseService("stressGrip", gripperCb);
+	ros::ServiceServer stopServer = nodeHandle.advertiseService("stressStop", stopCb);
+	ros::Publisher eventPub = nodeHandle.advertise<vision::CrateEventMsg>("stressCrateEvent", 1000);
+
+	CrateContentMap contentMap;
+	contentMap["source"] = createContent(true);
+	contentMap["destination"] = createContent(false);
+	std::vector<std::string> noise;
+	for(int i = 0; i < noiseCrates; i++) {
+		std::stringstream ss;
+		ss << NOISE << i;
+		noise.push_back(ss.str());
+		contentMap[ss.str()] = createContent(false);
+	}
+
+	//motions, gripper and crate events are handled concurrently, the spinner outlives the
+	//demo so the motion the action thread waits for at exit still finishes
+	ros::AsyncSpinner spinner(4);
+	size_t events = (size_t)(eventRate * duration) + 1;
+	StressDemo demo(nodeHandle, contentMap, events);
+	spinner.start();
+
+	while(eventPub.getNumSubscribers() == 0 && ros::ok()) {
+		ros::WallDuration(0.01).sleep();
+	}
+	for(size_t i = 0; i < noise.size(); i++) {
+		publish(eventPub, IN, noise[i], 0, 0, 0);
+	}
+	publish(eventPub, IN, "destination", 100, 0, 0);
+	publish(eventPub, IN, "source", -100, 0, 0);
+
+	ros::WallRate rate(eventRate);
+	ros::WallTime start = ros::WallTime::now();
+	ros::WallTime lastCrateMove = start;
+	float offset = 0;
+	for(size_t seq = 0; seq < events && ros::ok(); seq++) {
+		ros::WallTime now = ros::WallTime::now();
+		demo.setSent(seq, now);
+		publish(eventPub, MOVED, noise[seq % noise.size()], 0, seq, 0);
+
+		//move the crates in use, so the action thread has to validate its motions
+		if((now - lastCrateMove).toSec() * 1000.0 >= crateMoveInterval) {
+			lastCrateMove = now;
+			offset = offset == 0 ? 1 : 0;
+			publish(eventPub, MOVING, "destination", 100 + offset, 0, 0);
+			publish(eventPub, MOVED, "destination", 100 + offset, 0, 0);
+			publish(eventPub, MOVING, "source", -100 - offset, 0, 0);
+			publish(eventPub, MOVED, "source", -100 - offset, 0, 0);
+		}
+		rate.sleep();
+	}
+	double seconds = (ros::WallTime::now() - start).toSec();
+
+	//let the last events arrive
+	ros::WallDuration(0.5).sleep();
+
+	std::vector<double> latencies = demo.getLatencies();
+	std::sort(latencies.begin(), latencies.end());
+
+	size_t moved = 0;
+	for(size_t i = 0; i < contentMap["destination"].size(); i++) {
+		if(contentMap["destination"][i] != NULL) { moved++; }
+	}
+
+	printf("events:          %lu published, %lu handled in %.1f s\n", (unsigned long)events, (unsigned long)latencies.size(), seconds);
+	printf("latency p50:     %.3f ms\n", percentile(latencies, 0.50));
+	printf("latency p99:     %.3f ms\n", percentile(latencies, 0.99));
+	printf("latency max:     %.3f ms\n", latencies.empty() ? 0.0 : latencies.back());
+	printf("balls moved:     %lu\n", (unsigned long)moved);
+	printf("retried motions: %u\n", demo.getRetriedMotions());
+
+	if(latencies.empty() || latencies.back() > maxLatency) {
+		printf("FAILED: crate events waited longer than %.1f ms\n", maxLatency);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
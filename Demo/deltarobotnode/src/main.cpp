@@ -28,6 +28,9 @@
 //******************************************************************************
 #include <iostream>
 #include <stdexcept>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
 #include <huniplacer/huniplacer.h>
 #include <gripper/gripper.h>
 #include "ros/ros.h"
@@ -218,8 +221,37 @@ void calibrateAllMotors(steppermotor3& motors){
 
 int main(int argc, char** argv)
 {
-	grip = new gripper("192.168.0.2", 502);
-	grip->connect();
+	//--simulate[=time scale] runs on simulated motors without gripper, --timeline=file stores their motions on exit
+	//--device=path uses another serial port for the motor controllers, e.g. the pty of crd514_kd_emulator,
+	//--no-gripper and --no-calibration skip the parts that need the real robot
+	double time_scale = -1;
+	const char* timeline_path = NULL;
+	const char* device = crd514_kd::rtu_config::DEVICE;
+	bool use_gripper = true;
+	bool calibrate = true;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strncmp(argv[i], "--simulate", 10) == 0)
+		{
+			time_scale = argv[i][10] == '=' ? atof(argv[i] + 11) : 1;
+		}
+		else if(strncmp(argv[i], "--timeline=", 11) == 0)
+		{
+			timeline_path = argv[i] + 11;
+		}
+		else if(strncmp(argv[i], "--device=", 9) == 0)
+		{
+			device = argv[i] + 9;
+		}
+		else if(strcmp(argv[i], "--no-gripper") == 0)
+		{
+			use_gripper = false;
+		}
+		else if(strcmp(argv[i], "--no-calibration") == 0)
+		{
+			calibrate = false;
+		}
+	}
 
 	inverse_kinematics_impl kinematics(
 		measures::BASE,
@@ -228,23 +260,54 @@ int main(int argc, char** argv)
 		measures::ANKLE,
 		measures::HIP_ANKLE_ANGLE_MAX);
 
-	modbus_t* modbus_rtu = modbus_new_rtu(
-		"/dev/ttyS0",
-		crd514_kd::rtu_config::BAUDRATE,
-		crd514_kd::rtu_config::PARITY,
-		crd514_kd::rtu_config::DATA_BITS,
-		crd514_kd::rtu_config::STOP_BITS);
+	imotor3* motors;
+	simulated_motor3* simulation = NULL;
+	if(time_scale >= 0)
+	{
+		grip = NULL;
+		simulation = new simulated_motor3(measures::MOTOR_ROT_MIN, measures::MOTOR_ROT_MAX, simulation_config(time_scale));
+		simulation->power_on();
+		motors = simulation;
+	}
+	else
+	{
+		grip = NULL;
+		if(use_gripper)
+		{
+			grip = new gripper("192.168.0.2", 502);
+			grip->connect();
+		}
+
+		modbus_t* modbus_rtu = modbus_new_rtu(
+			device,
+			crd514_kd::rtu_config::BAUDRATE,
+			crd514_kd::rtu_config::PARITY,
+			crd514_kd::rtu_config::DATA_BITS,
+			crd514_kd::rtu_config::STOP_BITS);
 
-	double deviation[3] = {measures::MOTOR1_DEVIATION, measures::MOTOR2_DEVIATION, measures::MOTOR3_DEVIATION};
-	steppermotor3 motors(modbus_rtu, measures::MOTOR_ROT_MIN, measures::MOTOR_ROT_MAX, modbus_exhandler, deviation);
-	motors.power_on();
+		double deviation[3] = {measures::MOTOR1_DEVIATION, measures::MOTOR2_DEVIATION, measures::MOTOR3_DEVIATION};
+		steppermotor3* steppers = new steppermotor3(modbus_rtu, measures::MOTOR_ROT_MIN, measures::MOTOR_ROT_MAX, modbus_exhandler, deviation);
+		steppers->power_on();
 
-	calibrateAllMotors(motors);
+		if(calibrate)
+		{
+			calibrateAllMotors(*steppers);
+		}
+		motors = steppers;
+	}
 
-	robot = new huniplacer::deltarobot(kinematics, motors);
+	robot = new huniplacer::deltarobot(kinematics, *motors);
 	robot->generate_boundaries(2);
 	robot->power_on();
 
+	if(simulation != NULL)
+	{
+		//the simulated effector starts where deltarobot assumes it is
+		motionf home;
+		kinematics.point_to_motion(point3(0, 0, -161.9), home);
+		simulation->override_current_angles(home.angles);
+	}
+
 	ros::init(argc, argv, "Deltarobot");
 	ros::NodeHandle n;
 	ros::ServiceServer service1 = n.advertiseService("moveTo", moveTo);
@@ -267,10 +330,13 @@ int main(int argc, char** argv)
 	{
 		
 		//prevent the watchdog to trigger by sending the same command again
-		if(gripper_status)
-			grip->grab();
-		else
-			grip->release();
+		if(grip != NULL)
+		{
+			if(gripper_status)
+				grip->grab();
+			else
+				grip->release();
+		}
 
 		if(!previous_gripper_status && gripper_status)
 		{
@@ -281,7 +347,8 @@ int main(int argc, char** argv)
 			ROS_WARN("Gripper valve was turned on for longer than %d seconds. Gripper will be forced to turn off now to prevent overheating", MAX_GRIPPER_ON);
 			overheated = true;
 			got_overheated = ros::Time::now();
-			grip->release();
+			if(grip != NULL)
+				grip->release();
 			previous_gripper_status = gripper_status = false;
 		}
 		else if(overheated && (ros::Time::now() - got_overheated).toSec() > COOLDOWN_DURATION)
@@ -294,11 +361,21 @@ int main(int argc, char** argv)
 		ros::spinOnce();
 	}
 
-	grip->release();
+	if(grip != NULL)
+		grip->release();
 
     robot->wait_for_idle();
-	grip->disconnect();
+	if(grip != NULL)
+		grip->disconnect();
+
+	if(simulation != NULL && timeline_path != NULL)
+	{
+		std::ofstream timeline(timeline_path);
+		simulation->write_timeline(timeline);
+	}
 
+	delete robot;
+	delete motors;
 	return 0;
 }
 
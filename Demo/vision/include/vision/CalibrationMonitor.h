@@ -0,0 +1,138 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        VisionNode
+// File:           CalibrationMonitor.h
+// Description:    keeps the fiducial calibration up to date in the background while the node is running.
+// Author:         agent
+// Notes:          ...
+//
+// License:        GNU GPL v3
+//
+// This file is part of VisionNode.
+//
+// VisionNode is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// VisionNode is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+#pragma once
+#include <FiducialDetector.h>
+#include <CameraCalibration/RectifyImage.h>
+#include <pcrctransformation/transform_engine.hpp>
+#include <pcrctransformation/point2f.hpp>
+#include <Profiler/Profiler.h>
+#include <opencv2/core/core.hpp>
+#include <boost/thread.hpp>
+#include <vector>
+
+/**
+ * Keeps the calibration markers up to date without stopping the main loop.
+ * Every sampleInterval-th frame the windows around the known markers are copied
+ * and handed to a low priority worker thread, which only looks for the fiducials inside those windows.
+ * The worker keeps the median of the last samples of every marker. When one of the medians drifts
+ * further than the threshold from the markers in use, it builds a new transformer,
+ * which the main loop swaps in between two frames.
+ */
+class CalibrationMonitor{
+public:
+	/**
+	 * the constructor, starts the worker thread
+	 * @param detector the settings of the fiducial detector, the monitor uses a copy
+	 * @param realCoordinates the real life coordinates of the fiducials, in the order of the markers
+	 * @param sampleInterval sample one in this many offered frames
+	 * @param samples the number of samples of every marker the median is taken over
+	 * @param driftThreshold the amount of pixels a marker has to drift before the transformer is replaced
+	 * @param undistorter if not NULL, the offered frames are not rectified and the markers are undistorted before building the transformer
+	 */
+	CalibrationMonitor(const FiducialDetector& detector, const pcrctransformation::point2f::point2fvector& realCoordinates,
+			int sampleInterval = 15, unsigned int samples = 25, double driftThreshold = 1.0, const RectifyImage* undistorter = NULL);
+	/**
+	 * the destructor, stops the worker thread
+	 */
+	~CalibrationMonitor();
+
+	/**
+	 * sets the markers of the transformer that is in use and clears the collected samples
+	 * @param markers the pixel coordinates of the markers, ordered like the real life coordinates
+	 */
+	void setMarkers(const pcrctransformation::point2f::point2fvector& markers);
+
+	/**
+	 * offers a rectified grayscale frame. Copies the marker windows if the frame is sampled and the worker is idle, never waits for the worker.
+	 * @param gray the frame
+	 */
+	void offer(const cv::Mat& gray);
+
+	/**
+	 * replaces the transformer with the next complete estimate, even if the markers did not drift
+	 */
+	void forceUpdate();
+
+	/**
+	 * takes the transformer built by the worker, if there is one
+	 * @param markers is set to the markers of the new transformer, in the coordinates of the offered frames
+	 * @param drift is set to the largest marker drift in pixels that caused the update
+	 * @return the new transformer, owned by the caller, or NULL
+	 */
+	pcrctransformation::transform_engine* takeTransformer(pcrctransformation::point2f::point2fvector& markers, double& drift);
+
+	/**
+	 * @return the number of sampled frames in which not all markers were found
+	 */
+	unsigned int getFailures();
+
+private:
+	FiducialDetector detector;
+	pcrctransformation::point2f::point2fvector realCoordinates;
+	int sampleInterval;
+	unsigned int samples;
+	double driftThreshold;
+	const RectifyImage* undistorter;
+	int frameCount;
+	profiler::StageId detectStage;
+
+	boost::thread worker;
+	boost::mutex mutex;
+	boost::condition_variable sampleReady;
+	bool stopping;
+	bool busy;
+	bool force;
+	unsigned int failures;
+	//incremented by setMarkers, samples taken before that are dropped
+	unsigned int generation;
+
+	//the markers the transformer in use was built with, and the current estimate
+	std::vector<cv::Point2f> applied;
+	std::vector<cv::Point2f> estimate;
+	//the last samples of every marker, a ring buffer of the given size
+	std::vector<std::vector<cv::Point2f> > history;
+	unsigned int historyCount;
+	unsigned int historyNext;
+
+	//the copied windows and their position in the frame, only touched by the worker while busy
+	std::vector<cv::Mat> windows;
+	std::vector<cv::Point> offsets;
+
+	pcrctransformation::transform_engine* ready;
+	pcrctransformation::point2f::point2fvector readyMarkers;
+	double readyDrift;
+
+	void run();
+	void process();
+	void update(const std::vector<cv::Point2f>& found, unsigned int sampleGeneration);
+	static float median(std::vector<float>& values);
+
+	CalibrationMonitor(const CalibrationMonitor&);
+	CalibrationMonitor& operator=(const CalibrationMonitor&);
+};
@@ -0,0 +1,83 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        VisionNode
+// File:           CrateSnapshotEncoder.h
+// Description:    turns the tracked crates of every frame into full or delta snapshot messages.
+// Author:         agent
+// Notes:          ...
+//
+// License:        GNU GPL v3
+//
+// This file is part of VisionNode.
+//
+// VisionNode is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// VisionNode is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+#pragma once
+#include <vision/CrateTracker.h>
+#include <vision/CrateSnapshotMsg.h>
+#include <ros/ros.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Builds the crateSnapshot message of every processed frame.
+ * Every keyframeInterval frames a full snapshot with all tracked crates is built, in between only
+ * a delta with the crates that were added or changed and the names of the crates that were removed.
+ * A frame in which nothing changed gives no message at all, so a still scene costs one message per keyframe.
+ * Every delta names the sequence number of the snapshot before it, so a receiver that missed one knows
+ * it has to wait for the next full snapshot.
+ */
+class CrateSnapshotEncoder{
+public:
+	/**
+	 * the constructor
+	 * @param keyframeInterval a full snapshot is built at least once in this many frames
+	 */
+	CrateSnapshotEncoder(unsigned int keyframeInterval = 30);
+
+	/**
+	 * builds the snapshot of a frame
+	 * @param seq the sequence number of the frame
+	 * @param stamp the capture time of the frame
+	 * @param crates the tracked crates after the frame, as returned by CrateTracker::getAllCrates
+	 * @param msg receives the snapshot
+	 * @return true if msg has to be published, false if nothing changed since the last snapshot
+	 */
+	bool encode(uint32_t seq, const ros::Time& stamp, std::vector<exCrate>& crates, vision::CrateSnapshotMsg& msg);
+
+	/**
+	 * makes the next snapshot a full one, for example when a subscriber connects
+	 */
+	void requestKeyframe();
+
+private:
+	struct PublishedCrate{
+		int state;
+		float x, y, angle;
+	};
+
+	unsigned int keyframeInterval;
+	unsigned int framesSinceKeyframe;
+	bool keyframeRequested;
+	bool published;
+	uint32_t lastSeq;
+	/**
+	 * the crates as the receivers know them after the last snapshot
+	 */
+	std::map<std::string, PublishedCrate> known;
+};
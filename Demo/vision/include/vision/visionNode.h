@@ -27,14 +27,18 @@
 // along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
 //******************************************************************************
 #pragma once
-#include <pcrctransformation/pcrctransformer.hpp>
+#include <pcrctransformation/transform_engine.hpp>
 #include <pcrctransformation/point2f.hpp>
 #include <CameraCalibration/RectifyImage.h>
 #include <unicap_cv_bridge.hpp>
+#include <FrameSource/FrameSource.h>
+#include <Profiler/Profiler.h>
 #include <FiducialDetector.h>
 #include <QRCodeDetector.h>
 #include <Crate.h>
 #include <vision/CrateTracker.h>
+#include <vision/CalibrationMonitor.h>
+#include <vision/CrateSnapshotEncoder.h>
 #include "ros/ros.h"
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -43,10 +47,12 @@
 #include <sstream>
 
 #include <vision/CrateEventMsg.h>
+#include <vision/CrateSnapshotMsg.h>
 #include <vision/error.h>
 #include <vision/getCrate.h>
 #include <vision/getAllCrates.h>
 #include <std_srvs/Empty.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 
 class visionNode{
 public:
@@ -82,20 +88,34 @@ public:
 	 */
 	bool getAllCrates(vision::getAllCrates::Request &req,vision::getAllCrates::Response &res);
 	/**
-	 * callback function for the recalibrate services of ROS
+	 * callback function for the recalibrate services of ROS.
+	 * with continuous calibration the markers are replaced by the next background estimate, otherwise a full calibration is done before the next frame
 	 * @param req the request object
 	 * @param res the response object
 	 * @return
 	 */
 	bool recalibrate(std_srvs::Empty &req, std_srvs::Empty &res);
+	/**
+	 * callback for a new subscriber of the crateSnapshot topic, makes the next snapshot a full one
+	 * @param pub the publisher of the new subscriber
+	 */
+	void snapshotSubscriberConnected(const ros::SingleSubscriberPublisher& pub);
+
+	/**
+	 * converts points of the frame the detection runs on to real life coordinates
+	 * @param points the pixel coordinates, replaced by the real life coordinates
+	 */
+	void pixelToWorld(pcrctransformation::point2f::point2fvector& points);
 
 private:
-	unicap_cv_bridge::unicap_cv_camera * cam;
+	framesource::FrameSource * cam;
 	FiducialDetector * fidDetector;
 	QRCodeDetector * qrDetector;
-	pcrctransformation::pc_rc_transformer * cordTransformer;
+	pcrctransformation::transform_engine * cordTransformer;
 	RectifyImage * rectifier;
 	CrateTracker * crateTracker;
+	CalibrationMonitor * calibrationMonitor;
+	CrateSnapshotEncoder * snapshotEncoder;
 	pcrctransformation::point2f::point2fvector markers;
 
 	cv::Mat camFrame;
@@ -103,14 +123,42 @@ private:
 
 	ros::NodeHandle node;
 	ros::Publisher crateEventPublisher;
+	ros::Publisher crateSnapshotPublisher;
 	ros::Publisher ErrorPublisher;
 	ros::ServiceServer getCrateService;
 	ros::ServiceServer getAllCratesService;
+	ros::ServiceServer recalibrateService;
+	ros::Publisher diagnosticsPublisher;
+
+	profiler::StageId grabStage;
+	profiler::StageId rectifyStage;
+	profiler::StageId grayStage;
+	profiler::StageId detectStage;
+	profiler::StageId fiducialStage;
+	profiler::StageId transformStage;
+	profiler::StageId trackStage;
+	profiler::StageId publishStage;
+	profiler::StageId guiStage;
+	profiler::StageId frameStage;
+	profiler::StageId frameLatencyStage;
+	profiler::StageId eventLatencyStage;
+	double diagnosticsPeriod;
+	ros::WallTime lastDiagnostics;
 
 	double crateMovementThresshold;
 	int numberOfStableFrames;
 	bool invokeCalibration;
+	bool undistortPoints;
+	uint32_t frameSequence;
 
 	bool calibrate(unsigned int measurements = 100, int maxErrors = 100);
+	/**
+	 * replaces the coordinate transformer if the calibration monitor has built a new one
+	 */
+	void applyCalibrationUpdate();
+	/**
+	 * publishes the stage timings on /diagnostics, at most once per diagnosticsPeriod
+	 */
+	void publishDiagnostics();
 	void printUsage(char* invokeName);
 };
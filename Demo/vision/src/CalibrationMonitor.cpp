@@ -0,0 +1,237 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        VisionNode
+// File:           CalibrationMonitor.cpp
+// Description:    keeps the fiducial calibration up to date in the background while the node is running.
+// Author:         agent
+// Notes:          ...
+//
+// License:        GNU GPL v3
+//
+// This file is part of VisionNode.
+//
+// VisionNode is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// VisionNode is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+#include <vision/CalibrationMonitor.h>
+#include <FiducialDetector.h>
+#include <pcrctransformation/transform_engine.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace pcrctransformation;
+
+CalibrationMonitor::CalibrationMonitor(const FiducialDetector& detector, const point2f::point2fvector& realCoordinates,
+		int sampleInterval, unsigned int samples, double driftThreshold, const RectifyImage* undistorter) :
+		detector(detector), realCoordinates(realCoordinates), sampleInterval(sampleInterval), samples(samples),
+		driftThreshold(driftThreshold), undistorter(undistorter), frameCount(0), stopping(false), busy(false), force(false), failures(0),
+		generation(0), historyCount(0), historyNext(0), ready(NULL), readyDrift(0) {
+	if(this->sampleInterval < 1) this->sampleInterval = 1;
+	if(this->samples < 1) this->samples = 1;
+	detectStage = profiler::Profiler::instance().stage("background fiducial detect");
+	worker = boost::thread(boost::bind(&CalibrationMonitor::run, this));
+}
+
+CalibrationMonitor::~CalibrationMonitor(){
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		stopping = true;
+	}
+	sampleReady.notify_one();
+	worker.join();
+	delete ready;
+}
+
+void CalibrationMonitor::setMarkers(const point2f::point2fvector& markers){
+	boost::lock_guard<boost::mutex> lock(mutex);
+	applied.clear();
+	for(point2f::point2fvector::const_iterator it = markers.begin(); it != markers.end(); ++it){
+		applied.push_back(cv::Point2f(it->x, it->y));
+	}
+	estimate = applied;
+	history.assign(applied.size(), std::vector<cv::Point2f>(samples));
+	historyCount = 0;
+	historyNext = 0;
+	generation++;
+	//a transformer that was built for the old markers is outdated as well
+	delete ready;
+	ready = NULL;
+}
+
+void CalibrationMonitor::offer(const cv::Mat& gray){
+	if(++frameCount < sampleInterval) return;
+
+	boost::lock_guard<boost::mutex> lock(mutex);
+	//skip the frame if the worker is still busy with the previous one
+	if(busy || estimate.empty()) return;
+	frameCount = 0;
+
+	//a window large enough for the marker to move a radius in any direction
+	int half = detector.maxRad * 2;
+	cv::Rect frameRect(0, 0, gray.cols, gray.rows);
+	windows.resize(estimate.size());
+	offsets.resize(estimate.size());
+	for(unsigned int i = 0; i < estimate.size(); i++){
+		cv::Rect window(cv::saturate_cast<int>(estimate[i].x) - half, cv::saturate_cast<int>(estimate[i].y) - half, half * 2, half * 2);
+		window &= frameRect;
+		offsets[i] = window.tl();
+		if(window.area() == 0){
+			windows[i].release();
+		} else {
+			gray(window).copyTo(windows[i]);
+		}
+	}
+	busy = true;
+	sampleReady.notify_one();
+}
+
+void CalibrationMonitor::forceUpdate(){
+	boost::lock_guard<boost::mutex> lock(mutex);
+	force = true;
+}
+
+transform_engine* CalibrationMonitor::takeTransformer(point2f::point2fvector& markers, double& drift){
+	boost::lock_guard<boost::mutex> lock(mutex);
+	transform_engine* result = ready;
+	if(result != NULL){
+		markers = readyMarkers;
+		drift = readyDrift;
+		ready = NULL;
+	}
+	return result;
+}
+
+unsigned int CalibrationMonitor::getFailures(){
+	boost::lock_guard<boost::mutex> lock(mutex);
+	return failures;
+}
+
+void CalibrationMonitor::run(){
+	//calibrating may only use the time the main loop leaves unused
+#ifdef SCHED_IDLE
+	sched_param param;
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+	boost::unique_lock<boost::mutex> lock(mutex);
+	while(true){
+		while(!busy && !stopping) sampleReady.wait(lock);
+		if(stopping) return;
+		lock.unlock();
+		process();
+		lock.lock();
+		busy = false;
+	}
+}
+
+void CalibrationMonitor::process(){
+	std::vector<cv::Point2f> expected;
+	unsigned int sampleGeneration;
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		expected = estimate;
+		sampleGeneration = generation;
+	}
+
+	//the marker is the detected fiducial closest to where it was expected
+	std::vector<cv::Point2f> found(windows.size(), cv::Point2f(-1, -1));
+	for(unsigned int i = 0; i < windows.size() && i < expected.size(); i++){
+		if(windows[i].empty()) continue;
+		std::vector<cv::Point2f> points;
+		{
+			profiler::ScopedTimer timer(detectStage);
+			detector.detect(windows[i], points);
+		}
+
+		cv::Point2f local(expected[i].x - offsets[i].x, expected[i].y - offsets[i].y);
+		float best = detector.maxRad * detector.maxRad;
+		for(std::vector<cv::Point2f>::iterator it = points.begin(); it != points.end(); ++it){
+			cv::Point2f d = *it - local;
+			float distance = d.dot(d);
+			if(distance < best){
+				best = distance;
+				found[i] = cv::Point2f(it->x + offsets[i].x, it->y + offsets[i].y);
+			}
+		}
+	}
+	update(found, sampleGeneration);
+}
+
+void CalibrationMonitor::update(const std::vector<cv::Point2f>& found, unsigned int sampleGeneration){
+	boost::lock_guard<boost::mutex> lock(mutex);
+	if(sampleGeneration != generation || found.size() != history.size()) return;
+
+	//only complete samples are used, so the markers stay consistent with each other
+	for(unsigned int i = 0; i < found.size(); i++){
+		if(found[i].x < 0){
+			failures++;
+			return;
+		}
+	}
+	for(unsigned int i = 0; i < found.size(); i++){
+		history[i][historyNext] = found[i];
+	}
+	historyNext = (historyNext + 1) % samples;
+	if(historyCount < samples) historyCount++;
+	if(historyCount < samples) return;
+
+	//running median of every marker
+	std::vector<float> xs(historyCount), ys(historyCount);
+	double drift = 0;
+	for(unsigned int i = 0; i < history.size(); i++){
+		for(unsigned int n = 0; n < historyCount; n++){
+			xs[n] = history[i][n].x;
+			ys[n] = history[i][n].y;
+		}
+		estimate[i] = cv::Point2f(median(xs), median(ys));
+		cv::Point2f d = estimate[i] - applied[i];
+		drift = std::max(drift, (double)std::sqrt(d.dot(d)));
+	}
+
+	if(drift <= driftThreshold && !force) return;
+
+	point2f::point2fvector markers;
+	for(unsigned int i = 0; i < estimate.size(); i++){
+		markers.push_back(point2f(estimate[i].x, estimate[i].y));
+	}
+	point2f::point2fvector fiducials = markers;
+	if(undistorter != NULL) undistorter->undistortPoints(&fiducials[0].x, &fiducials[0].x, fiducials.size());
+	transform_engine* transformer;
+	try {
+		transformer = new transform_engine(realCoordinates, fiducials);
+	} catch(std::runtime_error&) {
+		return;
+	}
+	delete ready;
+	ready = transformer;
+	readyMarkers = markers;
+	readyDrift = drift;
+	applied = estimate;
+	force = false;
+}
+
+float CalibrationMonitor::median(std::vector<float>& values){
+	std::vector<float>::iterator n = values.begin() + values.size() / 2;
+	std::nth_element(values.begin(), n, values.end());
+	if(values.size() % 2 == 1) return *n;
+	//the lower middle is the largest value in front of n
+	return (*n + *std::max_element(values.begin(), n)) / 2.0f;
+}
@@ -0,0 +1,93 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        VisionNode
+// File:           CrateSnapshotEncoder.cpp
+// Description:    turns the tracked crates of every frame into full or delta snapshot messages.
+// Author:         agent
+// Notes:          ...
+//
+// License:        GNU GPL v3
+//
+// This file is part of VisionNode.
+//
+// VisionNode is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// VisionNode is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+#include <vision/CrateSnapshotEncoder.h>
+
+CrateSnapshotEncoder::CrateSnapshotEncoder(unsigned int keyframeInterval) :
+		keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1), framesSinceKeyframe(0),
+		keyframeRequested(false), published(false), lastSeq(0) {
+}
+
+void CrateSnapshotEncoder::requestKeyframe(){
+	keyframeRequested = true;
+}
+
+bool CrateSnapshotEncoder::encode(uint32_t seq, const ros::Time& stamp, std::vector<exCrate>& crates, vision::CrateSnapshotMsg& msg){
+	framesSinceKeyframe++;
+	bool full = keyframeRequested || !published || framesSinceKeyframe >= keyframeInterval;
+
+	msg.seq = seq;
+	msg.stamp = stamp;
+	msg.full = full;
+	msg.baseSeq = full ? 0 : lastSeq;
+	msg.states.clear();
+	msg.crates.clear();
+	msg.removed.clear();
+
+	std::map<std::string, PublishedCrate> current;
+	for(std::vector<exCrate>::iterator it = crates.begin(); it != crates.end(); ++it){
+		cv::RotatedRect rect = it->rect();
+		PublishedCrate crate;
+		crate.state = it->getState();
+		crate.x = rect.center.x;
+		crate.y = rect.center.y;
+		crate.angle = rect.angle;
+		current[it->name] = crate;
+
+		//a delta only holds what the receivers do not know yet
+		if(!full){
+			std::map<std::string, PublishedCrate>::iterator old = known.find(it->name);
+			if(old != known.end() && old->second.state == crate.state && old->second.x == crate.x
+					&& old->second.y == crate.y && old->second.angle == crate.angle){
+				continue;
+			}
+		}
+		vision::CrateMsg crateMsg;
+		crateMsg.name = it->name;
+		crateMsg.x = crate.x;
+		crateMsg.y = crate.y;
+		crateMsg.angle = crate.angle;
+		msg.states.push_back(crate.state);
+		msg.crates.push_back(crateMsg);
+	}
+	if(!full){
+		for(std::map<std::string, PublishedCrate>::iterator it = known.begin(); it != known.end(); ++it){
+			if(current.find(it->first) == current.end()) msg.removed.push_back(it->first);
+		}
+		if(msg.crates.empty() && msg.removed.empty()) return false;
+	}
+
+	known.swap(current);
+	published = true;
+	lastSeq = seq;
+	if(full){
+		keyframeRequested = false;
+		framesSinceKeyframe = 0;
+	}
+	return true;
+}
@@ -27,16 +27,19 @@
 // along with VisionNode.  If not, see <http://www.gnu.org/licenses/>.
 //******************************************************************************
 #include <vision/visionNode.h>
-#include <pcrctransformation/pcrctransformer.hpp>
+#include <pcrctransformation/transform_engine.hpp>
 #include <pcrctransformation/point2f.hpp>
 #include <CameraCalibration/RectifyImage.h>
 #include <unicap_cv_bridge.hpp>
+#include <FrameSource/UnicapSource.h>
+#include <FrameSource/ReplaySource.h>
 #include <FiducialDetector.h>
 #include <QRCodeDetector.h>
 #include <Crate.h>
 #include <ros/ros.h>
 
 #include <vision/CrateEventMsg.h>
+#include <vision/CrateSnapshotMsg.h>
 #include <vision/error.h>
 #include <vision/getCrate.h>
 #include <vision/getAllCrates.h>
@@ -46,9 +49,13 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <iostream>
 #include <sstream>
+#include <iomanip>
 #include <map>
+#include <cstdlib>
+#include <cstring>
 
 using namespace unicap_cv_bridge;
+using namespace framesource;
 using namespace pcrctransformation;
 using namespace std;
 using namespace cv;
@@ -56,24 +63,35 @@ using namespace cv;
 //on mouse click event, print the real life coordinate at the clicked pixel
 void on_mouse(int event, int x, int y, int flags, void* param){
 	if(event == CV_EVENT_LBUTTONDOWN){
-		pc_rc_transformer* cordTransformer = (pc_rc_transformer*)param;
-		point2f result = cordTransformer->to_rc(point2f(x, y));
+		//param is the visionNode, which looks up its current transformer on every click
+		visionNode* node = (visionNode*)param;
+		point2f::point2fvector points(1, point2f(x, y));
+		node->pixelToWorld(points);
+		point2f result = points[0];
 		ROS_INFO("X: %f, Y:%f", result.x, result.y);
 	}
 }
 
 visionNode::visionNode(int argc, char* argv[]){
-		if (argc != 4){
+		bool replay = argc > 1 && !strcmp(argv[1], "replay");
+		if (argc != 4 && !(replay && argc == 5)){
 			printUsage(argv[0]);
 			exit(1);
 		}
-		//setup the camera
-		int device_number = atoi(argv[1]);
-		int format_number = atoi(argv[2]);
-		cam = new unicap_cv_camera(device_number,format_number);
-		cam->set_auto_white_balance(true);
-		cam->set_exposure(0.015);
-		camFrame = Mat(cam->get_img_height(), cam->get_img_width(), cam->get_img_format());
+		if(replay){
+			//replay a recording instead of using the camera
+			double rate = argc == 5 ? atof(argv[4]) : ReplaySource::RECORDED_RATE;
+			cam = new ReplaySource(argv[2], rate);
+		} else {
+			//setup the camera
+			int device_number = atoi(argv[1]);
+			int format_number = atoi(argv[2]);
+			UnicapSource* unicap = new UnicapSource(device_number,format_number);
+			unicap->get_camera().set_auto_white_balance(true);
+			unicap->get_camera().set_exposure(0.015);
+			cam = unicap;
+		}
+		camFrame = Mat(cam->get_size(), cam->get_format());
 
 		//setup the fiducial detector
 		fidDetector = new FiducialDetector();
@@ -92,7 +110,7 @@ visionNode::visionNode(int argc, char* argv[]){
 		rc.push_back(point2f(61.5 + 1.5, 110.5));
 		rc.push_back(point2f(-62.5 + 1.5, 113.5));
 		rc.push_back(point2f(-65 + 1.5, -74));
-		cordTransformer= new pc_rc_transformer(rc,rc);
+		cordTransformer= new transform_engine(rc,rc);
 
 		//crate tracking configuration
 		//the amount of mm a point has to move before we mark it as moving.
@@ -103,22 +121,76 @@ visionNode::visionNode(int argc, char* argv[]){
 
 		//setup the camera lens distortion corrector
 		rectifier = new RectifyImage();
-		if(!rectifier->initRectify(argv[3], cv::Size( cam->get_img_width(),cam->get_img_height()))){
+		if(!rectifier->initRectify(argv[3], cam->get_size())){
 			cout << "XML not found" << endl;
 			exit(2);
 		}
 
 		invokeCalibration = false;
 
+		//continuous calibration: detect the markers on every calibration_interval-th frame in the background,
+		//and replace the transformer when their median drifts more than calibration_drift pixels
+		ros::NodeHandle privateNode("~");
+		bool continuousCalibration;
+		int calibrationInterval, calibrationSamples;
+		double calibrationDrift;
+		privateNode.param("continuous_calibration", continuousCalibration, true);
+		privateNode.param("calibration_interval", calibrationInterval, 15);
+		privateNode.param("calibration_samples", calibrationSamples, 25);
+		privateNode.param("calibration_drift", calibrationDrift, 1.0);
+
+		//undistort_points: detect on the unrectified frame and only undistort the detected points,
+		//instead of rectifying every frame
+		privateNode.param("undistort_points", undistortPoints, false);
+
+		calibrationMonitor = NULL;
+		if(continuousCalibration){
+			calibrationMonitor = new CalibrationMonitor(*fidDetector, rc, calibrationInterval, calibrationSamples, calibrationDrift,
+					undistortPoints ? rectifier : NULL);
+		}
+
+		//pipeline instrumentation
+		profiler::Profiler& prof = profiler::Profiler::instance();
+		grabStage = prof.stage("grab");
+		rectifyStage = prof.stage("rectify");
+		grayStage = prof.stage("gray");
+		detectStage = prof.stage("qr detect");
+		fiducialStage = prof.stage("fiducial detect");
+		transformStage = prof.stage("transform");
+		trackStage = prof.stage("track");
+		publishStage = prof.stage("publish");
+		guiStage = prof.stage("gui");
+		frameStage = prof.stage("frame");
+		frameLatencyStage = prof.stage("frame latency");
+		eventLatencyStage = prof.stage("frame to event latency");
+
+		//crate snapshots: a full snapshot at least every snapshot_keyframe_interval frames, deltas in between
+		int keyframeInterval;
+		privateNode.param("snapshot_keyframe_interval", keyframeInterval, 30);
+		snapshotEncoder = new CrateSnapshotEncoder(keyframeInterval);
+		frameSequence = 0;
+
+		privateNode.param("diagnostics_period", diagnosticsPeriod, 1.0);
+		std::string traceFile;
+		privateNode.param("trace_file", traceFile, std::string(""));
+		if(!traceFile.empty() && !prof.enableTrace(traceFile)){
+			ROS_WARN("Could not open trace file %s", traceFile.c_str());
+		}
+		lastDiagnostics = ros::WallTime::now();
+
 		//ROS things
 		crateEventPublisher = node.advertise<vision::CrateEventMsg>("crateEvent", 100);
+		crateSnapshotPublisher = node.advertise<vision::CrateSnapshotMsg>("crateSnapshot", 10,
+				boost::bind(&visionNode::snapshotSubscriberConnected, this, _1));
 		ErrorPublisher = node.advertise<vision::error>("visionError", 100);
 		getCrateService = node.advertiseService("getCrate", &visionNode::getCrate, this);
 		getAllCratesService = node.advertiseService("getAllCrates", &visionNode::getAllCrates, this);
+		recalibrateService = node.advertiseService("recalibrate", &visionNode::recalibrate, this);
+		diagnosticsPublisher = node.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
 
 		//GUI stuff
 		cv::namedWindow("image", CV_WINDOW_AUTOSIZE);
-		cvSetMouseCallback("image", &on_mouse, cordTransformer);
+		cvSetMouseCallback("image", &on_mouse, this);
 }
 
 bool visionNode::getCrate(vision::getCrate::Request &req,vision::getCrate::Response &res)
@@ -162,11 +234,19 @@ bool visionNode::getAllCrates(vision::getAllCrates::Request &req,vision::getAllC
 }
 
 bool visionNode::recalibrate(std_srvs::Empty &req, std_srvs::Empty &res){
-	invokeCalibration = true;
+	if(calibrationMonitor != NULL) calibrationMonitor->forceUpdate();
+	else invokeCalibration = true;
 	return true;
 }
 
+void visionNode::snapshotSubscriberConnected(const ros::SingleSubscriberPublisher& pub){
+	//called from spinOnce in the main loop, the encoder is not in use
+	snapshotEncoder->requestKeyframe();
+}
+
 visionNode::~visionNode(){
+	delete snapshotEncoder;
+	delete calibrationMonitor;
 	delete cam;
 	delete fidDetector;
 	delete qrDetector;
@@ -177,6 +257,7 @@ visionNode::~visionNode(){
 
 void visionNode::printUsage(char* invokeName){
 	printf("usage for starting capture: %s device_number format_number correction xml\n", invokeName);
+	printf("usage for replaying a recording: %s replay image_directory|video_file correction xml [fps|0 for max speed]\n", invokeName);
 }
 
 bool xComp(cv::Point2f i, cv::Point2f j) { return (i.x<j.x); }
@@ -213,13 +294,20 @@ bool visionNode::calibrate(unsigned int measurements, int maxErrors){
 	unsigned int measurementCount = 0;
 	unsigned int failCount = 0;
 	while(measurementCount<measurements && (maxErrors<0 || failCount<maxErrors)){
-		cam->get_frame(&camFrame);
-		rectifier->rectify(camFrame, rectifiedCamFrame);
+		if(!cam->get_frame(camFrame)) break;
 		cv::Mat gray;
-		cv::cvtColor(rectifiedCamFrame, gray, CV_BGR2GRAY);
+		if(undistortPoints){
+			cv::cvtColor(camFrame, gray, CV_BGR2GRAY);
+		} else {
+			rectifier->rectify(camFrame, rectifiedCamFrame);
+			cv::cvtColor(rectifiedCamFrame, gray, CV_BGR2GRAY);
+		}
 
 		std::vector<cv::Point2f> fiducialPoints;
-		fidDetector->detect(gray, fiducialPoints);
+		{
+			profiler::ScopedTimer timer(fiducialStage);
+			fidDetector->detect(gray, fiducialPoints);
+		}
 		if(fiducialPoints.size() == 3) {
 			measurementCount++;
 			Crate::order(fiducialPoints);
@@ -237,10 +325,14 @@ bool visionNode::calibrate(unsigned int measurements, int maxErrors){
 		cv::Point2f fid2(medianX(fid2_buffer), medianY(fid2_buffer));
 		cv::Point2f fid3(medianX(fid3_buffer), medianY(fid3_buffer));
 
+		markers.clear();
 		markers.push_back(point2f(fid1.x, fid1.y));
 		markers.push_back(point2f(fid2.x, fid2.y));
 		markers.push_back(point2f(fid3.x, fid3.y));
-		cordTransformer->set_fiducials_pixel_coordinates(markers);
+		point2f::point2fvector fiducials = markers;
+		if(undistortPoints) rectifier->undistortPoints(&fiducials[0].x, &fiducials[0].x, fiducials.size());
+		cordTransformer->set_fiducials_pixel_coordinates(fiducials);
+		if(calibrationMonitor != NULL) calibrationMonitor->setMarkers(markers);
 
 		// Determine mean deviation
 		double totalDistance = 0;
@@ -256,12 +348,81 @@ bool visionNode::calibrate(unsigned int measurements, int maxErrors){
 	return false;
 }
 
+void visionNode::pixelToWorld(point2f::point2fvector& points){
+	if(points.empty()) return;
+	if(undistortPoints) rectifier->undistortPoints(&points[0].x, &points[0].x, points.size());
+	cordTransformer->to_rc(points, points);
+}
+
+void visionNode::applyCalibrationUpdate(){
+	point2f::point2fvector newMarkers;
+	double drift;
+	transform_engine* newTransformer = calibrationMonitor->takeTransformer(newMarkers, drift);
+	if(newTransformer == NULL) return;
+
+	//only the main loop uses the transformer, swapping it between two frames is atomic for the pipeline
+	delete cordTransformer;
+	cordTransformer = newTransformer;
+	markers = newMarkers;
+	ROS_INFO("Calibration markers updated in the background. Drift: %f pixels Failed samples: %u", drift, calibrationMonitor->getFailures());
+}
+
+void visionNode::publishDiagnostics(){
+	ros::WallTime now = ros::WallTime::now();
+	double elapsed = (now - lastDiagnostics).toSec();
+	if(elapsed < diagnosticsPeriod) return;
+	lastDiagnostics = now;
+
+	profiler::Profiler& prof = profiler::Profiler::instance();
+	prof.flushTrace();
+	std::vector<profiler::StageStats> stats;
+	prof.snapshot(stats);
+
+	diagnostic_msgs::DiagnosticStatus status;
+	status.level = diagnostic_msgs::DiagnosticStatus::OK;
+	status.name = "vision: pipeline";
+	status.hardware_id = "camera";
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1) << stats[frameStage].histogram.count() / elapsed << " fps";
+	status.message = ss.str();
+
+	for(std::vector<profiler::StageStats>::iterator it = stats.begin(); it != stats.end(); ++it){
+		const profiler::Histogram& h = it->histogram;
+		if(h.count() == 0) continue;
+
+		const char* names[] = { "p50", "p90", "p99", "max" };
+		const double percentiles[] = { 50, 90, 99, 100 };
+		for(int i = 0; i < 4; i++){
+			diagnostic_msgs::KeyValue value;
+			ss.str("");
+			ss << it->name << " " << names[i] << " (ms)";
+			value.key = ss.str();
+			ss.str("");
+			ss << std::setprecision(3) << h.percentile(percentiles[i]) / 1000.0;
+			value.value = ss.str();
+			status.values.push_back(value);
+		}
+		diagnostic_msgs::KeyValue count;
+		count.key = it->name + " count";
+		ss.str("");
+		ss << h.count();
+		count.value = ss.str();
+		status.values.push_back(count);
+	}
+
+	diagnostic_msgs::DiagnosticArray msg;
+	msg.header.stamp = ros::Time::now();
+	msg.status.push_back(status);
+	diagnosticsPublisher.publish(msg);
+}
+
 void visionNode::run(){
 	//run initial calibration. If that fails, this node will shut down.
 	if(!calibrate()) ros::shutdown();
 	
 	VideoWriter outputVideo;
-	Size S = cv::Size(cam->get_img_width(),cam->get_img_height());
+	Size S = cam->get_size();
 	outputVideo.open("/home/lcv/output.avi" , CV_FOURCC('M','P','2','V'), 30, S, true);
 
 	//main loop
@@ -272,61 +433,132 @@ void visionNode::run(){
 			invokeCalibration = false;
 			calibrate();
 		}
+		if(calibrationMonitor != NULL) applyCalibrationUpdate();
 
-		//grab frame from camera
-		cam->get_frame(&camFrame);
+		uint64_t frameStart = profiler::now();
+		boost::posix_time::ptime captureTime;
 
-		//correct the lens distortion
-		rectifier->rectify(camFrame, rectifiedCamFrame);
+		//grab frame from camera, a replay ends the node when it runs out of frames
+		{
+			profiler::ScopedTimer timer(grabStage);
+			if(!cam->get_frame(camFrame, &captureTime)){
+				ROS_INFO("Replay finished");
+				break;
+			}
+		}
+		//the timestamps of a recording say nothing about the latency of this run,
+		//measure a replay from the moment the frame was read
+		boost::posix_time::ptime latencyStart = captureTime;
+		if(!cam->is_live()) latencyStart = boost::posix_time::microsec_clock::universal_time();
+
+		//correct the lens distortion, unless only the detected points are undistorted
+		cv::Mat view = camFrame;
+		if(!undistortPoints){
+			profiler::ScopedTimer timer(rectifyStage);
+			rectifier->rectify(camFrame, rectifiedCamFrame);
+			view = rectifiedCamFrame;
+		}
 
 		//create a duplicate grayscale frame
 		cv::Mat gray;
-		cv::cvtColor(rectifiedCamFrame, gray, CV_BGR2GRAY);
+		{
+			profiler::ScopedTimer timer(grayStage);
+			cv::cvtColor(view, gray, CV_BGR2GRAY);
+		}
+		if(calibrationMonitor != NULL) calibrationMonitor->offer(gray);
 
 		//draw the calibration points
 		for(point2f::point2fvector::iterator it=markers.begin(); it!=markers.end(); ++it)
-			cv::circle(rectifiedCamFrame, cv::Point(cv::saturate_cast<int>(it->x), cv::saturate_cast<int>(it->y)), 1, cv::Scalar(0, 0, 255), 2);
+			cv::circle(view, cv::Point(cv::saturate_cast<int>(it->x), cv::saturate_cast<int>(it->y)), 1, cv::Scalar(0, 0, 255), 2);
 
 		//detect crates
 		std::vector<Crate> crates;
-		qrDetector->detectCrates(gray, crates);
+		{
+			profiler::ScopedTimer timer(detectStage);
+			qrDetector->detectCrates(gray, crates);
+		}
 
 		//transform crate coordinates
-		for(std::vector<Crate>::iterator it=crates.begin(); it!=crates.end(); ++it)
 		{
-			it->draw(rectifiedCamFrame);
-
-			std::vector<cv::Point2f> points;
-			for(int n = 0; n <3; n++){
-				point2f result = cordTransformer->to_rc(point2f(it->getPoints()[n].x, it->getPoints()[n].y));
-				points.push_back(cv::Point2f(result.x, result.y));
+			profiler::ScopedTimer timer(transformStage);
+			//transform the points of all crates in one batch
+			point2f::point2fvector cratePoints;
+			for(std::vector<Crate>::iterator it=crates.begin(); it!=crates.end(); ++it)
+			{
+				it->draw(view);
+				std::vector<cv::Point2f> corners = it->getPoints();
+				for(int n = 0; n <3; n++){
+					cratePoints.push_back(point2f(corners[n].x, corners[n].y));
+				}
+			}
+			pixelToWorld(cratePoints);
+			point2f::point2fvector::iterator result = cratePoints.begin();
+			for(std::vector<Crate>::iterator it=crates.begin(); it!=crates.end(); ++it)
+			{
+				std::vector<cv::Point2f> points;
+				for(int n = 0; n <3; n++, ++result){
+					points.push_back(cv::Point2f(result->x, result->y));
+				}
+				it->setPoints(points);
 			}
-			it->setPoints(points);
 		}
 
 		//inform the crate tracker about the seen crates
-		std::vector<CrateEvent> events = crateTracker->update(crates);
+		std::vector<CrateEvent> events;
+		{
+			profiler::ScopedTimer timer(trackStage);
+			events = crateTracker->update(crates);
+		}
 
 		//publish events
-		for(std::vector<CrateEvent>::iterator it = events.begin(); it != events.end(); ++it)
 		{
-			vision::CrateEventMsg msg;
-			msg.event = it->type;
-			msg.crate.name = it->name;
-			msg.crate.x = it->x;
-			msg.crate.y = it->y;
-			msg.crate.angle = it->angle;
-
-			ROS_INFO(it->toString().c_str());
-			crateEventPublisher.publish(msg);
+			profiler::ScopedTimer timer(publishStage);
+			for(std::vector<CrateEvent>::iterator it = events.begin(); it != events.end(); ++it)
+			{
+				vision::CrateEventMsg msg;
+				msg.event = it->type;
+				msg.crate.name = it->name;
+				msg.crate.x = it->x;
+				msg.crate.y = it->y;
+				msg.crate.angle = it->angle;
+
+				ROS_INFO(it->toString().c_str());
+				crateEventPublisher.publish(msg);
+			}
+
+			//the state of all crates, only while someone listens; a new subscriber always starts with a full snapshot
+			if(crateSnapshotPublisher.getNumSubscribers() > 0){
+				std::vector<exCrate> allCrates = crateTracker->getAllCrates();
+				vision::CrateSnapshotMsg snapshot;
+				if(snapshotEncoder->encode(frameSequence, ros::Time::fromBoost(captureTime), allCrates, snapshot)){
+					crateSnapshotPublisher.publish(snapshot);
+				}
+			}
+			frameSequence++;
+		}
+
+		//latency from the moment the frame was captured
+		long long latency = (boost::posix_time::microsec_clock::universal_time() - latencyStart).total_microseconds();
+		if(latency < 0) latency = 0;
+		profiler::Profiler::instance().record(frameLatencyStage, latency);
+		if(!events.empty()){
+			profiler::Profiler::instance().record(eventLatencyStage, latency);
 		}
 
 		//update GUI
-		outputVideo.write(rectifiedCamFrame);
-		imshow("image",rectifiedCamFrame);
-		waitKey(1000/30);
+		{
+			profiler::ScopedTimer timer(guiStage);
+			outputVideo.write(view);
+			imshow("image",view);
+			//a replay is paced by its own rate
+			waitKey(cam->is_live() ? 1000/30 : 1);
+		}
+
+		profiler::Profiler::instance().record(frameStage, frameStart, profiler::now());
+		publishDiagnostics();
 
 		//let ROS do it's magical things
 		ros::spinOnce();
 	}
+	profiler::Profiler::instance().flushTrace();
 }
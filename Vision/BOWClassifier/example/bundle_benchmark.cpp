@@ -0,0 +1,129 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           bundle_benchmark.cpp
+// Description:    Compares startup time and memory of a saved classifier and a model bundle
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/bundle_benchmark.cpp src/*.cpp `pkg-config --cflags --libs opencv` -lboost_filesystem -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "BOWClassifier/BOWDTreeClassifier.h"
+#include "BOWClassifier/VocabularyTreeMatcher.h"
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/ml/ml.hpp>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/*
+ * Memory usage of this process in kB, as listed in /proc/self/status
+ */
+struct Memory {
+	long rss;
+	long anon;
+	long file;
+
+	static Memory current() {
+		Memory memory = { 0, 0, 0 };
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			sscanf(line.c_str(), "VmRSS: %ld", &memory.rss);
+			sscanf(line.c_str(), "RssAnon: %ld", &memory.anon);
+			sscanf(line.c_str(), "RssFile: %ld", &memory.file);
+		}
+		return memory;
+	}
+};
+
+BOWDTreeClassifier* createClassifier() {
+	return new BOWDTreeClassifier(new cv::SurfFeatureDetector(), new cv::SurfDescriptorExtractor(),
+			new VocabularyTreeMatcher());
+}
+
+/*
+ * Loads the classifier in a fresh process, so every format starts with the same memory
+ */
+void measure(const std::string& path) {
+	std::cout.flush();
+	pid_t pid = fork();
+	if (pid != 0) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	Memory before = Memory::current();
+	BOWDTreeClassifier* classifier = createClassifier();
+	int64 start = cv::getTickCount();
+	bool loaded = classifier->load(path);
+	double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+	Memory after = Memory::current();
+
+	struct stat st;
+	stat(path.c_str(), &st);
+	printf("%-12s %s %10.1f MB %10.2f ms %10ld kB %10ld kB %10ld kB\n", path.c_str(), loaded ? "ok  " : "fail",
+			st.st_size / 1048576.0, ms, after.rss - before.rss, after.anon - before.anon, after.file - before.file);
+	fflush(stdout);
+	_exit(0);
+}
+
+int main(int argc, char* argv[]) {
+	int words = argc > 1 ? atoi(argv[1]) : 10000;
+	int samples = argc > 2 ? atoi(argv[2]) : 40;
+
+	// A classifier with a random vocabulary of SURF sized words
+	BOWDTreeClassifier* classifier = createClassifier();
+	cv::Mat vocabulary(words, 64, CV_32FC1);
+	cv::randu(vocabulary, cv::Scalar(0), cv::Scalar(1));
+	classifier->bowExtractor->setVocabulary(vocabulary);
+	classifier->matcher->train();
+
+	cv::Mat histograms(samples, words, CV_32FC1);
+	cv::randu(histograms, cv::Scalar(0), cv::Scalar(0.01));
+	cv::Mat labels(samples, 1, CV_32FC1);
+	for (int i = 0; i < samples; i++) {
+		labels.at<float>(i) = i % 4;
+	}
+	static_cast<CvDTree*>(classifier->classifier)->train(histograms, CV_ROW_SAMPLE, labels);
+
+	classifier->save("model.yml");
+	classifier->saveBundle("model.bow");
+	delete classifier;
+
+	printf("%-12s %s %13s %13s %13s %13s %13s\n", "file", "    ", "size", "load", "rss", "anon", "file");
+	measure("model.yml");
+	measure("model.bow");
+
+	return 0;
+}
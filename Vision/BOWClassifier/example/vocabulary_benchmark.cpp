@@ -0,0 +1,193 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           vocabulary_benchmark.cpp
+// Description:    Compares vocabulary quantization with brute force, FLANN and the vocabulary tree
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/vocabulary_benchmark.cpp src/VocabularyTreeMatcher.cpp `pkg-config --cflags --libs opencv` -lboost_filesystem -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "BOWClassifier/VocabularyTreeMatcher.h"
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+ * The words assigned to the descriptors and the time it took
+ */
+struct Quantization {
+	std::string name;
+	double trainMs;
+	double matchMs;
+	std::vector<int> words;
+};
+
+Quantization quantize(const std::string& name, cv::Ptr<cv::DescriptorMatcher> matcher,
+		const cv::Mat& vocabulary, const cv::Mat& descriptors, int runs) {
+	Quantization result;
+	result.name = name;
+	double tick = cv::getTickFrequency() / 1000.0;
+
+	matcher->add(std::vector<cv::Mat>(1, vocabulary));
+	int64 start = cv::getTickCount();
+	matcher->train();
+	result.trainMs = (cv::getTickCount() - start) / tick;
+
+	std::vector<cv::DMatch> matches;
+	start = cv::getTickCount();
+	for (int i = 0; i < runs; i++) {
+		matcher->match(descriptors, matches);
+	}
+	result.matchMs = (cv::getTickCount() - start) / tick / runs;
+
+	result.words.assign(descriptors.rows, -1);
+	for (size_t i = 0; i < matches.size(); i++) {
+		result.words[matches[i].queryIdx] = matches[i].trainIdx;
+	}
+	return result;
+}
+
+/*
+ * Normalized BoW histograms, one row per image, the same as BOWImgDescriptorExtractor
+ */
+cv::Mat histograms(const std::vector<int>& words, const std::vector<int>& imageOfDescriptor,
+		int images, int vocabularySize) {
+	cv::Mat result = cv::Mat::zeros(images, vocabularySize, CV_32FC1);
+	std::vector<int> counts(images, 0);
+	for (size_t i = 0; i < words.size(); i++) {
+		result.at<float>(imageOfDescriptor[i], words[i]) += 1;
+		counts[imageOfDescriptor[i]]++;
+	}
+	for (int i = 0; i < images; i++) {
+		cv::Mat row = result.row(i);
+		row /= std::max(counts[i], 1);
+	}
+	return result;
+}
+
+/*
+ * Leave one out nearest neighbour classification of the histograms
+ */
+double accuracy(const cv::Mat& histograms, const std::vector<int>& labels) {
+	int correct = 0;
+	for (int i = 0; i < histograms.rows; i++) {
+		int best = -1;
+		double bestDistance = 0;
+		for (int j = 0; j < histograms.rows; j++) {
+			if (i == j) continue;
+			double distance = cv::norm(histograms.row(i), histograms.row(j), cv::NORM_L2);
+			if (best < 0 || distance < bestDistance) {
+				best = j;
+				bestDistance = distance;
+			}
+		}
+		if (best >= 0 && labels[best] == labels[i]) correct++;
+	}
+	return 100.0 * correct / histograms.rows;
+}
+
+int main(int argc, char* argv[]) {
+	namespace fs = boost::filesystem;
+	std::string dir = argc > 1 ? argv[1] : "Data";
+	int vocabularySize = argc > 2 ? atoi(argv[2]) : 1000;
+	int checks = argc > 3 ? atoi(argv[3]) : 64;
+	int runs = argc > 4 ? atoi(argv[4]) : 5;
+
+	// Every sub directory of the data directory is a label
+	cv::SurfFeatureDetector detector;
+	cv::SurfDescriptorExtractor extractor;
+	cv::Mat descriptors;
+	std::vector<int> imageOfDescriptor;
+	std::vector<int> labels;
+	int label = 0;
+	for (fs::directory_iterator d(dir); d != fs::directory_iterator(); ++d) {
+		if (!fs::is_directory(d->status())) continue;
+		for (fs::directory_iterator f(d->path()); f != fs::directory_iterator(); ++f) {
+			cv::Mat img = cv::imread(f->path().string(), 0);
+			if (!img.data) continue;
+
+			std::vector<cv::KeyPoint> keypoints;
+			detector.detect(img, keypoints);
+			if (keypoints.empty()) continue;
+
+			cv::Mat imgDescriptors;
+			extractor.compute(img, keypoints, imgDescriptors);
+			descriptors.push_back(imgDescriptors);
+			imageOfDescriptor.insert(imageOfDescriptor.end(), imgDescriptors.rows, (int)labels.size());
+			labels.push_back(label);
+		}
+		label++;
+	}
+	if (labels.empty()) {
+		std::cout << "No images found in " << dir << std::endl;
+		return 1;
+	}
+
+	vocabularySize = std::min(vocabularySize, descriptors.rows);
+	printf("%d images, %d labels, %d descriptors, %d words\n", (int)labels.size(), label, descriptors.rows,
+			vocabularySize);
+
+	cv::BOWKMeansTrainer trainer(vocabularySize, cv::TermCriteria(CV_TERMCRIT_ITER, 10, 0.001), 1,
+			cv::KMEANS_PP_CENTERS);
+	trainer.add(descriptors);
+	cv::Mat vocabulary = trainer.cluster();
+
+	std::vector<Quantization> results;
+	results.push_back(quantize("brute force", new cv::BruteForceMatcher<cv::L2<float> >(), vocabulary,
+			descriptors, runs));
+	results.push_back(quantize("flann", new cv::FlannBasedMatcher(), vocabulary, descriptors, runs));
+	results.push_back(quantize("vocabulary tree", new VocabularyTreeMatcher(8, 16, checks), vocabulary,
+			descriptors, runs));
+	results.push_back(quantize("vocabulary tree exact", new VocabularyTreeMatcher(8, 16, 0), vocabulary,
+			descriptors, runs));
+
+	// Compare with brute force
+	const Quantization& exact = results[0];
+	cv::Mat exactHistograms = histograms(exact.words, imageOfDescriptor, labels.size(), vocabularySize);
+	printf("%-22s %10s %10s %10s %12s %10s\n", "matcher", "train ms", "match ms", "same word", "hist diff",
+			"accuracy");
+	for (size_t r = 0; r < results.size(); r++) {
+		const Quantization& q = results[r];
+		int same = 0;
+		for (size_t i = 0; i < q.words.size(); i++) {
+			if (q.words[i] == exact.words[i]) same++;
+		}
+		cv::Mat h = histograms(q.words, imageOfDescriptor, labels.size(), vocabularySize);
+		double diff = cv::norm(h, exactHistograms, cv::NORM_L1) / labels.size();
+		printf("%-22s %10.2f %10.2f %9.2f%% %12.4f %9.1f%%\n", q.name.c_str(), q.trainMs, q.matchMs,
+				100.0 * same / q.words.size(), diff, accuracy(h, labels));
+	}
+
+	return 0;
+}
@@ -37,6 +37,7 @@
 #include "opencv2/core/core.hpp"
 #include "opencv2/features2d/features2d.hpp"
 #include "opencv2/ml/ml.hpp"
+#include "ModelBundle.h"
 
 /*! \brief A Bag of Words KeyPoint classifier
  *
@@ -68,6 +69,9 @@ public:
 	/*! \brief Loads the classifier from disk
 	 *
 	 *  Loads the classifier from the disk instead of training it.
+	 *  Accepts both a file written by save() and a bundle
+	 *  written by saveBundle(), so an existing classifier
+	 *  is converted by loading it and saving it as a bundle.
 	 *
 	 *  \warning Use the same feature classes used to generate
 	 *  the classifier!
@@ -78,6 +82,20 @@ public:
 	 */
 	bool load(const std::string& path);
 
+	/*! \brief Loads the classifier from a bundle
+	 *
+	 *  The vocabulary is used directly from a read-only
+	 *  mapping of the bundle, and the tree of a
+	 *  VocabularyTreeMatcher is loaded instead of built.
+	 *  The bundle stays mapped until the classifier is
+	 *  destroyed or loaded again.
+	 *
+	 *  \param path Path to a bundle written by saveBundle()
+	 *  \return <i>true</i> if successfully loaded\n
+	 *  		<i>false</i> if loading failed
+	 */
+	bool loadBundle(const std::string& path);
+
 	/*! \brief Saves the classifier to disk
 	 *
 	 *  \param path Path to save the classifier to
@@ -86,6 +104,17 @@ public:
 	 */
 	bool save(const std::string& path);
 
+	/*! \brief Saves the classifier to disk as a bundle
+	 *
+	 *  Stores the vocabulary, the tree of a VocabularyTreeMatcher
+	 *  and the classifier model in a ModelBundle.
+	 *
+	 *  \param path Path to save the bundle to
+	 *  \return <i>true</i> if successfully saved\n
+	 *  		<i>false</i> if saving failed
+	 */
+	bool saveBundle(const std::string& path);
+
 	/*! \brief Trains the classifier
 	 *
 	 *  Trains the classifier on a list of images.
@@ -122,6 +151,22 @@ public:
 	 */
 	virtual bool classify(const std::vector<std::string>& paths,
 			cv::Mat& results)=0;
+
+protected:
+	/*! \brief Sets the vocabulary of the BoW descriptor extractor
+	 *
+	 *  Also trains the matcher, so an index over the
+	 *  vocabulary (e.g. a VocabularyTreeMatcher or a
+	 *  FlannBasedMatcher) is built once instead of on
+	 *  the first classification.
+	 *
+	 *  \param vocabulary One word per row
+	 */
+	void setVocabulary(const cv::Mat& vocabulary);
+
+private:
+	//! The bundle the vocabulary was loaded from, if any
+	cv::Ptr<ModelBundle> bundle;
 };
 
 #endif /* BOWCLASSIFIER_H_ */
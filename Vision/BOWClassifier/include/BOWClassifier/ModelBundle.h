@@ -0,0 +1,155 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           ModelBundle.h
+// Description:    A binary, memory mappable file of classifier sections
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#ifndef MODELBUNDLE_H_
+#define MODELBUNDLE_H_
+
+#include "opencv2/core/core.hpp"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*! \brief A binary file of matrices and text sections
+ *
+ *  A bundle holds everything a BOWClassifier needs to
+ *  start: the vocabulary, the index of the matcher and
+ *  the classifier model. Every section starts at a 64
+ *  byte boundary and is stored in native byte order, so
+ *  an opened bundle is used directly from a read-only
+ *  memory mapping. Processes that open the same bundle
+ *  share its pages.
+ *
+ *  The file layout is a 16 byte header (magic, version,
+ *  section count) followed by the section table and the
+ *  section data.
+ *
+ *  \sa BOWClassifier::saveBundle, BOWClassifier::loadBundle
+ */
+class ModelBundle {
+public:
+	//! Sections written by BOWClassifier
+	enum SectionId {
+		VOCABULARY = 1, //!< The vocabulary, one word per row
+		TREE_NODES = 2, //!< VocabularyTreeMatcher nodes
+		TREE_CENTERS = 3, //!< VocabularyTreeMatcher node centers
+		TREE_WORDS = 4, //!< VocabularyTreeMatcher word order
+		MODEL = 5 //!< The classifier model as saved by CvStatModel
+	};
+
+	ModelBundle();
+
+	//! Unmaps the bundle if it is open
+	~ModelBundle();
+
+	/*! \brief Adds a matrix section to be saved
+	 *
+	 *  \param id Identifier of the section
+	 *  \param mat Matrix, is not copied until save()
+	 */
+	void add(int id, const cv::Mat& mat);
+
+	/*! \brief Adds a text section to be saved
+	 *
+	 *  \param id Identifier of the section
+	 *  \param text Contents of the section
+	 */
+	void add(int id, const std::string& text);
+
+	/*! \brief Writes the added sections to disk
+	 *
+	 *  An existing bundle is replaced with a rename, so processes
+	 *  that have it mapped keep reading the old file.
+	 *
+	 *  \param path Path of the bundle
+	 *  \return <i>true</i> if successfully saved\n
+	 *  		<i>false</i> if writing failed
+	 */
+	bool save(const std::string& path) const;
+
+	/*! \brief Maps a bundle read-only
+	 *
+	 *  Closes a previously opened bundle and
+	 *  discards the added sections.
+	 *
+	 *  \param path Path of the bundle
+	 *  \return <i>true</i> if successfully opened\n
+	 *  		<i>false</i> if the file is missing or not a valid bundle
+	 */
+	bool open(const std::string& path);
+
+	//! Unmaps the bundle and discards all sections
+	void close();
+
+	//! \return <i>true</i> if the bundle contains the section
+	bool has(int id) const;
+
+	/*! \brief Returns a matrix section
+	 *
+	 *  The matrix points into the mapping, it is only
+	 *  valid while the bundle is open and must not be
+	 *  written to.
+	 *
+	 *  \return The matrix, empty if the section does not exist
+	 */
+	cv::Mat mat(int id) const;
+
+	//! \return The contents of a text section, empty if it does not exist
+	std::string text(int id) const;
+
+	//! \return <i>true</i> if the file starts like a bundle
+	static bool isBundle(const std::string& path);
+
+private:
+	struct Section {
+		uint32_t id;
+		int32_t type;
+		int32_t rows;
+		int32_t cols;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	std::vector<Section> sections;
+	//! Data of the added sections, in the order of sections
+	std::vector<cv::Mat> data;
+
+	void* mapping;
+	size_t mappingSize;
+
+	const Section* find(int id) const;
+
+	ModelBundle(const ModelBundle&);
+	ModelBundle& operator=(const ModelBundle&);
+};
+
+#endif /* MODELBUNDLE_H_ */
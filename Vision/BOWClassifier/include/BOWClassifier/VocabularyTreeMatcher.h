@@ -0,0 +1,163 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           VocabularyTreeMatcher.h
+// Description:    A descriptor matcher using a hierarchical k-means vocabulary tree
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#ifndef VOCABULARYTREEMATCHER_H_
+#define VOCABULARYTREEMATCHER_H_
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/features2d/features2d.hpp"
+#include <vector>
+
+/*! \brief A descriptor matcher for large vocabularies
+ *
+ *  This matcher clusters the train descriptors (the words
+ *  of a vocabulary) into a tree using hierarchical k-means.
+ *  A descriptor is matched by descending the tree, visiting
+ *  the closest branches first, until a maximum amount of
+ *  distances has been computed. The cost of a match therefore
+ *  grows with the logarithm of the vocabulary size instead
+ *  of linearly.
+ *
+ *  The tree is built once in train(), which is called by
+ *  BOWClassifier when the vocabulary is trained or loaded.
+ *  Only float descriptors with the L2 distance are supported,
+ *  e.g. SURF and SIFT.
+ *
+ *  \sa BOWClassifier
+ */
+class VocabularyTreeMatcher: public cv::DescriptorMatcher {
+public:
+	/*! \brief The constructor
+	 *
+	 *  \param branching Amount of children of every node
+	 *  \param leafSize A node with at most this many words is not split
+	 *  \param checks Maximum amount of distances (to words and to
+	 *  node centers) computed per match, 0 to compare all words
+	 *  without using the tree (exact)
+	 */
+	VocabularyTreeMatcher(int branching = 8, int leafSize = 16, int checks = 64);
+	virtual ~VocabularyTreeMatcher();
+
+	virtual void add(const std::vector<cv::Mat>& descriptors);
+	virtual void clear();
+
+	/*! \brief Builds the tree
+	 *
+	 *  Does nothing if the tree is up to date with the
+	 *  train descriptors.
+	 */
+	virtual void train();
+
+	virtual bool isMaskSupported() const;
+	virtual cv::Ptr<cv::DescriptorMatcher> clone(bool emptyTrainData = false) const;
+
+	//! \return The depth of the tree, 0 if it has not been built
+	int depth() const;
+
+	/*! \brief Exports the tree
+	 *
+	 *  Builds the tree if needed. The matrices can be
+	 *  stored and passed to setTree() to skip building.
+	 *
+	 *  \param nodes Output, one node per row (CV_32SC1)
+	 *  \param centers Output, one node center per row (CV_32FC1),
+	 *  shares its data with the matcher
+	 *  \param wordOrder Output, the words sorted by leaf (CV_32SC1)
+	 */
+	void getTree(cv::Mat& nodes, cv::Mat& centers, cv::Mat& wordOrder);
+
+	/*! \brief Imports a tree exported by getTree()
+	 *
+	 *  Must be called after the train descriptors are
+	 *  added, with a tree built from the same descriptors.
+	 *  The centers are used in place, not copied.
+	 *
+	 *  \return <i>true</i> if the tree was imported\n
+	 *  		<i>false</i> if it does not fit the train descriptors
+	 */
+	bool setTree(const cv::Mat& nodes, const cv::Mat& centers,
+			const cv::Mat& wordOrder);
+
+protected:
+	virtual void knnMatchImpl(const cv::Mat& queryDescriptors,
+			std::vector<std::vector<cv::DMatch> >& matches, int k,
+			const std::vector<cv::Mat>& masks = std::vector<cv::Mat>(),
+			bool compactResult = false);
+	virtual void radiusMatchImpl(const cv::Mat& queryDescriptors,
+			std::vector<std::vector<cv::DMatch> >& matches, float maxDistance,
+			const std::vector<cv::Mat>& masks = std::vector<cv::Mat>(),
+			bool compactResult = false);
+
+private:
+	struct Node {
+		//! Row of the center in centers
+		int center;
+		//! Index of the first child in nodes, -1 for a leaf
+		int firstChild;
+		//! Amount of children
+		int childCount;
+		//! Range of the words of a leaf in wordOrder
+		int wordBegin;
+		int wordEnd;
+	};
+
+	//! Amount of fields of a node in getTree()
+	static const int NODE_FIELDS = 5;
+
+	int branching;
+	int leafSize;
+	int checks;
+
+	bool built;
+	//! All train descriptors in one matrix, or the only one in place
+	cv::Mat words;
+	//! Image and row of each word in the train collection
+	std::vector<std::pair<int, int> > wordSource;
+	//! Centers of the nodes
+	cv::Mat centers;
+	std::vector<Node> nodes;
+	//! Words sorted by leaf
+	std::vector<int> wordOrder;
+	//! Depth of the tree
+	int levels;
+
+	void gatherWords();
+	void build(int node, int begin, int end, int level);
+	void search(const float* query, int k, float maxDistance,
+			std::vector<std::pair<float, int> >& branches,
+			std::vector<std::pair<float, int> >& results) const;
+	void linearSearch(const float* query, int k, float maxDistanceSqr,
+			std::vector<std::pair<float, int> >& results) const;
+};
+
+#endif /* VOCABULARYTREEMATCHER_H_ */
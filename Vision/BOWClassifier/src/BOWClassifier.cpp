@@ -32,20 +32,84 @@
 //******************************************************************************
 
 #include <BOWClassifier/BOWClassifier.h>
+#include <BOWClassifier/ModelBundle.h>
+#include <BOWClassifier/VocabularyTreeMatcher.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/features2d/features2d.hpp>
 #include <opencv2/ml/ml.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
 
 using namespace cv;
 using namespace std;
 
+namespace {
+	/*! CvStatModel only reads and writes files, so the model
+	 *  section of a bundle goes through a temporary file
+	 */
+	string temporaryModelPath() {
+		char path[] = "/tmp/bowmodelXXXXXX.xml";
+		int fd = mkstemps(path, 4);
+		if (fd < 0)
+			return string();
+		close(fd);
+		return path;
+	}
+
+	bool readModel(CvStatModel* classifier, const string& model) {
+		string path = temporaryModelPath();
+		if (path.empty())
+			return false;
+		ofstream out(path.c_str(), ios::binary);
+		out << model;
+		out.close();
+		if (out.fail()) {
+			remove(path.c_str());
+			return false;
+		}
+		// Remove the file when loading throws as well
+		try {
+			classifier->load(path.c_str());
+		} catch (...) {
+			remove(path.c_str());
+			throw;
+		}
+		remove(path.c_str());
+		return true;
+	}
+
+	bool writeModel(CvStatModel* classifier, string& model) {
+		string path = temporaryModelPath();
+		if (path.empty())
+			return false;
+		try {
+			classifier->save(path.c_str());
+		} catch (...) {
+			remove(path.c_str());
+			throw;
+		}
+		ifstream in(path.c_str(), ios::binary);
+		stringstream ss;
+		ss << in.rdbuf();
+		remove(path.c_str());
+		model = ss.str();
+		return !model.empty();
+	}
+}
+
 BOWClassifier::~BOWClassifier() {
 	delete classifier;
 }
 
 bool BOWClassifier::load(const std::string& path) {
+	if (ModelBundle::isBundle(path))
+		return loadBundle(path);
+
 	cout << "Loading classifier..." << endl;
 	classifier->load(path.c_str());
 
@@ -57,12 +121,51 @@ bool BOWClassifier::load(const std::string& path) {
 		cout << "Failed to load vocabulary" << endl;
 		return false;
 	}
-	bowExtractor->setVocabulary(vocabulary);
+	setVocabulary(vocabulary);
 	fs.release();
 
 	return true;
 }
 
+bool BOWClassifier::loadBundle(const std::string& path) {
+	cout << "Loading bundle..." << endl;
+	Ptr<ModelBundle> newBundle = new ModelBundle();
+	if (!newBundle->open(path)) {
+		cout << "Failed to open " << path << endl;
+		return false;
+	}
+
+	Mat vocabulary = newBundle->mat(ModelBundle::VOCABULARY);
+	string model = newBundle->text(ModelBundle::MODEL);
+	if (vocabulary.empty() || model.empty()) {
+		cout << "Bundle is missing the vocabulary or the classifier" << endl;
+		return false;
+	}
+
+	cout << "Loading classifier..." << endl;
+	if (!readModel(classifier, model)) {
+		cout << "Failed to load classifier" << endl;
+		return false;
+	}
+
+	cout << "Loading vocabulary..." << endl;
+	bowExtractor->setVocabulary(vocabulary);
+
+	// Skip building the index if the bundle contains it
+	VocabularyTreeMatcher* tree = dynamic_cast<VocabularyTreeMatcher*> (
+			(DescriptorMatcher*) matcher);
+	if (tree != NULL && newBundle->has(ModelBundle::TREE_NODES)) {
+		if (!tree->setTree(newBundle->mat(ModelBundle::TREE_NODES),
+				newBundle->mat(ModelBundle::TREE_CENTERS), newBundle->mat(
+						ModelBundle::TREE_WORDS)))
+			cout << "Vocabulary tree does not match, rebuilding" << endl;
+	}
+	matcher->train();
+
+	bundle = newBundle;
+	return true;
+}
+
 bool BOWClassifier::save(const std::string& path) {
 	cout << "Saving classifier..." << endl;
 	classifier->save(path.c_str());
@@ -76,3 +179,36 @@ bool BOWClassifier::save(const std::string& path) {
 
 	return true;
 }
+
+bool BOWClassifier::saveBundle(const std::string& path) {
+	ModelBundle out;
+
+	cout << "Saving classifier..." << endl;
+	string model;
+	if (!writeModel(classifier, model)) {
+		cout << "Failed to save classifier" << endl;
+		return false;
+	}
+
+	cout << "Saving vocabulary..." << endl;
+	out.add(ModelBundle::VOCABULARY, bowExtractor->getVocabulary());
+
+	VocabularyTreeMatcher* tree = dynamic_cast<VocabularyTreeMatcher*> (
+			(DescriptorMatcher*) matcher);
+	if (tree != NULL) {
+		Mat nodes, centers, wordOrder;
+		tree->getTree(nodes, centers, wordOrder);
+		out.add(ModelBundle::TREE_NODES, nodes);
+		out.add(ModelBundle::TREE_CENTERS, centers);
+		out.add(ModelBundle::TREE_WORDS, wordOrder);
+	}
+
+	out.add(ModelBundle::MODEL, model);
+	return out.save(path);
+}
+
+void BOWClassifier::setVocabulary(const cv::Mat& vocabulary) {
+	bowExtractor->setVocabulary(vocabulary);
+	matcher->train();
+	bundle.release();
+}
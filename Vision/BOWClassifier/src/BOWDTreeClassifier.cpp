@@ -107,7 +107,7 @@ bool BOWDTreeClassifier::train(const std::vector<std::string>& paths,
 
 	// Generate dictionary
 	Mat dictionary = trainer.cluster();
-	bowExtractor->setVocabulary(dictionary);
+	setVocabulary(dictionary);
 
 	// Train classifier
 	Mat trainingData(0, paths.size(), CV_32FC1);
@@ -0,0 +1,227 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           ModelBundle.cpp
+// Description:    A binary, memory mappable file of classifier sections
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "BOWClassifier/ModelBundle.h"
+#include "opencv2/core/core.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+	const char MAGIC[8] = { 'L', 'C', 'V', 'B', 'O', 'W', 0, 1 };
+	const uint32_t VERSION = 1;
+	const size_t ALIGNMENT = 64;
+
+	//! Type of a text section
+	const int32_t TEXT = -1;
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t sectionCount;
+	};
+
+	inline uint64_t align(uint64_t offset) {
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+}
+
+ModelBundle::ModelBundle() :
+		mapping(NULL), mappingSize(0) {
+}
+
+ModelBundle::~ModelBundle() {
+	close();
+}
+
+void ModelBundle::add(int id, const cv::Mat& mat) {
+	Section section = { (uint32_t) id, mat.type(), mat.rows, mat.cols, 0,
+			(uint64_t) mat.rows * mat.cols * mat.elemSize() };
+	sections.push_back(section);
+	data.push_back(mat);
+}
+
+void ModelBundle::add(int id, const std::string& text) {
+	Section section = { (uint32_t) id, TEXT, 1, (int32_t) text.size(), 0,
+			text.size() };
+	sections.push_back(section);
+	data.push_back(Mat(1, text.size(), CV_8UC1, (void*) text.data()).clone());
+}
+
+bool ModelBundle::save(const std::string& path) const {
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.sectionCount = sections.size();
+
+	// Lay out the sections after the table
+	vector<Section> table(sections);
+	uint64_t offset = sizeof(Header) + table.size() * sizeof(Section);
+	for (size_t i = 0; i < table.size(); i++) {
+		table[i].offset = align(offset);
+		offset = table[i].offset + table[i].size;
+	}
+
+	// Bundles are mapped by readers, and by this bundle when it was opened
+	// from the same path, so the file is never truncated in place: a new
+	// file is written next to it and renamed over it
+	stringstream temp;
+	temp << path << "." << getpid() << ".tmp";
+	ofstream out(temp.str().c_str(), ios::binary | ios::trunc);
+	if (!out)
+		return false;
+	out.write((const char*) &header, sizeof(header));
+	if (!table.empty())
+		out.write((const char*) &table[0], table.size() * sizeof(Section));
+
+	const char padding[ALIGNMENT] = { 0 };
+	for (size_t i = 0; i < table.size(); i++) {
+		out.write(padding, table[i].offset - out.tellp());
+
+		Mat mat = data[i].isContinuous() ? data[i] : data[i].clone();
+		if (table[i].size > 0)
+			out.write((const char*) mat.data, table[i].size);
+	}
+
+	out.close();
+	if (out.fail() || rename(temp.str().c_str(), path.c_str()) != 0) {
+		unlink(temp.str().c_str());
+		return false;
+	}
+	return true;
+}
+
+bool ModelBundle::open(const std::string& path) {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+		::close(fd);
+		return false;
+	}
+
+	void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	mapping = map;
+	mappingSize = st.st_size;
+
+	// Validate the header and the section table
+	const Header* header = (const Header*) mapping;
+	uint64_t tableEnd = sizeof(Header)
+			+ (uint64_t) header->sectionCount * sizeof(Section);
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+			|| header->version != VERSION || tableEnd > mappingSize) {
+		cout << path << " is not a valid model bundle" << endl;
+		close();
+		return false;
+	}
+
+	const Section* table = (const Section*) ((const char*) mapping
+			+ sizeof(Header));
+	for (uint32_t i = 0; i < header->sectionCount; i++) {
+		const Section& section = table[i];
+		bool valid = section.offset % ALIGNMENT == 0 && section.offset
+				>= tableEnd && section.offset <= mappingSize && section.size
+				<= mappingSize - section.offset;
+		if (valid && section.type != TEXT)
+			valid = section.rows >= 0 && section.cols >= 0 && section.size
+					== (uint64_t) section.rows * section.cols
+							* CV_ELEM_SIZE(section.type);
+		if (!valid) {
+			cout << path << " has a corrupt section " << section.id << endl;
+			close();
+			return false;
+		}
+		sections.push_back(section);
+	}
+
+	return true;
+}
+
+void ModelBundle::close() {
+	if (mapping != NULL)
+		munmap(mapping, mappingSize);
+	mapping = NULL;
+	mappingSize = 0;
+	sections.clear();
+	data.clear();
+}
+
+bool ModelBundle::has(int id) const {
+	return find(id) != NULL;
+}
+
+cv::Mat ModelBundle::mat(int id) const {
+	const Section* section = find(id);
+	if (section == NULL || section->type == TEXT || mapping == NULL)
+		return Mat();
+	return Mat(section->rows, section->cols, section->type,
+			(char*) mapping + section->offset);
+}
+
+std::string ModelBundle::text(int id) const {
+	const Section* section = find(id);
+	if (section == NULL || section->type != TEXT || mapping == NULL)
+		return string();
+	return string((const char*) mapping + section->offset, section->size);
+}
+
+bool ModelBundle::isBundle(const std::string& path) {
+	char magic[sizeof(MAGIC)];
+	ifstream in(path.c_str(), ios::binary);
+	return in.read(magic, sizeof(magic)) && memcmp(magic, MAGIC,
+			sizeof(MAGIC)) == 0;
+}
+
+const ModelBundle::Section* ModelBundle::find(int id) const {
+	for (size_t i = 0; i < sections.size(); i++) {
+		if (sections[i].id == (uint32_t) id)
+			return &sections[i];
+	}
+	return NULL;
+}
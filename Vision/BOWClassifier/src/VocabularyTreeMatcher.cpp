@@ -0,0 +1,424 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        BOWClassifier
+// File:           VocabularyTreeMatcher.cpp
+// Description:    A descriptor matcher using a hierarchical k-means vocabulary tree
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "BOWClassifier/VocabularyTreeMatcher.h"
+#include "opencv2/core/core.hpp"
+#include "opencv2/features2d/features2d.hpp"
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+	//! Squared L2 distance between two rows of length n
+	inline float distanceSqr(const float* a, const float* b, int n) {
+		float sum = 0;
+		for (int i = 0; i < n; i++) {
+			float d = a[i] - b[i];
+			sum += d * d;
+		}
+		return sum;
+	}
+
+	/*! Adds a word to the k best results, or to all results
+	 *  within the radius if k is 0
+	 */
+	inline void addResult(float distance, int word, int k, float maxDistanceSqr,
+			vector<pair<float, int> >& results) {
+		if (k > 0) {
+			if ((int) results.size() < k || distance < results.back().first) {
+				pair<float, int> result(distance, word);
+				results.insert(upper_bound(results.begin(), results.end(),
+						result), result);
+				if ((int) results.size() > k)
+					results.pop_back();
+			}
+		} else if (distance <= maxDistanceSqr) {
+			results.push_back(make_pair(distance, word));
+		}
+	}
+
+	//! A branch that was not followed, ordered by the distance to its center
+	typedef pair<float, int> Branch;
+
+	inline void pushBranch(vector<Branch>& branches, float distance, int node) {
+		branches.push_back(Branch(distance, node));
+		push_heap(branches.begin(), branches.end(), greater<Branch>());
+	}
+}
+
+VocabularyTreeMatcher::VocabularyTreeMatcher(int branching, int leafSize,
+		int checks) :
+		branching(max(branching, 2)), leafSize(max(leafSize, 1)), checks(
+				max(checks, 0)), built(false), levels(0) {
+}
+
+VocabularyTreeMatcher::~VocabularyTreeMatcher() {
+}
+
+void VocabularyTreeMatcher::add(const std::vector<cv::Mat>& descriptors) {
+	DescriptorMatcher::add(descriptors);
+	built = false;
+}
+
+void VocabularyTreeMatcher::clear() {
+	DescriptorMatcher::clear();
+	built = false;
+	words.release();
+	wordSource.clear();
+	centers.release();
+	nodes.clear();
+	wordOrder.clear();
+	levels = 0;
+}
+
+void VocabularyTreeMatcher::train() {
+	if (built)
+		return;
+
+	gatherWords();
+	centers.release();
+	nodes.clear();
+	wordOrder.clear();
+	levels = 0;
+
+	if (!words.empty()) {
+		wordOrder.resize(words.rows);
+		for (int i = 0; i < words.rows; i++)
+			wordOrder[i] = i;
+
+		Node root = { -1, -1, 0, 0, 0 };
+		nodes.push_back(root);
+		build(0, 0, words.rows, 1);
+	}
+
+	built = true;
+}
+
+void VocabularyTreeMatcher::getTree(cv::Mat& nodes, cv::Mat& centers,
+		cv::Mat& wordOrder) {
+	train();
+
+	nodes.create(this->nodes.size(), NODE_FIELDS, CV_32SC1);
+	for (size_t i = 0; i < this->nodes.size(); i++) {
+		const Node& node = this->nodes[i];
+		int* row = nodes.ptr<int>(i);
+		row[0] = node.center;
+		row[1] = node.firstChild;
+		row[2] = node.childCount;
+		row[3] = node.wordBegin;
+		row[4] = node.wordEnd;
+	}
+	centers = this->centers;
+	Mat(this->wordOrder).copyTo(wordOrder);
+}
+
+bool VocabularyTreeMatcher::setTree(const cv::Mat& nodes,
+		const cv::Mat& centers, const cv::Mat& wordOrder) {
+	gatherWords();
+
+	if (nodes.type() != CV_32SC1 || nodes.cols != NODE_FIELDS
+			|| wordOrder.type() != CV_32SC1 || (int) wordOrder.total()
+			!= words.rows || (!centers.empty() && (centers.type() != CV_32FC1
+			|| centers.cols != words.cols)))
+		return false;
+
+	// Check every reference, so a tree of another vocabulary is rejected
+	vector<Node> tree(nodes.rows);
+	vector<int> depths(nodes.rows, 1);
+	int maxDepth = nodes.rows > 0 ? 1 : 0;
+	for (int i = 0; i < nodes.rows; i++) {
+		const int* row = nodes.ptr<int>(i);
+		Node node = { row[0], row[1], row[2], row[3], row[4] };
+		if ((i == 0 ? node.center != -1 : node.center < 0) || node.center
+				>= centers.rows || node.wordBegin < 0 || node.wordBegin
+				> node.wordEnd || node.wordEnd > words.rows)
+			return false;
+		if (node.firstChild >= 0) {
+			if (node.firstChild <= i || node.childCount <= 0 || node.firstChild
+					+ node.childCount > nodes.rows)
+				return false;
+			for (int c = 0; c < node.childCount; c++) {
+				depths[node.firstChild + c] = depths[i] + 1;
+				maxDepth = max(maxDepth, depths[i] + 1);
+			}
+		}
+		tree[i] = node;
+	}
+	vector<int> order(wordOrder.begin<int>(), wordOrder.end<int>());
+	for (size_t i = 0; i < order.size(); i++) {
+		if (order[i] < 0 || order[i] >= words.rows)
+			return false;
+	}
+
+	this->nodes.swap(tree);
+	this->centers = centers;
+	this->wordOrder.swap(order);
+	levels = maxDepth;
+	built = true;
+	return true;
+}
+
+void VocabularyTreeMatcher::gatherWords() {
+	words.release();
+	wordSource.clear();
+
+	// A single matrix is used in place, e.g. a mapped vocabulary
+	int count = 0;
+	for (size_t i = 0; i < trainDescCollection.size(); i++) {
+		if (!trainDescCollection[i].empty())
+			count++;
+	}
+
+	for (size_t i = 0; i < trainDescCollection.size(); i++) {
+		const Mat& descriptors = trainDescCollection[i];
+		if (descriptors.empty())
+			continue;
+		CV_Assert(descriptors.type() == CV_32FC1);
+		if (count == 1 && descriptors.isContinuous())
+			words = descriptors;
+		else
+			words.push_back(descriptors);
+		for (int row = 0; row < descriptors.rows; row++)
+			wordSource.push_back(make_pair((int) i, row));
+	}
+}
+
+void VocabularyTreeMatcher::build(int node, int begin, int end, int level) {
+	levels = max(levels, level);
+	int count = end - begin;
+
+	nodes[node].wordBegin = begin;
+	nodes[node].wordEnd = end;
+	if (count <= leafSize)
+		return;
+
+	// Cluster the words of this node
+	Mat data(count, words.cols, CV_32FC1);
+	for (int i = 0; i < count; i++)
+		words.row(wordOrder[begin + i]).copyTo(data.row(i));
+
+	int k = min(branching, count);
+	Mat labels, clusterCenters;
+	kmeans(data, k, labels, TermCriteria(
+			CV_TERMCRIT_ITER + CV_TERMCRIT_EPS, 10, 0.01), 1,
+			KMEANS_PP_CENTERS, clusterCenters);
+
+	// Sort the words by cluster
+	vector<vector<int> > clusters(k);
+	for (int i = 0; i < count; i++)
+		clusters[labels.at<int>(i)].push_back(wordOrder[begin + i]);
+
+	// Identical words can not be split, keep them in a leaf
+	for (int c = 0; c < k; c++) {
+		if ((int) clusters[c].size() == count)
+			return;
+	}
+
+	// The children of a node are stored next to each other
+	int firstChild = nodes.size();
+	int childCount = 0;
+	vector<int> bounds;
+	int offset = begin;
+	for (int c = 0; c < k; c++) {
+		if (clusters[c].empty())
+			continue;
+
+		Node child = { centers.rows, -1, 0, 0, 0 };
+		nodes.push_back(child);
+		centers.push_back(clusterCenters.row(c));
+		childCount++;
+
+		copy(clusters[c].begin(), clusters[c].end(),
+				wordOrder.begin() + offset);
+		bounds.push_back(offset);
+		offset += clusters[c].size();
+	}
+	bounds.push_back(end);
+
+	nodes[node].firstChild = firstChild;
+	nodes[node].childCount = childCount;
+
+	for (int c = 0; c < childCount; c++)
+		build(firstChild + c, bounds[c], bounds[c + 1], level + 1);
+}
+
+void VocabularyTreeMatcher::search(const float* query, int k, float maxDistance,
+		std::vector<std::pair<float, int> >& branches,
+		std::vector<std::pair<float, int> >& results) const {
+	results.clear();
+	branches.clear();
+	if (nodes.empty())
+		return;
+
+	int dims = words.cols;
+	float maxDistanceSqr = maxDistance * maxDistance;
+	int checked = 0;
+
+	// Comparing all words is cheaper without the tree
+	if (checks == 0 || checks >= words.rows)
+		linearSearch(query, k, maxDistanceSqr, results);
+	else
+		branches.push_back(Branch(0, 0));
+
+	while (!branches.empty() && checked < checks) {
+		pop_heap(branches.begin(), branches.end(), greater<Branch>());
+		int node = branches.back().second;
+		branches.pop_back();
+
+		// Descend to the closest leaf, remembering the other branches
+		while (nodes[node].firstChild >= 0) {
+			const Node& parent = nodes[node];
+			int closest = -1;
+			float closestDistance = 0;
+			for (int c = 0; c < parent.childCount; c++) {
+				int child = parent.firstChild + c;
+				float distance = distanceSqr(query,
+						centers.ptr<float>(nodes[child].center), dims);
+				if (closest < 0 || distance < closestDistance) {
+					if (closest >= 0)
+						pushBranch(branches, closestDistance, closest);
+					closest = child;
+					closestDistance = distance;
+				} else {
+					pushBranch(branches, distance, child);
+				}
+			}
+			checked += parent.childCount;
+			node = closest;
+		}
+
+		// Compare the words of the leaf
+		const Node& leaf = nodes[node];
+		for (int i = leaf.wordBegin; i < leaf.wordEnd; i++) {
+			int word = wordOrder[i];
+			addResult(distanceSqr(query, words.ptr<float>(word), dims), word, k,
+					maxDistanceSqr, results);
+			checked++;
+		}
+	}
+
+	if (k <= 0)
+		sort(results.begin(), results.end());
+}
+
+void VocabularyTreeMatcher::linearSearch(const float* query, int k,
+		float maxDistanceSqr, std::vector<std::pair<float, int> >& results) const {
+	for (int word = 0; word < words.rows; word++)
+		addResult(distanceSqr(query, words.ptr<float>(word), words.cols), word,
+				k, maxDistanceSqr, results);
+}
+
+bool VocabularyTreeMatcher::isMaskSupported() const {
+	return false;
+}
+
+cv::Ptr<cv::DescriptorMatcher> VocabularyTreeMatcher::clone(
+		bool emptyTrainData) const {
+	VocabularyTreeMatcher* matcher = new VocabularyTreeMatcher(branching,
+			leafSize, checks);
+	if (!emptyTrainData) {
+		matcher->trainDescCollection.resize(trainDescCollection.size());
+		for (size_t i = 0; i < trainDescCollection.size(); i++)
+			matcher->trainDescCollection[i] = trainDescCollection[i].clone();
+
+		matcher->built = built;
+		matcher->words = words.clone();
+		matcher->wordSource = wordSource;
+		matcher->centers = centers.clone();
+		matcher->nodes = nodes;
+		matcher->wordOrder = wordOrder;
+		matcher->levels = levels;
+	}
+	return matcher;
+}
+
+int VocabularyTreeMatcher::depth() const {
+	return levels;
+}
+
+void VocabularyTreeMatcher::knnMatchImpl(const cv::Mat& queryDescriptors,
+		std::vector<std::vector<cv::DMatch> >& matches, int k,
+		const std::vector<cv::Mat>& masks, bool compactResult) {
+	train();
+	CV_Assert(queryDescriptors.type() == CV_32FC1);
+	CV_Assert(queryDescriptors.cols == words.cols);
+
+	matches.resize(queryDescriptors.rows);
+	vector<pair<float, int> > branches, results;
+	for (int row = 0; row < queryDescriptors.rows; row++) {
+		search(queryDescriptors.ptr<float>(row), k, 0, branches, results);
+
+		vector<DMatch>& rowMatches = matches[row];
+		rowMatches.clear();
+		for (size_t i = 0; i < results.size(); i++) {
+			const pair<int, int>& source = wordSource[results[i].second];
+			rowMatches.push_back(DMatch(row, source.second, source.first,
+					sqrt(results[i].first)));
+		}
+	}
+}
+
+void VocabularyTreeMatcher::radiusMatchImpl(const cv::Mat& queryDescriptors,
+		std::vector<std::vector<cv::DMatch> >& matches, float maxDistance,
+		const std::vector<cv::Mat>& masks, bool compactResult) {
+	train();
+	CV_Assert(queryDescriptors.type() == CV_32FC1);
+	CV_Assert(queryDescriptors.cols == words.cols);
+
+	matches.resize(queryDescriptors.rows);
+	vector<pair<float, int> > branches, results;
+	for (int row = 0; row < queryDescriptors.rows; row++) {
+		search(queryDescriptors.ptr<float>(row), 0, maxDistance, branches,
+				results);
+
+		vector<DMatch>& rowMatches = matches[row];
+		rowMatches.clear();
+		for (size_t i = 0; i < results.size(); i++) {
+			const pair<int, int>& source = wordSource[results[i].second];
+			rowMatches.push_back(DMatch(row, source.second, source.first,
+					sqrt(results[i].first)));
+		}
+	}
+
+	if (compactResult) {
+		vector<vector<DMatch> > compact;
+		for (size_t i = 0; i < matches.size(); i++) {
+			if (!matches[i].empty())
+				compact.push_back(matches[i]);
+		}
+		matches.swap(compact);
+	}
+}
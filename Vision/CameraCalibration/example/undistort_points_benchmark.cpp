@@ -0,0 +1,194 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        CameraCalibration
+// File:           undistort_points_benchmark.cpp
+// Description:    compares rectifying whole frames with undistorting only the detected points
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/undistort_points_benchmark.cpp src/RectifyImage.cpp `pkg-config --cflags --libs opencv` -lboost_filesystem -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <CameraCalibration/RectifyImage.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+#define RUNS 100
+//3 fiducials and 10 crates of 3 corners
+#define POINTS (3 + 10 * 3)
+
+/**
+ * Looks up where a raw point ends up in the rectified image, the way rectify() moves it:
+ * the rectified pixel whose map entry points at the raw point.
+ * Newton iteration on the bilinearly interpolated maps.
+ */
+bool remapPosition(const Mat& mapX, const Mat& mapY, const Point2f& raw, Point2f& rectified){
+	double x = raw.x, y = raw.y;
+	for(int n = 0; n < 50; n++){
+		int ix = (int)floor(x), iy = (int)floor(y);
+		if(ix < 0 || iy < 0 || ix + 1 >= mapX.cols || iy + 1 >= mapX.rows) return false;
+		double fx = x - ix, fy = y - iy;
+
+		double mx[4] = { mapX.at<float>(iy, ix), mapX.at<float>(iy, ix + 1), mapX.at<float>(iy + 1, ix), mapX.at<float>(iy + 1, ix + 1) };
+		double my[4] = { mapY.at<float>(iy, ix), mapY.at<float>(iy, ix + 1), mapY.at<float>(iy + 1, ix), mapY.at<float>(iy + 1, ix + 1) };
+		double u = (1 - fy) * ((1 - fx) * mx[0] + fx * mx[1]) + fy * ((1 - fx) * mx[2] + fx * mx[3]);
+		double v = (1 - fy) * ((1 - fx) * my[0] + fx * my[1]) + fy * ((1 - fx) * my[2] + fx * my[3]);
+
+		//jacobian of the bilinear interpolation
+		double dudx = (1 - fy) * (mx[1] - mx[0]) + fy * (mx[3] - mx[2]);
+		double dudy = (1 - fx) * (mx[2] - mx[0]) + fx * (mx[3] - mx[1]);
+		double dvdx = (1 - fy) * (my[1] - my[0]) + fy * (my[3] - my[2]);
+		double dvdy = (1 - fx) * (my[2] - my[0]) + fx * (my[3] - my[1]);
+		double det = dudx * dvdy - dudy * dvdx;
+		if(fabs(det) < 1e-12) return false;
+
+		double eu = raw.x - u, ev = raw.y - v;
+		double dx = (dvdy * eu - dudy * ev) / det;
+		double dy = (dudx * ev - dvdx * eu) / det;
+		x += dx;
+		y += dy;
+		if(fabs(dx) < 1e-6 && fabs(dy) < 1e-6){
+			rectified = Point2f(x, y);
+			return true;
+		}
+	}
+	return false;
+}
+
+int main(int argc, char** argv){
+	if(argc < 2){
+		printf("usage: %s correction_xml [image] [mm_per_pixel]\n", argv[0]);
+		printf("without an image a random 800x600 frame is used, mm_per_pixel defaults to 0.25 (the delta robot table)\n");
+		return 1;
+	}
+	Mat frame;
+	if(argc > 2) frame = imread(argv[2]);
+	if(frame.empty()){
+		frame = Mat(600, 800, CV_8UC3);
+		randu(frame, Scalar::all(0), Scalar::all(255));
+	}
+	double mmPerPixel = argc > 3 ? atof(argv[3]) : 0.25;
+
+	RectifyImage rectifier;
+	if(!rectifier.initRectify(argv[1], frame.size())){
+		printf("Could not read %s\n", argv[1]);
+		return 1;
+	}
+
+	//current path: rectify the frame and detect on the rectified gray frame
+	Mat rectified, gray;
+	int64 start = getTickCount();
+	for(int i = 0; i < RUNS; i++){
+		rectifier.rectify(frame, rectified);
+		cvtColor(rectified, gray, CV_BGR2GRAY);
+	}
+	double rectifyMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / RUNS;
+
+	//point path: detect on the raw gray frame and undistort the detected points
+	vector<double> points(POINTS * 2);
+	for(int i = 0; i < POINTS; i++){
+		points[i * 2] = rand() % frame.cols;
+		points[i * 2 + 1] = rand() % frame.rows;
+	}
+	vector<double> undistorted(points.size());
+	start = getTickCount();
+	for(int i = 0; i < RUNS; i++){
+		cvtColor(frame, gray, CV_BGR2GRAY);
+		rectifier.undistortPoints(&points[0], &undistorted[0], POINTS);
+	}
+	double pointsMs = (getTickCount() - start) * 1000.0 / getTickFrequency() / RUNS;
+
+	printf("%-36s%8.3f ms/frame\n", "rectify + gray", rectifyMs);
+	printf("%-36s%8.3f ms/frame\n", "gray + undistort 33 points", pointsMs);
+	printf("%-36s%8.3f ms/frame\n", "saved", rectifyMs - pointsMs);
+
+	//accuracy: crates of 50 pixels at every position and angle, compared to where rectify() puts their corners
+	Mat mapX(frame.size(), CV_32FC1), mapY(frame.size(), CV_32FC1);
+	{
+		//the maps of the rectifier, recovered by rectifying the coordinates themselves
+		Mat coords(frame.size(), CV_32FC2);
+		for(int y = 0; y < frame.rows; y++){
+			for(int x = 0; x < frame.cols; x++){
+				coords.at<Vec2f>(y, x) = Vec2f(x, y);
+			}
+		}
+		Mat remapped;
+		rectifier.rectify(coords, remapped);
+		vector<Mat> channels;
+		split(remapped, channels);
+		mapX = channels[0];
+		mapY = channels[1];
+	}
+
+	double worstCorner = 0, worstAngle = 0;
+	int crates = 0;
+	for(int cy = 60; cy < frame.rows - 60; cy += 20){
+		for(int cx = 60; cx < frame.cols - 60; cx += 20){
+			for(int a = 0; a < 90; a += 15){
+				double angle = a * CV_PI / 180;
+				Point2f corners[3];
+				Point2f offsets[3] = { Point2f(-25, -25), Point2f(25, -25), Point2f(-25, 25) };
+				for(int n = 0; n < 3; n++){
+					corners[n] = Point2f(cx + offsets[n].x * cos(angle) - offsets[n].y * sin(angle),
+							cy + offsets[n].x * sin(angle) + offsets[n].y * cos(angle));
+				}
+
+				Point2f viaRemap[3], viaPoints[3];
+				bool valid = true;
+				for(int n = 0; n < 3 && valid; n++){
+					valid = remapPosition(mapX, mapY, corners[n], viaRemap[n]);
+					double p[2] = { corners[n].x, corners[n].y };
+					rectifier.undistortPoints(p, p, 1);
+					viaPoints[n] = Point2f(p[0], p[1]);
+				}
+				if(!valid) continue;
+				crates++;
+
+				for(int n = 0; n < 3; n++){
+					Point2f d = viaRemap[n] - viaPoints[n];
+					worstCorner = max(worstCorner, sqrt(d.dot(d)) * mmPerPixel);
+				}
+				double angleRemap = atan2(viaRemap[1].y - viaRemap[0].y, viaRemap[1].x - viaRemap[0].x);
+				double anglePoints = atan2(viaPoints[1].y - viaPoints[0].y, viaPoints[1].x - viaPoints[0].x);
+				worstAngle = max(worstAngle, fabs(angleRemap - anglePoints) * 180 / CV_PI);
+			}
+		}
+	}
+
+	printf("%d crate poses, largest corner difference %.4f mm, largest angle difference %.4f degrees\n", crates, worstCorner, worstAngle);
+	if(worstCorner > 0.1){
+		printf("FAILED: the point path is more than 0.1 mm off\n");
+		return 1;
+	}
+	return 0;
+}
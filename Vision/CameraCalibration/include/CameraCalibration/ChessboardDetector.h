@@ -0,0 +1,130 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        CameraCalibration
+// File:           ChessboardDetector.h
+// Description:    Parallel, cached extraction of checker board corners for calibration
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#ifndef CHESSBOARDDETECTOR_H_
+#define CHESSBOARDDETECTOR_H_
+
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief finds the checker board corners in a set of calibration images \n
+ * the images are handled by a pool of threads, and the corners of every image are
+ * stored in a cache directory so the next calibration with the same images does not detect them again
+ */
+class ChessboardDetector {
+public:
+	/**
+	 * The corners found in a single image
+	 */
+	struct Result {
+		/**
+		 * <i>true</i> if the complete board was found
+		 */
+		bool found;
+		/**
+		 * <i>true</i> if the result was read from the cache
+		 */
+		bool cached;
+		/**
+		 * the size of the image
+		 */
+		cv::Size imageSize;
+		/**
+		 * the corners of the board with sub pixel precision, empty if the board was not found
+		 */
+		std::vector<cv::Point2f> corners;
+	};
+
+	/**
+	 * Constructor
+	 *
+	 * @param boardSize amount of squares horizontally -1, amount of squares vertically -1
+	 * @param cacheDir the directory where the corners are cached, empty for no cache.
+	 * The cached corners are kept per board size and per setting of the detector.
+	 * @param threads the amount of threads, 0 for one per core
+	 */
+	ChessboardDetector(const cv::Size &boardSize, const std::string &cacheDir = "", unsigned int threads = 0);
+
+	/**
+	 * Images wider than this are first searched at this width with a fast check.
+	 * When the board is found there, its corners are refined in the full image,
+	 * otherwise the full image is searched as if there was no check. 0 disables the check. Default 800.
+	 */
+	int preCheckWidth;
+	/**
+	 * The image is enlarged up to this factor when the board is not found, for small boards. Default 1.
+	 */
+	int maxScale;
+	/**
+	 * Half the size of the search window of cornerSubPix. Default 4x4.
+	 */
+	cv::Size subPixWindow;
+	/**
+	 * Stop criteria of cornerSubPix. Default 30 iterations or 0.1 pixel.
+	 */
+	cv::TermCriteria subPixCriteria;
+
+	/**
+	 * Finds the board in image files
+	 *
+	 * @param paths the paths of the images
+	 * @param results receives a result for every path, in the same order
+	 * @return the amount of images in which the board was found
+	 */
+	int detect(const std::vector<std::string> &paths, std::vector<Result> &results);
+	/**
+	 * Finds the board in images that are already loaded. The cache is keyed on the pixel data.
+	 *
+	 * @param images the images, grayscale or color
+	 * @param results receives a result for every image, in the same order
+	 * @return the amount of images in which the board was found
+	 */
+	int detect(const std::vector<cv::Mat> &images, std::vector<Result> &results);
+
+private:
+	cv::Size boardSize;
+	std::string cacheDir;
+	unsigned int threads;
+
+	struct Job;
+	int run(Job &job);
+	void worker(Job *job);
+	void detectImage(const std::vector<std::string> *paths, const std::vector<cv::Mat> *images, size_t index, Result &result);
+	void findCorners(const cv::Mat &gray, Result &result);
+	std::string cachePath(unsigned long long hash) const;
+	bool readCache(const std::string &path, Result &result) const;
+	void writeCache(const std::string &path, const Result &result) const;
+};
+
+#endif /* CHESSBOARDDETECTOR_H_ */
@@ -35,6 +35,8 @@
 #define RECTIFYIMAGE_H_
 
 #include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
 /**
  * @brief this class creates and uses a matrix in order to rectify an image \n
  * the matrix is created by loading a directory with checker board pattern images
@@ -45,8 +47,13 @@ private:
 	std::vector<std::vector<cv::Point2f> > imagePoints;
 	cv::Mat distCoeffs;
 	cv::Mat cameraMatrix;
+	cv::Mat newCameraMatrix;
 	cv::Mat map1;
 	cv::Mat map2;
+	//cameraMatrix, newCameraMatrix and distCoeffs as plain numbers for undistortPoints
+	double camera[4];
+	double newCamera[4];
+	double coeffs[8];
 
 	void addPoints(const std::vector<cv::Point2f>& imageCorners, const std::vector<cv::Point3f>& objectCorners);
 	double calibrate(cv::Size &imageSize);
@@ -57,9 +64,10 @@ public:
 	 * @param imageDir the directory which contains the image to rectify
 	 * @param boardSize amount of squares horizontally -1, amount of squares vertically -1
 	 * @param XMLName the name of the xml file were the matrix for rectification is written to
+	 * @param cacheDir a directory where the corners found in every image are cached, so calibrating again with the same images skips the detection. empty for no cache
 	 * @return the amount of images which are successfully processed
 	 */
-	int createXML(const char* imageDir, const cv::Size &boardSize, const char* XMLName);
+	int createXML(const char* imageDir, const cv::Size &boardSize, const char* XMLName, const std::string &cacheDir = "");
 	/**
 	 * this function loads a matrix to rectify
 	 *
@@ -75,6 +83,23 @@ public:
 	 * @param output The rectified image
 	 */
 	void rectify(const cv::Mat &input, cv::Mat &output);
+	/**
+	 * Returns where points of an unrectified image are in the rectified image.
+	 * This is the same correction as rectify() does, but only for the given points,
+	 * so detection can run on the unrectified image.
+	 *
+	 * @param input The points in the unrectified image
+	 * @param output The points in the rectified image, may be the same vector as input
+	 */
+	void undistortPoints(const std::vector<cv::Point2f> &input, std::vector<cv::Point2f> &output) const;
+	/**
+	 * Returns where points of an unrectified image are in the rectified image
+	 *
+	 * @param input count x,y pairs in the unrectified image
+	 * @param output receives count x,y pairs in the rectified image, may be the same array as input
+	 * @param count the amount of points
+	 */
+	void undistortPoints(const double* input, double* output, size_t count) const;
 };
 
 #endif /* RECTIFYIMAGE_H_ */
@@ -0,0 +1,289 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        CameraCalibration
+// File:           ChessboardDetector.cpp
+// Description:    Parallel, cached extraction of checker board corners for calibration
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <CameraCalibration/ChessboardDetector.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+
+using namespace cv;
+using namespace std;
+
+namespace {
+	//FNV-1a, enough to tell calibration images apart
+	const unsigned long long FNV_OFFSET = 14695981039346656037ULL;
+	const unsigned long long FNV_PRIME = 1099511628211ULL;
+
+	unsigned long long fnv(const unsigned char* data, size_t size, unsigned long long hash = FNV_OFFSET){
+		for(size_t i = 0; i < size; i++){
+			hash ^= data[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	bool readFile(const string& path, vector<unsigned char>& buffer){
+		ifstream file(path.c_str(), ios::in | ios::binary);
+		if(!file) return false;
+		file.seekg(0, ios::end);
+		streamoff size = file.tellg();
+		if(size <= 0) return false;
+		file.seekg(0, ios::beg);
+		buffer.resize(size);
+		file.read((char*)&buffer[0], size);
+		return file.good();
+	}
+}
+
+struct ChessboardDetector::Job {
+	const vector<string>* paths;
+	const vector<Mat>* images;
+	vector<Result>* results;
+	size_t count;
+	boost::mutex mutex;
+	size_t next;
+};
+
+ChessboardDetector::ChessboardDetector(const Size &boardSize, const string &cacheDir, unsigned int threads) :
+		preCheckWidth(800), maxScale(1), subPixWindow(4, 4),
+		subPixCriteria(TermCriteria::MAX_ITER + TermCriteria::EPS, 30, 0.1),
+		boardSize(boardSize), cacheDir(cacheDir), threads(threads) {
+	if(this->threads == 0){
+		this->threads = boost::thread::hardware_concurrency();
+		if(this->threads == 0) this->threads = 1;
+	}
+	if(!this->cacheDir.empty()){
+		boost::system::error_code error;
+		boost::filesystem::create_directories(this->cacheDir, error);
+	}
+}
+
+int ChessboardDetector::detect(const vector<string> &paths, vector<Result> &results){
+	Job job;
+	job.paths = &paths;
+	job.images = NULL;
+	job.results = &results;
+	job.count = paths.size();
+	return run(job);
+}
+
+int ChessboardDetector::detect(const vector<Mat> &images, vector<Result> &results){
+	Job job;
+	job.paths = NULL;
+	job.images = &images;
+	job.results = &results;
+	job.count = images.size();
+	return run(job);
+}
+
+int ChessboardDetector::run(Job &job){
+	job.results->assign(job.count, Result());
+	job.next = 0;
+
+	boost::thread_group group;
+	for(unsigned int i = 0; i < threads && i < job.count; i++){
+		group.create_thread(boost::bind(&ChessboardDetector::worker, this, &job));
+	}
+	group.join_all();
+
+	int found = 0;
+	for(size_t i = 0; i < job.count; i++){
+		if((*job.results)[i].found) found++;
+	}
+	return found;
+}
+
+void ChessboardDetector::worker(Job *job){
+	while(true){
+		size_t index;
+		{
+			boost::lock_guard<boost::mutex> lock(job->mutex);
+			if(job->next >= job->count) return;
+			index = job->next++;
+		}
+		detectImage(job->paths, job->images, index, (*job->results)[index]);
+	}
+}
+
+void ChessboardDetector::detectImage(const vector<string> *paths, const vector<Mat> *images, size_t index, Result &result){
+	result.found = false;
+	result.cached = false;
+
+	Mat gray;
+	unsigned long long hash;
+	vector<unsigned char> buffer;
+	if(paths != NULL){
+		if(!readFile((*paths)[index], buffer)) return;
+		hash = fnv(&buffer[0], buffer.size());
+	} else {
+		const Mat &image = (*images)[index];
+		if(image.empty()) return;
+		int header[3] = { image.rows, image.cols, image.type() };
+		hash = fnv((const unsigned char*)header, sizeof(header));
+		for(int y = 0; y < image.rows; y++){
+			hash = fnv(image.ptr(y), image.cols * image.elemSize(), hash);
+		}
+	}
+
+	string cacheFile;
+	if(!cacheDir.empty()){
+		cacheFile = cachePath(hash);
+		if(readCache(cacheFile, result)){
+			result.cached = true;
+			return;
+		}
+	}
+
+	if(paths != NULL){
+		gray = imdecode(Mat(buffer), 0);
+	} else if((*images)[index].channels() == 3){
+		cvtColor((*images)[index], gray, CV_BGR2GRAY);
+	} else {
+		gray = (*images)[index];
+	}
+	if(gray.empty()) return;
+
+	findCorners(gray, result);
+	if(!cacheFile.empty()) writeCache(cacheFile, result);
+}
+
+void ChessboardDetector::findCorners(const Mat &gray, Result &result){
+	result.imageSize = gray.size();
+	vector<Point2f> &corners = result.corners;
+	bool found = false;
+
+	if(preCheckWidth > 0 && gray.cols > preCheckWidth){
+		//search a downscaled copy first, which is much faster when the board is found there
+		double factor = double(preCheckWidth) / gray.cols;
+		Mat small;
+		resize(gray, small, Size(), factor, factor, INTER_AREA);
+		found = findChessboardCorners(small, boardSize, corners,
+				CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE | CALIB_CB_FAST_CHECK);
+		if(found){
+			for(size_t i = 0; i < corners.size(); i++){
+				corners[i].x = (corners[i].x + 0.5f) / factor - 0.5f;
+				corners[i].y = (corners[i].y + 0.5f) / factor - 0.5f;
+			}
+			//the scaled corners can be off by the scale factor, first refine with a window that covers that
+			int coarse = cvCeil(1 / factor) + 2;
+			if(coarse > subPixWindow.width || coarse > subPixWindow.height){
+				cornerSubPix(gray, corners, Size(max(coarse, subPixWindow.width), max(coarse, subPixWindow.height)),
+						Size(-1, -1), subPixCriteria);
+			}
+		}
+	}
+
+	//a board the downscaled copy missed can still be found in the full (or enlarged) image
+	for(int scale = 1; scale <= maxScale && !found; scale++){
+		Mat timg;
+		if(scale == 1){
+			timg = gray;
+		} else {
+			resize(gray, timg, Size(), scale, scale);
+		}
+		found = findChessboardCorners(timg, boardSize, corners, CALIB_CB_ADAPTIVE_THRESH | CALIB_CB_NORMALIZE_IMAGE);
+		if(found && scale > 1){
+			for(size_t i = 0; i < corners.size(); i++){
+				corners[i] *= 1.f / scale;
+			}
+		}
+	}
+	if(!found){
+		corners.clear();
+		return;
+	}
+
+	cornerSubPix(gray, corners, subPixWindow, Size(-1, -1), subPixCriteria);
+	result.found = corners.size() == (size_t)boardSize.area();
+	if(!result.found) corners.clear();
+}
+
+string ChessboardDetector::cachePath(unsigned long long hash) const{
+	//the settings change the corners that are found, every combination has its own entry
+	stringstream settings;
+	settings << setprecision(17) << preCheckWidth << " " << maxScale << " "
+			<< subPixWindow.width << " " << subPixWindow.height << " "
+			<< subPixCriteria.type << " " << subPixCriteria.maxCount << " " << subPixCriteria.epsilon;
+	string s = settings.str();
+	unsigned long long settingsHash = fnv((const unsigned char*)s.data(), s.size());
+
+	stringstream ss;
+	ss << cacheDir << "/" << hex << setw(16) << setfill('0') << hash << dec << "_" << boardSize.width << "x" << boardSize.height
+			<< "_" << hex << setw(8) << setfill('0') << (settingsHash & 0xffffffffULL) << dec << ".corners";
+	return ss.str();
+}
+
+bool ChessboardDetector::readCache(const string &path, Result &result) const{
+	ifstream file(path.c_str());
+	if(!file) return false;
+	int found, count;
+	file >> found >> result.imageSize.width >> result.imageSize.height >> count;
+	//a found board has all its corners, a missing one none, anything else is a corrupt entry
+	int expected = found ? boardSize.area() : 0;
+	if(!file || count != expected) return false;
+	result.corners.resize(count);
+	for(int i = 0; i < count; i++){
+		file >> result.corners[i].x >> result.corners[i].y;
+	}
+	if(!file){
+		result.corners.clear();
+		return false;
+	}
+	result.found = found != 0;
+	return true;
+}
+
+void ChessboardDetector::writeCache(const string &path, const Result &result) const{
+	//write to a temporary file first, so a concurrent calibration never reads half a file
+	stringstream tmp;
+	tmp << path << "." << boost::this_thread::get_id() << ".tmp";
+	{
+		ofstream file(tmp.str().c_str());
+		if(!file) return;
+		file << (result.found ? 1 : 0) << " " << result.imageSize.width << " " << result.imageSize.height << " " << result.corners.size() << "\n";
+		file << setprecision(9);
+		for(size_t i = 0; i < result.corners.size(); i++){
+			file << result.corners[i].x << " " << result.corners[i].y << "\n";
+		}
+		if(!file) return;
+	}
+	rename(tmp.str().c_str(), path.c_str());
+}
@@ -53,12 +53,14 @@ int main(int argc, char* argv[]){
 	RectifyImage ri;
 	if(command == "train"){
 		if(argc < 4){
-			cout << "second argument has to be the image directory, the third the xml name" << endl;
+			cout << "second argument has to be the image directory, the third the xml name, "
+					"the optional fourth a directory to cache the found corners in" << endl;
 			return -1;
 		}
 
 		cv::Size boardSize(9,6);
-		if(ri.createXML(argv[2], boardSize, argv[3])<=0){
+		std::string cacheDir = argc > 4 ? argv[4] : "";
+		if(ri.createXML(argv[2], boardSize, argv[3], cacheDir)<=0){
 			cout << "training failed" << endl;
 			return -1;
 		}
@@ -31,12 +31,15 @@
 // OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //******************************************************************************
 #include <CameraCalibration/RectifyImage.h>
+#include <CameraCalibration/ChessboardDetector.h>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include <boost/filesystem.hpp>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 
 using namespace cv;
 using namespace std;
@@ -58,8 +61,7 @@ double RectifyImage::calibrate(Size &imageSize){
 			0);				// set options
 }
 
-int RectifyImage::createXML(const char* imageDir, const Size &boardSize, const char* XMLName){
-	vector<Point2f> imageCorners;
+int RectifyImage::createXML(const char* imageDir, const Size &boardSize, const char* XMLName, const string &cacheDir){
 	vector<Point3f> objectCorners;
 
 	for (int i=0; i<boardSize.height; i++) {
@@ -72,22 +74,26 @@ int RectifyImage::createXML(const char* imageDir, const Size &boardSize, const c
 		return -1;
 	}
 
-	Mat image;
-	int successes = 0;
+	vector<string> paths;
 	for (directory_iterator iter = directory_iterator(imageDir); iter != directory_iterator(); iter++) {
-		image = imread(iter->path().string().c_str(), 0);
-		if(image.data){
-			bool found = findChessboardCorners(image, boardSize, imageCorners);
-
-			if(found) {
-				cornerSubPix(image, imageCorners, Size(4, 4), Size(-1, -1),
-				TermCriteria(TermCriteria::MAX_ITER + TermCriteria::EPS, 30, 0.1));
-
-				if (imageCorners.size() == (uint)boardSize.area()) {
-					addPoints(imageCorners, objectCorners);
-					successes++;
-				}
-			}
+		if(is_regular_file(iter->status())){
+			paths.push_back(iter->path().string());
+		}
+	}
+	//the order of the images influences the calibration, keep it the same on every run
+	sort(paths.begin(), paths.end());
+
+	ChessboardDetector detector(boardSize, cacheDir);
+	vector<ChessboardDetector::Result> results;
+	detector.detect(paths, results);
+
+	Size imageSize;
+	int successes = 0;
+	for(size_t i = 0; i < results.size(); i++){
+		if(results[i].found){
+			addPoints(results[i].corners, objectCorners);
+			imageSize = results[i].imageSize;
+			successes++;
 		}
 	}
 
@@ -95,9 +101,7 @@ int RectifyImage::createXML(const char* imageDir, const Size &boardSize, const c
 		return -1;
 	}
 
-	Size imageSize(image.cols, image.rows);
 	calibrate(imageSize);
-	image.release();
 
     FileStorage fs(XMLName, FileStorage::WRITE);
     fs << "cameraMatrix" << cameraMatrix;
@@ -114,10 +118,60 @@ bool RectifyImage::initRectify(const char* XMLName, const Size &imageSize){
 	FileStorage fs(XMLName, FileStorage::READ);
 	fs["cameraMatrix"] >> cameraMatrix;
 	fs["distCoeffs"] >> distCoeffs;
-	initUndistortRectifyMap( cameraMatrix, distCoeffs, Mat(), Mat(), imageSize, CV_32FC1, map1, map2);
+	//the camera matrix initUndistortRectifyMap uses by default, undistortPoints needs it as well
+	newCameraMatrix = getDefaultNewCameraMatrix(cameraMatrix, imageSize, true);
+	initUndistortRectifyMap( cameraMatrix, distCoeffs, Mat(), newCameraMatrix, imageSize, CV_32FC1, map1, map2);
+
+	Mat_<double> A, Ar, k;
+	cameraMatrix.convertTo(A, CV_64F);
+	newCameraMatrix.convertTo(Ar, CV_64F);
+	distCoeffs.convertTo(k, CV_64F);
+	camera[0] = A(0, 0); camera[1] = A(1, 1); camera[2] = A(0, 2); camera[3] = A(1, 2);
+	newCamera[0] = Ar(0, 0); newCamera[1] = Ar(1, 1); newCamera[2] = Ar(0, 2); newCamera[3] = Ar(1, 2);
+	for(int i = 0; i < 8; i++){
+		coeffs[i] = i < (int)k.total() ? k(i) : 0;
+	}
 	return true;
 }
 
 void RectifyImage::rectify(const Mat &input, Mat &output){
 	remap(input, output, map1, map2, INTER_LINEAR);
 }
+
+void RectifyImage::undistortPoints(const vector<Point2f> &input, vector<Point2f> &output) const{
+	output.resize(input.size());
+	for(size_t i = 0; i < input.size(); i++){
+		double point[2] = { input[i].x, input[i].y };
+		undistortPoints(point, point, 1);
+		output[i] = Point2f(point[0], point[1]);
+	}
+}
+
+void RectifyImage::undistortPoints(const double* input, double* output, size_t count) const{
+	const double k1 = coeffs[0], k2 = coeffs[1], p1 = coeffs[2], p2 = coeffs[3];
+	const double k3 = coeffs[4], k4 = coeffs[5], k5 = coeffs[6], k6 = coeffs[7];
+
+	for(size_t i = 0; i < count * 2; i += 2){
+		double x0 = (input[i] - camera[2]) / camera[0];
+		double y0 = (input[i + 1] - camera[3]) / camera[1];
+
+		//invert the distortion model by fixed point iteration, like cv::undistortPoints does.
+		//the lens of the delta robot needs more than the 5 iterations of cv::undistortPoints in the corners
+		double x = x0, y = y0;
+		for(int n = 0; n < 20; n++){
+			double r2 = x * x + y * y;
+			double icdist = (1 + ((k6 * r2 + k5) * r2 + k4) * r2) / (1 + ((k3 * r2 + k2) * r2 + k1) * r2);
+			double deltaX = 2 * p1 * x * y + p2 * (r2 + 2 * x * x);
+			double deltaY = p1 * (r2 + 2 * y * y) + 2 * p2 * x * y;
+			double nx = (x0 - deltaX) * icdist;
+			double ny = (y0 - deltaY) * icdist;
+			bool converged = fabs(nx - x) < 1e-9 && fabs(ny - y) < 1e-9;
+			x = nx;
+			y = ny;
+			if(converged) break;
+		}
+
+		output[i] = x * newCamera[0] + newCamera[2];
+		output[i + 1] = y * newCamera[1] + newCamera[3];
+	}
+}
@@ -32,6 +32,9 @@
 //******************************************************************************
 
 #include "unicap_cv_bridge.hpp"
+#include "FrameSource/UnicapSource.h"
+#include "FrameSource/VideoCaptureSource.h"
+#include "FrameSource/ReplaySource.h"
 #include "FiducialDetector.h"
 #include "CrateDetector.h"
 #include "Crate.h"
@@ -153,10 +156,37 @@ void callback(char key, cv::Mat* image = NULL) {
 	}
 }
 
+void run(framesource::FrameSource& source, const char* rectifyPath) {
+	cv::Size size = source.get_size();
+	cv::Mat frame(size, source.get_format());
+
+	RectifyImage rectify;
+	if(rectifyPath) rectify.initRectify(rectifyPath, size);
+
+	// Retrieve camera frames
+	char key = 0;
+	while (key != 'q' && source.get_frame(frame)) {
+		imshow("Original", frame);
+
+		if(rectifyPath) rectify.rectify(frame.clone(), frame);
+
+		cv::Mat gray;
+		cv::Mat image = frame.clone();
+		cv::cvtColor(frame, gray, CV_BGR2GRAY);
+
+		process(gray, frame);
+
+		imshow("Result", frame);
+		key = cv::waitKey(10);
+		callback(key, &image);
+	}
+}
+
 void usage(char* cmd) {
 	std::cout << "Usage:\t" << cmd << " image <path> [rectify path]" << std::endl;
 	std::cout << "\t" << cmd << " cam <index> [rectify path]" << std::endl;
 	std::cout << "\t" << cmd << " unicap <index> <format> [rectify path]" << std::endl;
+	std::cout << "\t" << cmd << " replay <image directory | video> [fps, 0 for max speed] [rectify path]" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -213,36 +243,13 @@ int main(int argc, char* argv[]) {
 		}
 
 		// Initialize camera
-		cv::VideoCapture cam(atoi(argv[2]));
-		cv::Size size(cam.get(CV_CAP_PROP_FRAME_WIDTH), cam.get(CV_CAP_PROP_FRAME_HEIGHT));
-		cv::Mat frame;
-
-		if (!cam.isOpened()) {
-			std::cout << "Failed to open camera" << std::endl;
+		try {
+			framesource::VideoCaptureSource cam(atoi(argv[2]));
+			run(cam, argc > 3 ? argv[3] : NULL);
+		} catch(framesource::FrameSourceException& e) {
+			std::cout << e.what() << std::endl;
 			return -1;
 		}
-
-		RectifyImage rectify;
-		if(argc > 3) rectify.initRectify(argv[3], size);
-
-		// Retrieve camera frames
-		char key = 0;
-		while (key != 'q') {
-			cam.read(frame);
-
-			imshow("Original", frame);
-
-			if(argc > 4) rectify.rectify(frame.clone(), frame);
-
-			cv::Mat gray;
-			cv::cvtColor(frame, gray, CV_BGR2GRAY);
-
-			process(gray, frame);
-
-			imshow("Result", frame);
-			key = cv::waitKey(10);
-			callback(key, &frame);
-		}
 	}
 	else if(!strcmp(argv[1], "unicap")) {
 		if(argc < 4) {
@@ -253,34 +260,24 @@ int main(int argc, char* argv[]) {
 		// Initialize camera
 		int device = atoi(argv[2]);
 		int format = atoi(argv[3]);
-		unicap_cv_bridge::unicap_cv_camera cam(device,format);
-		cv::Size size(cam.get_img_width(), cam.get_img_height());
-		cv::Mat frame(size, cam.get_img_format());
-
-		cam.set_exposure(0.01);
-		cam.set_auto_white_balance(true);
-
-		RectifyImage rectify;
-		if(argc > 4) rectify.initRectify(argv[4], size);
-
-		// Retrieve camera frames
-		char key = 0;
-		while (key != 'q') {
-			cam.get_frame(&frame);
-
-			imshow("Original", frame);
-
-			if(argc > 4) rectify.rectify(frame.clone(), frame);
-
-			cv::Mat gray;
-			cv::Mat image = frame.clone();
-			cv::cvtColor(frame, gray, CV_BGR2GRAY);
-
-			process(gray, frame);
+		framesource::UnicapSource cam(device, format);
+		cam.get_camera().set_exposure(0.01);
+		cam.get_camera().set_auto_white_balance(true);
+		run(cam, argc > 4 ? argv[4] : NULL);
+	}
+	else if(!strcmp(argv[1], "replay")) {
+		if(argc < 3) {
+			usage(argv[0]);
+			return 1;
+		}
 
-			imshow("Result", frame);
-			key = cv::waitKey(10);
-			callback(key, &image);
+		double rate = argc > 3 ? atof(argv[3]) : framesource::ReplaySource::RECORDED_RATE;
+		try {
+			framesource::ReplaySource replay(argv[2], rate, true);
+			run(replay, argc > 4 ? argv[4] : NULL);
+		} catch(framesource::FrameSourceException& e) {
+			std::cout << e.what() << std::endl;
+			return -1;
 		}
 	}
 	else {
@@ -0,0 +1,131 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        DetectQRCode
+// File:           qr_localizer_benchmark.cpp
+// Description:    Compares QR decoding with and without the finder pattern localization
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude -I../Fiducial/include example/qr_localizer_benchmark.cpp src/BarcodeDetector.cpp src/MagickMat.cpp ../Fiducial/src/QRCodeDetector.cpp ../Fiducial/src/QRLocalizer.cpp ../Fiducial/src/Crate.cpp `pkg-config --cflags --libs opencv Magick++` -lzbar -lboost_filesystem -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "DetectQRCode/BarcodeDetector.h"
+#include <QRCodeDetector.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/**
+ * Decodes every image with and without localization and compares the results.
+ * Usage: qr_localizer_benchmark [image directory]...
+ * The default directory is Barcodes, the images of MetaDataApp/Test_set can be added.
+ */
+int main(int argc, char** argv){
+	std::vector<std::string> dirs;
+	for(int i = 1; i < argc; i++){
+		dirs.push_back(argv[i]);
+	}
+	if(dirs.empty()){
+		dirs.push_back("Barcodes");
+	}
+
+	std::vector<std::string> paths;
+	for(size_t i = 0; i < dirs.size(); i++){
+		boost::filesystem::directory_iterator end;
+		for(boost::filesystem::directory_iterator it(dirs[i]); it != end; ++it){
+			std::string ext = it->path().extension().string();
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			if(ext == ".jpg" || ext == ".png" || ext == ".bmp"){
+				paths.push_back(it->path().string());
+			}
+		}
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::vector<cv::Mat> images;
+	for(size_t i = 0; i < paths.size(); i++){
+		images.push_back(cv::imread(paths[i]));
+	}
+
+	DetectBarcode barcode;
+	QRCodeDetector qr;
+	double tick = cv::getTickFrequency() / 1000.0;
+	double fullBarcodeMs = 0, localBarcodeMs = 0, fullQRMs = 0, localQRMs = 0;
+	int fullBarcodes = 0, localBarcodes = 0, fullQR = 0, localQR = 0, differences = 0;
+
+	for(size_t i = 0; i < images.size(); i++){
+		cv::Mat gray;
+		cv::cvtColor(images[i], gray, CV_BGR2GRAY);
+		std::string full, local;
+
+		barcode.localize = false;
+		int64 start = cv::getTickCount();
+		bool fullFound = barcode.detect(images[i], full);
+		fullBarcodeMs += (cv::getTickCount() - start) / tick;
+
+		barcode.localize = true;
+		start = cv::getTickCount();
+		bool localFound = barcode.detect(images[i], local);
+		localBarcodeMs += (cv::getTickCount() - start) / tick;
+
+		fullBarcodes += fullFound;
+		localBarcodes += localFound;
+		if(fullFound != localFound || full != local){
+			printf("DetectBarcode differs on %s: '%s' / '%s'\n", paths[i].c_str(), full.c_str(), local.c_str());
+			differences++;
+		}
+
+		std::vector<Crate> fullCrates, localCrates;
+		qr.localize = false;
+		start = cv::getTickCount();
+		qr.detectCrates(gray, fullCrates);
+		fullQRMs += (cv::getTickCount() - start) / tick;
+
+		qr.localize = true;
+		start = cv::getTickCount();
+		qr.detectCrates(gray, localCrates);
+		localQRMs += (cv::getTickCount() - start) / tick;
+
+		fullQR += fullCrates.size();
+		localQR += localCrates.size();
+		if(fullCrates.size() != localCrates.size()){
+			printf("QRCodeDetector differs on %s: %d / %d crates\n", paths[i].c_str(), (int)fullCrates.size(), (int)localCrates.size());
+			differences++;
+		}
+	}
+
+	int n = std::max((size_t)1, images.size());
+	printf("%d images\n", (int)images.size());
+	printf("DetectBarcode   full  %7.2f ms/image  %7.1f images/s  %d decoded\n", fullBarcodeMs / n, 1000.0 * n / fullBarcodeMs, fullBarcodes);
+	printf("DetectBarcode   local %7.2f ms/image  %7.1f images/s  %d decoded\n", localBarcodeMs / n, 1000.0 * n / localBarcodeMs, localBarcodes);
+	printf("QRCodeDetector  full  %7.2f ms/image  %7.1f images/s  %d crates\n", fullQRMs / n, 1000.0 * n / fullQRMs, fullQR);
+	printf("QRCodeDetector  local %7.2f ms/image  %7.1f images/s  %d crates\n", localQRMs / n, 1000.0 * n / localQRMs, localQR);
+	return differences == 0 ? 0 : 1;
+}
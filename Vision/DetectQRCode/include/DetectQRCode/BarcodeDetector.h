@@ -39,6 +39,7 @@
 #include "MagickMat.h"
 #include <Magick++.h>
 #include <opencv2/core/core.hpp>
+#include <QRLocalizer.h>
 
 /**
  * @brief This class can detect barcodes from a Mat object
@@ -50,6 +51,11 @@ private:
 	MagickMatConverter converter;
 
 public:
+	///@brief locates QR codes, so only the regions around them are scanned before the whole image is
+	QRLocalizer localizer;
+	///@brief whether the localizer is used
+	bool localize;
+
     ///@brief constructor sets the values for the scanner
     DetectBarcode();
     ///@brief deconstructor
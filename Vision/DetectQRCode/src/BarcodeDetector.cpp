@@ -36,6 +36,8 @@
 #include "DetectQRCode/MagickMat.h"
 //#include "MagickBitmapSource.h"
 #include <sstream>
+#include <iostream>
+#include <opencv2/imgproc/imgproc.hpp>
 
 /*#include <zxing/common/Counted.h>
 #include <zxing/Binarizer.h>
@@ -64,9 +66,36 @@ using namespace zxing::qrcode;*/
 
 DetectBarcode::DetectBarcode(){
     scanner.set_config(zbar::ZBAR_NONE, zbar::ZBAR_CFG_ENABLE, 1);
+    localize = true;
 }
 
 bool DetectBarcode::detect(cv::Mat image, std::string &result){
+	// QR codes are found by scanning the regions around their finder patterns,
+	// other codes and QR codes that can not be located by scanning the whole image
+	if(localize){
+		try{
+			cv::Mat gray;
+			if(image.channels() == 3){
+				cv::cvtColor(image, gray, CV_BGR2GRAY);
+			}else{
+				gray = image;
+			}
+
+			std::vector<cv::Rect> regions;
+			localizer.locate(gray, regions);
+			for(std::vector<cv::Rect>::iterator it = regions.begin(); it != regions.end(); ++it){
+				cv::Mat region = gray(*it).clone();
+				zbar::Image zbarImage(region.cols, region.rows, "Y800", region.data, region.cols * region.rows);
+				if(scanner.scan(zbarImage)){
+					result += zbarImage.symbol_begin()->get_data();
+					return true;
+				}
+			}
+		}catch(std::exception &e){
+			std::cerr << "QR localization failed, scanning the whole image: " << e.what() << std::endl;
+		}
+	}
+
 	Magick::Image magickImage;
 	MagickMatConverter converter;
 
@@ -0,0 +1,258 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        DifferentsesSeparation
+// File:           stable_view_benchmark.cpp
+// Description:    compares CPU usage and detection latency of the stable view detection with the old polling loop
+// Author:         agent
+// Notes:          g++ -O2 -mssse3 -Iinclude -I../FrameSource/include example/stable_view_benchmark.cpp src/liblocator.cpp src/DifferenceEngine.cpp ../FrameSource/src/VideoCaptureSource.cpp `pkg-config --cflags --libs opencv` -lboost_thread -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <Locator/liblocator.h>
+#include <Locator/DifferenceEngine.h>
+#include <FrameSource/FrameSource.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <sys/resource.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+
+#define WIDTH 640
+#define HEIGHT 480
+#define FPS 30
+//every cycle an object is placed, moved and left alone, or it is taken away
+#define CYCLES 10
+#define KERNEL_RUNS 200
+
+/**
+ * A camera looking at a static scene with sensor noise, paced at FPS.
+ * The first cycle the view is empty, after that an object is placed and
+ * moved around for half a second, the next cycle it is taken away again.
+ */
+class SceneSource : public framesource::FrameSource{
+public:
+	SceneSource() : frameNr(0), objectPlaced(true){
+		cv::Mat scene(HEIGHT, WIDTH, CV_8UC3);
+		cv::randu(scene, cv::Scalar::all(40), cv::Scalar::all(200));
+		cv::GaussianBlur(scene, scene, cv::Size(9, 9), 0);
+		for(int i = 0; i < 4; i++){
+			cv::Mat noise(HEIGHT, WIDTH, CV_8UC3);
+			cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(6));
+			noisyScenes.push_back(scene + noise);
+		}
+		next = microsec_clock::local_time();
+		lastChange = next;
+	}
+
+	virtual bool get_frame(cv::Mat& frame, boost::posix_time::ptime* timestamp = NULL){
+		next += boost::posix_time::microseconds(1000000 / FPS);
+		boost::this_thread::sleep(next);
+
+		const int cycle = FPS * 2;
+		const int moving = FPS / 2;
+		int t = frameNr % cycle;
+		if(t == 0){
+			objectPlaced = !objectPlaced;
+			if(frameNr != 0){
+				lastChange = microsec_clock::local_time();
+			}
+		}else if(objectPlaced && t <= moving){
+			lastChange = microsec_clock::local_time();
+		}
+		noisyScenes[frameNr % noisyScenes.size()].copyTo(frame);
+		if(objectPlaced){
+			int offset = std::min(t, moving) * 8;
+			cv::rectangle(frame, cv::Point(100 + offset, 100), cv::Point(220 + offset, 200), cv::Scalar(20, 60, 230), CV_FILLED);
+		}
+		frameNr++;
+		if(timestamp != NULL){
+			*timestamp = microsec_clock::local_time();
+		}
+		return true;
+	}
+
+	virtual cv::Size get_size(void){
+		return cv::Size(WIDTH, HEIGHT);
+	}
+
+	//time at which the last frame that differed from the one before it was produced
+	ptime getLastChange() const{
+		return lastChange;
+	}
+
+private:
+	vector<cv::Mat> noisyScenes;
+	int frameNr;
+	bool objectPlaced;
+	ptime next;
+	ptime lastChange;
+};
+
+double cpuSeconds(){
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+double msSince(const ptime& start){
+	return (microsec_clock::local_time() - start).total_microseconds() / 1000.0;
+}
+
+/**
+ * The loop of Locator::WaitForStableViewAndTakeImage before the DifferenceEngine.
+ * cv::waitKey(100) is replaced by a sleep, without a window waitKey does not wait.
+ */
+void legacyWait(SceneSource& source, cv::Mat& lastStable, double maxNorm){
+	cv::Mat frame;
+	source.get_frame(frame);
+	double norm = cv::norm(lastStable, frame, cv::NORM_INF);
+	while(norm < maxNorm){
+		source.get_frame(frame);
+		norm = cv::norm(lastStable, frame, cv::NORM_INF);
+	}
+	while(norm > maxNorm){
+		cv::Mat detectedImage = frame.clone();
+		boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+		source.get_frame(frame);
+		norm = cv::norm(detectedImage, frame, cv::NORM_INF);
+	}
+	lastStable = frame.clone();
+}
+
+/**
+ * The per pixel loop of Locator::showDifference before the DifferenceEngine
+ */
+void legacyDifference(const cv::Mat& background, const cv::Mat& image, cv::Mat& difference, int differents){
+	difference = image.clone();
+	cv::MatConstIterator_<cv::Vec3b> it = background.begin<cv::Vec3b>(), it_end = background.end<cv::Vec3b>();
+	cv::MatConstIterator_<cv::Vec3b> _it = image.begin<cv::Vec3b>();
+	cv::MatIterator_<cv::Vec3b> dst_it = difference.begin<cv::Vec3b>();
+	for(; it != it_end; ++it, ++_it, ++dst_it){
+		cv::Vec3b b = *it, s = *_it;
+		if(abs(b[0] - s[0]) < differents || abs(b[1] - s[1]) < differents || abs(b[2] - s[2]) < differents){
+			*dst_it = cv::Vec3b(0, 0, 0);
+		}else{
+			*dst_it = cv::Vec3b(255, 255, 255);
+		}
+	}
+}
+
+void report(const char* name, const vector<double>& latencies, double cpu, double wall){
+	vector<double> sorted = latencies;
+	sort(sorted.begin(), sorted.end());
+	double sum = 0;
+	for(size_t i = 0; i < sorted.size(); i++){
+		sum += sorted[i];
+	}
+	printf("%-16s latency mean %7.1f ms  median %7.1f ms  max %7.1f ms  cpu %5.1f %%\n", name,
+		sum / sorted.size(), sorted[sorted.size() / 2], sorted.back(), 100.0 * cpu / wall);
+}
+
+/**
+ * The Locator, called every time the view became stable
+ */
+struct LatencyRecorder{
+	SceneSource* source;
+	vector<double>* latencies;
+
+	bool operator()(const cv::Mat&){
+		latencies->push_back(msSince(source->getLastChange()));
+		return latencies->size() < CYCLES;
+	}
+};
+
+int main(int argc, char** argv){
+	printf("%dx%d frames at %d fps, %d changes\n", WIDTH, HEIGHT, FPS, CYCLES);
+
+	//the old loop
+	{
+		SceneSource source;
+		cv::Mat background, frame;
+		source.get_frame(background);
+		source.get_frame(frame);
+		double maxNorm = cv::norm(background, frame, cv::NORM_INF) + 30;
+
+		vector<double> latencies;
+		double cpu = cpuSeconds();
+		ptime start = microsec_clock::local_time();
+		for(int i = 0; i < CYCLES; i++){
+			legacyWait(source, background, maxNorm);
+			latencies.push_back(msSince(source.getLastChange()));
+		}
+		report("polling loop", latencies, cpuSeconds() - cpu, msSince(start) / 1000.0);
+	}
+
+	//the DifferenceEngine through Locator::watch
+	{
+		SceneSource source;
+		Locator locator(source);
+		cv::Mat background;
+		locator.setBackground(background);
+
+		vector<double> latencies;
+		LatencyRecorder recorder = { &source, &latencies };
+		double cpu = cpuSeconds();
+		ptime start = microsec_clock::local_time();
+		locator.watch(recorder);
+		report("DifferenceEngine", latencies, cpuSeconds() - cpu, msSince(start) / 1000.0);
+	}
+
+	//the difference kernel of showDifference
+	{
+		cv::Mat background(HEIGHT, WIDTH, CV_8UC3), image(HEIGHT, WIDTH, CV_8UC3), legacy, mask;
+		cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(256));
+		cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+		ptime start = microsec_clock::local_time();
+		for(int i = 0; i < KERNEL_RUNS; i++){
+			legacyDifference(background, image, legacy, 30);
+		}
+		double legacyMs = msSince(start) / KERNEL_RUNS;
+
+		start = microsec_clock::local_time();
+		for(int i = 0; i < KERNEL_RUNS; i++){
+			DifferenceEngine::difference(background, image, mask, 30);
+		}
+		double engineMs = msSince(start) / KERNEL_RUNS;
+
+		cv::Mat legacyMask;
+		cv::cvtColor(legacy, legacyMask, CV_BGR2GRAY);
+		int mismatches = cv::countNonZero(legacyMask != mask);
+		printf("%-16s iterator %6.2f ms  engine %6.2f ms  %d pixels differ\n", "difference", legacyMs, engineMs, mismatches);
+		if(mismatches != 0){
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        DifferentsesSeparation
+// File:           DifferenceEngine.h
+// Description:    Vectorized image difference and stable view detection
+// Author:         agent
+// Notes:          SSSE3 versions are used when compiled with -mssse3
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#ifndef DIFFERENCEENGINE_H
+#define DIFFERENCEENGINE_H
+
+#include <opencv2/core/core.hpp>
+
+/**
+* @brief "Computes the difference between two images and detects when the view becomes stable"
+*
+* The difference of two images is computed in a single pass that fuses the
+* absolute difference, the per channel threshold and the combination of the
+* channels (16 pixels per step with SSSE3).
+* Stability is evaluated on a downscaled copy of the frames: every frame is
+* compared with a running average of the previous frames, and the view is
+* stable when it stayed within the noise for a number of frames.
+* @author agent
+* @version 1.0
+*/
+class DifferenceEngine{
+public:
+	/**
+	 * @brief constructor
+	 * @param scale the frames are downscaled by this factor for the stability check
+	 * @param learnRate weight of a new frame in the running average, between 0 and 1
+	 * @param stableFrames the amount of frames the view has to stay within the noise
+	 */
+	DifferenceEngine(int scale = 4, double learnRate = 0.5, int stableFrames = 2);
+
+	/**
+	 * @brief computes the pixels that differ between two images.
+	 * A pixel differs when all its channels differ at least threshold steps, like in Locator::showDifference.
+	 * @param background the background image, CV_8UC3 or CV_8UC1
+	 * @param image the image compared with the background, same size and type as background
+	 * @param mask CV_8UC1 image which contains 255 for pixels that differ and 0 for the others after calling the function
+	 * @param threshold the amount of steps a channel has to differ
+	 */
+	static void difference(const cv::Mat& background, const cv::Mat& image, cv::Mat& mask, int threshold);
+
+	/**
+	 * @brief sets the stable view and measures the noise of the camera.
+	 * @param first a frame of the stable view
+	 * @param second the next frame of the same view
+	 * @param margin added to the measured noise, differences up to this sum are considered noise
+	 */
+	void setBackground(const cv::Mat& first, const cv::Mat& second, int margin);
+
+	/**
+	 * @brief feeds the next frame.
+	 * After the view changed from the last stable view, this returns true for the first frame at which it is stable again.
+	 * That frame becomes the new stable view.
+	 * @param frame the next frame, same size and type as the background
+	 * @return true if the view became stable at this frame
+	 */
+	bool update(const cv::Mat& frame);
+
+	/**
+	 * @return true if the view changed and has not become stable yet
+	 */
+	bool isChanging() const{
+		return changing;
+	}
+
+	/**
+	 * @return the largest difference with the running average in the last frame
+	 */
+	double getMotion() const{
+		return motion;
+	}
+
+	/**
+	 * @return the largest difference which is considered noise
+	 */
+	double getNoise() const{
+		return noise;
+	}
+
+private:
+	void downscale(const cv::Mat& frame, cv::Mat& small) const;
+
+	int scale;
+	double learnRate;
+	int stableFrames;
+
+	double noise;
+	double motion;
+	bool changing;
+	int quietFrames;
+
+	cv::Mat small;
+	cv::Mat stableView;
+	cv::Mat model;
+};
+
+#endif
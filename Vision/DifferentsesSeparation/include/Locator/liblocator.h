@@ -43,17 +43,32 @@
 */
 
 #include <opencv2/highgui/highgui.hpp>
+#include <boost/function.hpp>
+#include <FrameSource/FrameSource.h>
 #include <Locator/cameraException.h>
+#include <Locator/DifferenceEngine.h>
 
 //Locator class
 class Locator{
 public:
+	/**
+	 * @brief called by watch() with the new stable image every time the view became stable again.
+	 * return false to stop watching.
+	 */
+	typedef boost::function<bool (const cv::Mat& stableImage)> StableViewCallback;
+
 	/**
 	 * @brief constructor
 	 * @param device device number of the camera
 	 */
 	Locator(int device);
 
+	/**
+	 * @brief constructor
+	 * @param source the frames are taken from this source, it must outlive the Locator
+	 */
+	Locator(framesource::FrameSource& source);
+
 	/**
 	 * @brief deconstructor
 	 */
@@ -70,10 +85,18 @@ public:
 	 * @param stableImage Mat object which contains the new stable background after calling the function.
 	 */
 	void WaitForStableViewAndTakeImage(cv::Mat &stableImage);
+
+	/**
+	 * @brief takes frames and calls the callback every time the view changed and became stable again.
+	 * The frames are read as they arrive from the source, so the stable view is detected at the first frame it is stable.
+	 * showDifference and findAndDrawBlobs can be called from the callback.
+	 * @param callback called with the new stable image, watching stops when it returns false.
+	 */
+	void watch(const StableViewCallback &callback);
 	
     /**
 	 * @brief this function shows the differents between the stable image and the stable background.
-	 * @param difference Mat object which contains the back and white image after calling the function. back means not changed and white means changed.
+	 * @param difference Mat object which contains the back and white (CV_8UC1) image after calling the function. back means not changed and white means changed.
 	 */
 	void showDifference( cv::Mat &difference);
     
@@ -99,18 +122,25 @@ public:
 	///@brief the number for the iterations for dilate and erode.
 	char filterIterations;
 
+	///@brief detects the stable views, its settings can be changed before setBackground is called.
+	DifferenceEngine engine;
+
 private:
 	void setStdVars(){
 		 minContourSize = 40;
 		 normRange = 30;
 		 differents = 30;
 		 filterIterations = 3;
-		 maxNorm = 0;		
 	}
+
+	void readFrame(cv::Mat &frame);
+	void takeStableImage();
+
+	Locator(const Locator&);
+	Locator& operator=(const Locator&);
 	
-	cv::VideoCapture cam;
-	double maxNorm;
-	double norm;
+	framesource::FrameSource* source;
+	bool ownsSource;
 	cv::Mat lastCapturedFrame;
 	cv::Mat lastStableBackground;
 	cv::Mat matchingBackground;
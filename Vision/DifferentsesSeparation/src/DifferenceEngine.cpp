@@ -0,0 +1,217 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        DifferentsesSeparation
+// File:           DifferenceEngine.cpp
+// Description:    Vectorized image difference and stable view detection
+// Author:         agent
+// Notes:          SSSE3 versions are used when compiled with -mssse3
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <Locator/DifferenceEngine.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdexcept>
+#include <stdint.h>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace{
+
+inline uint8_t absDiff(uint8_t a, uint8_t b){
+	return a > b ? a - b : b - a;
+}
+
+void differenceRowC3(const uint8_t* bg, const uint8_t* img, uint8_t* mask, int pixels, int threshold, int i){
+	for(; i < pixels; i++){
+		uint8_t b = absDiff(bg[3 * i], img[3 * i]);
+		uint8_t g = absDiff(bg[3 * i + 1], img[3 * i + 1]);
+		uint8_t r = absDiff(bg[3 * i + 2], img[3 * i + 2]);
+		mask[i] = (b < threshold || g < threshold || r < threshold) ? 0 : 255;
+	}
+}
+
+void differenceRowC1(const uint8_t* bg, const uint8_t* img, uint8_t* mask, int pixels, int threshold, int i){
+	for(; i < pixels; i++){
+		mask[i] = absDiff(bg[i], img[i]) < threshold ? 0 : 255;
+	}
+}
+
+#ifdef __SSSE3__
+// splits 16 packed pixels in their channels
+inline void deinterleave(const uint8_t* src, __m128i& c0, __m128i& c1, __m128i& c2){
+	const __m128i a0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i a1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+	const __m128i a2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+	const __m128i b0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+	const __m128i b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+	const __m128i d0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i d1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+	const __m128i d2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+	__m128i v0 = _mm_loadu_si128((const __m128i*)src);
+	__m128i v1 = _mm_loadu_si128((const __m128i*)(src + 16));
+	__m128i v2 = _mm_loadu_si128((const __m128i*)(src + 32));
+
+	c0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, a0), _mm_shuffle_epi8(v1, a1)), _mm_shuffle_epi8(v2, a2));
+	c1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, b0), _mm_shuffle_epi8(v1, b1)), _mm_shuffle_epi8(v2, b2));
+	c2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, d0), _mm_shuffle_epi8(v1, d1)), _mm_shuffle_epi8(v2, d2));
+}
+
+inline __m128i absDiff16(__m128i a, __m128i b){
+	return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+// 0xff where value >= threshold, 0 elsewhere
+inline __m128i atLeast16(__m128i value, __m128i threshold){
+	return _mm_cmpeq_epi8(_mm_max_epu8(value, threshold), value);
+}
+
+int differenceRowC3SSSE3(const uint8_t* bg, const uint8_t* img, uint8_t* mask, int pixels, int threshold){
+	const __m128i t = _mm_set1_epi8((char)threshold);
+	int i = 0;
+	for(; i + 16 <= pixels; i += 16){
+		__m128i b0, g0, r0, b1, g1, r1;
+		deinterleave(bg + 3 * i, b0, g0, r0);
+		deinterleave(img + 3 * i, b1, g1, r1);
+		// every channel has to differ, so the smallest difference decides
+		__m128i d = _mm_min_epu8(_mm_min_epu8(absDiff16(b0, b1), absDiff16(g0, g1)), absDiff16(r0, r1));
+		_mm_storeu_si128((__m128i*)(mask + i), atLeast16(d, t));
+	}
+	return i;
+}
+
+int differenceRowC1SSSE3(const uint8_t* bg, const uint8_t* img, uint8_t* mask, int pixels, int threshold){
+	const __m128i t = _mm_set1_epi8((char)threshold);
+	int i = 0;
+	for(; i + 16 <= pixels; i += 16){
+		__m128i a = _mm_loadu_si128((const __m128i*)(bg + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(img + i));
+		_mm_storeu_si128((__m128i*)(mask + i), atLeast16(absDiff16(a, b), t));
+	}
+	return i;
+}
+#endif
+
+}
+
+DifferenceEngine::DifferenceEngine(int scale, double learnRate, int stableFrames) :
+	scale(scale < 1 ? 1 : scale), learnRate(learnRate), stableFrames(stableFrames < 1 ? 1 : stableFrames),
+	noise(0), motion(0), changing(false), quietFrames(0){
+}
+
+void DifferenceEngine::difference(const cv::Mat& background, const cv::Mat& image, cv::Mat& mask, int threshold){
+	if(background.size() != image.size() || background.type() != image.type()){
+		throw std::invalid_argument("images differ in size or type");
+	}
+	if(image.type() != CV_8UC3 && image.type() != CV_8UC1){
+		throw std::invalid_argument("only CV_8UC3 and CV_8UC1 images are supported");
+	}
+	mask.create(image.size(), CV_8UC1);
+
+	// a channel never differs more than 255 steps, and always at least 0
+	if(threshold <= 0){
+		mask = cv::Scalar(255);
+		return;
+	}
+	if(threshold > 255){
+		mask = cv::Scalar(0);
+		return;
+	}
+
+	int rows = image.rows;
+	int cols = image.cols;
+	if(background.isContinuous() && image.isContinuous() && mask.isContinuous()){
+		cols *= rows;
+		rows = 1;
+	}
+	for(int y = 0; y < rows; y++){
+		const uint8_t* bg = background.ptr<uint8_t>(y);
+		const uint8_t* img = image.ptr<uint8_t>(y);
+		uint8_t* m = mask.ptr<uint8_t>(y);
+		int done = 0;
+		if(image.channels() == 3){
+#ifdef __SSSE3__
+			done = differenceRowC3SSSE3(bg, img, m, cols, threshold);
+#endif
+			differenceRowC3(bg, img, m, cols, threshold, done);
+		}else{
+#ifdef __SSSE3__
+			done = differenceRowC1SSSE3(bg, img, m, cols, threshold);
+#endif
+			differenceRowC1(bg, img, m, cols, threshold, done);
+		}
+	}
+}
+
+void DifferenceEngine::downscale(const cv::Mat& frame, cv::Mat& small) const{
+	if(scale == 1){
+		frame.copyTo(small);
+	}else{
+		cv::resize(frame, small, cv::Size(frame.cols / scale, frame.rows / scale), 0, 0, cv::INTER_AREA);
+	}
+}
+
+void DifferenceEngine::setBackground(const cv::Mat& first, const cv::Mat& second, int margin){
+	downscale(first, stableView);
+	downscale(second, small);
+	noise = cv::norm(stableView, small, cv::NORM_INF) + margin;
+	motion = 0;
+	changing = false;
+	quietFrames = 0;
+}
+
+bool DifferenceEngine::update(const cv::Mat& frame){
+	if(stableView.empty()){
+		throw std::logic_error("setBackground has not been called");
+	}
+	downscale(frame, small);
+
+	if(!changing){
+		motion = cv::norm(stableView, small, cv::NORM_INF);
+		if(motion >= noise){
+			changing = true;
+			quietFrames = 0;
+			small.copyTo(model);
+		}
+		return false;
+	}
+
+	motion = cv::norm(model, small, cv::NORM_INF);
+	cv::addWeighted(small, learnRate, model, 1.0 - learnRate, 0, model);
+	if(motion > noise){
+		quietFrames = 0;
+		return false;
+	}
+	if(++quietFrames < stableFrames){
+		return false;
+	}
+	changing = false;
+	small.copyTo(stableView);
+	return true;
+}
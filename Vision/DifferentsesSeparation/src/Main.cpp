@@ -35,13 +35,32 @@
 #include <iostream>
 #include <sstream>
 #include <cstdio>
+#include <cstdlib>
 #include <Locator/liblocator.h>
 #include <Locator/cameraException.h>
+#include <FrameSource/ReplaySource.h>
+#include <memory>
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
 
 using namespace std;
 
+/*
+ * Called by the locator every time the view became stable again,
+ * shows the differences and the blobs of the new view.
+ */
+static bool showStableView(Locator& loca){
+	cv::Mat difference, blobs;
+	loca.showDifference(difference);
+	loca.findAndDrawBlobs(blobs);
+	imshow("blobs",blobs);
+	imshow("differences",difference);
+	return cv::waitKey(10) != 'q';
+}
+
 /*! 
- * The main function opens an connection with a webcam on video1
+ * The main function opens an connection with a webcam on video1,
+ * or replays a recording when a directory or video file is given
  * by pressing the 'b' key you take an background image
  * when an new object is introduced in the webcams line of sight the
  * detected object is calculated when the image is stable.
@@ -50,12 +69,17 @@ using namespace std;
 int main(int argc, char** argv){
 	try{				
 		int deviceNr = 0;
+		std::auto_ptr<framesource::ReplaySource> replay;
 		if(argc > 1){
 			stringstream s;
 			s << argv[1];
-			s >> deviceNr;
+			if(!(s >> deviceNr)){
+				double rate = argc > 2 ? atof(argv[2]) : framesource::ReplaySource::RECORDED_RATE;
+				replay.reset(new framesource::ReplaySource(argv[1], rate, true));
+			}
 		}
-		Locator loca(deviceNr);
+		std::auto_ptr<Locator> locator(replay.get() ? new Locator(*replay) : new Locator(deviceNr));
+		Locator& loca = *locator;
 		int key = 0;
 		cv::Mat Background;
 
@@ -65,7 +89,7 @@ int main(int argc, char** argv){
 			loca.setBackground(Background);
 			cv::imshow("background",Background);
 		}
-		cv::Mat view, difference, blobs;
+		cv::Mat difference, blobs;
 
 		blobs = Background.clone();
 		difference = Background.clone();
@@ -75,13 +99,8 @@ int main(int argc, char** argv){
 		cvMoveWindow("differences", 100, 200);
 
 		std::cout << "Press q to quit" << std::endl;
-		while(key != 'q'){
-			loca.WaitForStableViewAndTakeImage(view);
-			loca.showDifference(difference);
-			loca.findAndDrawBlobs(blobs );
-			imshow("blobs",blobs);								
-			imshow("differences",difference);	
-			key = cv::waitKey(100);
+		if(key != 'q'){
+			loca.watch(boost::bind(&showStableView, boost::ref(loca)));
 		}
 	    
 	} catch(exception &e){
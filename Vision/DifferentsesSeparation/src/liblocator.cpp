@@ -32,6 +32,7 @@
 //******************************************************************************
 #include <Locator/liblocator.h>
 #include <Locator/cameraException.h>
+#include <FrameSource/VideoCaptureSource.h>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -41,14 +42,23 @@
 #include <iostream>
 
 Locator::Locator(int device){
-	cam = cv::VideoCapture(device);
 	setStdVars();
-	if(!cam.isOpened()){
+	try{
+		source = new framesource::VideoCaptureSource(device);
+		ownsSource = true;
+	} catch(framesource::FrameSourceException &e){
 		throw cameraException("can not open the camera");
 	}
 }
+Locator::Locator(framesource::FrameSource& source){
+	setStdVars();
+	this->source = &source;
+	ownsSource = false;
+}
 Locator::~Locator(){
-	cam.release();
+	if(ownsSource){
+		delete source;
+	}
 
 	lastCapturedFrame.release();
 	detectedDifference.release();
@@ -58,30 +68,50 @@ Locator::~Locator(){
 }
 
 void Locator::setBackground(cv::Mat &stableBackground){
-	cam.read(lastCapturedFrame);
-	stableBackground = lastCapturedFrame.clone();
-	lastStableBackground = lastCapturedFrame.clone();
-	matchingBackground =lastCapturedFrame.clone();
-	cam.read(lastCapturedFrame);
-	maxNorm = cv::norm(stableBackground, lastCapturedFrame, cv::NORM_INF) + normRange;
+	readFrame(lastCapturedFrame);
+	matchingBackground = lastCapturedFrame.clone();
+	lastStableBackground = matchingBackground;
+	stableBackground = matchingBackground.clone();
+	readFrame(lastCapturedFrame);
+	engine.setBackground(stableBackground, lastCapturedFrame, normRange);
 }
 
+/*
+ * Every frame is fed to the engine as soon as it arrives. The engine
+ * compares a downscaled copy with the last stable view and, once the view
+ * changed, with a running average of the frames, so there is no need to
+ * wait between frames or to compare full frames.
+ */
 void Locator::WaitForStableViewAndTakeImage(cv::Mat &stableImage){
-	cam.read(lastCapturedFrame);
-	norm = cv::norm(lastStableBackground, lastCapturedFrame, cv::NORM_INF);
-	while(norm < maxNorm){
-		cam.read(lastCapturedFrame);
-		norm = cv::norm(lastStableBackground, lastCapturedFrame, cv::NORM_INF);
-		
+	do{
+		readFrame(lastCapturedFrame);
+	}while(!engine.update(lastCapturedFrame));
+	takeStableImage();
+	lastStableBackground.copyTo(stableImage);
+}
+
+void Locator::watch(const StableViewCallback &callback){
+	for(;;){
+		readFrame(lastCapturedFrame);
+		if(engine.update(lastCapturedFrame)){
+			takeStableImage();
+			if(!callback(lastStableBackground)){
+				return;
+			}
+		}
 	}
-	while(norm > maxNorm){
-		cv::Mat detectedImage = lastCapturedFrame.clone();
-		cv::waitKey(100); //100 is an amount of milliseconds
-		cam.read(lastCapturedFrame);	
-		norm = cv::norm(detectedImage, lastCapturedFrame, cv::NORM_INF);	
+}
+
+void Locator::takeStableImage(){
+	// hand the buffer over, the next frame is read in a new one
+	lastStableBackground = lastCapturedFrame;
+	lastCapturedFrame = cv::Mat();
+}
+
+void Locator::readFrame(cv::Mat &frame){
+	if(!source->get_frame(frame)){
+		throw cameraException("no more frames");
 	}
-	lastStableBackground = lastCapturedFrame.clone();
-	stableImage = lastCapturedFrame.clone();
 }
 
 /*
@@ -89,32 +119,11 @@ void Locator::WaitForStableViewAndTakeImage(cv::Mat &stableImage){
  * on the difference pointer. the calculations are done by looking at the RGB values of the images
  */
 void Locator::showDifference(cv::Mat &difference){
-	difference = lastStableBackground.clone();
-	cv::MatConstIterator_<cv::Vec3b> it = matchingBackground.begin<cv::Vec3b>(), it_end = matchingBackground.end<cv::Vec3b>();
-	cv::MatIterator_<cv::Vec3b> _it = lastStableBackground.begin<cv::Vec3b>();
-	cv::MatIterator_<cv::Vec3b> dst_it = difference.begin<cv::Vec3b>();
-	cv::Vec3b pixBackground = *it;
-	cv::Vec3b pixShot = *_it;
-	int R =0,G = 0,B=0;
-	//for every pixel in the image
-	for (; it != it_end; ++it, ++_it ,++dst_it){
-		pixBackground = *it;
-		pixShot = *_it;
-		B = abs(pixBackground[0]-pixShot[0]);
-		G = abs(pixBackground[1]-pixShot[1]);
-		R = abs(pixBackground[2]-pixShot[2]);
-		if(R < differents||G < differents ||B < differents ){
-			//the pixel is not different against the background.
-			*dst_it = cv::Vec3b(0, 0, 0);
-		}else{
-			//the pixel is different from the background
-			*dst_it = cv::Vec3b(255, 255, 255);
-		}
-	}
-	cv::dilate(difference, difference, cv::Mat(), cv::Point(-1, -1), filterIterations);
-	cv::erode(difference, difference, cv::Mat(), cv::Point(-1, -1), filterIterations);
-	detectedDifference = difference.clone();
-	
+	//a pixel is different when all of its R,G,B values differ from the background
+	DifferenceEngine::difference(matchingBackground, lastStableBackground, detectedDifference, differents);
+	cv::dilate(detectedDifference, detectedDifference, cv::Mat(), cv::Point(-1, -1), filterIterations);
+	cv::erode(detectedDifference, detectedDifference, cv::Mat(), cv::Point(-1, -1), filterIterations);
+	detectedDifference.copyTo(difference);
 }
 
 /*
@@ -127,8 +136,8 @@ void Locator::findAndDrawBlobs(cv::Mat &blobs ){
 	blobs = lastStableBackground.clone();
 	cv::vector<cv::vector<cv::Point> > contours;
 	cv::vector<cv::Vec4i> hierarchy;
-	cv::Mat gray;
-	cv::cvtColor(detectedDifference, gray, CV_BGR2GRAY);
+	//findContours modifies its input
+	cv::Mat gray = detectedDifference.clone();
 
 	
 	/// Find contours
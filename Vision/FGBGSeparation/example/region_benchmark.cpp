@@ -0,0 +1,142 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           region_benchmark.cpp
+// Description:    compares the accuracy and speed of classifying pixels and classifying superpixels against the ground truth
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/region_benchmark.cpp src/*.cpp `pkg-config --cflags --libs opencv` -lboost_thread -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <FGBGSeparation/FGBGSeparation.h>
+#include <FGBGSeparation/Superpixels.h>
+#include <dirent.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/**
+ * @brief the part of the pixels that is classified the same as the ground truth
+ */
+double accuracy(const Mat &result, const Mat &truth){
+	long correct = 0;
+	for(int y = 0; y < result.rows; y++){
+		for(int x = 0; x < result.cols; x++){
+			Vec3b r = result.at<Vec3b>(y, x);
+			Vec3b t = truth.at<Vec3b>(y, x);
+			bool foreground = t[0] > 127 && t[1] > 127 && t[2] > 127;
+			if((r[0] > 127) == foreground){
+				correct++;
+			}
+		}
+	}
+	return 100.0 * correct / (result.rows * result.cols);
+}
+
+/**
+ * @brief trains on all images except one and tests on that one
+ * @param regionSize the size of the superpixels, 0 to classify pixels
+ */
+double leaveOneOut(const vector<Mat> &images, const vector<Mat> &truths, size_t test, int bins, int maskSize,
+		int regionSize, double& separateSeconds){
+	FGBGSeparator separator(bins, maskSize, RGB);
+	if(regionSize > 0){
+		separator.useRegions(regionSize);
+	}else{
+		separator.useSampling(20000);
+	}
+
+	for(size_t i = 0; i < images.size(); i++){
+		if(i != test){
+			Mat image = images[i].clone();
+			Mat truth = truths[i].clone();
+			separator.addImageToTrainingsSet(image, truth);
+		}
+	}
+	separator.train();
+
+	Mat result = images[test].clone();
+	int64 start = getTickCount();
+	separator.separateFB(images[test], result);
+	separateSeconds = (getTickCount() - start) / getTickFrequency();
+	return accuracy(result, truths[test]);
+}
+
+int main(int argc, char* argv[]){
+	string dir = argc > 1 ? argv[1] : "Data";
+	int bins = argc > 2 ? atoi(argv[2]) : 16;
+	int maskSize = argc > 3 ? atoi(argv[3]) : 5;
+	int regionSize = argc > 4 ? atoi(argv[4]) : 20;
+
+	// Every image in Original has a ground truth with the same name in FB_image
+	vector<Mat> images, truths;
+	vector<string> names;
+	DIR* original = opendir((dir + "/Original").c_str());
+	if(original == NULL){
+		printf("Could not open %s/Original\n", dir.c_str());
+		return 1;
+	}
+	for(dirent* entry = readdir(original); entry != NULL; entry = readdir(original)){
+		string name = entry->d_name;
+		if(name[0] == '.'){
+			continue;
+		}
+		Mat image = imread(dir + "/Original/" + name);
+		Mat truth = imread(dir + "/FB_image/" + name);
+		if(image.data && truth.data && image.size() == truth.size()){
+			images.push_back(image);
+			truths.push_back(truth);
+			names.push_back(name);
+		}
+	}
+	closedir(original);
+
+	// A prediction per pixel against a prediction per region
+	printf("%-20s %10s %10s %10s %10s %10s %10s\n", "test image", "pixels", "predicts", "ms", "regions", "predicts", "ms");
+	SuperpixelSegmenter segmenter(regionSize);
+	double pixelTotal = 0, regionTotal = 0;
+	for(size_t i = 0; i < images.size(); i++){
+		Mat regions;
+		int regionCount = segmenter.segment(images[i], regions);
+		double pixelSeconds, regionSeconds;
+		double pixel = leaveOneOut(images, truths, i, bins, maskSize, 0, pixelSeconds);
+		double region = leaveOneOut(images, truths, i, bins, maskSize, regionSize, regionSeconds);
+		printf("%-20s %9.2f%% %10d %10.1f %9.2f%% %10d %10.1f\n", names[i].c_str(), pixel,
+				images[i].rows * images[i].cols, 1000 * pixelSeconds, region, regionCount, 1000 * regionSeconds);
+		pixelTotal += pixel;
+		regionTotal += region;
+	}
+	if(!images.empty()){
+		printf("%-20s %9.2f%% %21s %9.2f%%\n", "mean", pixelTotal / images.size(), "", regionTotal / images.size());
+	}
+
+	return 0;
+}
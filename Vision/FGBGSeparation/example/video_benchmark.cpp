@@ -0,0 +1,130 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           video_benchmark.cpp
+// Description:    compares separateFB on every frame with the change gated video mode on a synthetic moving scene
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/video_benchmark.cpp src/*.cpp `pkg-config --cflags --libs opencv` -lboost_thread -lboost_system
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <FGBGSeparation/FGBGSeparation.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace cv;
+using namespace std;
+
+/**
+ * @brief builds a frame of the background with the sprite pasted at the given position and some sensor noise
+ */
+void makeFrame(const Mat &background, const Mat &sprite, Point position, int noise, RNG &rng, Mat &frame){
+	background.copyTo(frame);
+	Rect area(position.x, position.y, sprite.cols, sprite.rows);
+	area &= Rect(0, 0, frame.cols, frame.rows);
+	Mat target = frame(area);
+	Mat source = sprite(Rect(0, 0, area.width, area.height));
+	source.copyTo(target);
+	if(noise > 0){
+		Mat noiseImage(frame.size(), CV_16SC3);
+		rng.fill(noiseImage, RNG::UNIFORM, Scalar::all(-noise), Scalar::all(noise + 1));
+		Mat noisy;
+		frame.convertTo(noisy, CV_16SC3);
+		noisy += noiseImage;
+		noisy.convertTo(frame, CV_8UC3);
+	}
+}
+
+/**
+ * @brief the part of the pixels where both results agree
+ */
+double agreement(const Mat &a, const Mat &b){
+	long same = 0;
+	for(int y = 0; y < a.rows; y++){
+		for(int x = 0; x < a.cols; x++){
+			if((a.at<Vec3b>(y, x)[0] > 127) == (b.at<Vec3b>(y, x)[0] > 127)){
+				same++;
+			}
+		}
+	}
+	return 100.0 * same / (a.rows * a.cols);
+}
+
+int main(int argc, char* argv[]){
+	string dir = argc > 1 ? argv[1] : "Data";
+	double threshold = argc > 2 ? atof(argv[2]) : 8.0;
+	int noise = argc > 3 ? atoi(argv[3]) : 2;
+	int frames = argc > 4 ? atoi(argv[4]) : 100;
+
+	Mat background = imread(dir + "/Original/black-smurf.jpg");
+	Mat truth = imread(dir + "/FB_image/black-smurf.jpg");
+	Mat spriteImage = imread(dir + "/Original/smurfin.jpg");
+	if(!background.data || !truth.data || !spriteImage.data){
+		printf("Could not read the images in %s\n", dir.c_str());
+		return 1;
+	}
+
+	FGBGSeparator full(16, 5, RGB);
+	Mat image = background.clone();
+	full.addImageToTrainingsSet(image, truth);
+	full.train();
+	full.saveTraining("video_benchmark_tree.xml", "tree");
+	FGBGSeparator gated(16, 5, RGB);
+	gated.loadTraining("video_benchmark_tree.xml", "tree");
+	gated.setVideoMode(16, threshold, 50);
+
+	// A sprite of a fifth of the frame moving from left to right
+	Mat sprite = spriteImage(Rect(0, 0, min(spriteImage.cols, background.cols / 5),
+			min(spriteImage.rows, background.rows / 5)));
+	RNG rng(12345);
+	Mat frame, fullResult, gatedResult;
+	double fullSeconds = 0, gatedSeconds = 0, agreementTotal = 0, reclassifiedTotal = 0;
+	for(int i = 0; i < frames; i++){
+		Point position((background.cols - sprite.cols) * i / max(frames - 1, 1), background.rows / 3);
+		makeFrame(background, sprite, position, noise, rng, frame);
+
+		int64 start = getTickCount();
+		fullResult = frame.clone();
+		full.separateFB(frame, fullResult);
+		fullSeconds += (getTickCount() - start) / getTickFrequency();
+
+		start = getTickCount();
+		gated.separateVideoFrame(frame, gatedResult);
+		gatedSeconds += (getTickCount() - start) / getTickFrequency();
+
+		agreementTotal += agreement(fullResult, gatedResult);
+		reclassifiedTotal += gated.getReclassifiedFraction();
+	}
+
+	printf("%d frames of %dx%d, threshold %.1f, noise %d\n", frames, background.cols, background.rows, threshold, noise);
+	printf("separateFB          %8.2f ms/frame\n", 1000 * fullSeconds / frames);
+	printf("separateVideoFrame  %8.2f ms/frame\n", 1000 * gatedSeconds / frames);
+	printf("reclassified        %8.2f %%\n", 100 * reclassifiedTotal / frames);
+	printf("agreement           %8.2f %%\n", agreementTotal / frames);
+	return 0;
+}
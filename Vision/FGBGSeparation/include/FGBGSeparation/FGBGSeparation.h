@@ -37,6 +37,8 @@
 #include <opencv2/ml/ml.hpp>
 #include <sstream>
 #include <FGBGSeparation/TrainingData.h>
+#include <FGBGSeparation/TrainingSetBuilder.h>
+#include <FGBGSeparation/Superpixels.h>
 #include <string>
 class FGBGSeparator{
 public:
@@ -48,6 +50,32 @@ public:
 	 */
 	FGBGSeparator(int bins, int maskSize, int RGBorHSV);
     
+	/**
+	 * @brief samples the training images instead of using a row for every pixel
+	 * @param rowsPerImage the amount of pixels used of every image
+	 * @param foregroundShare the part of the rows of an image that is used for foreground pixels,
+	 * 		a negative value keeps the share the foreground has in the image
+	 * @param bufferRows the amount of rows kept in memory
+	 * @param spillPath file the rows are written to when the buffer is full, empty to keep everything in memory
+	 * @note call this before the first image is added, images added before are discarded
+	 * @see TrainingSetBuilder
+	 */
+	void useSampling(int rowsPerImage, double foregroundShare = -1, int bufferRows = 200000,
+			const std::string& spillPath = "");
+
+	/**
+	 * @brief classifies superpixels instead of pixels
+	 * Every image is oversegmented with SLIC and a row with the histogram of every region is
+	 * added to the training set, labeled with the label of most of its pixels. separateFB then
+	 * does one prediction per region instead of one per pixel. The regions have their own
+	 * training set and tree, saveTraining and loadTraining store them in a separate format.
+	 * @param regionSize the width and height of the regions
+	 * @param compactness the weight of the position against the colour, higher gives more regular regions
+	 * @note call this before the first image is added, useSampling is not used for regions
+	 * @see SuperpixelSegmenter
+	 */
+	void useRegions(int regionSize = 20, double compactness = 10.0);
+
 	/**
 	 * @brief function for adding a image to the trainingsSet
 	 * @param image the total image
@@ -80,8 +108,37 @@ public:
 	 */
 	void separateFB(const cv::Mat &image, cv::Mat &result);
 
+	/**
+	 * @brief sets the parameters of separateVideoFrame and starts a new video
+	 * @param blockSize the size of the blocks that are checked for changes
+	 * @param changeThreshold the mean absolute difference per channel above which a block has changed
+	 * @param refreshInterval every this many frames the whole frame is classified, 0 to never do so
+	 */
+	void setVideoMode(int blockSize, double changeThreshold, int refreshInterval);
+
+	/**
+	 * @brief decides for each pixel of a video frame if its fore or background
+	 * Only the blocks that changed since they were last classified, plus a halo of maskSize/2,
+	 * are classified again. All other pixels keep their result of the previous frame.
+	 * @param frame the frame on which is checked if its fore or background
+	 * @param result an matrix in which the result is placed white means forground back means background
+	 * @note classifies pixels, can not be used after useRegions
+	 */
+	void separateVideoFrame(const cv::Mat &frame, cv::Mat &result);
+
+	/**
+	 * @brief forgets the previous frames, the next frame is classified completely
+	 */
+	void resetVideo();
+
+	/**
+	 * @return the part of the pixels that was classified by the last separateVideoFrame
+	 */
+	double getReclassifiedFraction() const;
+
 	/**
 	 * @brief save the tree
+	 * With useRegions the file also holds the region parameters and can only be loaded in region mode.
 	 * @param pathName the path were it need to be saved to
 	 * @param treeName the name at which the tree is saved in the .xml
 	 */
@@ -89,6 +146,7 @@ public:
 
 	/**
 	 * @brief loads the tree
+	 * With useRegions only a file saved in region mode with the same bins is accepted.
 	 * @param pathName the path were its saved to
 	 * @param treeName the name at which the tree is loaded from the .xml
 	 */
@@ -111,6 +169,50 @@ private:
 	cv::Mat trainData;
 	///@brief matrix whit the labels of the training data
 	cv::Mat labels;
+	///@brief builds a sampled training set instead of trainData and labels, if set
+	cv::Ptr<TrainingSetBuilder> builder;
+
+	///@brief region mode: oversegments the images, if set
+	cv::Ptr<SuperpixelSegmenter> segmenter;
+	///@brief region mode: the decision tree for region histograms
+	CvDTree regionTree;
+	///@brief region mode: matrix whit a histogram per region
+	cv::Mat regionTrainData;
+	///@brief region mode: matrix whit the label of every region
+	cv::Mat regionLabels;
+
+	///@brief video mode: the size of the blocks that are checked for changes
+	int videoBlockSize;
+	///@brief video mode: the mean absolute difference above which a block has changed
+	double videoThreshold;
+	///@brief video mode: the amount of frames between two complete classifications
+	int videoRefreshInterval;
+	///@brief video mode: the amount of frames since the last complete classification
+	int videoFrames;
+	///@brief video mode: each block as it was when it was last classified
+	cv::Mat videoReference;
+	///@brief video mode: the label of every pixel, 255 for foreground
+	cv::Mat videoLabels;
+	///@brief video mode: the part of the pixels classified by the last frame
+	double videoReclassified;
+
+	/**
+	 * @brief classifies the pixels of an image
+	 * @param image the RGB/HSV image
+	 * @param dirty the pixels to classify are not 0, empty to classify all pixels
+	 * @param labels receives 255 for foreground and 0 for background at the classified pixels
+	 * @return the amount of classified pixels
+	 */
+	long classifyPixels(const cv::Mat &image, const cv::Mat &dirty, cv::Mat &labels);
+
+	/**
+	 * @brief oversegments an image and makes a histogram of every region
+	 * @param image the RGB image
+	 * @param regions receives the region of every pixel
+	 * @param histograms receives the histogram of every region
+	 * @return the amount of regions
+	 */
+	int createRegionHistograms(const cv::Mat &image, cv::Mat &regions, cv::Mat &histograms);
 
 };
 
@@ -0,0 +1,127 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           Superpixels.h
+// Description:    oversegments an image into compact regions of similar colour (SLIC), in parallel
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#ifndef SUPERPIXELS_H_
+#define SUPERPIXELS_H_
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+/**
+ * @brief oversegments an image into superpixels with SLIC
+ *
+ * The image is covered with a grid of regionSize x regionSize cells, each with a center.
+ * Every iteration each pixel joins the nearest of the centers of its own and the eight
+ * neighbouring cells, by a distance that mixes the Lab colour difference with the
+ * position difference weighted by compactness. The centers then move to the mean of
+ * their pixels. Because a pixel only looks at its own neighbourhood, the rows of the
+ * image are divided over threads without locking. Finally small fragments that are not
+ * connected to the rest of their region are merged with a neighbouring region.
+ */
+class SuperpixelSegmenter{
+public:
+	/**
+	 * @brief constructor
+	 * @param regionSize the width and height of the grid cells, the regions are about this size
+	 * @param compactness the weight of the position against the colour, higher gives more regular regions
+	 * @param iterations the amount of assignment and update steps
+	 * @param threads the amount of threads, 0 for one per core
+	 */
+	SuperpixelSegmenter(int regionSize = 20, double compactness = 10.0, int iterations = 10, unsigned int threads = 0);
+
+	/**
+	 * @brief oversegments an image
+	 * @param image the RGB image
+	 * @param regions receives a CV_32SC1 matrix with the region of every pixel, numbered from 0
+	 * @return the amount of regions
+	 */
+	int segment(const cv::Mat &image, cv::Mat &regions);
+
+	/**
+	 * @return the width and height of the grid cells
+	 */
+	int getRegionSize() const;
+
+	/**
+	 * @return the weight of the position against the colour
+	 */
+	double getCompactness() const;
+
+private:
+	///@brief a cluster center: Lab colour and position
+	struct Center{
+		float l, a, b, x, y;
+	};
+
+	///@brief the width and height of the grid cells
+	int regionSize;
+	///@brief the weight of the position against the colour
+	double compactness;
+	///@brief the amount of assignment and update steps
+	int iterations;
+	///@brief the amount of threads
+	unsigned int threads;
+
+	///@brief the image in Lab
+	cv::Mat lab;
+	///@brief the centers, the center of grid cell (x, y) is at index y * gridCols + x
+	std::vector<Center> centers;
+	///@brief the amount of grid cells horizontally
+	int gridCols;
+	///@brief the amount of grid cells vertically
+	int gridRows;
+	///@brief per thread the sums of colour, position and count of every center
+	std::vector<std::vector<double> > sums;
+
+	/**
+	 * @brief places a center in every grid cell, at the lowest gradient of its 3x3 neighbourhood
+	 */
+	void initCenters();
+
+	/**
+	 * @brief assigns the pixels of a band of rows to their nearest center and sums them per center
+	 * @param firstRow the first row of the band
+	 * @param endRow the row after the band
+	 * @param regions receives the center of every pixel
+	 * @param bandSums receives the sums of colour, position and count of every center
+	 */
+	void assignBand(int firstRow, int endRow, cv::Mat *regions, std::vector<double> *bandSums);
+
+	/**
+	 * @brief merges fragments smaller than a quarter region into a neighbouring region and numbers the regions from 0
+	 * @param regions the center of every pixel, replaced by the region of every pixel
+	 * @return the amount of regions
+	 */
+	int enforceConnectivity(cv::Mat &regions);
+};
+
+#endif /*SUPERPIXELS_H_*/
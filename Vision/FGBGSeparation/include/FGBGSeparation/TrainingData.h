@@ -67,6 +67,27 @@ public:
 	 * @return the created histogram
 	 */
 	cv::Mat CreateHistogramFromPixel(cv::MatConstIterator_<cv::Vec3b> it, int bins, int imageWidth, int imageHeight, int maskSize);
+
+	/**
+	 * @brief creates an histogram with the size of maskSize at the pixel were it points to, without allocating
+	 * @param it points to an pixel within an image
+	 * @param bins the amount of bins where the values are divided over
+	 * @param imageWidth the width of an image
+	 * @param imageHeight the height of an image
+	 * @param maskSize the size of the mask at which the histograms are made
+	 * @param histogram the bins * 3 floats the histogram is written to
+	 */
+	void CreateHistogramFromPixel(cv::MatConstIterator_<cv::Vec3b> it, int bins, int imageWidth, int imageHeight, int maskSize, float* histogram);
+
+	/**
+	 * @brief creates an histogram of every region of an image
+	 * @param image the RGB/HSV image
+	 * @param regions a CV_32SC1 matrix with the region of every pixel, numbered from 0
+	 * @param regionCount the amount of regions
+	 * @param bins the amount of bins where the values are divided over
+	 * @param histograms receives a row of bins * 3 floats for every region
+	 */
+	void CreateHistogramsFromRegions(const cv::Mat &image, const cv::Mat &regions, int regionCount, int bins, cv::Mat &histograms);
 };
 
 #endif /*TRAINER_H_*/
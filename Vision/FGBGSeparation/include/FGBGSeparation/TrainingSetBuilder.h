@@ -0,0 +1,135 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           TrainingSetBuilder.h
+// Description:    builds a sampled training set of histograms with a fixed amount of rows per image, optionally spilled to disk
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#ifndef TRAININGSETBUILDER_H_
+#define TRAININGSETBUILDER_H_
+
+#include <opencv2/core/core.hpp>
+#include <FGBGSeparation/TrainingData.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief builds a training set without a row for every pixel
+ *
+ * Of every image only rowsPerImage pixels are used. They are drawn with a reservoir
+ * per label, so the fore- and background each get a fixed share of the rows, or the
+ * share they have in the image. Histograms are only made for the drawn pixels and are
+ * written into a buffer that is allocated once.
+ *
+ * When a spill path is given, a full buffer is appended to that file instead of growing,
+ * so any amount of annotated images can be added. getTrainingSet() then draws a
+ * stratified sample of at most bufferRows rows from the file.
+ */
+class TrainingSetBuilder{
+public:
+	/**
+	 * @brief constructor
+	 * @param bins the amount of bins where the values are divided over
+	 * @param maskSize the size of the mask at which the histograms are made
+	 * @param RGBorHSV 1 for RGB and 2 for HSV
+	 * @param rowsPerImage the amount of pixels used of every image
+	 * @param foregroundShare the part of the rows of an image that is used for foreground pixels,
+	 * 		a negative value keeps the share the foreground has in the image
+	 * @param bufferRows the amount of rows kept in memory, without a spill path the buffer grows when it is full
+	 * @param spillPath file the rows are written to when the buffer is full, empty to keep everything in memory
+	 */
+	TrainingSetBuilder(int bins, int maskSize, int RGBorHSV, int rowsPerImage = 20000, double foregroundShare = -1,
+			int bufferRows = 200000, const std::string& spillPath = "");
+
+	/**
+	 * @brief destructor, removes the spill file
+	 */
+	~TrainingSetBuilder();
+
+	/**
+	 * @brief samples an image and adds its histograms to the training set
+	 * @param image the RGB image
+	 * @param binaryImage a binary image where white means foreground and black means background
+	 */
+	void addImage(const cv::Mat &image, const cv::Mat &binaryImage);
+
+	/**
+	 * @brief returns the training set
+	 * @param trainData receives one histogram per row
+	 * @param labels receives a label per row, 1 for foreground and 0 for background
+	 * @note without spilling the matrices share their data with the buffer
+	 */
+	void getTrainingSet(cv::Mat &trainData, cv::Mat &labels);
+
+	/**
+	 * @brief removes all rows
+	 */
+	void clear();
+
+	/**
+	 * @return the amount of rows added, including spilled rows
+	 */
+	long rows() const;
+
+	/**
+	 * @return the amount of foreground rows added, including spilled rows
+	 */
+	long foregroundRows() const;
+
+private:
+	int bins;
+	int maskSize;
+	int RGBorHSV;
+	int rowsPerImage;
+	double foregroundShare;
+	int bufferRows;
+	std::string spillPath;
+
+	///@brief the features, preallocated with bufferRows rows
+	cv::Mat buffer;
+	///@brief the labels of the buffer
+	cv::Mat bufferLabels;
+	///@brief the amount of used rows in the buffer
+	int used;
+	///@brief the amount of rows written to the spill file
+	long spilled;
+	long spilledForeground;
+	long foreground;
+
+	Trainer DataTrainer;
+	cv::RNG rng;
+
+	void sample(std::vector<int>& reservoir, int capacity, int index, int& seen);
+	void spill();
+	void readSpilled(cv::Mat &trainData, cv::Mat &labels);
+
+	TrainingSetBuilder(const TrainingSetBuilder&);
+	TrainingSetBuilder& operator=(const TrainingSetBuilder&);
+};
+
+#endif /*TRAININGSETBUILDER_H_*/
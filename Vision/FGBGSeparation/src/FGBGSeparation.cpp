@@ -59,11 +59,55 @@ FGBGSeparator::FGBGSeparator(int bins, int maskSize, int RGBorHSV){
 	this->maskSize = maskSize;
 	this->RGBorHSV = RGBorHSV;
 
+	setVideoMode(16, 8.0, 50);
+
 	trainData = Mat(bins*3, 0, CV_32FC1);
 	labels = Mat(1, 0, CV_32FC1);
 }
 
+void FGBGSeparator::useSampling(int rowsPerImage, double foregroundShare, int bufferRows, const std::string& spillPath){
+	builder = new TrainingSetBuilder(bins, maskSize, RGBorHSV, rowsPerImage, foregroundShare, bufferRows, spillPath);
+	trainData = Mat(bins*3, 0, CV_32FC1);
+	labels = Mat(1, 0, CV_32FC1);
+}
+
+void FGBGSeparator::useRegions(int regionSize, double compactness){
+	segmenter = new SuperpixelSegmenter(regionSize, compactness);
+	regionTrainData = Mat(0, bins*3, CV_32FC1);
+	regionLabels = Mat(0, 1, CV_32SC1);
+}
+
 void FGBGSeparator::addImageToTrainingsSet(Mat &image, Mat &binaryImage){
+	if(!segmenter.empty()){
+		if(image.size() != binaryImage.size()){
+			throw variableException("binaryImage needs to have the size of image");
+		}
+		Mat regions, histograms;
+		int regionCount = createRegionHistograms(image, regions, histograms);
+
+		// A region is foreground when most of its pixels are
+		vector<int> foreground(regionCount, 0), pixels(regionCount, 0);
+		MatConstIterator_<Vec3b> bit = binaryImage.begin<Vec3b>();
+		for(int y = 0; y < regions.rows; y++){
+			const int* region = regions.ptr<int>(y);
+			for(int x = 0; x < regions.cols; x++, ++bit){
+				Vec3b pixBinary = *bit;
+				if(pixBinary[0] > 127 && pixBinary[1] > 127 && pixBinary[2] > 127){
+					foreground[region[x]]++;
+				}
+				pixels[region[x]]++;
+			}
+		}
+		for(int r = 0; r < regionCount; r++){
+			regionLabels.push_back(foreground[r] * 2 > pixels[r] ? 1 : 0);
+		}
+		regionTrainData.push_back(histograms);
+		return;
+	}
+	if(!builder.empty()){
+		builder->addImage(image, binaryImage);
+		return;
+	}
 	DataTrainer.CreateTrainDataFromImage(image, binaryImage, trainData, labels, bins, maskSize, RGBorHSV);
 }
 
@@ -93,13 +137,77 @@ void FGBGSeparator::train(int maxDepth, int minSampleCount,int maxCategories, fl
 	treeParams.use_1se_rule = use1seRule;
 	treeParams.truncate_pruned_tree = truncatePrunedTree;
 	treeParams.priors = priors;
+	if(!segmenter.empty()){
+		regionTree.train(regionTrainData, CV_ROW_SAMPLE, regionLabels, Mat(), Mat(), Mat(), Mat(), treeParams);
+		return;
+	}
+	if(!builder.empty()){
+		Mat sampledData, sampledLabels;
+		builder->getTrainingSet(sampledData, sampledLabels);
+		tree.train(sampledData, CV_ROW_SAMPLE, sampledLabels, Mat(), Mat(), Mat(), Mat(), treeParams);
+		return;
+	}
 	tree.train(trainData, CV_ROW_SAMPLE, labels, Mat(), Mat(), Mat(), Mat(), treeParams);
 }
 
-void FGBGSeparator::saveTraining(const std::string& pathName, const std::string& treeName){	tree.save(pathName.c_str(), treeName.c_str());	}
-void FGBGSeparator::loadTraining(const std::string& pathName, const std::string& treeName){	tree.load(pathName.c_str(), treeName.c_str());	}
+void FGBGSeparator::saveTraining(const std::string& pathName, const std::string& treeName){
+	if(segmenter.empty()){
+		tree.save(pathName.c_str(), treeName.c_str());
+		return;
+	}
+	// The region tree expects region histograms, the file says so
+	FileStorage fs(pathName, FileStorage::WRITE);
+	fs << "featureType" << "regions";
+	fs << "bins" << bins;
+	fs << "regionSize" << segmenter->getRegionSize();
+	fs << "compactness" << segmenter->getCompactness();
+	regionTree.write(*fs, treeName.c_str());
+}
+
+void FGBGSeparator::loadTraining(const std::string& pathName, const std::string& treeName){
+	if(segmenter.empty()){
+		tree.load(pathName.c_str(), treeName.c_str());
+		return;
+	}
+	FileStorage fs(pathName, FileStorage::READ);
+	if(!fs.isOpened() || (string)fs["featureType"] != "regions"){
+		throw variableException("the file does not contain a region tree, it is not saved after useRegions");
+	}
+	if((int)fs["bins"] != bins){
+		throw variableException("the region tree is trained with a different amount of bins");
+	}
+	FileNode node = fs[treeName];
+	if(node.empty()){
+		throw variableException("the file does not contain " + treeName);
+	}
+	// The regions are made the same way as during training
+	segmenter = new SuperpixelSegmenter((int)fs["regionSize"], (double)fs["compactness"]);
+	regionTree.read(*fs, *node);
+}
 
 void FGBGSeparator::separateFB(const Mat &image, Mat &result){
+	if(!segmenter.empty()){
+		// One prediction per region
+		Mat regions, histograms;
+		int regionCount = createRegionHistograms(image, regions, histograms);
+		vector<uchar> foreground(regionCount);
+		for(int r = 0; r < regionCount; r++){
+			CvDTreeNode *resultNode = regionTree.predict(histograms.row(r));
+			foreground[r] = resultNode->value ? 255 : 0;
+		}
+
+		result.create(image.size(), CV_8UC3);
+		for(int y = 0; y < image.rows; y++){
+			const int* region = regions.ptr<int>(y);
+			Vec3b* pix = result.ptr<Vec3b>(y);
+			for(int x = 0; x < image.cols; x++){
+				uchar value = foreground[region[x]];
+				pix[x] = Vec3b(value, value, value);
+			}
+		}
+		return;
+	}
+
 	Mat temp = image.clone();
 	if(RGBorHSV == 2){
 		cvtColor(image, temp, CV_RGB2HSV);
@@ -122,3 +230,115 @@ void FGBGSeparator::separateFB(const Mat &image, Mat &result){
 		cvtColor(result, result, CV_HSV2RGB);
 	}
 }
+
+void FGBGSeparator::setVideoMode(int blockSize, double changeThreshold, int refreshInterval){
+	if(blockSize <= 0){
+		throw variableException("blockSize needs to be greater than 0");
+	}
+	if(refreshInterval < 0){
+		throw variableException("refreshInterval can not be negative");
+	}
+	videoBlockSize = blockSize;
+	videoThreshold = changeThreshold;
+	videoRefreshInterval = refreshInterval;
+	resetVideo();
+}
+
+void FGBGSeparator::resetVideo(){
+	videoReference.release();
+	videoLabels.release();
+	videoFrames = 0;
+	videoReclassified = 0;
+}
+
+double FGBGSeparator::getReclassifiedFraction() const{
+	return videoReclassified;
+}
+
+void FGBGSeparator::separateVideoFrame(const Mat &frame, Mat &result){
+	if(!segmenter.empty()){
+		throw variableException("separateVideoFrame classifies pixels, it can not be used with useRegions");
+	}
+
+	// A new image, it is kept as reference
+	Mat temp;
+	if(RGBorHSV == HSV){
+		cvtColor(frame, temp, CV_RGB2HSV);
+	}else{
+		temp = frame.clone();
+	}
+
+	long classified;
+	bool refresh = videoRefreshInterval > 0 && videoFrames >= videoRefreshInterval;
+	if(videoReference.empty() || videoReference.size() != temp.size() || refresh){
+		// Classify the whole frame
+		videoLabels.create(temp.size(), CV_8UC1);
+		classified = classifyPixels(temp, Mat(), videoLabels);
+		videoReference = temp;
+		videoFrames = 0;
+	}else{
+		// Find the blocks that changed since they were last classified
+		Mat difference;
+		absdiff(temp, videoReference, difference);
+
+		Mat dirty = Mat::zeros(temp.size(), CV_8UC1);
+		int halo = maskSize / 2;
+		Rect frameRect(0, 0, temp.cols, temp.rows);
+		for(int y = 0; y < temp.rows; y += videoBlockSize){
+			for(int x = 0; x < temp.cols; x += videoBlockSize){
+				Rect block = Rect(x, y, videoBlockSize, videoBlockSize) & frameRect;
+				Scalar change = mean(difference(block));
+				if(max(change[0], max(change[1], change[2])) <= videoThreshold){
+					continue;
+				}
+
+				// The histograms of the halo around the block contain its pixels
+				Rect area = Rect(block.x - halo, block.y - halo, block.width + 2 * halo, block.height + 2 * halo)
+						& frameRect;
+				dirty(area).setTo(Scalar(255));
+				Mat reference = videoReference(block);
+				temp(block).copyTo(reference);
+			}
+		}
+		classified = classifyPixels(temp, dirty, videoLabels);
+	}
+	videoFrames++;
+	videoReclassified = (double)classified / (temp.rows * temp.cols);
+
+	result.create(frame.size(), CV_8UC3);
+	result.setTo(Scalar(0, 0, 0));
+	result.setTo(Scalar(255, 255, 255), videoLabels);
+}
+
+long FGBGSeparator::classifyPixels(const Mat &image, const Mat &dirty, Mat &labels){
+	Mat histogram(1, bins * 3, CV_32FC1);
+	MatConstIterator_<Vec3b> begin = image.begin<Vec3b>();
+	long classified = 0;
+	for(int y = 0; y < image.rows; y++){
+		const uchar* dirtyRow = dirty.empty() ? NULL : dirty.ptr<uchar>(y);
+		uchar* labelRow = labels.ptr<uchar>(y);
+		for(int x = 0; x < image.cols; x++){
+			if(dirtyRow != NULL && dirtyRow[x] == 0){
+				continue;
+			}
+			DataTrainer.CreateHistogramFromPixel(begin + (y * image.cols + x), bins, image.cols, image.rows, maskSize,
+					histogram.ptr<float>());
+			CvDTreeNode *resultNode = tree.predict(histogram);
+			labelRow[x] = resultNode->value ? 255 : 0;
+			classified++;
+		}
+	}
+	return classified;
+}
+
+int FGBGSeparator::createRegionHistograms(const Mat &image, Mat &regions, Mat &histograms){
+	int regionCount = segmenter->segment(image, regions);
+	Mat temp;
+	if(RGBorHSV == HSV){
+		cvtColor(image, temp, CV_RGB2HSV);
+	} else {
+		temp = image;
+	}
+	DataTrainer.CreateHistogramsFromRegions(temp, regions, regionCount, bins, histograms);
+	return regionCount;
+}
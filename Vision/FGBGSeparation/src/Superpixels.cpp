@@ -0,0 +1,257 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           Superpixels.cpp
+// Description:    oversegments an image into compact regions of similar colour (SLIC), in parallel
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include <FGBGSeparation/Superpixels.h>
+#include <FGBGSeparation/variableException.h>
+
+using namespace cv;
+using namespace std;
+
+SuperpixelSegmenter::SuperpixelSegmenter(int regionSize, double compactness, int iterations, unsigned int threads) :
+		regionSize(regionSize), compactness(compactness), iterations(iterations), threads(threads),
+		gridCols(0), gridRows(0){
+	if(regionSize <= 1){
+		throw variableException("regionSize needs to be greater than 1");
+	}
+	if(compactness <= 0){
+		throw variableException("compactness needs to be greater than 0");
+	}
+	if(iterations <= 0){
+		throw variableException("iterations needs to be greater than 0");
+	}
+	if(this->threads == 0){
+		this->threads = boost::thread::hardware_concurrency();
+		if(this->threads == 0){
+			this->threads = 1;
+		}
+	}
+}
+
+int SuperpixelSegmenter::getRegionSize() const{
+	return regionSize;
+}
+
+double SuperpixelSegmenter::getCompactness() const{
+	return compactness;
+}
+
+int SuperpixelSegmenter::segment(const Mat &image, Mat &regions){
+	if(image.type() != CV_8UC3 || image.empty()){
+		throw variableException("image needs to be RGB");
+	}
+	cvtColor(image, lab, CV_BGR2Lab);
+	regions.create(image.size(), CV_32SC1);
+
+	gridCols = max(1, image.cols / regionSize);
+	gridRows = max(1, image.rows / regionSize);
+	initCenters();
+
+	// Every thread gets a band of rows and its own sums, so nothing is shared while assigning
+	unsigned int bands = min(threads, (unsigned int)image.rows);
+	sums.resize(bands);
+	for(int i = 0; i < iterations; i++){
+		if(bands == 1){
+			assignBand(0, image.rows, &regions, &sums[0]);
+		}else{
+			boost::thread_group group;
+			for(unsigned int t = 0; t < bands; t++){
+				group.create_thread(boost::bind(&SuperpixelSegmenter::assignBand, this, image.rows * t / bands,
+						image.rows * (t + 1) / bands, &regions, &sums[t]));
+			}
+			group.join_all();
+		}
+
+		// Move every center to the mean of its pixels, a center without pixels stays
+		for(size_t k = 0; k < centers.size(); k++){
+			double total[6] = {0, 0, 0, 0, 0, 0};
+			for(unsigned int t = 0; t < bands; t++){
+				for(int j = 0; j < 6; j++){
+					total[j] += sums[t][k * 6 + j];
+				}
+			}
+			if(total[5] > 0){
+				centers[k].l = total[0] / total[5];
+				centers[k].a = total[1] / total[5];
+				centers[k].b = total[2] / total[5];
+				centers[k].x = total[3] / total[5];
+				centers[k].y = total[4] / total[5];
+			}
+		}
+	}
+
+	return enforceConnectivity(regions);
+}
+
+void SuperpixelSegmenter::initCenters(){
+	centers.resize(gridCols * gridRows);
+	for(int gy = 0; gy < gridRows; gy++){
+		// The last row and column of cells take the rest of the image
+		int top = gy * regionSize;
+		int bottom = gy == gridRows - 1 ? lab.rows : top + regionSize;
+		for(int gx = 0; gx < gridCols; gx++){
+			int left = gx * regionSize;
+			int right = gx == gridCols - 1 ? lab.cols : left + regionSize;
+			int cx = (left + right) / 2;
+			int cy = (top + bottom) / 2;
+
+			// Do not start on an edge
+			int bestX = cx, bestY = cy;
+			float bestGradient = FLT_MAX;
+			for(int y = max(cy - 1, 1); y <= min(cy + 1, lab.rows - 2); y++){
+				for(int x = max(cx - 1, 1); x <= min(cx + 1, lab.cols - 2); x++){
+					float gradient = 0;
+					for(int c = 0; c < 3; c++){
+						float dx = (float)lab.at<Vec3b>(y, x + 1)[c] - lab.at<Vec3b>(y, x - 1)[c];
+						float dy = (float)lab.at<Vec3b>(y + 1, x)[c] - lab.at<Vec3b>(y - 1, x)[c];
+						gradient += dx * dx + dy * dy;
+					}
+					if(gradient < bestGradient){
+						bestGradient = gradient;
+						bestX = x;
+						bestY = y;
+					}
+				}
+			}
+
+			Center &center = centers[gy * gridCols + gx];
+			const Vec3b &colour = lab.at<Vec3b>(bestY, bestX);
+			center.l = colour[0];
+			center.a = colour[1];
+			center.b = colour[2];
+			center.x = bestX;
+			center.y = bestY;
+		}
+	}
+}
+
+void SuperpixelSegmenter::assignBand(int firstRow, int endRow, Mat *regions, vector<double> *bandSums){
+	bandSums->assign(centers.size() * 6, 0.0);
+	float weight = (float)(compactness * compactness / (regionSize * regionSize));
+	for(int y = firstRow; y < endRow; y++){
+		const uchar* colour = lab.ptr<uchar>(y);
+		int* region = regions->ptr<int>(y);
+		int gy = min(y / regionSize, gridRows - 1);
+		for(int x = 0; x < lab.cols; x++, colour += 3){
+			int gx = min(x / regionSize, gridCols - 1);
+
+			// Only the centers of this and the neighbouring cells can be near enough
+			int best = gy * gridCols + gx;
+			float bestDistance = FLT_MAX;
+			for(int cy = max(gy - 1, 0); cy <= min(gy + 1, gridRows - 1); cy++){
+				for(int cx = max(gx - 1, 0); cx <= min(gx + 1, gridCols - 1); cx++){
+					const Center &center = centers[cy * gridCols + cx];
+					float dl = colour[0] - center.l;
+					float da = colour[1] - center.a;
+					float db = colour[2] - center.b;
+					float dx = x - center.x;
+					float dy = y - center.y;
+					float distance = dl * dl + da * da + db * db + weight * (dx * dx + dy * dy);
+					if(distance < bestDistance){
+						bestDistance = distance;
+						best = cy * gridCols + cx;
+					}
+				}
+			}
+
+			region[x] = best;
+			double* sum = &(*bandSums)[best * 6];
+			sum[0] += colour[0];
+			sum[1] += colour[1];
+			sum[2] += colour[2];
+			sum[3] += x;
+			sum[4] += y;
+			sum[5] += 1;
+		}
+	}
+}
+
+int SuperpixelSegmenter::enforceConnectivity(Mat &regions){
+	const int dx[4] = {-1, 0, 1, 0};
+	const int dy[4] = {0, -1, 0, 1};
+	int minSize = regionSize * regionSize / 4;
+
+	Mat connected(regions.size(), CV_32SC1, Scalar(-1));
+	vector<int> fragment;
+	fragment.reserve(regionSize * regionSize * 4);
+	int count = 0;
+	for(int y = 0; y < regions.rows; y++){
+		for(int x = 0; x < regions.cols; x++){
+			if(connected.at<int>(y, x) >= 0){
+				continue;
+			}
+
+			// A neighbour that already has its final region, to merge a small fragment with
+			int adjacent = -1;
+			for(int n = 0; n < 4; n++){
+				int nx = x + dx[n], ny = y + dy[n];
+				if(nx >= 0 && nx < regions.cols && ny >= 0 && ny < regions.rows && connected.at<int>(ny, nx) >= 0){
+					adjacent = connected.at<int>(ny, nx);
+				}
+			}
+
+			// Flood fill the fragment of the center this pixel belongs to
+			int center = regions.at<int>(y, x);
+			fragment.clear();
+			fragment.push_back(y * regions.cols + x);
+			connected.at<int>(y, x) = count;
+			for(size_t i = 0; i < fragment.size(); i++){
+				int px = fragment[i] % regions.cols, py = fragment[i] / regions.cols;
+				for(int n = 0; n < 4; n++){
+					int nx = px + dx[n], ny = py + dy[n];
+					if(nx >= 0 && nx < regions.cols && ny >= 0 && ny < regions.rows &&
+							connected.at<int>(ny, nx) < 0 && regions.at<int>(ny, nx) == center){
+						connected.at<int>(ny, nx) = count;
+						fragment.push_back(ny * regions.cols + nx);
+					}
+				}
+			}
+
+			if((int)fragment.size() < minSize && adjacent >= 0){
+				for(size_t i = 0; i < fragment.size(); i++){
+					connected.at<int>(fragment[i] / regions.cols, fragment[i] % regions.cols) = adjacent;
+				}
+			}else{
+				count++;
+			}
+		}
+	}
+
+	regions = connected;
+	return count;
+}
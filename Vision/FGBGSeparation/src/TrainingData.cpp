@@ -69,7 +69,12 @@ void Trainer::CreateTrainDataFromImage(Mat &image, Mat &binary, Mat &trainData,
 }
 
 Mat Trainer::CreateHistogramFromPixel(MatConstIterator_<Vec3b> it, int bins, int imageWidth, int imageHeight, int maskSize){
-	float HSV[bins * 3];
+	Mat histogram(1, bins * 3, CV_32FC1);
+	CreateHistogramFromPixel(it, bins, imageWidth, imageHeight, maskSize, histogram.ptr<float>());
+	return histogram;
+}
+
+void Trainer::CreateHistogramFromPixel(MatConstIterator_<Vec3b> it, int bins, int imageWidth, int imageHeight, int maskSize, float* HSV){
 	Vec3b pix;
 	int pixelInMask = 0;
 	MatConstIterator_<Vec3b> temp = it;
@@ -101,7 +106,34 @@ Mat Trainer::CreateHistogramFromPixel(MatConstIterator_<Vec3b> it, int bins, int
 	for(int i = 0; i < (bins * 3); i++){
 		HSV[i] = HSV[i]/pixelInMask;
 	}
-
-	return Mat(1,bins*3,CV_32FC1, HSV);
 }
 
+
+void Trainer::CreateHistogramsFromRegions(const Mat &image, const Mat &regions, int regionCount, int bins, Mat &histograms){
+	histograms = Mat::zeros(regionCount, bins * 3, CV_32FC1);
+	vector<int> pixelsInRegion(regionCount, 0);
+
+	// The same bins as CreateHistogramFromPixel, over the pixels of a region instead of a mask
+	int binOf[256];
+	for(int value = 0; value < 256; value++){
+		binOf[value] = value > 254 ? (int)((254/255.0)*bins) : (int)((value/255.0)*bins);
+	}
+	for(int y = 0; y < image.rows; y++){
+		const Vec3b* pix = image.ptr<Vec3b>(y);
+		const int* region = regions.ptr<int>(y);
+		for(int x = 0; x < image.cols; x++){
+			float* histogram = histograms.ptr<float>(region[x]);
+			for(int i = 0; i < 3; i++){
+				histogram[binOf[pix[x][i]] + (bins*i)]++;
+			}
+			pixelsInRegion[region[x]]++;
+		}
+	}
+
+	for(int r = 0; r < regionCount; r++){
+		float* histogram = histograms.ptr<float>(r);
+		for(int i = 0; i < (bins * 3) && pixelsInRegion[r] > 0; i++){
+			histogram[i] = histogram[i]/pixelsInRegion[r];
+		}
+	}
+}
@@ -0,0 +1,254 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FGBGSeparation
+// File:           TrainingSetBuilder.cpp
+// Description:    builds a sampled training set of histograms with a fixed amount of rows per image, optionally spilled to disk
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <FGBGSeparation/TrainingSetBuilder.h>
+#include <FGBGSeparation/variableException.h>
+
+using namespace cv;
+using namespace std;
+
+TrainingSetBuilder::TrainingSetBuilder(int bins, int maskSize, int RGBorHSV, int rowsPerImage, double foregroundShare,
+		int bufferRows, const std::string& spillPath) :
+		bins(bins), maskSize(maskSize), RGBorHSV(RGBorHSV), rowsPerImage(rowsPerImage),
+		foregroundShare(foregroundShare), bufferRows(bufferRows), spillPath(spillPath), used(0), spilled(0),
+		spilledForeground(0), foreground(0){
+	if(rowsPerImage <= 0){
+		throw variableException("rowsPerImage needs to be greater than 0");
+	}
+	if(bufferRows <= 0){
+		throw variableException("bufferRows needs to be greater than 0");
+	}
+	if(foregroundShare > 1){
+		throw variableException("foregroundShare can not be greater than 1");
+	}
+	clear();
+}
+
+TrainingSetBuilder::~TrainingSetBuilder(){
+	if(!spillPath.empty()){
+		remove(spillPath.c_str());
+	}
+}
+
+void TrainingSetBuilder::addImage(const Mat &image, const Mat &binaryImage){
+	if(image.size() != binaryImage.size() || image.type() != CV_8UC3){
+		throw variableException("image needs to be RGB with the size of binaryImage");
+	}
+
+	// temp = image would share its buffer, and cvtColor would then convert the caller's image in place
+	Mat temp;
+	if(RGBorHSV == HSV){
+		cvtColor(image, temp, CV_RGB2HSV);
+	} else {
+		temp = image;
+	}
+
+	// Draw a reservoir of pixels per label, keeping only their index
+	vector<int> foregroundPixels, backgroundPixels;
+	int foregroundSeen = 0, backgroundSeen = 0;
+	int binaryChannels = binaryImage.channels();
+	for(int y = 0; y < binaryImage.rows; y++){
+		const uchar* row = binaryImage.ptr<uchar>(y);
+		for(int x = 0; x < binaryImage.cols; x++, row += binaryChannels){
+			bool isForeground = true;
+			for(int c = 0; c < binaryChannels; c++){
+				isForeground = isForeground && row[c] > 127;
+			}
+			if(isForeground){
+				sample(foregroundPixels, rowsPerImage, y * binaryImage.cols + x, foregroundSeen);
+			}else{
+				sample(backgroundPixels, rowsPerImage, y * binaryImage.cols + x, backgroundSeen);
+			}
+		}
+	}
+
+	// Split the rows, a label with too few pixels leaves its rows to the other
+	int pixels = foregroundSeen + backgroundSeen;
+	int foregroundTake = foregroundShare < 0 ?
+			cvRound(min(rowsPerImage, pixels) * (double)foregroundSeen / max(pixels, 1)) :
+			cvRound(rowsPerImage * foregroundShare);
+	foregroundTake = min(foregroundTake, foregroundSeen);
+	int backgroundTake = min(rowsPerImage - foregroundTake, backgroundSeen);
+	foregroundTake = min(rowsPerImage - backgroundTake, foregroundSeen);
+
+	// A random subset of a reservoir is a random subset of the image
+	vector<pair<int, int> > selected;
+	for(int i = 0; i < foregroundTake; i++){
+		swap(foregroundPixels[i], foregroundPixels[rng.uniform(i, (int)foregroundPixels.size())]);
+		selected.push_back(make_pair(foregroundPixels[i], 1));
+	}
+	for(int i = 0; i < backgroundTake; i++){
+		swap(backgroundPixels[i], backgroundPixels[rng.uniform(i, (int)backgroundPixels.size())]);
+		selected.push_back(make_pair(backgroundPixels[i], 0));
+	}
+	sort(selected.begin(), selected.end());
+
+	// Only the drawn pixels get a histogram
+	if(buffer.empty()){
+		buffer.create(bufferRows, bins * 3, CV_32FC1);
+		bufferLabels.create(bufferRows, 1, CV_32SC1);
+	}
+	MatConstIterator_<Vec3b> begin = temp.begin<Vec3b>();
+	for(size_t i = 0; i < selected.size(); i++){
+		if(used == buffer.rows){
+			if(spillPath.empty()){
+				// Nowhere to spill, grow the buffer instead
+				Mat grown(buffer.rows * 2, buffer.cols, CV_32FC1);
+				Mat grownLabels(buffer.rows * 2, 1, CV_32SC1);
+				Mat head = grown.rowRange(0, buffer.rows);
+				Mat headLabels = grownLabels.rowRange(0, buffer.rows);
+				buffer.copyTo(head);
+				bufferLabels.copyTo(headLabels);
+				buffer = grown;
+				bufferLabels = grownLabels;
+			}else{
+				spill();
+			}
+		}
+
+		DataTrainer.CreateHistogramFromPixel(begin + selected[i].first, bins, temp.cols, temp.rows, maskSize,
+				buffer.ptr<float>(used));
+		bufferLabels.at<int>(used) = selected[i].second;
+		foreground += selected[i].second;
+		used++;
+	}
+}
+
+void TrainingSetBuilder::getTrainingSet(Mat &trainData, Mat &labels){
+	if(spilled == 0){
+		trainData = buffer.rowRange(0, used);
+		labels = bufferLabels.rowRange(0, used);
+	}else{
+		spill();
+		readSpilled(trainData, labels);
+	}
+}
+
+void TrainingSetBuilder::clear(){
+	used = 0;
+	spilled = 0;
+	spilledForeground = 0;
+	foreground = 0;
+	if(!spillPath.empty()){
+		FILE* file = fopen(spillPath.c_str(), "wb");
+		if(file == NULL){
+			throw variableException("can not create " + spillPath);
+		}
+		fclose(file);
+	}
+}
+
+long TrainingSetBuilder::rows() const{
+	return spilled + used;
+}
+
+long TrainingSetBuilder::foregroundRows() const{
+	return spilledForeground + foreground;
+}
+
+void TrainingSetBuilder::sample(vector<int>& reservoir, int capacity, int index, int& seen){
+	seen++;
+	if((int)reservoir.size() < capacity){
+		reservoir.push_back(index);
+	}else{
+		int slot = rng.uniform(0, seen);
+		if(slot < capacity){
+			reservoir[slot] = index;
+		}
+	}
+}
+
+void TrainingSetBuilder::spill(){
+	FILE* file = fopen(spillPath.c_str(), "ab");
+	if(file == NULL){
+		throw variableException("can not write to " + spillPath);
+	}
+	// Every record is the label followed by the histogram
+	for(int i = 0; i < used; i++){
+		fwrite(bufferLabels.ptr<int>(i), sizeof(int), 1, file);
+		fwrite(buffer.ptr<float>(i), sizeof(float), buffer.cols, file);
+	}
+	bool failed = ferror(file) != 0;
+	fclose(file);
+	if(failed){
+		throw variableException("can not write to " + spillPath);
+	}
+
+	spilled += used;
+	spilledForeground += foreground;
+	used = 0;
+	foreground = 0;
+}
+
+void TrainingSetBuilder::readSpilled(Mat &trainData, Mat &labels){
+	FILE* file = fopen(spillPath.c_str(), "rb");
+	if(file == NULL){
+		throw variableException("can not read " + spillPath);
+	}
+
+	// Keep the share of the foreground when the file does not fit in memory
+	long count = min(spilled, (long)bufferRows);
+	long foregroundCapacity = spilled <= bufferRows ? spilledForeground :
+			(long)((double)count * spilledForeground / spilled + 0.5);
+	long capacity[2] = { count - foregroundCapacity, foregroundCapacity };
+	long offset[2] = { foregroundCapacity, 0 };
+	long seen[2] = { 0, 0 };
+
+	trainData.create(count, bins * 3, CV_32FC1);
+	labels.create(count, 1, CV_32SC1);
+	vector<float> record(bins * 3);
+	for(long i = 0; i < spilled; i++){
+		int label;
+		if(fread(&label, sizeof(int), 1, file) != 1 || fread(&record[0], sizeof(float), record.size(), file)
+				!= record.size()){
+			fclose(file);
+			throw variableException("can not read " + spillPath);
+		}
+
+		int c = label ? 1 : 0;
+		long slot = seen[c]++;
+		if(slot >= capacity[c]){
+			slot = (long)(rng.uniform(0.0, 1.0) * seen[c]);
+			if(slot >= capacity[c]){
+				continue;
+			}
+		}
+		copy(record.begin(), record.end(), trainData.ptr<float>(offset[c] + slot));
+		labels.at<int>(offset[c] + slot) = label;
+	}
+	fclose(file);
+}
@@ -0,0 +1,217 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Fiducial
+// File:           crate_detector_benchmark.cpp
+// Description:    Compares the crate segmentation with the exhaustive point in contour search
+// Author:         agent
+// Notes:          g++ -O2 -Iinclude example/crate_detector_benchmark.cpp src/CrateDetector.cpp src/Crate.cpp `pkg-config --cflags --libs opencv`
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "CrateDetector.h"
+#include "Crate.h"
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#define WIDTH 1280
+#define HEIGHT 960
+#define FIDUCIAL_SIZE 40
+
+/*
+ * CrateDetector::detect before the point grid: every point is tested
+ * against every contour, the leftovers are found by a scan of the used points.
+ */
+void exhaustiveDetect(const cv::Mat& image, const std::vector<cv::Point2f>& points, std::vector<Crate>& crates,
+		std::vector<cv::Point2f>& leftovers, int lowThreshold, int highThreshold) {
+	cv::Mat canny;
+	cv::Canny(image, canny, lowThreshold, highThreshold);
+
+	std::vector<std::vector<cv::Point> > contours;
+	cv::findContours(canny, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+
+	std::vector<cv::Point2f> usedPoints;
+	for (size_t c = 0; c < contours.size(); c++) {
+		std::vector<cv::Point2f> fiducials;
+		for (size_t p = 0; p < points.size(); p++) {
+			if (cv::pointPolygonTest(contours[c], points[p], false) == 1) {
+				fiducials.push_back(points[p]);
+			}
+		}
+		if (fiducials.size() == 3) {
+			Crate::order(fiducials);
+			crates.push_back(Crate(fiducials));
+			usedPoints.insert(usedPoints.end(), fiducials.begin(), fiducials.end());
+		}
+	}
+
+	for (size_t p = 0; p < points.size(); p++) {
+		size_t u = 0;
+		for (; u < usedPoints.size(); u++) if (points[p] == usedPoints[u]) break;
+		if (u == usedPoints.size()) leftovers.push_back(points[p]);
+	}
+}
+
+/*
+ * Draws a conveyor with crates, each with three of the sample fiducials,
+ * and scatters clutter and false fiducial points around them.
+ */
+void createScene(const std::vector<cv::Mat>& samples, int clutter, cv::Mat& scene, std::vector<cv::Point2f>& points) {
+	scene = cv::Mat(HEIGHT, WIDTH, CV_8UC1, cv::Scalar(200));
+	points.clear();
+	cv::RNG rng(42);
+
+	std::vector<cv::Rect> crateRects;
+	for (int row = 0; row < 2; row++) {
+		for (int col = 0; col < 3; col++) {
+			crateRects.push_back(cv::Rect(80 + col * 400, 100 + row * 440, 300, 240));
+		}
+	}
+
+	for (size_t i = 0; i < crateRects.size(); i++) {
+		const cv::Rect& r = crateRects[i];
+		cv::rectangle(scene, r, cv::Scalar(150), CV_FILLED);
+		cv::rectangle(scene, r, cv::Scalar(40), 3);
+
+		cv::Point2f corners[3] = {
+			cv::Point2f(r.x + 50, r.y + 50),
+			cv::Point2f(r.x + r.width - 50, r.y + 50),
+			cv::Point2f(r.x + 50, r.y + r.height - 50)
+		};
+		for (int f = 0; f < 3; f++) {
+			cv::Rect roi((int)corners[f].x - FIDUCIAL_SIZE / 2, (int)corners[f].y - FIDUCIAL_SIZE / 2, FIDUCIAL_SIZE, FIDUCIAL_SIZE);
+			cv::Mat dst = scene(roi);
+			samples[(i + f) % samples.size()].copyTo(dst);
+			points.push_back(corners[f]);
+		}
+	}
+
+	// clutter stays off the crates, otherwise it merges with their contours
+	int placed = 0;
+	while (placed < clutter) {
+		cv::Point center(rng.uniform(10, WIDTH - 10), rng.uniform(10, HEIGHT - 10));
+		int size = rng.uniform(3, 12);
+		bool onCrate = false;
+		for (size_t i = 0; i < crateRects.size(); i++) {
+			cv::Rect area(crateRects[i].x - 30, crateRects[i].y - 30, crateRects[i].width + 60, crateRects[i].height + 60);
+			if (area.contains(center)) onCrate = true;
+		}
+		if (onCrate) continue;
+
+		switch (placed % 3) {
+		case 0: cv::circle(scene, center, size, cv::Scalar(rng.uniform(0, 100)), CV_FILLED); break;
+		case 1: cv::rectangle(scene, cv::Rect(center.x - size, center.y - size, 2 * size, size), cv::Scalar(rng.uniform(0, 100)), CV_FILLED); break;
+		case 2: cv::line(scene, center, cv::Point(center.x + size, center.y + size), cv::Scalar(rng.uniform(0, 100)), 2); break;
+		}
+		// some of the clutter is mistaken for a fiducial
+		if (placed % 10 == 0) points.push_back(cv::Point2f(center.x, center.y));
+		placed++;
+	}
+}
+
+bool sameCrates(const std::vector<Crate>& a, const std::vector<Crate>& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].getPoints() != b[i].getPoints()) return false;
+	}
+	return true;
+}
+
+/*
+ * Usage: crate_detector_benchmark [fiducial directory] [clutter] [runs]
+ */
+int main(int argc, char* argv[]) {
+	std::string dir = argc > 1 ? argv[1] : "Fiducials";
+	int clutter = argc > 2 ? atoi(argv[2]) : 600;
+	int runs = argc > 3 ? atoi(argv[3]) : 20;
+
+	const char* names[] = { "circle.png", "cross.png", "crosshair.png", "square.png" };
+	std::vector<cv::Mat> samples;
+	for (int i = 0; i < 4; i++) {
+		cv::Mat sample = cv::imread(dir + "/" + names[i], CV_LOAD_IMAGE_GRAYSCALE);
+		if (!sample.data) {
+			std::cout << "Could not open " << dir << "/" << names[i] << std::endl;
+			return 1;
+		}
+		cv::resize(sample, sample, cv::Size(FIDUCIAL_SIZE, FIDUCIAL_SIZE), 0, 0, cv::INTER_AREA);
+		samples.push_back(sample);
+	}
+
+	cv::Mat scene;
+	std::vector<cv::Point2f> points;
+	createScene(samples, clutter, scene, points);
+
+	CrateDetector detector;
+	cv::Mat canny;
+	std::vector<std::vector<cv::Point> > contours;
+	cv::Canny(scene, canny, detector.lowThreshold, detector.highThreshold);
+	cv::findContours(canny, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+	printf("%d points, %d contours\n", (int)points.size(), (int)contours.size());
+
+	// the Canny and findContours time is the same for both
+	double tick = cv::getTickFrequency() / 1000.0;
+	int64 start = cv::getTickCount();
+	for (int i = 0; i < runs; i++) {
+		cv::Canny(scene, canny, detector.lowThreshold, detector.highThreshold);
+		contours.clear();
+		cv::findContours(canny, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+	}
+	double edgesMs = (cv::getTickCount() - start) / tick / runs;
+
+	std::vector<Crate> exhaustiveCrates, gridCrates;
+	std::vector<cv::Point2f> exhaustiveLeftovers, gridLeftovers;
+	start = cv::getTickCount();
+	for (int i = 0; i < runs; i++) {
+		exhaustiveCrates.clear();
+		exhaustiveLeftovers.clear();
+		exhaustiveDetect(scene, points, exhaustiveCrates, exhaustiveLeftovers, detector.lowThreshold, detector.highThreshold);
+	}
+	double exhaustiveMs = (cv::getTickCount() - start) / tick / runs;
+
+	start = cv::getTickCount();
+	for (int i = 0; i < runs; i++) {
+		gridCrates.clear();
+		gridLeftovers.clear();
+		detector.detect(scene, points, gridCrates, &gridLeftovers);
+	}
+	double gridMs = (cv::getTickCount() - start) / tick / runs;
+
+	printf("canny + contours %8.2f ms\n", edgesMs);
+	printf("exhaustive       %8.2f ms (assignment %.2f ms)\n", exhaustiveMs, exhaustiveMs - edgesMs);
+	printf("grid             %8.2f ms (assignment %.2f ms)\n", gridMs, gridMs - edgesMs);
+	printf("%d crates, %d leftovers\n", (int)gridCrates.size(), (int)gridLeftovers.size());
+
+	if (!sameCrates(exhaustiveCrates, gridCrates) || exhaustiveLeftovers != gridLeftovers) {
+		std::cout << "Results differ" << std::endl;
+		return 1;
+	}
+	return 0;
+}
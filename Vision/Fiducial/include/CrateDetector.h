@@ -70,6 +70,8 @@ public:
 	 *  Detects all crates in the image and segments points
 	 *  belonging to each crate into Crate instances. These
 	 *  are added to the crates vector.
+	 *  Each point is only tested against the contours
+	 *  whose bounding box contains it.
 	 *
 	 *  \param image Image with the crates
 	 *  \param points Detected fiducial points
@@ -26,8 +26,8 @@
 // You should have received a copy of the GNU General Public License
 // along with DetectQRCode.  If not, see <http://www.gnu.org/licenses/>.
 //******************************************************************************
-#ifndef DETECTBARCODE_H_
-#define DETECTBARCODE_H_
+#ifndef QRCODEDETECTOR_H_
+#define QRCODEDETECTOR_H_
 
 #include <stdlib.h>
 #include <zbar.h>
@@ -35,6 +35,7 @@
 #include <vector>
 #include <opencv2/core/core.hpp>
 #include "Crate.h"
+#include "QRLocalizer.h"
 
 /**
  * @brief This class can detect barcodes from a Mat object
@@ -43,7 +44,41 @@ class QRCodeDetector{
 private:
 	///@brief the scanner which scans the code from an image
     zbar::ImageScanner scanner;
+
+	///@brief a decoded code with the corners of its location
+	struct Code {
+		std::string data;
+		std::vector<cv::Point2f> location;
+	};
+
+	/**
+	 * @brief scans the regions with a code, or the whole image if no region could be decoded,
+	 * if the previous frame had a finder pattern outside its codes, or every fullScanInterval frames
+	 * @param image the image to scan
+	 * @param codes the decoded codes
+	 */
+	void scan(cv::Mat& image, std::vector<Code>& codes);
+
+	/**
+	 * @brief scans a single image with zbar
+	 * @param image the image to scan, must be continuous
+	 * @param offset added to the locations of the codes
+	 * @param codes the decoded codes are appended to this vector
+	 */
+	void scanImage(const cv::Mat& image, cv::Point offset, std::vector<Code>& codes);
+
+	///@brief the amount of frames since the whole image was scanned
+	int framesSinceFullScan;
+	///@brief whether the next frame scans the whole image, because a finder pattern lay outside the decoded codes
+	bool fullScanNext;
 public:
+	///@brief locates the codes, so only the regions around them are scanned
+	QRLocalizer localizer;
+	///@brief whether the localizer is used, the whole image is scanned otherwise
+	bool localize;
+	///@brief when codes were decoded and every finder pattern lies inside them, the whole image is still scanned once per this amount of frames, 1 for every frame
+	int fullScanInterval;
+
     ///@brief constructor sets the values for the scanner
     QRCodeDetector();
     ///@brief deconstructor
@@ -69,4 +104,4 @@ public:
 };
 
 
-#endif /* DETECTBARCODE_H_ */
+#endif /* QRCODEDETECTOR_H_ */
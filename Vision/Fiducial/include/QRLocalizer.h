@@ -0,0 +1,110 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Fiducial
+// File:           QRLocalizer.h
+// Description:    Locates QR codes by their finder patterns
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#ifndef QRLOCALIZER_H_
+#define QRLOCALIZER_H_
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+/*! \brief Locates QR codes before they are decoded.
+ *
+ *  Scanning a full frame for QR codes is slow, while the
+ *  codes only cover a small part of it. This class finds
+ *  the three finder patterns (the squares in the corners)
+ *  of each code on a downscaled, binarized copy of the
+ *  frame, so only the regions around them have to be
+ *  scanned at full resolution.
+ */
+class QRLocalizer {
+public:
+	//! Frames are downscaled until their longest side is at most this size
+	int maxSize;
+	//! Size of the neighbourhood used by the adaptive threshold
+	int blockSize;
+	//! A pixel is dark if it is this much darker than its neighbourhood
+	double offset;
+	//! Margin around a code in modules, includes the quiet zone
+	int padding;
+	//! Maximum amount of finder patterns combined into codes
+	unsigned int maxFinders;
+
+	/*! \brief A finder pattern
+	 */
+	struct Finder {
+		//! Center of the pattern, in frame coordinates
+		cv::Point2f center;
+		//! Size of a module (the smallest square of the code), in frame coordinates
+		float module;
+		//! Amount of rows the pattern was found on
+		int rows;
+	};
+
+	/*! \brief The QRLocalizer constructor
+	 *
+	 *  Constructs the localizer with default properties.
+	 *  The properties can be changed after construction.
+	 */
+	QRLocalizer(int maxSize = 640);
+
+	//! The QRLocalizer deconstructor
+	virtual ~QRLocalizer();
+
+	/*! \brief Finds the regions that contain a QR code
+	 *
+	 *  Groups the finder patterns in sets of three that
+	 *  form the corners of a code. Overlapping regions
+	 *  are merged.
+	 *
+	 *  \param gray 8 bit grayscale image
+	 *  \param regions Output vector for the regions, padded
+	 *  and clipped to the image
+	 *  \param finders Optional pointer to output vector for
+	 *  all finder patterns that were found
+	 */
+	void locate(const cv::Mat& gray, std::vector<cv::Rect>& regions, std::vector<Finder>* finders = NULL) const;
+
+	/*! \brief Finds the finder patterns
+	 *
+	 *  Every row of the binary image is searched for runs of
+	 *  dark and light pixels in the ratio 1:1:3:1:1, which is
+	 *  then verified along the column through its center.
+	 *
+	 *  \param binary Binary image, dark pixels are non-zero
+	 *  \param finders Output vector for the finder patterns,
+	 *  in the coordinates of the binary image
+	 */
+	void findFinders(const cv::Mat& binary, std::vector<Finder>& finders) const;
+};
+
+#endif /* QRLOCALIZER_H_ */
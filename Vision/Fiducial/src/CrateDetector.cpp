@@ -38,6 +38,7 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <vector>
 #include <set>
+#include <algorithm>
 
 CrateDetector::CrateDetector(int lowThreshold, int highThreshold) {
 	this->lowThreshold = lowThreshold;
@@ -47,6 +48,60 @@ CrateDetector::CrateDetector(int lowThreshold, int highThreshold) {
 CrateDetector::~CrateDetector() {
 }
 
+/*
+ * The points are put in a uniform grid, so for every contour only the
+ * points in the cells covered by its bounding box have to be tested.
+ */
+namespace {
+	const int GRID_CELL_SIZE = 32;
+
+	class PointGrid {
+	public:
+		PointGrid(const std::vector<cv::Point2f>& points, cv::Size size) : points(points) {
+			cols = std::max(1, (size.width + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+			rows = std::max(1, (size.height + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE);
+			cells.resize(cols * rows);
+			for(size_t i = 0; i < points.size(); i++) {
+				cells[cellY(points[i].y) * cols + cellX(points[i].x)].push_back(i);
+			}
+		}
+
+		//! Appends the indices of the points within rect, in the order of the points
+		void query(const cv::Rect& rect, std::vector<int>& indices) const {
+			indices.clear();
+			int x0 = cellX(rect.x), x1 = cellX(rect.x + rect.width);
+			int y0 = cellY(rect.y), y1 = cellY(rect.y + rect.height);
+			for(int y = y0; y <= y1; y++) {
+				for(int x = x0; x <= x1; x++) {
+					const std::vector<int>& cell = cells[y * cols + x];
+					for(std::vector<int>::const_iterator it = cell.begin(); it != cell.end(); ++it) {
+						const cv::Point2f& p = points[*it];
+						if(p.x >= rect.x && p.y >= rect.y && p.x <= rect.x + rect.width && p.y <= rect.y + rect.height) {
+							indices.push_back(*it);
+						}
+					}
+				}
+			}
+			std::sort(indices.begin(), indices.end());
+		}
+
+	private:
+		// points outside the image end up in the border cells
+		int cellX(float x) const {
+			return std::min(cols - 1, std::max(0, (int)x / GRID_CELL_SIZE));
+		}
+
+		int cellY(float y) const {
+			return std::min(rows - 1, std::max(0, (int)y / GRID_CELL_SIZE));
+		}
+
+		const std::vector<cv::Point2f>& points;
+		int cols;
+		int rows;
+		std::vector<std::vector<int> > cells;
+	};
+}
+
 void CrateDetector::detect(const cv::Mat& image, const std::vector<cv::Point2f>& points, std::vector<Crate>& crates, std::vector<cv::Point2f>* leftovers) {
 	cv::Mat canny;
 	cv::Canny(image, canny, lowThreshold, highThreshold);
@@ -54,31 +109,40 @@ void CrateDetector::detect(const cv::Mat& image, const std::vector<cv::Point2f>&
 	std::vector<std::vector<cv::Point> > contours;
 	cv::findContours(canny, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
 
-	std::vector<cv::Point2f> usedPoints;
+	PointGrid grid(points, image.size());
+	std::vector<bool> used(points.size(), false);
+	std::vector<int> candidates;
 
 	for (std::vector<std::vector<cv::Point> >::iterator it = contours.begin();
 			it != contours.end(); ++it) {
+		// A crate needs exactly three points inside its contour
+		grid.query(cv::boundingRect(*it), candidates);
+		if (candidates.size() < 3) {
+			continue;
+		}
+
 		std::vector<cv::Point2f> fiducials;
-		for (std::vector<cv::Point2f>::const_iterator point_it = points.begin();
-				point_it != points.end(); ++point_it) {
-			if (cv::pointPolygonTest(*it, *point_it, false) == 1) {
-				fiducials.push_back(*point_it);
+		std::vector<int> indices;
+		for (std::vector<int>::const_iterator index_it = candidates.begin();
+				index_it != candidates.end(); ++index_it) {
+			if (cv::pointPolygonTest(*it, points[*index_it], false) == 1) {
+				fiducials.push_back(points[*index_it]);
+				indices.push_back(*index_it);
 			}
 		}
 		if (fiducials.size() == 3) {
 			Crate::order(fiducials);
 			Crate crate(fiducials);
 			crates.push_back(crate);
-			usedPoints.insert(usedPoints.end(), fiducials.begin(), fiducials.end());
+			for (size_t i = 0; i < indices.size(); i++) {
+				used[indices[i]] = true;
+			}
 		}
 	}
 
 	if(leftovers != NULL) {
-		for(std::vector<cv::Point2f>::const_iterator it = points.begin();
-			it != points.end(); ++it) {
-			std::vector<cv::Point2f>::iterator used_it = usedPoints.begin();
-			for(; used_it!=usedPoints.end(); ++used_it) if(*it == *used_it) break;
-			if(used_it == usedPoints.end()) leftovers->push_back(*it);
+		for(size_t i = 0; i < points.size(); i++) {
+			if(!used[i]) leftovers->push_back(points[i]);
 		}
 	}
 }
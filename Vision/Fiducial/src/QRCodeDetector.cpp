@@ -34,21 +34,83 @@
 
 QRCodeDetector::QRCodeDetector() {
     scanner.set_config(zbar::ZBAR_QRCODE, zbar::ZBAR_CFG_ENABLE, 1);
+    localize = true;
+    fullScanInterval = 10;
+    framesSinceFullScan = 0;
+    fullScanNext = false;
 }
 
 QRCodeDetector::~QRCodeDetector() {}
 
-bool QRCodeDetector::detect(cv::Mat& image, std::string &result) {
-	try {
-		zbar::Image zbarImage(image.cols, image.rows, "Y800", (void*)image.data, image.cols * image.rows);
+void QRCodeDetector::scanImage(const cv::Mat& image, cv::Point offset, std::vector<Code>& codes) {
+	zbar::Image zbarImage(image.cols, image.rows, "Y800", (void*)image.data, image.cols * image.rows);
+
+	int amountOfScannedResults = scanner.scan(zbarImage);
+
+	if (amountOfScannedResults > 0) {
+		zbar::Image::SymbolIterator it = zbarImage.symbol_begin();
+		for(; it!=zbarImage.symbol_end(); ++it) {
+			Code code;
+			code.data = it->get_data();
+			for(int i = 0; i < it->get_location_size(); i++) {
+				code.location.push_back(cv::Point2f(it->get_location_x(i) + offset.x, it->get_location_y(i) + offset.y));
+			}
+			codes.push_back(code);
+		}
+	}
+}
+
+void QRCodeDetector::scan(cv::Mat& image, std::vector<Code>& codes) {
+	codes.clear();
+
+	if (localize) {
+		std::vector<cv::Rect> regions;
+		std::vector<QRLocalizer::Finder> finders;
+		localizer.locate(image, regions, &finders);
 
-		int amountOfScannedResults = scanner.scan(zbarImage);
+		std::vector<cv::Rect> decoded;
+		for(std::vector<cv::Rect>::iterator it = regions.begin(); it != regions.end(); ++it) {
+			size_t before = codes.size();
+			// zbar needs a continuous image
+			scanImage(image(*it).clone(), it->tl(), codes);
+			if (codes.size() > before) decoded.push_back(*it);
+		}
+
+		// A finder pattern outside the decoded regions may belong to
+		// a code that could not be located, only a full scan finds it.
+		bool explained = !decoded.empty();
+		for(std::vector<QRLocalizer::Finder>::iterator it = finders.begin(); explained && it != finders.end(); ++it) {
+			cv::Point center(cvRound(it->center.x), cvRound(it->center.y));
+			bool inside = false;
+			for(std::vector<cv::Rect>::iterator r = decoded.begin(); r != decoded.end() && !inside; ++r) {
+				inside = r->contains(center);
+			}
+			explained = inside;
+		}
+		// Frames without any decoded region are always rescanned. Otherwise
+		// leftover finder patterns get the whole image scanned on the next
+		// frame, so this frame still returns its codes without the delay of
+		// a full scan. Frames without leftovers are rescanned every
+		// fullScanInterval frames, for codes whose finders were not found.
+		if (!decoded.empty() && !fullScanNext && ++framesSinceFullScan < fullScanInterval) {
+			fullScanNext = !explained;
+			return;
+		}
+		codes.clear();
+	}
 
-		if (amountOfScannedResults) {
-			zbar::Image::SymbolIterator symbol = zbarImage.symbol_begin();
+	framesSinceFullScan = 0;
+	fullScanNext = false;
+	scanImage(image, cv::Point(0, 0), codes);
+}
 
-			result = symbol->get_data();
+bool QRCodeDetector::detect(cv::Mat& image, std::string &result) {
+	try {
+		std::vector<Code> codes;
+		scan(image, codes);
 
+		if (!codes.empty()) {
+			result = codes.front().data;
 		} else {
 			return false;
 		}
@@ -60,30 +122,28 @@ bool QRCodeDetector::detect(cv::Mat& image, std::string &result) {
 
 void QRCodeDetector::detectCrates(cv::Mat& image, std::vector<Crate> &crates, cv::TermCriteria criteria) {
 	try {
-		zbar::Image zbarImage(image.cols, image.rows, "Y800", (void*)image.data, image.cols * image.rows);
+		std::vector<Code> codes;
+		scan(image, codes);
 
-		int amountOfScannedResults = scanner.scan(zbarImage);
+		for(std::vector<Code>::iterator it = codes.begin(); it!=codes.end(); ++it) {
+			if (it->location.size() < 4) continue;
 
-		if (amountOfScannedResults > 0) {
-			zbar::Image::SymbolIterator it = zbarImage.symbol_begin();
-			for(; it!=zbarImage.symbol_end(); ++it) {
-				std::vector<cv::Point2f> points;
-				points.push_back(cv::Point2f(it->get_location_x(1), it->get_location_y(1)));
-				points.push_back(cv::Point2f(it->get_location_x(0), it->get_location_y(0)));
-				points.push_back(cv::Point2f(it->get_location_x(3), it->get_location_y(3)));
+			std::vector<cv::Point2f> points;
+			points.push_back(it->location[1]);
+			points.push_back(it->location[0]);
+			points.push_back(it->location[3]);
 
-				//std::cout << "Before: " << points << std::endl;
+			//std::cout << "Before: " << points << std::endl;
 
-				// Refine to subpixel-percision
-				// TODO: Utilize more corners to improve robustness and precision
-				float distance = Crate::distance(points[0], points[2]);
-				float windowsSize = 2.0*(distance/130.0);
-				cv::cornerSubPix(image, points, cv::Size(windowsSize,windowsSize), cv::Size(-1,-1), criteria);
+			// Refine to subpixel-percision
+			// TODO: Utilize more corners to improve robustness and precision
+			float distance = Crate::distance(points[0], points[2]);
+			float windowsSize = 2.0*(distance/130.0);
+			cv::cornerSubPix(image, points, cv::Size(windowsSize,windowsSize), cv::Size(-1,-1), criteria);
 
-				//std::cout << "After: " << points << std::endl;
+			//std::cout << "After: " << points << std::endl;
 
-				crates.push_back(Crate(it->get_data(), points));
-			}
+			crates.push_back(Crate(it->data, points));
 		}
 	} catch (std::exception &e) {
 		return;
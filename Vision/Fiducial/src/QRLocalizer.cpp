@@ -0,0 +1,289 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Fiducial
+// File:           QRLocalizer.cpp
+// Description:    Locates QR codes by their finder patterns
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "QRLocalizer.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Checks the 1:1:3:1:1 ratio of the dark, light, dark, light and dark runs
+	bool isFinderRatio(const int runs[5], float& module) {
+		int total = runs[0] + runs[1] + runs[2] + runs[3] + runs[4];
+		if (total < 7) {
+			return false;
+		}
+		module = total / 7.0f;
+		float variance = module / 2.0f;
+		return std::fabs(module - runs[0]) < variance
+				&& std::fabs(module - runs[1]) < variance
+				&& std::fabs(3.0f * module - runs[2]) < 3.0f * variance
+				&& std::fabs(module - runs[3]) < variance
+				&& std::fabs(module - runs[4]) < variance;
+	}
+
+	// Measures the runs in column x around row y, which lies in the center run
+	bool crossCheckVertical(const cv::Mat& binary, int x, int y, int maxRun, float& centerY, float& module) {
+		int runs[5] = { 0, 0, 0, 0, 0 };
+
+		int i = y;
+		while (i >= 0 && binary.at<uchar>(i, x)) {
+			runs[2]++;
+			i--;
+		}
+		while (i >= 0 && !binary.at<uchar>(i, x) && runs[1] <= maxRun) {
+			runs[1]++;
+			i--;
+		}
+		if (i < 0 || runs[1] > maxRun) {
+			return false;
+		}
+		while (i >= 0 && binary.at<uchar>(i, x) && runs[0] <= maxRun) {
+			runs[0]++;
+			i--;
+		}
+
+		int j = y + 1;
+		while (j < binary.rows && binary.at<uchar>(j, x)) {
+			runs[2]++;
+			j++;
+		}
+		while (j < binary.rows && !binary.at<uchar>(j, x) && runs[3] <= maxRun) {
+			runs[3]++;
+			j++;
+		}
+		if (j == binary.rows || runs[3] > maxRun) {
+			return false;
+		}
+		while (j < binary.rows && binary.at<uchar>(j, x) && runs[4] <= maxRun) {
+			runs[4]++;
+			j++;
+		}
+
+		if (runs[0] > maxRun || runs[4] > maxRun || !isFinderRatio(runs, module)) {
+			return false;
+		}
+		centerY = (j - runs[4] - runs[3]) - runs[2] / 2.0f;
+		return true;
+	}
+
+	bool moreRows(const QRLocalizer::Finder& a, const QRLocalizer::Finder& b) {
+		return a.rows > b.rows;
+	}
+
+	float squaredDistance(const cv::Point2f& a, const cv::Point2f& b) {
+		float dx = a.x - b.x, dy = a.y - b.y;
+		return dx * dx + dy * dy;
+	}
+}
+
+QRLocalizer::QRLocalizer(int maxSize) {
+	this->maxSize = maxSize;
+	blockSize = 81;
+	offset = 10;
+	padding = 6;
+	maxFinders = 30;
+}
+
+QRLocalizer::~QRLocalizer() {
+}
+
+void QRLocalizer::findFinders(const cv::Mat& binary, std::vector<Finder>& finders) const {
+	finders.clear();
+	std::vector<int> edges;
+
+	for (int y = 0; y < binary.rows; y++) {
+		// Split the row into runs, run r lies between edges r and r + 1
+		const uchar* row = binary.ptr<uchar>(y);
+		edges.clear();
+		edges.push_back(0);
+		for (int x = 1; x < binary.cols; x++) {
+			if ((row[x] != 0) != (row[x - 1] != 0)) {
+				edges.push_back(x);
+			}
+		}
+		edges.push_back(binary.cols);
+
+		// Runs alternate, so every other run is dark
+		for (size_t r = (row[0] != 0) ? 0 : 1; r + 5 < edges.size(); r += 2) {
+			int runs[5];
+			for (int k = 0; k < 5; k++) {
+				runs[k] = edges[r + k + 1] - edges[r + k];
+			}
+
+			float module;
+			if (!isFinderRatio(runs, module)) {
+				continue;
+			}
+
+			float centerX = edges[r + 2] + runs[2] / 2.0f;
+			float centerY, verticalModule;
+			if (!crossCheckVertical(binary, (int)centerX, y, (int)(7 * module), centerY, verticalModule)
+					|| std::fabs(verticalModule - module) >= 0.4f * module) {
+				continue;
+			}
+			module = (module + verticalModule) / 2.0f;
+
+			// The rows through one pattern are averaged
+			std::vector<Finder>::iterator it = finders.begin();
+			for (; it != finders.end(); ++it) {
+				if (std::fabs(it->center.x - centerX) <= it->module && std::fabs(it->center.y - centerY) <= it->module) {
+					float weight = 1.0f / (it->rows + 1);
+					it->center.x += (centerX - it->center.x) * weight;
+					it->center.y += (centerY - it->center.y) * weight;
+					it->module += (module - it->module) * weight;
+					it->rows++;
+					break;
+				}
+			}
+			if (it == finders.end()) {
+				Finder finder;
+				finder.center = cv::Point2f(centerX, centerY);
+				finder.module = module;
+				finder.rows = 1;
+				finders.push_back(finder);
+			}
+		}
+	}
+}
+
+void QRLocalizer::locate(const cv::Mat& gray, std::vector<cv::Rect>& regions, std::vector<Finder>* finders) const {
+	regions.clear();
+	if (gray.empty()) {
+		return;
+	}
+
+	cv::Mat small = gray;
+	int longest = std::max(gray.cols, gray.rows);
+	if (longest > maxSize) {
+		double scale = (double)maxSize / longest;
+		cv::resize(gray, small, cv::Size(cvRound(gray.cols * scale), cvRound(gray.rows * scale)), 0, 0, cv::INTER_AREA);
+	}
+	float scaleX = (float)gray.cols / small.cols;
+	float scaleY = (float)gray.rows / small.rows;
+
+	cv::Mat binary;
+	cv::adaptiveThreshold(small, binary, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV, blockSize | 1, offset);
+
+	std::vector<Finder> found;
+	findFinders(binary, found);
+
+	// A pattern that is found on a single row is most likely noise
+	std::vector<Finder> patterns;
+	for (std::vector<Finder>::iterator it = found.begin(); it != found.end(); ++it) {
+		if (it->rows >= 2) {
+			it->center.x *= scaleX;
+			it->center.y *= scaleY;
+			it->module *= (scaleX + scaleY) / 2.0f;
+			patterns.push_back(*it);
+		}
+	}
+	std::sort(patterns.begin(), patterns.end(), moreRows);
+	if (patterns.size() > maxFinders) {
+		patterns.resize(maxFinders);
+	}
+	if (finders != NULL) {
+		*finders = patterns;
+	}
+
+	// Three patterns form the corners of a code: a right angled,
+	// isosceles triangle of at least 14 (version 1) and at most
+	// 170 (version 40) modules wide. The modules of a rotated code
+	// are measured up to 1.4 times too large, so the minimum is lower.
+	cv::Rect bounds(0, 0, gray.cols, gray.rows);
+	for (size_t i = 0; i < patterns.size(); i++) {
+		for (size_t j = i + 1; j < patterns.size(); j++) {
+			for (size_t k = j + 1; k < patterns.size(); k++) {
+				const Finder* p[3] = { &patterns[i], &patterns[j], &patterns[k] };
+				float minModule = std::min(p[0]->module, std::min(p[1]->module, p[2]->module));
+				float maxModule = std::max(p[0]->module, std::max(p[1]->module, p[2]->module));
+				if (maxModule > 1.5f * minModule) {
+					continue;
+				}
+
+				// The corner lies opposite of the longest side
+				float d[3] = {
+					squaredDistance(p[1]->center, p[2]->center),
+					squaredDistance(p[0]->center, p[2]->center),
+					squaredDistance(p[0]->center, p[1]->center)
+				};
+				int corner = (d[0] >= d[1] && d[0] >= d[2]) ? 0 : (d[1] >= d[2] ? 1 : 2);
+				float hypotenuse = d[corner];
+				float leg1 = d[(corner + 1) % 3];
+				float leg2 = d[(corner + 2) % 3];
+				if (std::min(leg1, leg2) < 0.5f * std::max(leg1, leg2)
+						|| std::fabs(hypotenuse - leg1 - leg2) > 0.3f * hypotenuse) {
+					continue;
+				}
+				float module = (p[0]->module + p[1]->module + p[2]->module) / 3.0f;
+				float width = (std::sqrt(leg1) + std::sqrt(leg2)) / 2.0f / module;
+				if (width < 9 || width > 180) {
+					continue;
+				}
+
+				// The fourth corner completes the parallelogram
+				const cv::Point2f& a = p[corner]->center;
+				const cv::Point2f& b = p[(corner + 1) % 3]->center;
+				const cv::Point2f& c = p[(corner + 2) % 3]->center;
+				cv::Point2f e(b.x + c.x - a.x, b.y + c.y - a.y);
+				float left = std::min(std::min(a.x, b.x), std::min(c.x, e.x));
+				float right = std::max(std::max(a.x, b.x), std::max(c.x, e.x));
+				float top = std::min(std::min(a.y, b.y), std::min(c.y, e.y));
+				float bottom = std::max(std::max(a.y, b.y), std::max(c.y, e.y));
+
+				// The centers lie 3.5 modules from the edge of the code
+				float pad = (3.5f + padding) * module;
+				cv::Rect region(cvFloor(left - pad), cvFloor(top - pad),
+						cvCeil(right - left + 2 * pad), cvCeil(bottom - top + 2 * pad));
+				region &= bounds;
+				if (region.area() > 0) {
+					regions.push_back(region);
+				}
+			}
+		}
+	}
+
+	// Merge overlapping regions, so every code is scanned once
+	for (bool merged = true; merged;) {
+		merged = false;
+		for (size_t i = 0; i < regions.size() && !merged; i++) {
+			for (size_t j = i + 1; j < regions.size() && !merged; j++) {
+				if ((regions[i] & regions[j]).area() > 0) {
+					regions[i] |= regions[j];
+					regions.erase(regions.begin() + j);
+					merged = true;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,419 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FiducialTuner
+// File:           main.cpp
+// Description:    Searches FiducialDetector settings on an annotated test set
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <imageMetaData/Types.hpp>
+#include <imageMetaData/MetaDataStore.hpp>
+#include <imageMetaData/Evaluator.hpp>
+#include <report/Report.hpp>
+#include <report/ReportList.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include "FiducialDetector.h"
+
+#ifdef __CDT_PARSER__
+#define foreach(a, b) for(a : b)
+#else
+#define foreach(a, b) BOOST_FOREACH(a, b)
+#endif
+
+#define MAX_DEVIATION 5
+#define MAX_DISTANCE 50
+// Part of the set used to decide whether a setting is worth a full run
+#define PROBE_FRACTION 0.2
+#define PROBE_MIN_IMAGES 10
+// A setting is pruned when its probe accuracy is this much below the best accuracy
+#define PRUNE_MARGIN 0.1
+#define RANDOM_SEED 1
+
+using namespace std;
+using namespace imageMetaData;
+using namespace report;
+
+/**
+ * The FiducialDetector properties that are searched
+ */
+struct Settings {
+	int minRad;
+	int maxRad;
+	int circleVotes;
+	int lineVotes;
+	int lowThreshold;
+	int highThreshold;
+};
+
+/**
+ * Range of a single property: min, max and step size
+ */
+struct Range {
+	int min;
+	int max;
+	int step;
+};
+
+// Search space, in the same order as Settings
+const Range ranges[] = {
+	{ 15, 25, 5 },		// minRad
+	{ 35, 45, 5 },		// maxRad
+	{ 60, 140, 20 },	// circleVotes
+	{ 5, 15, 5 },		// lineVotes
+	{ 75, 175, 50 },	// lowThreshold
+	{ 200, 400, 100 }	// highThreshold
+};
+const int numRanges = sizeof(ranges) / sizeof(ranges[0]);
+
+/**
+ * Result of a single image
+ */
+struct Score {
+	bool correct;
+	double deviation;
+	double ms;
+};
+
+/**
+ * Result of a single setting over the test set
+ */
+struct Outcome {
+	Settings settings;
+	bool pruned;
+	int images;
+	int correct;
+	double deviation;
+	double ms;
+
+	double accuracy() const {
+		return images == 0 ? 0 : correct / (double)images;
+	}
+};
+
+typedef map<string, vector<cv::Point2f> > TargetMap;
+
+bool isValid(const Settings& s){
+	return s.minRad < s.maxRad && s.lowThreshold < s.highThreshold;
+}
+
+Settings fromValues(const int* values){
+	Settings s = { values[0], values[1], values[2], values[3], values[4], values[5] };
+	return s;
+}
+
+/**
+ * Creates every valid combination of the ranges
+ */
+vector<Settings> gridSearch(){
+	vector<Settings> settings;
+	int values[numRanges];
+	for(int i = 0; i < numRanges; i++){
+		values[i] = ranges[i].min;
+	}
+
+	for(;;){
+		Settings s = fromValues(values);
+		if(isValid(s)){
+			settings.push_back(s);
+		}
+
+		int i = 0;
+		while(i < numRanges && (values[i] += ranges[i].step) > ranges[i].max){
+			values[i] = ranges[i].min;
+			i++;
+		}
+		if(i == numRanges){
+			break;
+		}
+	}
+	return settings;
+}
+
+/**
+ * Draws count valid settings from the ranges
+ */
+vector<Settings> randomSearch(int count){
+	vector<Settings> settings;
+	srand(RANDOM_SEED);
+	while((int)settings.size() < count){
+		int values[numRanges];
+		for(int i = 0; i < numRanges; i++){
+			int steps = (ranges[i].max - ranges[i].min) / ranges[i].step + 1;
+			values[i] = ranges[i].min + (rand() % steps) * ranges[i].step;
+		}
+		Settings s = fromValues(values);
+		if(isValid(s)){
+			settings.push_back(s);
+		}
+	}
+	return settings;
+}
+
+/**
+ * Collects the annotated fiducial positions of every image.
+ * Both the fidN.x (Fiducial test set) and fidN_x (FiducialROS) names are accepted.
+ */
+TargetMap getTargets(const MetaDataStore& store){
+	TargetMap targets;
+	for(size_t i = 0; i < store.size(); i++){
+		MetaDataStore::Image img = store.image(i);
+		vector<cv::Point2f>& points = targets[img.path()];
+		for(size_t o = 0; o < img.objectCount(); o++){
+			MetaDataStore::Properties object = img.object(o);
+			for(int n = 1; n <= 3; n++){
+				const char* formats[] = { "fid%d.x", "fid%d_x" };
+				foreach(const char* format, formats){
+					char name[16];
+					sprintf(name, format, n);
+					MetaDataStore::Key x = store.key(name);
+					name[strlen(name) - 1] = 'y';
+					MetaDataStore::Key y = store.key(name);
+					if(object.has(x) && object.has(y)){
+						points.push_back(cv::Point2f(object.getDouble(x), object.getDouble(y)));
+					}
+				}
+			}
+		}
+	}
+	return targets;
+}
+
+cv::Mat readGray(const string& path){
+	cv::Mat image = cv::imread(path, CV_LOAD_IMAGE_GRAYSCALE);
+	if(!image.data){
+		throw runtime_error("can not read " + path);
+	}
+	return image;
+}
+
+/**
+ * Runs the detector with the given settings on one image.
+ * Called concurrently by the evaluator, so every call uses its own detector.
+ */
+bool testImage(const Settings& s, const TargetMap& targets,
+		const ImageMD& img, const cv::Mat& gray, Score& score){
+	FiducialDetector detector(s.minRad, s.maxRad);
+	detector.circleVotes = s.circleVotes;
+	detector.lineVotes = s.lineVotes;
+	detector.lowThreshold = s.lowThreshold;
+	detector.highThreshold = s.highThreshold;
+
+	cv::Mat image = gray;
+	vector<cv::Point2f> points;
+	boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+	detector.detect(image, points);
+	score.ms = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() / 1000.0;
+
+	const vector<cv::Point2f>& expected = targets.find(img.path)->second;
+	int matched = 0;
+	score.deviation = 0;
+	foreach(const cv::Point2f& target, expected){
+		double best = MAX_DISTANCE;
+		foreach(const cv::Point2f& point, points){
+			double d = sqrt((point.x - target.x) * (point.x - target.x) + (point.y - target.y) * (point.y - target.y));
+			best = min(best, d);
+		}
+		if(best < MAX_DISTANCE){
+			matched++;
+			score.deviation = max(score.deviation, best);
+		}
+	}
+
+	score.correct = matched == (int)expected.size() && points.size() == expected.size()
+			&& score.deviation <= MAX_DEVIATION;
+	return score.correct;
+}
+
+void accumulate(Outcome& outcome, const map<string, Score>& scores){
+	typedef pair<string, Score> ImageScore;
+	foreach(const ImageScore& s, scores){
+		outcome.deviation = (outcome.deviation * outcome.images + s.second.deviation) / (outcome.images + 1);
+		outcome.ms = (outcome.ms * outcome.images + s.second.ms) / (outcome.images + 1);
+		outcome.images++;
+		if(s.second.correct){
+			outcome.correct++;
+		}
+	}
+}
+
+/**
+ * Counts the failures of the last run of the evaluator per image
+ */
+void collectFailures(const Evaluator<cv::Mat, Score>& evaluator, map<string, int>& failures){
+	foreach(const string& failure, evaluator.getFailures()){
+		failures[failure]++;
+	}
+}
+
+/**
+ * Evaluates a setting on the probe set, and on the rest of the set
+ * when the probe accuracy is close enough to the best accuracy so far
+ */
+Outcome evaluate(Evaluator<cv::Mat, Score>& evaluator, const Settings& settings, const TargetMap& targets,
+		const vector<ImageMD>& probe, const vector<ImageMD>& rest, double bestAccuracy,
+		map<string, int>& failures){
+	Outcome outcome = { settings, false, 0, 0, 0, 0 };
+	Evaluator<cv::Mat, Score>::Test test = boost::bind(testImage, settings, boost::cref(targets), _1, _2, _3);
+
+	map<string, Score> scores;
+	evaluator.run(probe, test, &scores);
+	collectFailures(evaluator, failures);
+	accumulate(outcome, scores);
+	if(outcome.accuracy() + PRUNE_MARGIN < bestAccuracy){
+		outcome.pruned = true;
+		return outcome;
+	}
+
+	scores.clear();
+	evaluator.run(rest, test, &scores);
+	collectFailures(evaluator, failures);
+	accumulate(outcome, scores);
+	return outcome;
+}
+
+bool fasterThan(const Outcome& lhs, const Outcome& rhs){
+	return lhs.ms < rhs.ms;
+}
+
+/**
+ * Returns the settings for which no other setting is both faster and more accurate
+ */
+vector<Outcome> paretoFront(vector<Outcome> outcomes){
+	sort(outcomes.begin(), outcomes.end(), fasterThan);
+	vector<Outcome> front;
+	foreach(const Outcome& o, outcomes){
+		if(!o.pruned && (front.empty() || o.accuracy() > front.back().accuracy())){
+			front.push_back(o);
+		}
+	}
+	return front;
+}
+
+ReportList* outcomeList(const char* name, const vector<Outcome>& outcomes){
+	ReportList* list = new ReportList(name, 10, INT, INT, INT, INT, INT, INT, INT, DOUBLE, DOUBLE, DOUBLE);
+	list->setColumnNames("Min radius", "Max radius", "Circle votes", "Line votes", "Low threshold",
+			"High threshold", "Images", "Accuracy", "Mean deviation", "ms per image");
+	foreach(const Outcome& o, outcomes){
+		list->appendRow(o.settings.minRad, o.settings.maxRad, o.settings.circleVotes, o.settings.lineVotes,
+				o.settings.lowThreshold, o.settings.highThreshold, o.images,
+				o.accuracy(), o.deviation, o.ms);
+	}
+	return list;
+}
+
+int main(int argc, char** argv){
+	if(argc < 2){
+		cout << "Usage: " << argv[0] << " <xml path> [grid | random <count>] [report path]\n";
+		return 1;
+	}
+
+	cout << setiosflags(ios::left) << setiosflags(ios::fixed) << setprecision(3);
+
+	// Choose the settings to search
+	vector<Settings> settings;
+	int argReport = 3;
+	if(argc > 3 && strcmp(argv[2], "random") == 0){
+		settings = randomSearch(atoi(argv[3]));
+		argReport = 4;
+	} else {
+		settings = gridSearch();
+	}
+	string reportPath = argc > argReport ? argv[argReport] : "FiducialTuner.html";
+
+	// Always evaluate the default settings first, so there is a baseline for pruning
+	FiducialDetector defaults;
+	Settings defaultSettings = { defaults.minRad, defaults.maxRad, defaults.circleVotes,
+			defaults.lineVotes, (int)defaults.lowThreshold, (int)defaults.highThreshold };
+	settings.insert(settings.begin(), defaultSettings);
+
+	// Load the set once, split it in a probe part and the rest
+	MetaDataStore store;
+	store.load(argv[1]);
+	TargetMap targets = getTargets(store);
+	vector<ImageMD> images = store.toImageMD();
+	srand(RANDOM_SEED);
+	random_shuffle(images.begin(), images.end());
+	size_t probeSize = min(images.size(), max((size_t)PROBE_MIN_IMAGES, (size_t)(images.size() * PROBE_FRACTION)));
+	vector<ImageMD> probe(images.begin(), images.begin() + probeSize);
+	vector<ImageMD> rest(images.begin() + probeSize, images.end());
+
+	// The decoded images stay cached in the evaluator between settings
+	Evaluator<cv::Mat, Score> evaluator(readGray);
+
+	vector<Outcome> outcomes;
+	map<string, int> failures;
+	double bestAccuracy = 0;
+	int pruned = 0;
+	for(size_t i = 0; i < settings.size(); i++){
+		Outcome o = evaluate(evaluator, settings[i], targets, probe, rest, bestAccuracy, failures);
+		outcomes.push_back(o);
+		if(o.pruned){
+			pruned++;
+		} else {
+			bestAccuracy = max(bestAccuracy, o.accuracy());
+		}
+		cout << "Setting " << setw(6) << i + 1 << "/" << settings.size()
+				<< (o.pruned ? " pruned   " : " accuracy ") << o.accuracy()
+				<< " ms " << o.ms << endl;
+	}
+
+	// Failures of every run, not only the last one
+	for(map<string, int>::const_iterator it = failures.begin(); it != failures.end(); ++it){
+		cout << "Image " << it->first << " could not be read or tested in "
+				<< it->second << " runs" << endl;
+	}
+
+	//========================================================================
+	// Create the report
+	//========================================================================
+	Report r("FiducialDetector tuning");
+	stringstream desc;
+	desc << settings.size() << " settings on " << images.size() << " images, "
+			<< pruned << " pruned after " << probe.size() << " images";
+	r.setDescription(desc.str());
+	r.addField(outcomeList("Pareto front (accuracy versus runtime)", paretoFront(outcomes)));
+	r.addField(outcomeList("All settings", outcomes));
+	r.saveHTML(reportPath);
+
+	cout << "Report written to " << reportPath << endl;
+	return 0;
+}
@@ -0,0 +1,80 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           FrameRecorder.h
+// Description:    Records frames to a directory that ReplaySource can replay
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <FrameSource/FrameSource.h>
+#include <fstream>
+#include <string>
+
+namespace framesource
+{
+	/**
+	 * @brief writes frames and their capture times to a directory
+	 *
+	 * Frames are written as frame000000<extension>, frame000001<extension>, ...
+	 * and their timestamps are appended to timestamps.txt, so the directory
+	 * can be replayed with ReplaySource at the recorded rate.
+	 **/
+	class FrameRecorder
+	{
+		private:
+			std::string directory;
+			std::string extension;
+			std::ofstream timestamps;
+			size_t count;
+
+		public:
+			/**
+			 * @brief creates the directory if needed and starts a new recording in it
+			 * @param directory the directory to write to
+			 * @param extension image format of the frames, ".png" is lossless
+			 * @throw FrameSourceException if the directory can not be written
+			 **/
+			FrameRecorder(const std::string& directory, const std::string& extension = ".png");
+
+			/**
+			 * @brief write a frame
+			 * @param frame the frame
+			 * @param timestamp the time the frame was captured
+			 * @throw FrameSourceException if the frame could not be written
+			 **/
+			void record(const cv::Mat& frame, const boost::posix_time::ptime& timestamp);
+
+			/**
+			 * @brief get the amount of recorded frames
+			 * @return frame count
+			 **/
+			size_t get_count(void) { return count; }
+	};
+}
@@ -0,0 +1,93 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           FrameSource.h
+// Description:    Common interface for everything that produces camera frames
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <opencv2/core/core.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <stdexcept>
+#include <string>
+
+namespace framesource
+{
+	/**
+	 * @brief frame source exception
+	 **/
+	class FrameSourceException : public std::runtime_error
+	{
+		public:
+			FrameSourceException(const std::string& msg) : std::runtime_error(msg) {}
+			virtual ~FrameSourceException(void) throw() {}
+	};
+
+	/**
+	 * @brief a source of frames: a camera, a video file or a recording.
+	 *
+	 * Pipelines take frames from a FrameSource instead of a specific camera
+	 * class, so they can run on recorded material without any hardware.
+	 **/
+	class FrameSource
+	{
+		public:
+			virtual ~FrameSource(void) {}
+
+			/**
+			 * @brief get the next frame
+			 *
+			 * this function blocks until a new frame is available
+			 * @param frame the frame is copied into this matrix, it is (re)allocated when needed
+			 * @param timestamp if not NULL, receives the time the frame was captured
+			 * @return false if the source has no more frames, true otherwise
+			 * @throw FrameSourceException if the frame could not be read
+			 **/
+			virtual bool get_frame(cv::Mat& frame, boost::posix_time::ptime* timestamp = NULL) = 0;
+
+			/**
+			 * @brief get the size of the frames
+			 * @return frame size
+			 **/
+			virtual cv::Size get_size(void) = 0;
+
+			/**
+			 * @brief get the format of the frames
+			 * @return frame format, e.g. CV_8UC3
+			 **/
+			virtual int get_format(void) { return CV_8UC3; }
+
+			/**
+			 * @brief whether the frames come from a live camera
+			 * @return true for cameras, false for recordings
+			 **/
+			virtual bool is_live(void) { return true; }
+	};
+}
@@ -0,0 +1,123 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           ReplaySource.h
+// Description:    Frame source replaying an image directory or a video file
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <FrameSource/FrameSource.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <string>
+#include <vector>
+
+namespace framesource
+{
+	/**
+	 * @brief replays recorded frames as if they came from a camera
+	 *
+	 * The source is either a directory of images, replayed in file name order,
+	 * or a video file. The capture time of every frame is read from a
+	 * timestamp file, as written by FrameRecorder:
+	 *  - for a directory: timestamps.txt in that directory, one "<file name> <seconds>" line per frame
+	 *  - for a video: <video path>.timestamps, one "<frame number> <seconds>" line per frame
+	 * seconds are counted from 1970-01-01 00:00 UTC. Frames without a timestamp
+	 * get one at a fixed interval (the video frame rate, or 30 fps for images)
+	 * after the previous frame, so replays are deterministic.
+	 **/
+	class ReplaySource : public FrameSource
+	{
+		public:
+			/**
+			 * @brief rate to replay frames without waiting
+			 **/
+			static const double AS_FAST_AS_POSSIBLE;
+
+			/**
+			 * @brief rate to replay frames with the intervals they were recorded with
+			 **/
+			static const double RECORDED_RATE;
+
+			/**
+			 * @brief opens a recording
+			 * @param path image directory or video file
+			 * @param rate frames per second, AS_FAST_AS_POSSIBLE or RECORDED_RATE
+			 * @param loop start over at the end of the recording instead of returning false
+			 * @param preload decode all frames up front, so decoding does not count towards the time of the pipeline
+			 * @throw FrameSourceException if the recording can not be opened or has no frames
+			 **/
+			ReplaySource(const std::string& path, double rate = RECORDED_RATE, bool loop = false, bool preload = false);
+
+			virtual bool get_frame(cv::Mat& frame, boost::posix_time::ptime* timestamp = NULL);
+			virtual cv::Size get_size(void);
+			virtual int get_format(void);
+			virtual bool is_live(void) { return false; }
+
+			/**
+			 * @brief get the amount of frames in the recording
+			 * @return frame count
+			 **/
+			size_t get_frame_count(void);
+
+			/**
+			 * @brief get the number of frames returned so far, including previous loops
+			 * @return frame number
+			 **/
+			size_t get_position(void);
+
+			/**
+			 * @brief restart the replay at the first frame
+			 **/
+			void rewind(void);
+
+		private:
+			std::string path;
+			double rate;
+			bool loop;
+
+			std::vector<std::string> files;
+			cv::VideoCapture video;
+			std::vector<cv::Mat> frames;
+			std::vector<boost::posix_time::ptime> timestamps;
+			boost::posix_time::time_duration interval;
+
+			cv::Size size;
+			int format;
+			size_t count;
+			size_t position;
+			boost::posix_time::ptime start;
+
+			void open_directory(void);
+			void open_video(void);
+			void read_timestamps(const std::string& file, const std::vector<std::string>& names);
+			bool read_frame(size_t index, cv::Mat& frame);
+			void wait_for(size_t pass, size_t index);
+	};
+}
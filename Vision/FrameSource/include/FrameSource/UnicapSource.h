@@ -0,0 +1,98 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           UnicapSource.h
+// Description:    Frame source for unicap cameras
+// Author:         agent
+// Notes:          Header only, link with unicap_cv_bridge when using it
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <FrameSource/FrameSource.h>
+#include <unicap_cv_bridge.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+namespace framesource
+{
+	/**
+	 * @brief frame source for a unicap camera
+	 **/
+	class UnicapSource : public FrameSource
+	{
+		private:
+			unicap_cv_bridge::unicap_cv_camera cam;
+
+		public:
+			/**
+			 * @brief opens a unicap camera
+			 * @param dev device number
+			 * @param format format number
+			 * @throw unicap_cv_bridge::unicap_cv_exception if the camera can not be opened
+			 **/
+			UnicapSource(int dev, int format) : cam(dev, format) {}
+
+			/**
+			 * @brief get the underlying camera, for exposure and white balance settings
+			 * @return the camera
+			 **/
+			unicap_cv_bridge::unicap_cv_camera& get_camera(void) { return cam; }
+
+			virtual bool get_frame(cv::Mat& frame, boost::posix_time::ptime* timestamp = NULL)
+			{
+				frame.create(get_size(), get_format());
+				cam.get_frame(&frame);
+				if (timestamp != NULL)
+				{
+					*timestamp = boost::posix_time::microsec_clock::universal_time();
+				}
+				return true;
+			}
+
+			/**
+			 * @brief get the next frame as BGR and as gray, converted in a single pass
+			 * @param frame the BGR frame is copied into this matrix
+			 * @param gray the gray frame is copied into this matrix
+			 * @param timestamp if not NULL, receives the time the frame was captured
+			 * @return true
+			 **/
+			bool get_frame(cv::Mat& frame, cv::Mat& gray, boost::posix_time::ptime* timestamp = NULL)
+			{
+				frame.create(get_size(), get_format());
+				gray.create(get_size(), CV_8UC1);
+				cam.get_frame(&frame, &gray);
+				if (timestamp != NULL)
+				{
+					*timestamp = boost::posix_time::microsec_clock::universal_time();
+				}
+				return true;
+			}
+
+			virtual cv::Size get_size(void) { return cv::Size(cam.get_img_width(), cam.get_img_height()); }
+			virtual int get_format(void) { return cam.get_img_format(); }
+	};
+}
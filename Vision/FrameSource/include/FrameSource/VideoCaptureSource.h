@@ -0,0 +1,66 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           VideoCaptureSource.h
+// Description:    Frame source reading from an OpenCV VideoCapture device
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <FrameSource/FrameSource.h>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace framesource
+{
+	/**
+	 * @brief frame source for cameras supported by cv::VideoCapture (v4l, webcams)
+	 **/
+	class VideoCaptureSource : public FrameSource
+	{
+		private:
+			cv::VideoCapture cam;
+
+		public:
+			/**
+			 * @brief opens a camera
+			 * @param device device number
+			 * @throw FrameSourceException if the camera can not be opened
+			 **/
+			VideoCaptureSource(int device);
+
+			/**
+			 * @brief get the underlying capture, to set capture properties
+			 * @return the capture
+			 **/
+			cv::VideoCapture& get_capture(void) { return cam; }
+
+			virtual bool get_frame(cv::Mat& frame, boost::posix_time::ptime* timestamp = NULL);
+			virtual cv::Size get_size(void);
+	};
+}
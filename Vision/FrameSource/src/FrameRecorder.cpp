@@ -0,0 +1,71 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           FrameRecorder.cpp
+// Description:    Records frames to a directory that ReplaySource can replay
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <FrameSource/FrameRecorder.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <cstdio>
+
+namespace framesource
+{
+FrameRecorder::FrameRecorder(const std::string& directory, const std::string& extension) :
+	directory(directory), extension(extension), count(0)
+{
+	boost::filesystem::create_directories(directory);
+	std::string file = (boost::filesystem::path(directory) / "timestamps.txt").string();
+	timestamps.open(file.c_str(), std::ios::out | std::ios::trunc);
+	if (!timestamps)
+	{
+		throw FrameSourceException("Failed to create " + file);
+	}
+}
+
+void FrameRecorder::record(const cv::Mat& frame, const boost::posix_time::ptime& timestamp)
+{
+	char name[32];
+	sprintf(name, "frame%06lu", (unsigned long)count);
+	std::string file = name + extension;
+
+	if (!cv::imwrite((boost::filesystem::path(directory) / file).string(), frame))
+	{
+		throw FrameSourceException("Failed to write " + file);
+	}
+
+	boost::posix_time::time_duration since_epoch = timestamp - boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1));
+	char seconds[32];
+	sprintf(seconds, "%ld.%06ld", (long)since_epoch.total_seconds(), (long)(since_epoch.total_microseconds() % 1000000));
+	timestamps << file << " " << seconds << std::endl;
+	count++;
+}
+}
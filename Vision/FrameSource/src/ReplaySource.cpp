@@ -0,0 +1,286 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        FrameSource
+// File:           ReplaySource.cpp
+// Description:    Frame source replaying an image directory or a video file
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <FrameSource/ReplaySource.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+namespace framesource
+{
+const double ReplaySource::AS_FAST_AS_POSSIBLE = 0;
+const double ReplaySource::RECORDED_RATE = -1;
+
+static const char* image_extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".ppm", ".pgm", ".tif", ".tiff" };
+
+static boost::posix_time::ptime from_seconds(double seconds)
+{
+	return boost::posix_time::ptime(boost::gregorian::date(1970, 1, 1))
+		+ boost::posix_time::microseconds((long long)(seconds * 1000000.0 + 0.5));
+}
+
+ReplaySource::ReplaySource(const std::string& path, double rate, bool loop, bool preload) :
+	path(path), rate(rate), loop(loop), format(CV_8UC3), count(0), position(0)
+{
+	if (boost::filesystem::is_directory(path))
+	{
+		open_directory();
+	}
+	else
+	{
+		open_video();
+	}
+
+	if (count == 0)
+	{
+		throw FrameSourceException("Recording contains no frames: " + path);
+	}
+
+	if (preload)
+	{
+		frames.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!read_frame(i, frames[i]))
+			{
+				count = i;
+				frames.resize(count);
+				break;
+			}
+		}
+	}
+}
+
+void ReplaySource::open_directory(void)
+{
+	for (boost::filesystem::directory_iterator it(path), end; it != end; ++it)
+	{
+		std::string file = it->path().string();
+		size_t dot = file.find_last_of("./");
+		std::string extension = dot != std::string::npos && file[dot] == '.' ? boost::algorithm::to_lower_copy(file.substr(dot)) : "";
+		const char** last = image_extensions + sizeof(image_extensions) / sizeof(image_extensions[0]);
+		if (boost::filesystem::is_regular_file(it->status()) && std::find(image_extensions, last, extension) != last)
+		{
+			files.push_back(file);
+		}
+	}
+	std::sort(files.begin(), files.end());
+	count = files.size();
+	if (count == 0)
+	{
+		return;
+	}
+
+	cv::Mat first = cv::imread(files[0]);
+	if (first.empty())
+	{
+		throw FrameSourceException("Failed to read image " + files[0]);
+	}
+	size = first.size();
+	format = first.type();
+
+	interval = boost::posix_time::microseconds(1000000 / 30);
+	std::vector<std::string> names;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		names.push_back(files[i].substr(files[i].find_last_of('/') + 1));
+	}
+	read_timestamps((boost::filesystem::path(path) / "timestamps.txt").string(), names);
+}
+
+void ReplaySource::open_video(void)
+{
+	if (!video.open(path))
+	{
+		throw FrameSourceException("Failed to open video " + path);
+	}
+	size = cv::Size(video.get(CV_CAP_PROP_FRAME_WIDTH), video.get(CV_CAP_PROP_FRAME_HEIGHT));
+	count = (size_t)video.get(CV_CAP_PROP_FRAME_COUNT);
+
+	double fps = video.get(CV_CAP_PROP_FPS);
+	interval = boost::posix_time::microseconds((long long)(1000000.0 / (fps > 0 ? fps : 30)));
+	std::vector<std::string> names;
+	for (size_t i = 0; i < count; i++)
+	{
+		std::stringstream ss;
+		ss << i;
+		names.push_back(ss.str());
+	}
+	read_timestamps(path + ".timestamps", names);
+}
+
+void ReplaySource::read_timestamps(const std::string& file, const std::vector<std::string>& names)
+{
+	std::map<std::string, double> recorded;
+	std::ifstream in(file.c_str());
+	std::string name;
+	double seconds;
+	while (in >> name >> seconds)
+	{
+		recorded[name] = seconds;
+	}
+
+	timestamps.resize(names.size());
+	boost::posix_time::ptime previous = from_seconds(0) - interval;
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		std::map<std::string, double>::iterator it = recorded.find(names[i]);
+		timestamps[i] = it != recorded.end() ? from_seconds(it->second) : previous + interval;
+		previous = timestamps[i];
+	}
+}
+
+bool ReplaySource::read_frame(size_t index, cv::Mat& frame)
+{
+	if (!frames.empty())
+	{
+		frames[index].copyTo(frame);
+		return true;
+	}
+
+	if (!files.empty())
+	{
+		frame = cv::imread(files[index]);
+		if (frame.empty())
+		{
+			throw FrameSourceException("Failed to read image " + files[index]);
+		}
+		return true;
+	}
+
+	// video frames are read in order, seek only when starting over
+	if (index == 0 && video.get(CV_CAP_PROP_POS_FRAMES) != 0)
+	{
+		video.set(CV_CAP_PROP_POS_FRAMES, 0);
+	}
+	cv::Mat captured;
+	if (!video.read(captured))
+	{
+		return false;
+	}
+	captured.copyTo(frame);
+	return true;
+}
+
+void ReplaySource::wait_for(size_t pass, size_t index)
+{
+	boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+	if (start.is_not_a_date_time())
+	{
+		start = now;
+		return;
+	}
+	if (rate == AS_FAST_AS_POSSIBLE)
+	{
+		return;
+	}
+
+	boost::posix_time::ptime due;
+	if (rate > 0)
+	{
+		due = start + boost::posix_time::microseconds((long long)(position * 1000000.0 / rate));
+	}
+	else
+	{
+		boost::posix_time::time_duration length = timestamps[count - 1] - timestamps[0] + interval;
+		due = start + (timestamps[index] - timestamps[0]) + length * (int)pass;
+	}
+	if (due > now)
+	{
+		boost::this_thread::sleep(due - now);
+	}
+}
+
+bool ReplaySource::get_frame(cv::Mat& frame, boost::posix_time::ptime* ts)
+{
+	size_t pass = position / count;
+	size_t index = position % count;
+	if (pass > 0 && !loop)
+	{
+		return false;
+	}
+
+	if (!read_frame(index, frame))
+	{
+		// the frame count of a video is an estimate, the recording ends at the first frame that can not be read
+		if (index == 0)
+		{
+			return false;
+		}
+		count = index;
+		position = (pass + 1) * count;
+		return get_frame(frame, ts);
+	}
+	wait_for(pass, index);
+
+	if (ts != NULL)
+	{
+		// keep timestamps increasing when looping
+		boost::posix_time::time_duration length = timestamps[count - 1] - timestamps[0] + interval;
+		*ts = timestamps[index] + length * (int)pass;
+	}
+	position++;
+	return true;
+}
+
+cv::Size ReplaySource::get_size(void)
+{
+	return size;
+}
+
+int ReplaySource::get_format(void)
+{
+	return format;
+}
+
+size_t ReplaySource::get_frame_count(void)
+{
+	return count;
+}
+
+size_t ReplaySource::get_position(void)
+{
+	return position;
+}
+
+void ReplaySource::rewind(void)
+{
+	position = 0;
+	start = boost::posix_time::ptime();
+}
+}
@@ -0,0 +1,178 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        PixelCord_RealifeCord_Transformation
+// File:           transform_engine.hpp
+// Description:    closed-form transformation between pixel and real life coordinates, fitted to the fiducials
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#pragma once
+
+#include "point2f.hpp"
+#include <vector>
+#include <cstddef>
+
+namespace pcrctransformation {
+	/**
+	* @brief transforms pixel coordinates to real life coordinates and back \
+	   with an affine or projective model that is fitted to the fiducials once.
+	*
+	* Unlike pc_rc_transformer, transforming a point costs a few multiplications and never fails.
+	* With more fiducials than the model needs, the model is a least squares fit and
+	* the residuals tell how well the fiducials agree with it.
+	**/
+	class transform_engine {
+		public:
+			enum model_type {
+				/**
+				 * x and y scale, rotation, shear and translation. needs at least 3 fiducials
+				 */
+				affine,
+				/**
+				 * perspective transformation of a plane. needs at least 4 fiducials
+				 */
+				homography
+			};
+
+			/**
+			 * constructor for a transform_engine
+			 * @param fiducials_real_coordinates a vector with the real world coordinates of the fiducials in the same order as fiducials_pixel_coordinates
+			 * @param fiducials_pixel_coordinates a vector with the pixel coordinates of the fiducials in the same order as fiducials_real_coordinates
+			 * @param model the model that is fitted to the fiducials
+			 * @throw std::runtime_error if the amount of fiducials does not match, is too small for the model, or the fiducials are on one line
+			 */
+			transform_engine(const point2f::point2fvector& fiducials_real_coordinates, const point2f::point2fvector& fiducials_pixel_coordinates, model_type model = affine);
+			/**
+			 * destructor
+			 */
+			virtual ~transform_engine();
+			/**
+			 * function for updating the pixel coordinates of the fiducials. refits the model and rebuilds the lookup table if there is one
+			 * @param fiducials_pixel_coordinates the new coordinates
+			 * @throw std::runtime_error if the model can not be fitted
+			 */
+			void set_fiducials_pixel_coordinates(const point2f::point2fvector& fiducials_pixel_coordinates);
+
+			/**
+			 * convert pixel coordinate to a real world coordinate.
+			 * @param pixel_coordinate the pixel coordinate
+			 * @return the real world location of the point.
+			 */
+			point2f to_rc(const point2f& pixel_coordinate) const;
+			/**
+			 * convert real world coordinate to a pixel coordinate.
+			 * @param real_coordinate coordinate the real world coordinate
+			 * @return the pixel location of the point.
+			 */
+			point2f to_pc(const point2f& real_coordinate) const;
+
+			/**
+			 * convert a batch of pixel coordinates to real world coordinates
+			 * @param pixel_coordinates the pixel coordinates
+			 * @param real_coordinates is resized and filled with the real world coordinates, may be the same vector as pixel_coordinates
+			 */
+			void to_rc(const point2f::point2fvector& pixel_coordinates, point2f::point2fvector& real_coordinates) const;
+			/**
+			 * convert a batch of real world coordinates to pixel coordinates
+			 * @param real_coordinates the real world coordinates
+			 * @param pixel_coordinates is resized and filled with the pixel coordinates, may be the same vector as real_coordinates
+			 */
+			void to_pc(const point2f::point2fvector& real_coordinates, point2f::point2fvector& pixel_coordinates) const;
+			/**
+			 * convert an array of pixel coordinates to real world coordinates
+			 * @param pixel_coordinates count x,y pairs
+			 * @param real_coordinates receives count x,y pairs, may be the same array as pixel_coordinates
+			 * @param count the amount of points
+			 */
+			void to_rc(const double* pixel_coordinates, double* real_coordinates, size_t count) const;
+			/**
+			 * convert an array of real world coordinates to pixel coordinates
+			 * @param real_coordinates count x,y pairs
+			 * @param pixel_coordinates receives count x,y pairs, may be the same array as real_coordinates
+			 * @param count the amount of points
+			 */
+			void to_pc(const double* real_coordinates, double* pixel_coordinates, size_t count) const;
+
+			/**
+			 * @return the distance in real world units between every fiducial and its transformed pixel coordinate.
+			 * always 0 when the amount of fiducials is the minimum for the model.
+			 */
+			const std::vector<double>& get_residuals() const { return residuals; }
+			/**
+			 * @return the root mean square of the residuals
+			 */
+			double get_rms_residual() const;
+
+			/**
+			 * precomputes the real world coordinate of every pixel of an image.
+			 * the table is rebuilt when the fiducials change.
+			 * @param width the width of the image
+			 * @param height the height of the image
+			 */
+			void build_lookup(int width, int height);
+			/**
+			 * @return true if build_lookup was called
+			 */
+			bool has_lookup() const { return !lookup.empty(); }
+			/**
+			 * @return the lookup table: for every pixel, row by row, the real world x and y as floats
+			 */
+			const float* get_lookup() const { return lookup.empty() ? NULL : &lookup[0]; }
+			/**
+			 * @return the width of the lookup table
+			 */
+			int get_lookup_width() const { return lookup_width; }
+			/**
+			 * @return the height of the lookup table
+			 */
+			int get_lookup_height() const { return lookup_height; }
+			/**
+			 * real world coordinate of a pixel from the lookup table
+			 * @param x the x of the pixel, inside the table
+			 * @param y the y of the pixel, inside the table
+			 */
+			point2f lookup_rc(int x, int y) const {
+				const float* entry = &lookup[(static_cast<size_t>(y) * lookup_width + x) * 2];
+				return point2f(entry[0], entry[1]);
+			}
+
+		private:
+			point2f::point2fvector fiducials_real_coordinates;
+			point2f::point2fvector fiducials_pixel_coordinates;
+			model_type model;
+			//pixel to real and real to pixel, row major 3x3. the last row is 0 0 1 for affine
+			double forward[9];
+			double inverse[9];
+			std::vector<double> residuals;
+			std::vector<float> lookup;
+			int lookup_width;
+			int lookup_height;
+
+			void update_transformation_parameters();
+			static void apply(const double* m, bool projective, const double* in, double* out, size_t count);
+	};
+}
@@ -0,0 +1,332 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        PixelCord_RealifeCord_Transformation
+// File:           transform_engine.cpp
+// Description:    closed-form transformation between pixel and real life coordinates, fitted to the fiducials
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+#include <pcrctransformation/transform_engine.hpp>
+#include <pcrctransformation/point2f.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+
+namespace pcrctransformation {
+	namespace {
+		/**
+		 * solves a*x = b with gaussian elimination and partial pivoting. a and b are overwritten
+		 * @return false if a is singular
+		 */
+		bool solve(std::vector<double>& a, std::vector<double>& b, int n)
+		{
+			for(int col = 0; col < n; col++)
+			{
+				int pivot = col;
+				for(int row = col + 1; row < n; row++)
+				{
+					if(fabs(a[row * n + col]) > fabs(a[pivot * n + col])) pivot = row;
+				}
+				if(fabs(a[pivot * n + col]) < 1e-12) return false;
+				if(pivot != col)
+				{
+					for(int k = 0; k < n; k++) std::swap(a[pivot * n + k], a[col * n + k]);
+					std::swap(b[pivot], b[col]);
+				}
+				for(int row = col + 1; row < n; row++)
+				{
+					double factor = a[row * n + col] / a[col * n + col];
+					for(int k = col; k < n; k++) a[row * n + k] -= factor * a[col * n + k];
+					b[row] -= factor * b[col];
+				}
+			}
+			for(int row = n - 1; row >= 0; row--)
+			{
+				double sum = b[row];
+				for(int k = row + 1; k < n; k++) sum -= a[row * n + k] * b[k];
+				b[row] = sum / a[row * n + row];
+			}
+			return true;
+		}
+
+		/**
+		 * similarity that moves the centroid of the points to 0,0 and their mean distance to it to sqrt(2),
+		 * which keeps the normal equations well conditioned for pixel sized coordinates
+		 */
+		void normalization(const point2f::point2fvector& points, double* m)
+		{
+			point2f centroid;
+			for(unsigned int n = 0; n < points.size(); n++) centroid += points[n];
+			centroid.x /= points.size();
+			centroid.y /= points.size();
+			double distance = 0;
+			for(unsigned int n = 0; n < points.size(); n++) distance += points[n].distance(centroid);
+			distance /= points.size();
+			double s = distance > 0 ? sqrt(2.0) / distance : 1;
+			m[0] = s; m[1] = 0; m[2] = -s * centroid.x;
+			m[3] = 0; m[4] = s; m[5] = -s * centroid.y;
+			m[6] = 0; m[7] = 0; m[8] = 1;
+		}
+
+		void multiply(const double* a, const double* b, double* result)
+		{
+			for(int row = 0; row < 3; row++)
+			{
+				for(int col = 0; col < 3; col++)
+				{
+					result[row * 3 + col] = a[row * 3] * b[col] + a[row * 3 + 1] * b[3 + col] + a[row * 3 + 2] * b[6 + col];
+				}
+			}
+		}
+
+		bool invert(const double* m, double* result)
+		{
+			double det = m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+			if(fabs(det) < 1e-300) return false;
+			result[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+			result[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+			result[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+			result[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+			result[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+			result[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+			result[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+			result[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+			result[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+			return true;
+		}
+	}
+
+	transform_engine::transform_engine(const point2f::point2fvector& fiducials_real_coordinates,
+			const point2f::point2fvector& fiducials_pixel_coordinates, model_type model)
+		: fiducials_real_coordinates(fiducials_real_coordinates), fiducials_pixel_coordinates(fiducials_pixel_coordinates),
+		  model(model), lookup_width(0), lookup_height(0)
+	{
+		update_transformation_parameters();
+	}
+
+	transform_engine::~transform_engine()
+	{
+	}
+
+	void transform_engine::set_fiducials_pixel_coordinates(const point2f::point2fvector& fiducials_pixel_coordinates)
+	{
+		this->fiducials_pixel_coordinates = fiducials_pixel_coordinates;
+		update_transformation_parameters();
+		if(has_lookup()) build_lookup(lookup_width, lookup_height);
+	}
+
+	point2f transform_engine::to_rc(const point2f& pixel_coordinate) const
+	{
+		point2f result;
+		apply(forward, model == homography, &pixel_coordinate.x, &result.x, 1);
+		return result;
+	}
+
+	point2f transform_engine::to_pc(const point2f& real_coordinate) const
+	{
+		point2f result;
+		apply(inverse, model == homography, &real_coordinate.x, &result.x, 1);
+		return result;
+	}
+
+	void transform_engine::to_rc(const point2f::point2fvector& pixel_coordinates, point2f::point2fvector& real_coordinates) const
+	{
+		real_coordinates.resize(pixel_coordinates.size());
+		if(pixel_coordinates.empty()) return;
+		//a point2f is two adjacent doubles, so the vector can be handled as one array of x,y pairs
+		to_rc(&pixel_coordinates[0].x, &real_coordinates[0].x, pixel_coordinates.size());
+	}
+
+	void transform_engine::to_pc(const point2f::point2fvector& real_coordinates, point2f::point2fvector& pixel_coordinates) const
+	{
+		pixel_coordinates.resize(real_coordinates.size());
+		if(real_coordinates.empty()) return;
+		to_pc(&real_coordinates[0].x, &pixel_coordinates[0].x, real_coordinates.size());
+	}
+
+	void transform_engine::to_rc(const double* pixel_coordinates, double* real_coordinates, size_t count) const
+	{
+		apply(forward, model == homography, pixel_coordinates, real_coordinates, count);
+	}
+
+	void transform_engine::to_pc(const double* real_coordinates, double* pixel_coordinates, size_t count) const
+	{
+		apply(inverse, model == homography, real_coordinates, pixel_coordinates, count);
+	}
+
+	double transform_engine::get_rms_residual() const
+	{
+		if(residuals.empty()) return 0;
+		double sum = 0;
+		for(unsigned int n = 0; n < residuals.size(); n++) sum += residuals[n] * residuals[n];
+		return sqrt(sum / residuals.size());
+	}
+
+	void transform_engine::build_lookup(int width, int height)
+	{
+		if(width <= 0 || height <= 0)
+		{
+			lookup.clear();
+			lookup_width = lookup_height = 0;
+			return;
+		}
+		lookup_width = width;
+		lookup_height = height;
+		lookup.resize(static_cast<size_t>(width) * height * 2);
+
+		//along a row the numerators and the denominator change by a constant per pixel
+		const double* m = forward;
+		float* entry = &lookup[0];
+		for(int y = 0; y < height; y++)
+		{
+			double u = m[1] * y + m[2];
+			double v = m[4] * y + m[5];
+			double w = model == homography ? m[7] * y + m[8] : 1;
+			for(int x = 0; x < width; x++)
+			{
+				entry[0] = static_cast<float>(u / w);
+				entry[1] = static_cast<float>(v / w);
+				entry += 2;
+				u += m[0];
+				v += m[3];
+				if(model == homography) w += m[6];
+			}
+		}
+	}
+
+	void transform_engine::update_transformation_parameters()
+	{
+		const point2f::point2fvector& pixel = fiducials_pixel_coordinates;
+		const point2f::point2fvector& real = fiducials_real_coordinates;
+		if(real.size() != pixel.size())
+			throw std::runtime_error("Number of real fiducial coordinates does not match number of pixel fiducials coordinates");
+		unsigned int needed = model == homography ? 4 : 3;
+		if(pixel.size() < needed)
+			throw std::runtime_error("Not enough fiducials for the transformation model");
+
+		//fit in normalized coordinates, forward = real_norm^-1 * fit * pixel_norm
+		double pixel_norm[9], real_norm[9], real_denorm[9];
+		normalization(pixel, pixel_norm);
+		normalization(real, real_norm);
+		invert(real_norm, real_denorm);
+
+		double fit[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+		if(model == affine)
+		{
+			//both rows of the affine matrix are least squares fits over the same pixel coordinates
+			std::vector<double> ata(9, 0), atx(3, 0), aty(3, 0);
+			for(unsigned int n = 0; n < pixel.size(); n++)
+			{
+				double p[3] = { pixel_norm[0] * pixel[n].x + pixel_norm[2], pixel_norm[4] * pixel[n].y + pixel_norm[5], 1 };
+				double rx = real_norm[0] * real[n].x + real_norm[2];
+				double ry = real_norm[4] * real[n].y + real_norm[5];
+				for(int row = 0; row < 3; row++)
+				{
+					for(int col = 0; col < 3; col++) ata[row * 3 + col] += p[row] * p[col];
+					atx[row] += p[row] * rx;
+					aty[row] += p[row] * ry;
+				}
+			}
+			std::vector<double> ata2 = ata;
+			if(!solve(ata, atx, 3) || !solve(ata2, aty, 3))
+				throw std::runtime_error("Fiducials are on one line");
+			for(int k = 0; k < 3; k++)
+			{
+				fit[k] = atx[k];
+				fit[3 + k] = aty[k];
+			}
+		}
+		else
+		{
+			//direct linear transformation with the last element fixed to 1
+			std::vector<double> ata(64, 0), atb(8, 0);
+			for(unsigned int n = 0; n < pixel.size(); n++)
+			{
+				double x = pixel_norm[0] * pixel[n].x + pixel_norm[2];
+				double y = pixel_norm[4] * pixel[n].y + pixel_norm[5];
+				double rx = real_norm[0] * real[n].x + real_norm[2];
+				double ry = real_norm[4] * real[n].y + real_norm[5];
+				double rows[2][8] = {
+					{ x, y, 1, 0, 0, 0, -rx * x, -rx * y },
+					{ 0, 0, 0, x, y, 1, -ry * x, -ry * y }
+				};
+				double b[2] = { rx, ry };
+				for(int r = 0; r < 2; r++)
+				{
+					for(int i = 0; i < 8; i++)
+					{
+						for(int j = 0; j < 8; j++) ata[i * 8 + j] += rows[r][i] * rows[r][j];
+						atb[i] += rows[r][i] * b[r];
+					}
+				}
+			}
+			if(!solve(ata, atb, 8))
+				throw std::runtime_error("Fiducials do not determine a homography");
+			for(int k = 0; k < 8; k++) fit[k] = atb[k];
+		}
+
+		double temp[9];
+		multiply(fit, pixel_norm, temp);
+		multiply(real_denorm, temp, forward);
+		if(!invert(forward, inverse))
+			throw std::runtime_error("Transformation can not be inverted");
+
+		residuals.resize(pixel.size());
+		for(unsigned int n = 0; n < pixel.size(); n++)
+		{
+			residuals[n] = to_rc(pixel[n]).distance(real[n]);
+		}
+	}
+
+	void transform_engine::apply(const double* m, bool projective, const double* in, double* out, size_t count)
+	{
+		const double m0 = m[0], m1 = m[1], m2 = m[2], m3 = m[3], m4 = m[4], m5 = m[5];
+		if(!projective)
+		{
+			for(size_t n = 0; n < count * 2; n += 2)
+			{
+				double x = in[n];
+				double y = in[n + 1];
+				out[n] = m0 * x + m1 * y + m2;
+				out[n + 1] = m3 * x + m4 * y + m5;
+			}
+		}
+		else
+		{
+			const double m6 = m[6], m7 = m[7], m8 = m[8];
+			for(size_t n = 0; n < count * 2; n += 2)
+			{
+				double x = in[n];
+				double y = in[n + 1];
+				double w = 1.0 / (m6 * x + m7 * y + m8);
+				out[n] = (m0 * x + m1 * y + m2) * w;
+				out[n + 1] = (m3 * x + m4 * y + m5) * w;
+			}
+		}
+	}
+}
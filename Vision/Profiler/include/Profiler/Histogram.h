@@ -0,0 +1,177 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Profiler
+// File:           Histogram.h
+// Description:    Latency histogram with constant time recording
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+
+namespace profiler {
+
+/**
+ * Counters of a histogram are written by a single thread and read by
+ * Profiler::snapshot() from another one. Relaxed atomic loads and stores
+ * make that well defined without a locked instruction in record().
+ */
+inline uint64_t loadCounter(const uint64_t& counter) {
+#ifdef __ATOMIC_RELAXED
+	return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+#else
+	return __sync_fetch_and_add(const_cast<uint64_t*>(&counter), 0);
+#endif
+}
+
+inline void storeCounter(uint64_t& counter, uint64_t value) {
+#ifdef __ATOMIC_RELAXED
+	__atomic_store_n(&counter, value, __ATOMIC_RELAXED);
+#else
+	__sync_lock_test_and_set(&counter, value);
+#endif
+}
+
+/**
+ * Histogram of durations in microseconds.
+ * Buckets are log-linear: every power of two is split in SUB_BUCKETS
+ * buckets, so percentiles are within 1/SUB_BUCKETS (6%) of the real value
+ * up to about 70 minutes. Recording is a few instructions and never allocates.
+ */
+class Histogram {
+public:
+	static const int SUB_BITS = 4;
+	static const int SUB_BUCKETS = 1 << SUB_BITS;
+	static const int BUCKETS = (32 - SUB_BITS + 1) * SUB_BUCKETS;
+
+	Histogram() {
+		clear();
+	}
+
+	/**
+	 * Adds a duration. Must only be called by the thread that owns the histogram.
+	 * @param us the duration in microseconds
+	 */
+	void record(uint64_t us) {
+		int b = bucket(us);
+		storeCounter(counts[b], counts[b] + 1);
+		storeCounter(total, total + 1);
+		storeCounter(sum, sum + us);
+	}
+
+	/**
+	 * Copies a histogram that its owning thread may be recording into.
+	 * The count is the sum of the copied buckets, so it always agrees with them.
+	 */
+	void copyFrom(const Histogram& live) {
+		total = 0;
+		for(int i = 0; i < BUCKETS; i++) {
+			counts[i] = loadCounter(live.counts[i]);
+			total += counts[i];
+		}
+		sum = loadCounter(live.sum);
+	}
+
+	/**
+	 * Adds all durations of another histogram
+	 */
+	void add(const Histogram& other) {
+		for(int i = 0; i < BUCKETS; i++) {
+			counts[i] += other.counts[i];
+		}
+		total += other.total;
+		sum += other.sum;
+	}
+
+	/**
+	 * Removes the durations of an earlier copy of this histogram,
+	 * leaving the durations recorded since that copy was made
+	 */
+	void subtract(const Histogram& earlier) {
+		for(int i = 0; i < BUCKETS; i++) {
+			counts[i] -= earlier.counts[i];
+		}
+		total -= earlier.total;
+		sum -= earlier.sum;
+	}
+
+	void clear() {
+		memset(counts, 0, sizeof(counts));
+		total = 0;
+		sum = 0;
+	}
+
+	/**
+	 * @return the amount of recorded durations
+	 */
+	uint64_t count() const {
+		return total;
+	}
+
+	/**
+	 * @return the mean duration in microseconds
+	 */
+	double mean() const {
+		return total == 0 ? 0 : sum / (double)total;
+	}
+
+	/**
+	 * @param p the percentile, 0 to 100
+	 * @return the upper bound of the bucket containing the percentile, in microseconds
+	 */
+	uint64_t percentile(double p) const;
+
+private:
+	uint64_t counts[BUCKETS];
+	uint64_t total;
+	uint64_t sum;
+
+	static int bucket(uint64_t us) {
+		if(us < SUB_BUCKETS) {
+			return (int)us;
+		}
+		if(us > 0xFFFFFFFFull) {
+			return BUCKETS - 1;
+		}
+		int exponent = 31 - __builtin_clz((uint32_t)us);
+		return (exponent - SUB_BITS + 1) * SUB_BUCKETS + (int)((us >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+	}
+
+	static uint64_t upperBound(int bucket) {
+		if(bucket < SUB_BUCKETS) {
+			return bucket;
+		}
+		int exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+		uint64_t sub = bucket % SUB_BUCKETS;
+		return ((SUB_BUCKETS + sub + 1) << (exponent - SUB_BITS)) - 1;
+	}
+};
+
+}
@@ -0,0 +1,192 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Profiler
+// File:           Profiler.h
+// Description:    Per stage timing of a processing pipeline
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <Profiler/Histogram.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <time.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace profiler {
+
+/**
+ * Index of a registered stage
+ */
+typedef unsigned int StageId;
+
+/**
+ * The durations of a stage recorded in some period, by all threads
+ */
+struct StageStats {
+	std::string name;
+	Histogram histogram;
+};
+
+/**
+ * @return a monotonic time in microseconds
+ */
+inline uint64_t now() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//========================================================================
+// Profiler class
+//========================================================================
+/**
+ * Collects the durations of the stages of a pipeline.
+ * Every thread records into its own histograms, so recording takes no lock
+ * and threads never wait for each other or for the reader. snapshot() reads
+ * the histograms of all threads and returns what was recorded since the
+ * previous snapshot.
+ *
+ * When a trace file is enabled, every recorded duration is also written as
+ * an event in the chrome://tracing JSON format. Events are buffered per
+ * thread and written in batches.
+ */
+class Profiler {
+public:
+	static const unsigned int MAX_STAGES = 32;
+
+	/**
+	 * @return the process wide profiler
+	 */
+	static Profiler& instance();
+
+	/**
+	 * Registers a stage, or looks up an existing one.
+	 * Look up the id once and keep it, this takes a lock.
+	 * @param name the name of the stage
+	 * @return the id of the stage
+	 * @throw std::length_error if more than MAX_STAGES stages are registered
+	 */
+	StageId stage(const std::string& name);
+
+	/**
+	 * Records a duration of a stage for the calling thread
+	 * @param stage the stage
+	 * @param start the start time, from now()
+	 * @param end the end time, from now()
+	 */
+	void record(StageId stage, uint64_t start, uint64_t end);
+
+	/**
+	 * Records a duration that was not measured with now(), e.g. a latency
+	 * computed from a capture timestamp. It does not appear in the trace.
+	 * @param stage the stage
+	 * @param us the duration in microseconds
+	 */
+	void record(StageId stage, uint64_t us);
+
+	/**
+	 * Collects the durations recorded by all threads since the previous call
+	 * @param stats receives one entry per registered stage
+	 */
+	void snapshot(std::vector<StageStats>& stats);
+
+	/**
+	 * Starts writing a trace file
+	 * @param path the file to write to, it is overwritten
+	 * @return false if the file could not be opened
+	 */
+	bool enableTrace(const std::string& path);
+
+	/**
+	 * Writes the trace events buffered by the calling thread
+	 */
+	void flushTrace();
+
+private:
+	struct TraceEvent {
+		StageId stage;
+		uint64_t start;
+		uint64_t duration;
+	};
+
+	struct ThreadData {
+		unsigned int id;
+		Histogram histograms[MAX_STAGES];
+		Histogram previous[MAX_STAGES];	// only used by snapshot()
+		std::vector<TraceEvent> trace;
+	};
+
+	Profiler();
+	Profiler(const Profiler&);
+	Profiler& operator=(const Profiler&);
+
+	static void keepThreadData(ThreadData*) {
+	}
+
+	ThreadData& threadData();
+	void writeTrace(ThreadData& data);
+
+	boost::mutex mutex;
+	std::vector<std::string> stages;
+	std::vector<ThreadData*> threads;
+	boost::thread_specific_ptr<ThreadData> current;
+
+	boost::mutex traceMutex;
+	std::ofstream traceFile;
+	volatile bool tracing;
+	uint64_t traceStart;
+};
+
+//========================================================================
+// ScopedTimer class
+//========================================================================
+/**
+ * Records the time between its construction and destruction as a
+ * duration of a stage.
+ */
+class ScopedTimer {
+public:
+	ScopedTimer(StageId stage) :
+			stage(stage), start(now()) {
+	}
+
+	~ScopedTimer() {
+		Profiler::instance().record(stage, start, now());
+	}
+
+private:
+	StageId stage;
+	uint64_t start;
+};
+
+}
@@ -0,0 +1,152 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        Profiler
+// File:           Profiler.cpp
+// Description:    Per stage timing of a processing pipeline
+// Author:         agent
+// Notes:          None
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include <Profiler/Profiler.h>
+#include <stdexcept>
+
+#define TRACE_BATCH 4096
+
+namespace profiler {
+
+Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() :
+		current(&Profiler::keepThreadData), tracing(false), traceStart(now()) {
+	// ThreadData is not deleted when its thread ends: snapshot() may still read it
+}
+
+StageId Profiler::stage(const std::string& name) {
+	boost::lock_guard<boost::mutex> lock(mutex);
+	for(size_t i = 0; i < stages.size(); i++) {
+		if(stages[i] == name) {
+			return i;
+		}
+	}
+	if(stages.size() >= MAX_STAGES) {
+		throw std::length_error("Too many profiler stages");
+	}
+	stages.push_back(name);
+	return stages.size() - 1;
+}
+
+Profiler::ThreadData& Profiler::threadData() {
+	ThreadData* data = current.get();
+	if(data == NULL) {
+		data = new ThreadData();
+		current.reset(data);
+		boost::lock_guard<boost::mutex> lock(mutex);
+		data->id = threads.size() + 1;
+		threads.push_back(data);
+	}
+	return *data;
+}
+
+void Profiler::record(StageId stage, uint64_t start, uint64_t end) {
+	ThreadData& data = threadData();
+	data.histograms[stage].record(end - start);
+	if(tracing) {
+		TraceEvent event = { stage, start, end - start };
+		data.trace.push_back(event);
+		if(data.trace.size() >= TRACE_BATCH) {
+			writeTrace(data);
+		}
+	}
+}
+
+void Profiler::record(StageId stage, uint64_t us) {
+	threadData().histograms[stage].record(us);
+}
+
+void Profiler::snapshot(std::vector<StageStats>& stats) {
+	boost::lock_guard<boost::mutex> lock(mutex);
+	stats.resize(stages.size());
+	for(size_t s = 0; s < stages.size(); s++) {
+		stats[s].name = stages[s];
+		stats[s].histogram.clear();
+	}
+
+	// The owning threads keep recording while this reads their counters
+	// with atomic loads. Counters only increase, so a copy is at worst
+	// missing the last few durations, which show up in the next snapshot.
+	for(size_t t = 0; t < threads.size(); t++) {
+		ThreadData& data = *threads[t];
+		for(size_t s = 0; s < stages.size(); s++) {
+			Histogram copy;
+			copy.copyFrom(data.histograms[s]);
+			Histogram recent = copy;
+			recent.subtract(data.previous[s]);
+			data.previous[s] = copy;
+			stats[s].histogram.add(recent);
+		}
+	}
+}
+
+bool Profiler::enableTrace(const std::string& path) {
+	boost::lock_guard<boost::mutex> lock(traceMutex);
+	traceFile.open(path.c_str(), std::ios::out | std::ios::trunc);
+	if(!traceFile) {
+		return false;
+	}
+	// chrome://tracing accepts a trace without the closing bracket
+	traceFile << "[" << std::endl;
+	tracing = true;
+	return true;
+}
+
+void Profiler::flushTrace() {
+	if(tracing) {
+		writeTrace(threadData());
+	}
+}
+
+void Profiler::writeTrace(ThreadData& data) {
+	std::vector<std::string> names;
+	{
+		boost::lock_guard<boost::mutex> lock(mutex);
+		names = stages;
+	}
+
+	boost::lock_guard<boost::mutex> lock(traceMutex);
+	for(size_t i = 0; i < data.trace.size(); i++) {
+		const TraceEvent& event = data.trace[i];
+		traceFile << "{\"name\":\"" << names[event.stage] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << data.id
+				<< ",\"ts\":" << event.start - traceStart << ",\"dur\":" << event.duration << "},\n";
+	}
+	traceFile.flush();
+	data.trace.clear();
+}
+
+}
@@ -33,6 +33,9 @@
 
 #pragma once
 #include <opencv2/core/core.hpp>
+#include <CameraCalibration/ChessboardDetector.h>
+#include <string>
+#include <vector>
 
 namespace stereoVision {
 
@@ -45,19 +48,32 @@ private:
 	///The matrixes used for re-mapping the images
 	cv::Mat rmap[2][2];
 
+	ChessboardDetector createDetector(cv::Size boardSize, const std::string& cacheDir);
+	bool calibrate(const std::vector<ChessboardDetector::Result>& results, const std::string& xmlName, cv::Size boardSize);
+
 public:
     ///The valid regions within the two correctified images
 	cv::Rect validRoi[2];
 
+    /**
+     * Creates a xml file for correcting the images.
+     * The corners are found by a pool of threads, one per core.
+     * @param filename a file with a list of image file names, left and right alternately
+     * @param xmlName the name of the resulting xml file
+     * @param boardSize The size of the checker board (the amount of horizontal squares -1 , the amount of vertical squares -1)
+     * @param cacheDir a directory where the corners of every image are cached, so calibrating again with the same images skips the detection. empty for no cache
+     * @return <b>false</b> if it didn't succeed
+     */
+	bool StereoCalib(const std::string& filename, const std::string& xmlName, cv::Size boardSize, const std::string& cacheDir = "");
     /**
      * Creates a xml file for correcting the images
-     * @param imagelist a list with all the file names
+     * @param imagelist the images, left and right alternately
      * @param xmlName the name of the resulting xml file
      * @param boardSize The size of the checker board (the amount of horizontal squares -1 , the amount of vertical squares -1)
+     * @param cacheDir a directory where the corners of every image are cached, keyed on the pixel data. empty for no cache
      * @return <b>false</b> if it didn't succeed
      */
-	bool StereoCalib(const std::string& filename, const std::string& xmlName, cv::Size boardSize);
-	bool StereoCalib(const std::vector<cv::Mat>& imagelist, const std::string& xmlName, cv::Size boardSize);
+	bool StereoCalib(const std::vector<cv::Mat>& imagelist, const std::string& xmlName, cv::Size boardSize, const std::string& cacheDir = "");
     /**
      * Reads the matrixes for rectifying the images
      */
@@ -53,6 +53,8 @@ using namespace std;
 int main(int argc, char** argv) {
 	namespace sv = stereoVision;
 	sv::StereoVisionCalibration rs;
+	//the optional first argument is a directory to cache the found corners in
+	string cacheDir = argc > 1 ? argv[1] : "";
 
 	int savedImagesCounter = 0;
 	char key = '0';
@@ -89,7 +91,7 @@ int main(int argc, char** argv) {
 
 		if (!trainingImages.empty()) {
 			cout << "training..." << endl;
-			if (rs.StereoCalib(trainingImages, "stereo.xml", cv::Size(SQUARES_WIDTH, SQUARES_HEIGHT))) {
+			if (rs.StereoCalib(trainingImages, "stereo.xml", cv::Size(SQUARES_WIDTH, SQUARES_HEIGHT), cacheDir)) {
 				cout << "Training successfully finished" << endl;
 			} else {
 				cout << "Training failed" << endl;
@@ -39,76 +39,58 @@
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <StereoVision/StereoVisionCalibration.hpp>
+#include <CameraCalibration/ChessboardDetector.h>
 
 using namespace cv;
 using namespace std;
 
-bool stereoVision::StereoVisionCalibration::StereoCalib(const std::vector<cv::Mat>& imagelist, const std::string& xmlName, cv::Size boardSize) {
+bool stereoVision::StereoVisionCalibration::StereoCalib(const std::vector<cv::Mat>& imagelist, const std::string& xmlName, cv::Size boardSize, const std::string& cacheDir) {
 	if (imagelist.size() % 2 != 0) {
 		cerr << "Error: the image list contains odd (non-even) number of elements\n";
 		return false;
 	}
-	const int maxScale = 5;
+	ChessboardDetector detector = createDetector(boardSize, cacheDir);
+	vector<ChessboardDetector::Result> results;
+	detector.detect(imagelist, results);
+	return calibrate(results, xmlName, boardSize);
+}
+
+ChessboardDetector stereoVision::StereoVisionCalibration::createDetector(cv::Size boardSize, const std::string& cacheDir) {
+	ChessboardDetector detector(boardSize, cacheDir);
+	//small boards are searched in enlarged images
+	detector.maxScale = 5;
+	detector.subPixWindow = Size(11, 11);
+	detector.subPixCriteria = TermCriteria(CV_TERMCRIT_ITER + CV_TERMCRIT_EPS, 30, 0.01);
+	return detector;
+}
+
+bool stereoVision::StereoVisionCalibration::calibrate(const std::vector<ChessboardDetector::Result>& results, const std::string& xmlName, cv::Size boardSize) {
 	const float squareSize = 1.f; // Set this to your actual square size
 	// ARRAY AND VECTOR STORAGE:
 	vector<vector<Point2f> > imagePoints[2];
 	vector<vector<Point3f> > objectPoints;
 	Size imageSize;
 
-	int i, j, k, nimages = (int) imagelist.size() / 2;
-
-	imagePoints[0].resize(nimages);
-	imagePoints[1].resize(nimages);
-
-	for (i = j = 0; i < nimages; i++) {
-		for (k = 0; k < 2; k++) {
-			Mat img = imagelist[i * 2 + k];
-
-			if (img.empty()) {
-				break;
-			}
-
-			if (imageSize == Size()) {
-				imageSize = img.size();
-			} else if (img.size() != imageSize) {
-				cerr << "Image has wrong size, Skipping the pair\n";
-				break;
-			}
-
-			bool found = false;
-			vector<Point2f>& corners = imagePoints[k][j];
-			for (int scale = 1; scale <= maxScale; scale++) {
-
-				Mat timg;
-				if (scale == 1) {
-					timg = img;
-				} else {
-					resize(img, timg, Size(), scale, scale);
-				}
-
-				found = findChessboardCorners(timg, boardSize, corners, CV_CALIB_CB_ADAPTIVE_THRESH | CV_CALIB_CB_NORMALIZE_IMAGE);
-
-				if (found) {
-					if (scale > 1) {
-						Mat cornersMat(corners);
-						cornersMat *= 1. / scale;
-					}
-					break;
-				}
-			}
+	int i, j, k, nimages = (int) results.size() / 2;
 
-			if (!found) {
-				break;
-			}
-
-			cornerSubPix(img, corners, Size(11, 11), Size(-1, -1), TermCriteria(CV_TERMCRIT_ITER + CV_TERMCRIT_EPS,
-			30, 0.01));
+	//only pairs in which the board was found in both images are used
+	for (i = 0; i < nimages; i++) {
+		const ChessboardDetector::Result& left = results[i * 2];
+		const ChessboardDetector::Result& right = results[i * 2 + 1];
+		if (!left.found || !right.found) {
+			continue;
 		}
-
-		if (k == 2) {
-			j++;
+		if (imageSize == Size()) {
+			imageSize = left.imageSize;
+		}
+		if (left.imageSize != imageSize || right.imageSize != imageSize) {
+			cerr << "Image has wrong size, Skipping the pair\n";
+			continue;
 		}
+		imagePoints[0].push_back(left.corners);
+		imagePoints[1].push_back(right.corners);
 	}
+	j = imagePoints[0].size();
 
 	cout << j << " pairs have been successfully detected.\n";
 	nimages = j;
@@ -157,8 +139,8 @@ bool stereoVision::StereoVisionCalibration::StereoCalib(const std::vector<cv::Ma
 	return true;
 }
 
-bool stereoVision::StereoVisionCalibration::StereoCalib(const std::string& filename, const std::string& xmlName, cv::Size boardSize) {
-	vector<cv::Mat> list;
+bool stereoVision::StereoVisionCalibration::StereoCalib(const std::string& filename, const std::string& xmlName, cv::Size boardSize, const std::string& cacheDir) {
+	vector<string> list;
 	FileStorage fs(filename, FileStorage::READ);
 	if (!fs.isOpened())
 		return false;
@@ -167,9 +149,17 @@ bool stereoVision::StereoVisionCalibration::StereoCalib(const std::string& filen
 		return false;
 	FileNodeIterator it = n.begin(), it_end = n.end();
 	for (; it != it_end; ++it)
-		list.push_back(imread((string) *it));
+		list.push_back((string) *it);
+	if (list.size() % 2 != 0) {
+		cerr << "Error: the image list contains odd (non-even) number of elements\n";
+		return false;
+	}
 
-	return StereoCalib(list, xmlName, boardSize);
+	//the images are read by the detector threads, which also cache the corners per file
+	ChessboardDetector detector = createDetector(boardSize, cacheDir);
+	vector<ChessboardDetector::Result> results;
+	detector.detect(list, results);
+	return calibrate(results, xmlName, boardSize);
 }
 
 bool stereoVision::StereoVisionCalibration::initRectifyImage(const std::string& xmlName) {
@@ -0,0 +1,456 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        TestBenchGUI
+// File:           JobScheduler.cpp
+// Description:    Runs jobs concurrently in worker processes
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "JobScheduler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+
+namespace {
+
+// Imports the module of the job and calls getResult() like callPythonFunc did:
+// argv = path, module name, argument count, parameters...
+const char* RUNNER =
+    "import imp, sys\n"
+    "m = imp.load_source(sys.argv[2], sys.argv[1] + sys.argv[2] + '.py')\n"
+    "args = sys.argv[4:] + [None] * (int(sys.argv[3]) - len(sys.argv[4:]))\n"
+    "r = m.getResult(*args)\n"
+    "sys.stdout.write('<type>string<type><name>result<name><value>%s<value>' % r)\n";
+
+const int POLL_TIMEOUT_MS = 100;
+
+/**
+ * 64 bit FNV-1a hash
+ */
+class Hash {
+public:
+    Hash() : h(14695981039346656037ULL) {}
+
+    void add(const char* data, size_t size){
+        for(size_t i = 0; i < size; i++){
+            h ^= (unsigned char)data[i];
+            h *= 1099511628211ULL;
+        }
+    }
+
+    void add(const std::string& str){
+        add(str.c_str(), str.size() + 1);
+    }
+
+    void addFile(const std::string& path){
+        std::ifstream in(path.c_str(), std::ios::binary);
+        char buf[65536];
+        while(in.read(buf, sizeof(buf)) || in.gcount() > 0){
+            add(buf, in.gcount());
+        }
+    }
+
+    /**
+     * Hashes the names, sizes and modification times of all files in a directory.
+     * Never throws: files that disappear during the scan are hashed by name only,
+     * and an unreadable directory ends the scan with its error in the hash.
+     */
+    void addDirectory(const std::string& path){
+        using namespace boost::filesystem;
+        std::vector<std::string> entries;
+        boost::system::error_code ec;
+        recursive_directory_iterator it(path, ec), end;
+        while(!ec && it != end){
+            std::stringstream ss;
+            ss << it->path().string();
+            boost::system::error_code statusEc, sizeEc, timeEc;
+            file_status status = it->status(statusEc);
+            if(!statusEc && is_regular_file(status)){
+                boost::uintmax_t size = file_size(it->path(), sizeEc);
+                std::time_t modified = last_write_time(it->path(), timeEc);
+                if(!sizeEc && !timeEc){
+                    ss << ':' << size << ':' << modified;
+                }
+            }
+            entries.push_back(ss.str());
+            it.increment(ec);
+        }
+        if(ec){
+            entries.push_back("error:" + ec.message());
+        }
+        std::sort(entries.begin(), entries.end());
+        for(unsigned int i = 0; i < entries.size(); i++){
+            add(entries[i]);
+        }
+    }
+
+    std::string hex() const {
+        std::stringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << h;
+        return ss.str();
+    }
+
+private:
+    boost::uint64_t h;
+};
+
+}
+
+JobScheduler::JobScheduler(JobListener* listener, unsigned int maxConcurrent, const std::string& cacheDir) :
+    listener(listener), maxConcurrent(0), cacheDir(cacheDir), busy(false), cancelled(false)
+{
+    setMaxConcurrent(maxConcurrent);
+    if(this->cacheDir.empty()){
+        const char* home = getenv("HOME");
+        this->cacheDir = std::string(home != NULL ? home : ".") + "/.testbench/cache";
+    }
+}
+
+JobScheduler::~JobScheduler(){
+    cancel();
+    thread.join();
+}
+
+void JobScheduler::setMaxConcurrent(unsigned int maxConcurrent){
+    if(maxConcurrent == 0){
+        maxConcurrent = boost::thread::hardware_concurrency();
+    }
+    boost::lock_guard<boost::mutex> lock(mutex);
+    this->maxConcurrent = maxConcurrent > 0 ? maxConcurrent : 1;
+}
+
+bool JobScheduler::isRunning() const {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    return busy;
+}
+
+bool JobScheduler::start(const std::vector<Script>& jobs){
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        if(busy){
+            return false;
+        }
+        busy = true;
+        cancelled = false;
+        this->jobs = jobs;
+        queue.clear();
+        for(unsigned int i = 0; i < jobs.size(); i++){
+            queue.push_back(i);
+        }
+    }
+
+    thread.join();
+    thread = boost::thread(&JobScheduler::threadFunc, this);
+    return true;
+}
+
+void JobScheduler::cancel(){
+    boost::lock_guard<boost::mutex> lock(mutex);
+    cancelled = true;
+    for(unsigned int i = 0; i < running.size(); i++){
+        kill(running[i].pid, SIGTERM);
+    }
+}
+
+void JobScheduler::threadFunc(){
+    for(;;){
+        std::vector<unsigned int> skipped;
+        std::vector<unsigned int> toLaunch;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if(cancelled){
+                skipped.assign(queue.begin(), queue.end());
+                queue.clear();
+            }
+            while(running.size() + toLaunch.size() < maxConcurrent && !queue.empty()){
+                toLaunch.push_back(queue.front());
+                queue.pop_front();
+            }
+        }
+
+        for(unsigned int i = 0; i < skipped.size(); i++){
+            listener->jobStateChanged(skipped[i], JOB_CANCELLED);
+        }
+
+        for(unsigned int i = 0; i < toLaunch.size(); i++){
+            unsigned int job = toLaunch[i];
+            std::string key = jobKey(jobs[job]);
+            if(replayCache(job, key)){
+                listener->jobStateChanged(job, JOB_CACHED);
+                continue;
+            }
+
+            Process process;
+            process.key = key;
+            if(launch(job, process)){
+                boost::lock_guard<boost::mutex> lock(mutex);
+                running.push_back(process);
+                // cancel() may have been called between launching and storing the process
+                if(cancelled){
+                    kill(process.pid, SIGTERM);
+                }
+            } else {
+                listener->jobStateChanged(job, JOB_FAILED);
+            }
+        }
+
+        {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if(running.empty() && queue.empty()){
+                break;
+            }
+        }
+        if(running.empty()){
+            continue;
+        }
+
+        // Only this thread modifies running, so it can be read without the lock
+        std::vector<pollfd> fds(running.size());
+        for(unsigned int i = 0; i < running.size(); i++){
+            fds[i].fd = running[i].fd;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        poll(&fds[0], fds.size(), POLL_TIMEOUT_MS);
+
+        for(int i = running.size() - 1; i >= 0; i--){
+            if(fds[i].revents != 0 && !readOutput(running[i])){
+                Process process = running[i];
+                {
+                    boost::lock_guard<boost::mutex> lock(mutex);
+                    running.erase(running.begin() + i);
+                }
+                finish(process);
+            }
+        }
+    }
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        busy = false;
+    }
+    listener->allJobsDone();
+}
+
+bool JobScheduler::launch(unsigned int job, Process& process){
+    const Script& s = jobs[job];
+    unsigned int argCount = s.params.size() + (s.training ? 2 : 1);
+    std::stringstream argCountStr;
+    argCountStr << argCount;
+
+    std::vector<std::string> args;
+    args.push_back(s.python);
+    args.push_back("-c");
+    args.push_back(RUNNER);
+    args.push_back(s.path);
+    args.push_back(s.name);
+    args.push_back(argCountStr.str());
+    for(unsigned int i = 0; i < s.params.size(); i++){
+        args.push_back(s.params[i].value);
+    }
+
+    std::vector<char*> argv;
+    for(unsigned int i = 0; i < args.size(); i++){
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+
+    int fds[2];
+    if(pipe(fds) != 0){
+        return false;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0){
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if(pid == 0){
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    process.job = job;
+    process.pid = pid;
+    process.fd = fds[0];
+    listener->jobStateChanged(job, JOB_RUNNING);
+    return true;
+}
+
+bool JobScheduler::readOutput(Process& process){
+    char buf[4096];
+    ssize_t n;
+    do {
+        n = read(process.fd, buf, sizeof(buf));
+    } while(n < 0 && errno == EINTR);
+    if(n <= 0){
+        return false;
+    }
+
+    process.output.append(buf, n);
+    process.buffer.append(buf, n);
+    JobResult result;
+    while(parseResult(process.buffer, result)){
+        listener->jobResult(process.job, result);
+    }
+    return true;
+}
+
+void JobScheduler::finish(Process& process){
+    int status = 0;
+    waitpid(process.pid, &status, 0);
+    close(process.fd);
+
+    bool wasCancelled;
+    {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        wasCancelled = cancelled;
+    }
+
+    if(WIFEXITED(status) && WEXITSTATUS(status) == 0){
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(cacheDir, ec);
+        // Write to a temporary file and rename it, so an interrupted write or a
+        // concurrent scheduler never leaves a partial result to be replayed
+        std::string file = cacheDir + "/" + process.key;
+        std::string temp = file + boost::filesystem::unique_path(".%%%%%%%%.tmp", ec).string();
+        if(!ec){
+            std::ofstream out(temp.c_str(), std::ios::binary);
+            out << process.output;
+            out.close();
+            if(out.fail() || std::rename(temp.c_str(), file.c_str()) != 0){
+                boost::filesystem::remove(temp, ec);
+            }
+        }
+        listener->jobStateChanged(process.job, JOB_DONE);
+    } else {
+        listener->jobStateChanged(process.job, wasCancelled ? JOB_CANCELLED : JOB_FAILED);
+    }
+}
+
+bool JobScheduler::replayCache(unsigned int job, const std::string& key){
+    std::ifstream in((cacheDir + "/" + key).c_str(), std::ios::binary);
+    if(!in.is_open()){
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << in.rdbuf();
+    std::string buffer = ss.str();
+    JobResult result;
+    while(parseResult(buffer, result)){
+        listener->jobResult(job, result);
+    }
+    return true;
+}
+
+bool JobScheduler::parseResult(std::string& buffer, JobResult& result){
+    static const std::string TYPE = "<type>";
+    static const std::string NAME = "<name>";
+    static const std::string VALUE = "<value>";
+
+    size_t typeBegin = buffer.find(TYPE);
+    if(typeBegin == std::string::npos){
+        return false;
+    }
+    typeBegin += TYPE.size();
+    size_t typeEnd = buffer.find(TYPE, typeBegin);
+    if(typeEnd == std::string::npos){
+        return false;
+    }
+    size_t nameBegin = buffer.find(NAME, typeEnd + TYPE.size());
+    if(nameBegin == std::string::npos){
+        return false;
+    }
+    nameBegin += NAME.size();
+    size_t nameEnd = buffer.find(NAME, nameBegin);
+    if(nameEnd == std::string::npos){
+        return false;
+    }
+    size_t valueBegin = buffer.find(VALUE, nameEnd + NAME.size());
+    if(valueBegin == std::string::npos){
+        return false;
+    }
+    valueBegin += VALUE.size();
+    size_t valueEnd = buffer.find(VALUE, valueBegin);
+    if(valueEnd == std::string::npos){
+        return false;
+    }
+
+    result.type = buffer.substr(typeBegin, typeEnd - typeBegin);
+    result.name = buffer.substr(nameBegin, nameEnd - nameBegin);
+    result.value = buffer.substr(valueBegin, valueEnd - valueBegin);
+    buffer.erase(0, valueEnd + VALUE.size());
+    return true;
+}
+
+std::string JobScheduler::jobKey(const Script& job){
+    using namespace boost::filesystem;
+
+    Hash hash;
+    hash.add(job.python);
+    hash.add(job.path + job.name);
+    hash.addFile(job.path + job.name + ".py");
+    // Training runs get other arguments than normal runs of the same script
+    hash.add(job.training ? "training" : "run");
+
+    for(unsigned int i = 0; i < job.params.size(); i++){
+        const Param& p = job.params[i];
+        hash.add(p.name);
+        hash.add(p.value);
+
+        boost::system::error_code ec;
+        if(is_regular_file(p.value, ec)){
+            hash.addFile(p.value);
+        } else if(is_directory(p.value, ec)){
+            hash.addDirectory(p.value);
+        }
+    }
+
+    return hash.hex();
+}
@@ -0,0 +1,149 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        TestBenchGUI
+// File:           JobScheduler.h
+// Description:    Runs jobs concurrently in worker processes
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <sys/types.h>
+#include <boost/thread.hpp>
+
+#include "Scripts.h"
+
+/**
+ * A single value a job sends back through the pipe protocol:
+ * <type>type<type><name>name<name><value>value<value>
+ */
+struct JobResult {
+    std::string type, name, value;
+};
+
+enum JobState {
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_CACHED,
+    JOB_DONE,
+    JOB_FAILED,
+    JOB_CANCELLED
+};
+
+/**
+ * Receives the progress of the jobs.
+ * All functions are called from the scheduler thread, not the GUI thread.
+ */
+class JobListener {
+public:
+    virtual ~JobListener(){}
+    virtual void jobStateChanged(unsigned int job, JobState state) = 0;
+    virtual void jobResult(unsigned int job, const JobResult& result) = 0;
+    virtual void allJobsDone() = 0;
+};
+
+/**
+ * Runs every job in its own python process, with at most maxConcurrent
+ * processes at the same time. The output of the processes is parsed as it
+ * arrives and passed to the listener.
+ * The output of successful jobs is cached, keyed by the script, its
+ * parameters and the contents of the files and directories the parameters
+ * point to. Jobs with a cached output are not run again.
+ */
+class JobScheduler {
+public:
+    /**
+     * @param listener receives the progress of the jobs
+     * @param maxConcurrent the maximum amount of running jobs, 0 for one per core
+     * @param cacheDir directory for cached results, empty for ~/.testbench/cache
+     */
+    JobScheduler(JobListener* listener, unsigned int maxConcurrent = 0, const std::string& cacheDir = "");
+    ~JobScheduler();
+
+    /**
+     * Starts running the jobs, returns immediately
+     * @return false if jobs are still running
+     */
+    bool start(const std::vector<Script>& jobs);
+
+    /**
+     * Kills the running jobs and skips the queued jobs
+     */
+    void cancel();
+
+    bool isRunning() const;
+
+    void setMaxConcurrent(unsigned int maxConcurrent);
+    unsigned int getMaxConcurrent() const { return maxConcurrent; }
+
+    /**
+     * Takes the first complete result from the front of buffer
+     * @return true if a result was found and removed from the buffer
+     */
+    static bool parseResult(std::string& buffer, JobResult& result);
+
+    /**
+     * @return the cache key of a job
+     */
+    static std::string jobKey(const Script& job);
+
+private:
+    struct Process {
+        unsigned int job;
+        pid_t pid;
+        int fd;
+        std::string key;
+        std::string output;
+        std::string buffer;
+    };
+
+    JobListener* listener;
+    unsigned int maxConcurrent;
+    std::string cacheDir;
+
+    std::vector<Script> jobs;
+    std::deque<unsigned int> queue;
+    std::vector<Process> running;
+
+    mutable boost::mutex mutex;
+    boost::thread thread;
+    bool busy;
+    bool cancelled;
+
+    void threadFunc();
+    bool launch(unsigned int job, Process& process);
+    bool readOutput(Process& process);
+    void finish(Process& process);
+    bool replayCache(unsigned int job, const std::string& key);
+};
+
+#endif
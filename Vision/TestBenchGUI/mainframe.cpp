@@ -55,6 +55,28 @@
 ////@begin XPM images
 ////@end XPM images
 
+DEFINE_EVENT_TYPE(wxEVT_JOB_UPDATE)
+
+/*
+ * Kinds of wxEVT_JOB_UPDATE events, stored in the event id
+ */
+enum {
+    JOB_UPDATE_STATE,
+    JOB_UPDATE_RESULT,
+    JOB_UPDATE_DONE
+};
+
+/*
+ * Columns of the jobs list
+ */
+enum {
+    COLUMN_NAME,
+    COLUMN_TEST,
+    COLUMN_TRAIN,
+    COLUMN_STATUS,
+    COLUMN_RESULTS
+};
+
 
 /*
  * MainFrame type definition
@@ -80,6 +102,8 @@ BEGIN_EVENT_TABLE( MainFrame, wxFrame )
 
 ////@end MainFrame event table entries
 
+    EVT_COMMAND( wxID_ANY, wxEVT_JOB_UPDATE, MainFrame::OnJobUpdate )
+
 END_EVENT_TABLE()
 
 
@@ -123,6 +147,8 @@ MainFrame::~MainFrame()
 {
 ////@begin MainFrame destruction
 ////@end MainFrame destruction
+    // Stops the scheduler thread and its jobs
+    delete jobScheduler;
 }
 
 
@@ -134,6 +160,7 @@ void MainFrame::Init()
 {
 ////@begin MainFrame member initialisation
 ////@end MainFrame member initialisation
+    jobScheduler = new JobScheduler(this);
 }
 
 
@@ -182,9 +209,11 @@ void MainFrame::CreateControls()
 ////@end MainFrame content construction
 
     wxListCtrl* lj = (wxListCtrl*)FindWindowById(ListJobs);
-    lj->InsertColumn(0, _("Name"));
-    lj->InsertColumn(1, _("Test"));
-    lj->InsertColumn(2, _("Train"));
+    lj->InsertColumn(COLUMN_NAME, _("Name"));
+    lj->InsertColumn(COLUMN_TEST, _("Test"));
+    lj->InsertColumn(COLUMN_TRAIN, _("Train"));
+    lj->InsertColumn(COLUMN_STATUS, _("Status"));
+    lj->InsertColumn(COLUMN_RESULTS, _("Results"));
 
     //scripts = new
 }
@@ -253,9 +282,15 @@ void MainFrame::OnButtonAddJobClick( wxCommandEvent& event )
 
 void MainFrame::OnButtonClearJobsClick( wxCommandEvent& event )
 {
+    if(jobScheduler->isRunning()){
+        wxMessageBox(_("Jobs are still running, cancel them first"), _("Error"), wxOK|wxICON_ERROR, this);
+        return;
+    }
+
     int answer = wxMessageBox(_("This will clear all jobs, are you sure?"), _("Confirm"),
         wxOK|wxCANCEL|wxICON_EXCLAMATION, this);
     if(answer == wxOK){
+        jobScheduler->cancel();
         scripts.clear();
 
         wxListCtrl* lj = (wxListCtrl*)FindWindowById(ListJobs);
@@ -272,17 +307,83 @@ void MainFrame::OnButtonClearJobsClick( wxCommandEvent& event )
 
 void MainFrame::OnButtonRunJobsClick( wxCommandEvent& event )
 {
+    wxButton* run = (wxButton*)FindWindowById(ButtonRunJobs);
+    if(jobScheduler->isRunning()){
+        jobScheduler->cancel();
+        run->Disable();
+        return;
+    }
+
     if(!scripts.empty()){
-        for(unsigned int i = 0; i < scripts.size(); i++){
-            try{
-                unsigned int argCount = scripts[i].params.size() + (scripts[i].training ? 2 : 1);
-                callPythonFunc(scripts[i].path.c_str(), scripts[i].name.c_str(), "getResult", scripts[i].params, argCount);
-            } catch(PythonErr &e) {
-                std::cerr << "Error running script:\n";
-                std::cerr <<  e.what();
-            }
+        wxListCtrl* lj = (wxListCtrl*)FindWindowById(ListJobs);
+        for(long i = 0; i < lj->GetItemCount(); i++){
+            lj->SetItem(i, COLUMN_STATUS, _("Queued"));
+            lj->SetItem(i, COLUMN_RESULTS, _(""));
+        }
+
+        // The jobs run in worker processes, the GUI is updated through OnJobUpdate
+        jobScheduler->start(scripts);
+        run->SetLabel(_("Cancel"));
+    }
+}
+
+void MainFrame::jobStateChanged(unsigned int job, JobState state)
+{
+    wxCommandEvent event(wxEVT_JOB_UPDATE, JOB_UPDATE_STATE);
+    event.SetInt(job);
+    event.SetExtraLong(state);
+    AddPendingEvent(event);
+}
+
+void MainFrame::jobResult(unsigned int job, const JobResult& result)
+{
+    wxCommandEvent event(wxEVT_JOB_UPDATE, JOB_UPDATE_RESULT);
+    event.SetInt(job);
+    event.SetString(wxString((result.name + "=" + result.value).c_str(), wxConvUTF8));
+    AddPendingEvent(event);
+}
+
+void MainFrame::allJobsDone()
+{
+    wxCommandEvent event(wxEVT_JOB_UPDATE, JOB_UPDATE_DONE);
+    AddPendingEvent(event);
+}
+
+void MainFrame::OnJobUpdate( wxCommandEvent& event )
+{
+    static const wxString stateNames[] = {
+        _("Queued"), _("Running"), _("Cached"), _("Done"), _("Failed"), _("Cancelled")
+    };
+
+    wxListCtrl* lj = (wxListCtrl*)FindWindowById(ListJobs);
+    // Jobs are inserted at the top of the list
+    long row = lj->GetItemCount() - 1 - event.GetInt();
+
+    switch(event.GetId()){
+    case JOB_UPDATE_STATE:
+        if(row >= 0)
+            lj->SetItem(row, COLUMN_STATUS, stateNames[event.GetExtraLong()]);
+        break;
+    case JOB_UPDATE_RESULT:
+        if(row >= 0){
+            wxListItem item;
+            item.SetId(row);
+            item.SetColumn(COLUMN_RESULTS);
+            item.SetMask(wxLIST_MASK_TEXT);
+            lj->GetItem(item);
+            wxString text = item.GetText();
+            if(!text.IsEmpty())
+                text += _(", ");
+            lj->SetItem(row, COLUMN_RESULTS, text + event.GetString());
         }
+        break;
+    case JOB_UPDATE_DONE: {
+        wxButton* run = (wxButton*)FindWindowById(ButtonRunJobs);
+        run->SetLabel(_("Run"));
+        run->Enable();
         wxMessageBox(_("Done running scripts"), _("Done"), wxOK, this);
+        break;
+    }
     }
 }
 
@@ -45,6 +45,9 @@
 ////@end includes
 
 #include "Scripts.h"
+#include "JobScheduler.h"
+
+DECLARE_EVENT_TYPE(wxEVT_JOB_UPDATE, -1)
 
 /*!
  * Forward declarations
@@ -78,7 +81,7 @@
  * MainFrame class declaration
  */
 
-class MainFrame: public wxFrame
+class MainFrame: public wxFrame, public JobListener
 {
     DECLARE_CLASS( MainFrame )
     DECLARE_EVENT_TABLE()
@@ -130,10 +133,19 @@ public:
     /// Should we show tooltips?
     static bool ShowToolTips();
 
+    /// JobListener functions, called from the scheduler thread
+    void jobStateChanged(unsigned int job, JobState state);
+    void jobResult(unsigned int job, const JobResult& result);
+    void allJobsDone();
+
+    /// wxEVT_JOB_UPDATE event handler, progress of the scheduler on the GUI thread
+    void OnJobUpdate( wxCommandEvent& event );
+
 ////@begin MainFrame member variables
 public:
     std::vector<Script> scripts;
 ////@end MainFrame member variables
+    JobScheduler* jobScheduler;
     std::string callPythonFunc(
         const char* modulePath, const char* moduleName, const char* func, std::vector<Param> params, unsigned int argCount
     );
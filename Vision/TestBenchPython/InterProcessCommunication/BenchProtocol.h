@@ -0,0 +1,222 @@
+#ifndef BENCHPROTOCOL_H
+#define BENCHPROTOCOL_H
+
+// Binary framed protocol for sending results from a C++ program to the
+// python testbench through a pipe. Replaces the <type>..<type> text format
+// of sendOutcomeToBench for arrays and images.
+//
+// Every frame (native byte order):
+//   uint32 magic 'LCVB'
+//   uint32 size of the rest of the frame
+//   uint8  kind (SCALAR, ARRAY, SHARED)
+//   uint8  data type
+//   uint16 name length, followed by the name
+//   SCALAR: the value (STRING: the characters)
+//   ARRAY:  uint32 ndim, uint32 dims[ndim], the elements
+//   SHARED: uint32 ndim, uint32 dims[ndim], uint16 length + name of a
+//           POSIX shared memory object holding the elements. The reader
+//           unlinks the object after reading it.
+//
+// The python side is in benchproto.py.
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sstream>
+
+namespace bench {
+
+const uint32_t MAGIC = 0x4256434C; // "LCVB"
+
+enum FrameKind {
+	SCALAR = 0,
+	ARRAY = 1,
+	SHARED = 2
+};
+
+enum DataType {
+	INT8 = 0,
+	UINT8 = 1,
+	INT16 = 2,
+	UINT16 = 3,
+	INT32 = 4,
+	UINT32 = 5,
+	FLOAT32 = 6,
+	FLOAT64 = 7,
+	STRING = 8
+};
+
+template<typename T> struct TypeOf;
+template<> struct TypeOf<int8_t> { static const DataType type = INT8; };
+template<> struct TypeOf<uint8_t> { static const DataType type = UINT8; };
+template<> struct TypeOf<int16_t> { static const DataType type = INT16; };
+template<> struct TypeOf<uint16_t> { static const DataType type = UINT16; };
+template<> struct TypeOf<int32_t> { static const DataType type = INT32; };
+template<> struct TypeOf<uint32_t> { static const DataType type = UINT32; };
+template<> struct TypeOf<float> { static const DataType type = FLOAT32; };
+template<> struct TypeOf<double> { static const DataType type = FLOAT64; };
+
+/**
+ * Writes frames to a stream, stdout by default.
+ * Arrays of at least sharedThreshold bytes are passed through shared
+ * memory, only their description goes through the pipe.
+ */
+class BenchWriter {
+public:
+	BenchWriter(FILE* out = stdout, size_t sharedThreshold = 1 << 20) :
+			out(out), sharedThreshold(sharedThreshold), sharedCount(0) {
+	}
+
+	~BenchWriter() {
+		fflush(out);
+	}
+
+	void send(const std::string& name, int32_t value) {
+		writeHeader(SCALAR, INT32, name, sizeof(value));
+		fwrite(&value, sizeof(value), 1, out);
+	}
+
+	void send(const std::string& name, double value) {
+		writeHeader(SCALAR, FLOAT64, name, sizeof(value));
+		fwrite(&value, sizeof(value), 1, out);
+	}
+
+	void send(const std::string& name, const std::string& value) {
+		writeHeader(SCALAR, STRING, name, value.size());
+		fwrite(value.data(), 1, value.size(), out);
+	}
+
+	void send(const std::string& name, const char* value) {
+		send(name, std::string(value));
+	}
+
+	/**
+	 * Sends a multi dimensional array
+	 * @param data the elements, row major
+	 * @param dims the size of every dimension
+	 */
+	template<typename T>
+	void sendArray(const std::string& name, const T* data, const std::vector<uint32_t>& dims) {
+		size_t count = 1;
+		for(size_t i = 0; i < dims.size(); i++) {
+			count *= dims[i];
+		}
+		size_t bytes = count * sizeof(T);
+		size_t dimBytes = sizeof(uint32_t) * (1 + dims.size());
+
+		if(bytes >= sharedThreshold) {
+			std::string shmName = createShared(data, bytes);
+			if(!shmName.empty()) {
+				uint16_t len = shmName.size();
+				writeHeader(SHARED, TypeOf<T>::type, name, dimBytes + sizeof(len) + len);
+				writeDims(dims);
+				fwrite(&len, sizeof(len), 1, out);
+				fwrite(shmName.data(), 1, len, out);
+				return;
+			}
+		}
+
+		writeHeader(ARRAY, TypeOf<T>::type, name, dimBytes + bytes);
+		writeDims(dims);
+		fwrite(data, sizeof(T), count, out);
+	}
+
+	template<typename T>
+	void sendArray(const std::string& name, const std::vector<T>& data) {
+		std::vector<uint32_t> dims(1, data.size());
+		sendArray<T>(name, data.empty() ? NULL : &data[0], dims);
+	}
+
+#ifdef __OPENCV_CORE_HPP__
+	/**
+	 * Sends a matrix as an array of rows x cols x channels
+	 */
+	void sendMat(const std::string& name, const cv::Mat& mat) {
+		cv::Mat m = mat.isContinuous() ? mat : mat.clone();
+		std::vector<uint32_t> dims;
+		dims.push_back(m.rows);
+		dims.push_back(m.cols);
+		if(m.channels() > 1) {
+			dims.push_back(m.channels());
+		}
+		switch(m.depth()) {
+		case CV_8U: sendArray(name, m.ptr<uint8_t>(), dims); break;
+		case CV_8S: sendArray(name, m.ptr<int8_t>(), dims); break;
+		case CV_16U: sendArray(name, m.ptr<uint16_t>(), dims); break;
+		case CV_16S: sendArray(name, m.ptr<int16_t>(), dims); break;
+		case CV_32S: sendArray(name, m.ptr<int32_t>(), dims); break;
+		case CV_32F: sendArray(name, m.ptr<float>(), dims); break;
+		case CV_64F: sendArray(name, m.ptr<double>(), dims); break;
+		}
+	}
+#endif
+
+	void flush() {
+		fflush(out);
+	}
+
+private:
+	FILE* out;
+	size_t sharedThreshold;
+	unsigned int sharedCount;
+
+	void writeHeader(FrameKind kind, DataType type, const std::string& name, size_t payload) {
+		uint32_t magic = MAGIC;
+		uint32_t size = 4 + name.size() + payload;
+		uint8_t k = kind;
+		uint8_t t = type;
+		uint16_t len = name.size();
+		fwrite(&magic, sizeof(magic), 1, out);
+		fwrite(&size, sizeof(size), 1, out);
+		fwrite(&k, sizeof(k), 1, out);
+		fwrite(&t, sizeof(t), 1, out);
+		fwrite(&len, sizeof(len), 1, out);
+		fwrite(name.data(), 1, len, out);
+	}
+
+	void writeDims(const std::vector<uint32_t>& dims) {
+		uint32_t ndim = dims.size();
+		fwrite(&ndim, sizeof(ndim), 1, out);
+		if(ndim != 0) {
+			fwrite(&dims[0], sizeof(uint32_t), ndim, out);
+		}
+	}
+
+	/**
+	 * Copies data to a new shared memory object
+	 * @return the name of the object, empty if it could not be created
+	 */
+	std::string createShared(const void* data, size_t bytes) {
+		std::stringstream ss;
+		ss << "/lcvbench." << getpid() << "." << sharedCount++;
+		std::string shmName = ss.str();
+
+		int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		if(fd < 0) {
+			return "";
+		}
+		if(ftruncate(fd, bytes) != 0) {
+			close(fd);
+			shm_unlink(shmName.c_str());
+			return "";
+		}
+		void* mem = mmap(NULL, bytes, PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if(mem == MAP_FAILED) {
+			shm_unlink(shmName.c_str());
+			return "";
+		}
+		memcpy(mem, data, bytes);
+		munmap(mem, bytes);
+		return shmName;
+	}
+};
+
+}
+
+#endif
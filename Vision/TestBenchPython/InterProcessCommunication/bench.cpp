@@ -0,0 +1,41 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <vector>
+#include "BenchProtocol.h"
+using namespace std;
+
+// Sends an array of floats in the text format, one outcome per element,
+// the only way to send an array with sendOutcomeToBench
+void sendText(const vector<float>& data) {
+	for(size_t i = 0; i < data.size(); i++) {
+		stringstream ss;
+		ss << "<type>float<type><name>data<name><value>" << data[i] << "<value>";
+		printf("%s", ss.str().c_str());
+	}
+}
+
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		cerr << "Usage: " << argv[0] << " <text|binary|shared> <megabytes>" << endl;
+		return 1;
+	}
+
+	size_t count = atof(argv[2]) * (1 << 20) / sizeof(float);
+	vector<float> data(count);
+	for(size_t i = 0; i < count; i++) {
+		data[i] = i * 0.5f;
+	}
+
+	if(strcmp(argv[1], "text") == 0) {
+		sendText(data);
+	} else {
+		// Pipe everything in binary frames, or pass the array through shared memory
+		bench::BenchWriter writer(stdout, strcmp(argv[1], "shared") == 0 ? 0 : (size_t)-1);
+		writer.sendArray("data", data);
+	}
+	fflush(stdout);
+	return 0;
+}
@@ -0,0 +1,40 @@
+#!/usr/bin/python
+#
+# Measures the throughput of the text protocol of sendOutcomeToBench
+# against the binary framed protocol of BenchProtocol.h.
+#
+# Usage: ./benchmark.py [megabytes]
+# Needs ./bench, build it with: g++ -O2 -o bench bench.cpp -lrt
+
+import os, re, subprocess, sys, time
+import benchproto
+
+OUTCOME = re.compile(r'<type>(.*?)<type><name>(.*?)<name><value>(.*?)<value>', re.S)
+
+def parse_text(stream):
+	values = [float(m.group(3)) for m in OUTCOME.finditer(stream.read().decode('utf-8'))]
+	return len(values)
+
+def parse_binary(stream):
+	data = benchproto.read_results(stream)['data']
+	if benchproto.numpy is None:
+		dims, data = data
+	return len(data)
+
+def run(mode, megabytes, parse):
+	bench = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'bench')
+	start = time.time()
+	proc = subprocess.Popen([bench, mode, str(megabytes)], stdout=subprocess.PIPE)
+	count = parse(proc.stdout)
+	proc.wait()
+	elapsed = time.time() - start
+	print('%-8s %10d values %8.3f s %10.1f MB/s' % (mode, count, elapsed, megabytes / elapsed))
+
+def main():
+	megabytes = float(sys.argv[1]) if len(sys.argv) > 1 else 16
+	run('text', megabytes, parse_text)
+	run('binary', megabytes, parse_binary)
+	run('shared', megabytes, parse_binary)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,113 @@
+#!/usr/bin/python
+#
+# Reader for the binary framed protocol written by BenchProtocol.h.
+# See BenchProtocol.h for the layout of a frame.
+
+import mmap, os, struct, array
+
+MAGIC = 0x4256434C
+
+SCALAR, ARRAY, SHARED = 0, 1, 2
+
+# data type -> (struct format, array typecode)
+TYPES = {
+	0: ('b', 'b'),
+	1: ('B', 'B'),
+	2: ('h', 'h'),
+	3: ('H', 'H'),
+	4: ('i', 'i'),
+	5: ('I', 'I'),
+	6: ('f', 'f'),
+	7: ('d', 'd'),
+}
+STRING = 8
+
+try:
+	import numpy
+except ImportError:
+	numpy = None
+
+class ProtocolError(Exception):
+	pass
+
+def _read_exact(stream, size):
+	data = stream.read(size)
+	if len(data) != size:
+		raise ProtocolError('unexpected end of stream')
+	return data
+
+def _make_array(dtype, dims, data):
+	"""Returns a numpy array when numpy is available,
+	otherwise a (dims, array.array) tuple"""
+	typecode = TYPES[dtype][1]
+	if numpy is not None:
+		return numpy.frombuffer(data, dtype=numpy.dtype(typecode)).reshape(dims)
+	a = array.array(typecode)
+	a.frombytes(data) if hasattr(a, 'frombytes') else a.fromstring(data)
+	return (tuple(dims), a)
+
+def _read_shared(name, size):
+	path = '/dev/shm/' + name.lstrip('/')
+	fd = os.open(path, os.O_RDONLY)
+	try:
+		if size == 0:
+			return b''
+		m = mmap.mmap(fd, size, mmap.MAP_SHARED, mmap.PROT_READ)
+		data = m[:size]
+		m.close()
+		return data
+	finally:
+		os.close(fd)
+		os.unlink(path)
+
+def _parse_dims(payload, offset):
+	(ndim,) = struct.unpack_from('=I', payload, offset)
+	dims = struct.unpack_from('=%dI' % ndim, payload, offset + 4)
+	count = 1
+	for d in dims:
+		count *= d
+	return list(dims), count, offset + 4 + 4 * ndim
+
+def read_frame(stream):
+	"""Reads one frame, returns (name, value) or None at the end of the stream"""
+	header = stream.read(8)
+	if len(header) == 0:
+		return None
+	if len(header) != 8:
+		raise ProtocolError('unexpected end of stream')
+	magic, size = struct.unpack('=II', header)
+	if magic != MAGIC:
+		raise ProtocolError('bad magic 0x%08x' % magic)
+
+	payload = _read_exact(stream, size)
+	kind, dtype, namelen = struct.unpack_from('=BBH', payload, 0)
+	name = payload[4:4 + namelen].decode('utf-8')
+	offset = 4 + namelen
+
+	if kind == SCALAR:
+		if dtype == STRING:
+			return name, payload[offset:].decode('utf-8')
+		(value,) = struct.unpack_from('=' + TYPES[dtype][0], payload, offset)
+		return name, value
+
+	dims, count, offset = _parse_dims(payload, offset)
+	nbytes = count * struct.calcsize(TYPES[dtype][0])
+	if kind == ARRAY:
+		return name, _make_array(dtype, dims, payload[offset:offset + nbytes])
+	if kind == SHARED:
+		(shmlen,) = struct.unpack_from('=H', payload, offset)
+		shm = payload[offset + 2:offset + 2 + shmlen].decode('utf-8')
+		return name, _make_array(dtype, dims, _read_shared(shm, nbytes))
+	raise ProtocolError('unknown frame kind %d' % kind)
+
+def read_frames(stream):
+	"""Yields (name, value) for every frame in the stream"""
+	while True:
+		frame = read_frame(stream)
+		if frame is None:
+			return
+		yield frame
+
+def read_results(stream):
+	"""Reads all frames into a dictionary"""
+	return dict(read_frames(stream))
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <sstream>
+#include <vector>
+#include "BenchProtocol.h"
 using namespace std;
 void sendOutcomeToBench(string varType, string varName, string varValue) {
 	stringstream ss;
@@ -10,6 +12,13 @@ void sendOutcomeToBench(string varType, string varName, string varValue) {
 }
 
 int main(int argc, char** argv) {
+	if(argc > 1 && strcmp(argv[1], "binary") == 0) {
+		bench::BenchWriter writer;
+		writer.send("intVar", 42);
+		vector<float> histogram(256, 1.0f);
+		writer.sendArray("histogram", histogram);
+		return 0;
+	}
 	sendOutcomeToBench("int","intVar","42");
 	return 0;
 }
@@ -0,0 +1,129 @@
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <map>
+#include <cstdlib>
+#include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <imageMetaData/Types.hpp>
+#include <imageMetaData/Tools.hpp>
+#include <imageMetaData/MetaDataStore.hpp>
+
+#ifdef __CDT_PARSER__
+#define foreach(a, b) for(a : b)
+#else
+#define foreach(a, b) BOOST_FOREACH(a, b)
+#endif
+
+#define DEFAULT_IMAGES 50000
+
+using namespace std;
+using namespace imageMetaData;
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+
+/**
+ * Writes a meta data XML file with a number of generated images
+ */
+void generateSet(const string& path, int count){
+	const char* lighting[] = { "point_light", "diffuse", "fluorescent" };
+	const char* background[] = { "even_green", "even_white", "uneven" };
+
+	ofstream out(path.c_str());
+	out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<metadata>\n";
+	for(int i = 0; i < count; i++){
+		out << "\t<image path=\"/Images/UImage" << i << ".jpg\">\n"
+			<< "\t\t<category name=\"Lighting\" value=\"" << lighting[i % 3] << "\"/>\n"
+			<< "\t\t<category name=\"Background\" value=\"" << background[(i / 3) % 3] << "\"/>\n"
+			<< "\t\t<property name=\"width\" value=\"1280\"/>\n";
+		for(int o = 0; o < 3; o++){
+			out << "\t\t<object>\n"
+				<< "\t\t\t<property name=\"type\" value=\"Crate\"/>\n"
+				<< "\t\t\t<property name=\"x\" value=\"" << (i + o) % 1280 << "\"/>\n"
+				<< "\t\t\t<property name=\"y\" value=\"" << (i * 7 + o) % 960 << "\"/>\n"
+				<< "\t\t\t<property name=\"angle\" value=\"" << (i % 360) + 0.5 << "\"/>\n"
+				<< "\t\t</object>\n";
+		}
+		out << "\t</image>\n";
+	}
+	out << "</metadata>\n";
+}
+
+double msSince(const ptime& start){
+	return (microsec_clock::local_time() - start).total_microseconds() / 1000.0;
+}
+
+int main(int argc, char** argv){
+	string xmlPath = "benchmark.xml";
+	if(argc > 1){
+		xmlPath = argv[1];
+	} else {
+		cout << "Generating " << DEFAULT_IMAGES << " images in " << xmlPath << endl;
+		generateSet(xmlPath, DEFAULT_IMAGES);
+	}
+	string binPath = xmlPath + ".bin";
+
+	cout << setiosflags(ios::left) << setiosflags(ios::fixed) << setprecision(2);
+
+	// Load times
+	ptime start = microsec_clock::local_time();
+	vector<ImageMD> images = getMetaData(xmlPath);
+	cout << setw(32) << "getMetaData" << msSince(start) << " ms" << endl;
+
+	MetaDataStore store;
+	start = microsec_clock::local_time();
+	store.loadXML(xmlPath);
+	cout << setw(32) << "MetaDataStore::loadXML" << msSince(start) << " ms" << endl;
+
+	start = microsec_clock::local_time();
+	store.saveBinary(binPath);
+	cout << setw(32) << "MetaDataStore::saveBinary" << msSince(start) << " ms" << endl;
+
+	start = microsec_clock::local_time();
+	if(!store.loadBinary(binPath)){
+		cout << "Could not read " << binPath << endl;
+		return 1;
+	}
+	cout << setw(32) << "MetaDataStore::loadBinary" << msSince(start) << " ms" << endl;
+
+	// Query times: sum the x of all crates per lighting category
+	map<string, double> anyResult;
+	start = microsec_clock::local_time();
+	foreach(ImageMD& img, images){
+		foreach(Properties& object, img.objects){
+			if(object["type"] == "Crate"){
+				anyResult[img.categories["Lighting"]] += (int)object["x"];
+			}
+		}
+	}
+	cout << setw(32) << "query ImageMD" << msSince(start) << " ms" << endl;
+
+	map<MetaDataStore::Key, double> storeResult;
+	start = microsec_clock::local_time();
+	MetaDataStore::Key type = store.key("type");
+	MetaDataStore::Key crate = store.key("Crate");
+	MetaDataStore::Key x = store.key("x");
+	MetaDataStore::Key lighting = store.key("Lighting");
+	for(size_t i = 0; i < store.size(); i++){
+		MetaDataStore::Image img = store.image(i);
+		for(size_t o = 0; o < img.objectCount(); o++){
+			MetaDataStore::Properties object = img.object(o);
+			if(object.equals(type, crate)){
+				storeResult[img.category(lighting)] += object.getInt(x);
+			}
+		}
+	}
+	cout << setw(32) << "query MetaDataStore" << msSince(start) << " ms" << endl;
+
+	// Both representations have to give the same answer
+	typedef pair<MetaDataStore::Key, double> KeyResult;
+	foreach(KeyResult r, storeResult){
+		if(anyResult[store.str(r.first)] != r.second){
+			cout << "Results differ for " << store.str(r.first) << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -3,9 +3,15 @@
 #include <iomanip>
 #include <set>
 #include <map>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <cstdlib>
 #include <boost/foreach.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <imageMetaData/Types.hpp>
 #include <imageMetaData/Tools.hpp>
+#include <imageMetaData/Evaluator.hpp>
 #include <report/Report.hpp>
 #include <report/CategoryOverview.hpp>
 #include <report/ReportHistogram.hpp>
@@ -24,16 +30,46 @@ using namespace std;
 using namespace imageMetaData;
 using namespace report;
 
+/**
+ * Decoder for the example, reads the raw bytes of the image file.
+ * A real test bench would decode with e.g. cv::imread.
+ */
+string readImage(const string& path){
+	ifstream in(path.c_str(), ios::binary);
+	if(!in.is_open()){
+		throw runtime_error("can not open " + path);
+	}
+	return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+/**
+ * Test function for the example, called concurrently for every image
+ */
+bool testImage(const ImageMD& img, const string& image, RESULT_TYPE& result){
+	// Do something with the image
+	// ...
+
+	int width = 1200; // int width = image.width;
+	// Check if the obtained result corresponds with the given property
+	Properties::const_iterator x;
+	if(!img.objects.empty() && (x = img.objects[0].find("x")) != img.objects[0].end()){
+		AnyType value = x->second;
+		result = abs(12 - (int)value) / (double)width;
+		return result <= MAX_DEVIATION;
+	}
+	return false;
+}
+
 int main(int argc, char** argv){
-	if (argc < 3) {
-		cout << "Usage: main <xml path> <xml root tag>\n";
+	if (argc < 2) {
+		cout << "Usage: main <xml path> [runs]\n";
 		return 1;
 	}
 
 	cout << setiosflags(ios::left) << setiosflags(ios::fixed);
 
 	// Load the metadata of the images from an XML file
-	vector<ImageMD> images = getMetaData(argv[1], argv[2]);
+	vector<ImageMD> images = getMetaData(argv[1]);
 
 	// Create a container for storing the result per image.
 	// Here we use a double as result, but this can be anything
@@ -41,30 +77,21 @@ int main(int argc, char** argv){
 	// Create a container for storing the categories and their results
 	CategoriesResults catsResults;
 
-	// Loop through all the images
-	foreach(ImageMD& img, images){
-		bool test = false;
-
-		// Do something with the image
-		// ...
-
-		int width = 1200; // int width = image.width;
-		// Check if the obtained result corresponds with the given property
-		if(!img.objects.empty() && ContainsKey(img.objects[0], string("x"))){
-			double deviation = abs(12 - img.objects[0]["x"]) / (double)width;
-			imgResults[img.path] = deviation;
-			test = (deviation <= MAX_DEVIATION);
-		}
-
-		// Store the results in the categories container
-		foreach(Category c, img.categories){
-			if(test){
-				// Increment number of correct images in category
-				catsResults[c.first][c.second].first++;
-			}
-			// Increment total number images in category
-			catsResults[c.first][c.second].second++;
-		}
+	// Test all the images in parallel. Repeated runs over the same
+	// set take the decoded images from the cache of the evaluator
+	Evaluator<string, RESULT_TYPE> evaluator(readImage);
+	int runs = argc > 2 ? atoi(argv[2]) : 1;
+	for(int i = 0; i < runs; i++){
+		boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+		imgResults.clear();
+		catsResults = evaluator.run(images, testImage, &imgResults);
+		cout << "Run " << i << ": "
+			<< (boost::posix_time::microsec_clock::local_time() - start).total_milliseconds()
+			<< " ms" << endl;
+	}
+
+	foreach(const string& failure, evaluator.getFailures()){
+		cout << "Image " << failure << " could not be read" << endl;
 	}
 
 //========================================================================
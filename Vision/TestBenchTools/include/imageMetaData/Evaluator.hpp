@@ -0,0 +1,361 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        TestBenchTools
+// File:           Evaluator.hpp
+// Description:    Runs a test function over a set of images in parallel,
+//                 with prefetched decoding and a cache of decoded images.
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD
+//
+// Copyright © 2012, HU University of Applied Sciences Utrecht.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <exception>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <imageMetaData/Types.hpp>
+
+namespace imageMetaData {
+
+//========================================================================
+// ImageCache class (holds decoded images between runs)
+//========================================================================
+/**
+ * Thread safe cache of decoded images, keyed by image path.
+ * When the capacity is reached the oldest image is evicted.
+ */
+template<typename Image>
+class ImageCache {
+public:
+	typedef boost::shared_ptr<const Image> ImagePtr;
+
+	/**
+	 * Constructor
+	 * @param capacity the maximum amount of cached images, 0 for unlimited
+	 */
+	ImageCache(size_t capacity = 0) :
+			capacity(capacity) {
+	}
+
+	/**
+	 * Looks up a decoded image
+	 * @param path the path of the image
+	 * @return the cached image, or an empty pointer if it is not cached
+	 */
+	ImagePtr get(const std::string& path) const {
+		boost::lock_guard<boost::mutex> lock(mutex);
+		typename std::map<std::string, ImagePtr>::const_iterator it = images.find(path);
+		return it == images.end() ? ImagePtr() : it->second;
+	}
+
+	/**
+	 * Stores a decoded image
+	 * @param path the path of the image
+	 * @param image the decoded image
+	 */
+	void put(const std::string& path, ImagePtr image) {
+		boost::lock_guard<boost::mutex> lock(mutex);
+		if(images.find(path) == images.end()) {
+			if(capacity != 0 && images.size() >= capacity) {
+				images.erase(order.front());
+				order.pop_front();
+			}
+			order.push_back(path);
+		}
+		images[path] = image;
+	}
+
+	/**
+	 * Removes all images from the cache
+	 */
+	void clear() {
+		boost::lock_guard<boost::mutex> lock(mutex);
+		images.clear();
+		order.clear();
+	}
+
+	/**
+	 * @return the amount of cached images
+	 */
+	size_t size() const {
+		boost::lock_guard<boost::mutex> lock(mutex);
+		return images.size();
+	}
+
+private:
+	mutable boost::mutex mutex;
+	size_t capacity;
+	std::map<std::string, ImagePtr> images;
+	std::deque<std::string> order;
+};
+
+//========================================================================
+// Evaluator class (runs a test over a set of images)
+//========================================================================
+/**
+ * The Evaluator runs a test function over a set of images.
+ * Images are decoded by a pool of decode threads that stay at most
+ * a fixed amount of images ahead of the test threads. Each test thread
+ * keeps its own results, which are merged when all threads are done,
+ * so the test function itself never contends for a lock.
+ * Decoded images are kept in a cache, so running the same set again
+ * skips decoding.
+ *
+ * Image is the type returned by the decoder, e.g. cv::Mat.
+ * Result is the per image result, e.g. a deviation.
+ */
+template<typename Image, typename Result = double>
+class Evaluator {
+public:
+	typedef typename ImageCache<Image>::ImagePtr ImagePtr;
+
+	/**
+	 * Decodes the image at the given path.
+	 * May throw a std::exception when the image can not be decoded.
+	 */
+	typedef boost::function<Image (const std::string&)> Decoder;
+
+	/**
+	 * Tests a single image. Is called concurrently from multiple threads.
+	 * An exception thrown by the test counts the image as incorrect and
+	 * adds it to the failures.
+	 * Stores the result of the image in the last argument and returns
+	 * true if the image is considered correct.
+	 */
+	typedef boost::function<bool (const ImageMD&, const Image&, Result&)> Test;
+
+	/**
+	 * Constructor
+	 * @param decoder the function that decodes an image
+	 * @param threads the amount of test threads, 0 for one per core
+	 * @param decodeThreads the amount of decode threads, 0 for half the test threads
+	 * @param prefetch the amount of images decoded ahead, 0 for twice the test threads
+	 * @param cacheCapacity the maximum amount of cached images, 0 for unlimited
+	 */
+	Evaluator(Decoder decoder, unsigned int threads = 0, unsigned int decodeThreads = 0,
+			size_t prefetch = 0, size_t cacheCapacity = 0) :
+			decoder(decoder), threads(threads), decodeThreads(decodeThreads),
+			prefetch(prefetch), imageCache(cacheCapacity), images(NULL) {
+		if(this->threads == 0) {
+			this->threads = boost::thread::hardware_concurrency();
+			if(this->threads == 0) {
+				this->threads = 1;
+			}
+		}
+		if(this->decodeThreads == 0) {
+			this->decodeThreads = this->threads > 1 ? this->threads / 2 : 1;
+		}
+		if(this->prefetch == 0) {
+			this->prefetch = this->threads * 2;
+		}
+	}
+
+	/**
+	 * Runs the test over all images
+	 * @param images the images with their metadata
+	 * @param test the test function
+	 * @param imgResults if not NULL, receives the result per image path
+	 * @return the results per category
+	 */
+	CategoriesResults run(const std::vector<ImageMD>& images, Test test,
+			std::map<std::string, Result>* imgResults = NULL) {
+		this->images = &images;
+		this->test = test;
+		nextDecode = 0;
+		decoded = 0;
+		queue.clear();
+		failures.clear();
+
+		results.assign(images.size(), Result());
+		evaluated.assign(images.size(), 0);
+		accumulators.assign(threads, CategoriesResults());
+
+		boost::thread_group group;
+		for(unsigned int i = 0; i < decodeThreads; i++) {
+			group.create_thread(boost::bind(&Evaluator::decodeThreadFunc, this));
+		}
+		for(unsigned int i = 0; i < threads; i++) {
+			group.create_thread(boost::bind(&Evaluator::testThreadFunc, this, i));
+		}
+		group.join_all();
+
+		CategoriesResults catsResults;
+		for(size_t t = 0; t < accumulators.size(); t++) {
+			merge(catsResults, accumulators[t]);
+		}
+
+		if(imgResults != NULL) {
+			for(size_t i = 0; i < images.size(); i++) {
+				if(evaluated[i]) {
+					(*imgResults)[images[i].path] = results[i];
+				}
+			}
+		}
+
+		this->images = NULL;
+		return catsResults;
+	}
+
+	/**
+	 * @return the paths of the images that could not be decoded or tested during the last run
+	 */
+	const std::vector<std::string>& getFailures() const {
+		return failures;
+	}
+
+	/**
+	 * @return the cache with decoded images
+	 */
+	ImageCache<Image>& cache() {
+		return imageCache;
+	}
+
+private:
+	Decoder decoder;
+	Test test;
+	unsigned int threads;
+	unsigned int decodeThreads;
+	size_t prefetch;
+	ImageCache<Image> imageCache;
+
+	const std::vector<ImageMD>* images;
+	std::vector<Result> results;
+	std::vector<char> evaluated;
+	std::vector<CategoriesResults> accumulators;
+	std::vector<std::string> failures;
+
+	boost::mutex queueMutex;
+	boost::condition_variable queueNotFull;
+	boost::condition_variable queueNotEmpty;
+	std::deque<std::pair<size_t, ImagePtr> > queue;
+	size_t nextDecode;
+	size_t decoded;
+
+	void decodeThreadFunc() {
+		for(;;) {
+			size_t index;
+			{
+				boost::unique_lock<boost::mutex> lock(queueMutex);
+				while(queue.size() >= prefetch) {
+					queueNotFull.wait(lock);
+				}
+				if(nextDecode >= images->size()) {
+					return;
+				}
+				index = nextDecode++;
+			}
+
+			const std::string& path = (*images)[index].path;
+			ImagePtr image = imageCache.get(path);
+			if(!image) {
+				try {
+					image.reset(new Image(decoder(path)));
+					imageCache.put(path, image);
+				} catch(std::exception&) {
+					image.reset();
+				} catch(...) {
+					image.reset();
+				}
+			}
+
+			boost::lock_guard<boost::mutex> lock(queueMutex);
+			if(!image) {
+				failures.push_back(path);
+			}
+			queue.push_back(std::make_pair(index, image));
+			decoded++;
+			queueNotEmpty.notify_one();
+		}
+	}
+
+	void testThreadFunc(unsigned int thread) {
+		CategoriesResults& catsResults = accumulators[thread];
+		for(;;) {
+			std::pair<size_t, ImagePtr> item;
+			{
+				boost::unique_lock<boost::mutex> lock(queueMutex);
+				while(queue.empty()) {
+					if(decoded >= images->size()) {
+						queueNotEmpty.notify_all();
+						return;
+					}
+					queueNotEmpty.wait(lock);
+				}
+				item = queue.front();
+				queue.pop_front();
+				queueNotFull.notify_one();
+			}
+
+			const ImageMD& img = (*images)[item.first];
+			bool correct = false;
+			if(item.second) {
+				bool failed = false;
+				try {
+					correct = test(img, *item.second, results[item.first]);
+					evaluated[item.first] = 1;
+				} catch(std::exception&) {
+					failed = true;
+				} catch(...) {
+					failed = true;
+				}
+				if(failed) {
+					correct = false;
+					boost::lock_guard<boost::mutex> lock(queueMutex);
+					failures.push_back(img.path);
+				}
+			}
+
+			for(std::map<std::string, std::string>::const_iterator it = img.categories.begin();
+					it != img.categories.end(); ++it) {
+				std::pair<int, int>& counts = catsResults[it->first][it->second];
+				if(correct) {
+					counts.first++;
+				}
+				counts.second++;
+			}
+		}
+	}
+
+	static void merge(CategoriesResults& dst, const CategoriesResults& src) {
+		for(CategoriesResults::const_iterator cat = src.begin(); cat != src.end(); ++cat) {
+			for(std::map<std::string, std::pair<int, int> >::const_iterator sub = cat->second.begin();
+					sub != cat->second.end(); ++sub) {
+				std::pair<int, int>& counts = dst[cat->first][sub->first];
+				counts.first += sub->second.first;
+				counts.second += sub->second.second;
+			}
+		}
+	}
+};
+
+}
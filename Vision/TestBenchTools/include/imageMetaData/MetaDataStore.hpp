@@ -0,0 +1,340 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        TestBenchTools
+// File:           MetaDataStore.hpp
+// Description:    Compact, typed storage of image meta data with interned
+//                 keys and a binary cache format.
+// Author:         agent
+// Notes:          ...
+//
+// License: newBSD
+//
+// Copyright © 2012, HU University of Applied Sciences Utrecht.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <imageMetaData/Types.hpp>
+
+namespace imageMetaData {
+
+//========================================================================
+// MetaDataStore class (compact, typed image meta data)
+//========================================================================
+/**
+ * The MetaDataStore holds the meta data of a set of images in a few flat
+ * arrays instead of a map of AnyType objects per image.
+ * All names and string values are interned: a name is looked up once with
+ * key() and the returned Key is used for every access after that.
+ * Properties are stored with their type, so reading them does not need a
+ * cast or a string comparison.
+ *
+ * The XML file stays the source of truth. load() keeps a binary copy next
+ * to it, which is used as long as the XML file is not modified.
+ */
+class MetaDataStore {
+public:
+	/**
+	 * An interned name or string value
+	 */
+	typedef unsigned int Key;
+
+	/**
+	 * Key returned for names that do not occur in the store
+	 */
+	static const Key NO_KEY = ~0u;
+
+	/**
+	 * Type of a property value, determined when the XML is parsed
+	 */
+	enum ValueType {
+		INT = 0,
+		DOUBLE = 1,
+		STRING = 2
+	};
+
+	/**
+	 * A single property, 16 bytes
+	 */
+	struct Value {
+		Key key;					///< The name of the property
+		unsigned int type;			///< The ValueType of the property
+		union {
+			int i;					///< The value if type is INT
+			double d;				///< The value if type is DOUBLE
+			Key s;					///< The interned value if type is STRING
+		};
+	};
+
+	/**
+	 * Read only view on the properties of an image or an object.
+	 * Lookups are a binary search over the (sorted) keys of the properties.
+	 */
+	class Properties {
+	public:
+		/**
+		 * @param key the name of the property
+		 * @return true if the property exists
+		 */
+		bool has(Key key) const {
+			return find(key) != NULL;
+		}
+
+		/**
+		 * @param key the name of the property
+		 * @return the type of the property
+		 * @throw std::out_of_range if the property does not exist
+		 */
+		ValueType type(Key key) const;
+
+		/**
+		 * @param key the name of the property
+		 * @return the value of an INT property
+		 * @throw std::out_of_range if the property does not exist
+		 * @throw std::invalid_argument if the property is not an INT
+		 */
+		int getInt(Key key) const;
+
+		/**
+		 * @param key the name of the property
+		 * @return the value of an INT or DOUBLE property
+		 * @throw std::out_of_range if the property does not exist
+		 * @throw std::invalid_argument if the property is a STRING
+		 */
+		double getDouble(Key key) const;
+
+		/**
+		 * @param key the name of the property
+		 * @return the value of a STRING property
+		 * @throw std::out_of_range if the property does not exist
+		 * @throw std::invalid_argument if the property is not a STRING
+		 */
+		const std::string& getString(Key key) const;
+
+		/**
+		 * @param key the name of the property
+		 * @param value the interned value to compare with
+		 * @return true if the property is a STRING equal to value
+		 */
+		bool equals(Key key, Key value) const;
+
+		/**
+		 * @return the amount of properties
+		 */
+		size_t size() const {
+			return end - begin;
+		}
+
+		/**
+		 * @param i the index of the property
+		 * @return the property at index i, sorted by key
+		 */
+		const Value& at(size_t i) const;
+
+	private:
+		friend class MetaDataStore;
+		Properties(const MetaDataStore* store, unsigned int begin, unsigned int end) :
+				store(store), begin(begin), end(end) {
+		}
+
+		const Value* find(Key key) const;
+		const Value& get(Key key) const;
+
+		const MetaDataStore* store;
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	/**
+	 * Read only view on a single image
+	 */
+	class Image {
+	public:
+		/**
+		 * @return the path to the image
+		 */
+		const std::string& path() const;
+
+		/**
+		 * @return the file name of the image
+		 */
+		const std::string& name() const;
+
+		/**
+		 * @param category the name of the category
+		 * @return the interned sub category of the image, or NO_KEY if the image is not in the category
+		 */
+		Key category(Key category) const;
+
+		/**
+		 * @return the amount of categories the image is in
+		 */
+		size_t categoryCount() const;
+
+		/**
+		 * @param i the index of the category
+		 * @return the category at index i as a pair of interned names
+		 */
+		std::pair<Key, Key> categoryAt(size_t i) const;
+
+		/**
+		 * @return the properties of the entire image
+		 */
+		Properties properties() const;
+
+		/**
+		 * @return the amount of objects in the image
+		 */
+		size_t objectCount() const;
+
+		/**
+		 * @param i the index of the object
+		 * @return the properties of the object
+		 */
+		Properties object(size_t i) const;
+
+		/**
+		 * @return the meta data of this image as an ImageMD object
+		 */
+		ImageMD toImageMD() const;
+
+	private:
+		friend class MetaDataStore;
+		Image(const MetaDataStore* store, size_t index) :
+				store(store), index(index) {
+		}
+
+		const MetaDataStore* store;
+		size_t index;
+	};
+
+	/**
+	 * Creates an empty store
+	 */
+	MetaDataStore();
+
+	/**
+	 * Loads the meta data of an XML file, using a binary cache when it is up to date.
+	 * If the cache is missing or older than the XML file, the XML file is parsed
+	 * and the cache is rewritten.
+	 * @param xmlFile the path of the XML file containing the meta data
+	 * @param cacheFile the path of the binary cache, empty for xmlFile + ".bin"
+	 */
+	void load(const std::string& xmlFile, std::string cacheFile = "");
+
+	/**
+	 * Parses the meta data of an XML file, in the same format as getMetaData()
+	 * @param xmlFile the path of the XML file containing the meta data
+	 */
+	void loadXML(const std::string& xmlFile);
+
+	/**
+	 * Reads a binary cache written by saveBinary()
+	 * @param path the path of the binary cache
+	 * @param xmlFile if not empty, the cache is rejected if it was not created from this XML file as it is now
+	 * @return true if the cache was read, false if it is missing, corrupt or out of date
+	 */
+	bool loadBinary(const std::string& path, const std::string& xmlFile = "");
+
+	/**
+	 * Writes the store to a binary cache
+	 * @param path the path of the binary cache
+	 * @return true if saved successfully, false otherwise
+	 */
+	bool saveBinary(const std::string& path) const;
+
+	/**
+	 * Looks up the interned key of a name or string value
+	 * @param name the name
+	 * @return the key, or NO_KEY if the name does not occur in the store
+	 */
+	Key key(const std::string& name) const;
+
+	/**
+	 * @param key an interned key
+	 * @return the string of the key, or an empty string for NO_KEY
+	 */
+	const std::string& str(Key key) const {
+		static const std::string empty;
+		return key < strings.size() ? strings[key] : empty;
+	}
+
+	/**
+	 * @return the amount of images
+	 */
+	size_t size() const {
+		return images.size();
+	}
+
+	/**
+	 * @param i the index of the image
+	 * @return a view on the image
+	 */
+	Image image(size_t i) const {
+		return Image(this, i);
+	}
+
+	/**
+	 * @return the meta data of all images as ImageMD objects
+	 */
+	std::vector<ImageMD> toImageMD() const;
+
+private:
+	struct ImageRecord {
+		Key path;
+		Key name;
+		unsigned int categoryBegin;
+		unsigned int categoryEnd;
+		unsigned int propertyBegin;
+		unsigned int propertyEnd;
+		unsigned int objectBegin;
+		unsigned int objectEnd;
+	};
+
+	struct Range {
+		unsigned int begin;
+		unsigned int end;
+	};
+
+	std::vector<std::string> strings;
+	std::vector<Key> sortedKeys;
+	std::vector<ImageRecord> images;
+	std::vector<std::pair<Key, Key> > categories;
+	std::vector<Range> objects;
+	std::vector<Value> values;
+
+	// Only used while parsing XML
+	std::map<std::string, Key> internMap;
+
+	void clear();
+	Key intern(const std::string& str);
+	void addValue(const std::string& name, const std::string& value);
+	void sortValues(unsigned int begin);
+	void buildIndex();
+	bool isValid() const;
+};
+
+}
@@ -0,0 +1,557 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        TestBenchTools
+// File:           MetaDataStore.cpp
+// Description:    Compact, typed storage of image meta data with interned
+//                 keys and a binary cache format.
+// Author:         agent
+// Notes:          ...
+//
+// License:        GNU GPL v3
+//
+// This file is part of TestBenchTools.
+//
+// TestBenchTools is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// TestBenchTools is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with TestBenchTools.  If not, see <http://www.gnu.org/licenses/>.
+//******************************************************************************
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+#include <boost/foreach.hpp>
+#include <boost/filesystem.hpp>
+#include <imageMetaData/MetaDataStore.hpp>
+#include <imageMetaData/Tools.hpp>
+
+#ifdef __CDT_PARSER__
+#define foreach(a, b) for(a : b)
+#else
+#define foreach(a, b) BOOST_FOREACH(a, b)
+#endif
+
+namespace {
+
+const char BINARY_MAGIC[8] = { 'L', 'C', 'V', 'M', 'D', '0', '0', '1' };
+
+/**
+ * Identifies the XML file a binary cache was created from
+ */
+struct XMLStamp {
+	boost::uint64_t size;
+	boost::int64_t modified;
+};
+
+XMLStamp stampOf(const std::string& xmlFile) {
+	XMLStamp stamp;
+	stamp.size = boost::filesystem::file_size(xmlFile);
+	stamp.modified = boost::filesystem::last_write_time(xmlFile);
+	return stamp;
+}
+
+template<typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& v) {
+	boost::uint32_t count = v.size();
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	if(count != 0) {
+		out.write(reinterpret_cast<const char*>(&v[0]), count * sizeof(T));
+	}
+}
+
+template<typename T>
+bool readArray(std::ifstream& in, std::streamoff fileSize, std::vector<T>& v) {
+	boost::uint32_t count = 0;
+	if(!in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+		return false;
+	}
+	// A corrupt count must not make us allocate more than the file holds
+	std::streamoff remaining = fileSize - in.tellg();
+	if(remaining < 0 || count > static_cast<boost::uint64_t>(remaining) / sizeof(T)) {
+		return false;
+	}
+	v.resize(count);
+	if(count != 0) {
+		in.read(reinterpret_cast<char*>(&v[0]), count * sizeof(T));
+	}
+	return !in.fail();
+}
+
+/**
+ * Orders interned keys by their string
+ */
+struct KeyLess {
+	const std::vector<std::string>& strings;
+	KeyLess(const std::vector<std::string>& strings) : strings(strings) {
+	}
+	bool operator()(imageMetaData::MetaDataStore::Key lhs, imageMetaData::MetaDataStore::Key rhs) const {
+		return strings[lhs] < strings[rhs];
+	}
+	bool operator()(imageMetaData::MetaDataStore::Key lhs, const std::string& rhs) const {
+		return strings[lhs] < rhs;
+	}
+};
+
+bool valueKeyLess(const imageMetaData::MetaDataStore::Value& lhs,
+		const imageMetaData::MetaDataStore::Value& rhs) {
+	return lhs.key < rhs.key;
+}
+
+bool valueKeyEqual(const imageMetaData::MetaDataStore::Value& lhs,
+		const imageMetaData::MetaDataStore::Value& rhs) {
+	return lhs.key == rhs.key;
+}
+
+}
+
+//========================================================================
+// Properties
+//========================================================================
+
+const imageMetaData::MetaDataStore::Value* imageMetaData::MetaDataStore::Properties::find(Key key) const {
+	const Value* first = store->values.empty() ? NULL : &store->values[0] + begin;
+	const Value* last = first + (end - begin);
+	Value target;
+	target.key = key;
+	const Value* it = std::lower_bound(first, last, target, valueKeyLess);
+	return (it != last && it->key == key) ? it : NULL;
+}
+
+const imageMetaData::MetaDataStore::Value& imageMetaData::MetaDataStore::Properties::get(Key key) const {
+	const Value* value = find(key);
+	if(value == NULL) {
+		throw std::out_of_range("property does not exist");
+	}
+	return *value;
+}
+
+imageMetaData::MetaDataStore::ValueType imageMetaData::MetaDataStore::Properties::type(Key key) const {
+	return static_cast<ValueType>(get(key).type);
+}
+
+int imageMetaData::MetaDataStore::Properties::getInt(Key key) const {
+	const Value& value = get(key);
+	if(value.type != INT) {
+		throw std::invalid_argument("property " + store->str(key) + " is not an integer");
+	}
+	return value.i;
+}
+
+double imageMetaData::MetaDataStore::Properties::getDouble(Key key) const {
+	const Value& value = get(key);
+	if(value.type == INT) {
+		return value.i;
+	} else if(value.type != DOUBLE) {
+		throw std::invalid_argument("property " + store->str(key) + " is not a number");
+	}
+	return value.d;
+}
+
+const std::string& imageMetaData::MetaDataStore::Properties::getString(Key key) const {
+	const Value& value = get(key);
+	if(value.type != STRING) {
+		throw std::invalid_argument("property " + store->str(key) + " is not a string");
+	}
+	return store->str(value.s);
+}
+
+bool imageMetaData::MetaDataStore::Properties::equals(Key key, Key value) const {
+	const Value* v = find(key);
+	return v != NULL && v->type == STRING && v->s == value;
+}
+
+const imageMetaData::MetaDataStore::Value& imageMetaData::MetaDataStore::Properties::at(size_t i) const {
+	return store->values[begin + i];
+}
+
+//========================================================================
+// Image
+//========================================================================
+
+const std::string& imageMetaData::MetaDataStore::Image::path() const {
+	return store->str(store->images[index].path);
+}
+
+const std::string& imageMetaData::MetaDataStore::Image::name() const {
+	return store->str(store->images[index].name);
+}
+
+imageMetaData::MetaDataStore::Key imageMetaData::MetaDataStore::Image::category(Key category) const {
+	const ImageRecord& rec = store->images[index];
+	for(unsigned int i = rec.categoryBegin; i < rec.categoryEnd; i++) {
+		if(store->categories[i].first == category) {
+			return store->categories[i].second;
+		}
+	}
+	return NO_KEY;
+}
+
+size_t imageMetaData::MetaDataStore::Image::categoryCount() const {
+	const ImageRecord& rec = store->images[index];
+	return rec.categoryEnd - rec.categoryBegin;
+}
+
+std::pair<imageMetaData::MetaDataStore::Key, imageMetaData::MetaDataStore::Key>
+imageMetaData::MetaDataStore::Image::categoryAt(size_t i) const {
+	return store->categories[store->images[index].categoryBegin + i];
+}
+
+imageMetaData::MetaDataStore::Properties imageMetaData::MetaDataStore::Image::properties() const {
+	const ImageRecord& rec = store->images[index];
+	return Properties(store, rec.propertyBegin, rec.propertyEnd);
+}
+
+size_t imageMetaData::MetaDataStore::Image::objectCount() const {
+	const ImageRecord& rec = store->images[index];
+	return rec.objectEnd - rec.objectBegin;
+}
+
+imageMetaData::MetaDataStore::Properties imageMetaData::MetaDataStore::Image::object(size_t i) const {
+	const Range& range = store->objects[store->images[index].objectBegin + i];
+	return Properties(store, range.begin, range.end);
+}
+
+imageMetaData::ImageMD imageMetaData::MetaDataStore::Image::toImageMD() const {
+	ImageMD imd(path(), name());
+
+	for(size_t i = 0; i < categoryCount(); i++) {
+		std::pair<Key, Key> c = categoryAt(i);
+		imd.categories[store->str(c.first)] = store->str(c.second);
+	}
+
+	for(size_t o = 0; o <= objectCount(); o++) {
+		Properties props = o == 0 ? properties() : object(o - 1);
+		imageMetaData::Properties converted;
+		for(size_t i = 0; i < props.size(); i++) {
+			const Value& v = props.at(i);
+			switch(v.type) {
+			case INT:
+				converted[store->str(v.key)] = v.i;
+				break;
+			case DOUBLE:
+				converted[store->str(v.key)] = v.d;
+				break;
+			default:
+				converted[store->str(v.key)] = store->str(v.s);
+				break;
+			}
+		}
+		if(o == 0) {
+			imd.properties = converted;
+		} else {
+			imd.objects.push_back(converted);
+		}
+	}
+
+	return imd;
+}
+
+//========================================================================
+// MetaDataStore
+//========================================================================
+
+imageMetaData::MetaDataStore::MetaDataStore() {
+}
+
+void imageMetaData::MetaDataStore::clear() {
+	strings.clear();
+	sortedKeys.clear();
+	images.clear();
+	categories.clear();
+	objects.clear();
+	values.clear();
+	internMap.clear();
+}
+
+imageMetaData::MetaDataStore::Key imageMetaData::MetaDataStore::intern(const std::string& str) {
+	std::map<std::string, Key>::iterator it = internMap.lower_bound(str);
+	if(it != internMap.end() && it->first == str) {
+		return it->second;
+	}
+	Key key = strings.size();
+	strings.push_back(str);
+	internMap.insert(it, std::make_pair(str, key));
+	return key;
+}
+
+void imageMetaData::MetaDataStore::addValue(const std::string& name, const std::string& str) {
+	Value value;
+	value.key = intern(name);
+
+	// Same interpretation as AnyTypeFromString
+	std::stringstream ss;
+	ss << str;
+	if(str.find_first_of('.') == std::string::npos) {
+		ss >> value.i;
+		value.type = INT;
+	} else {
+		ss >> value.d;
+		value.type = DOUBLE;
+	}
+	if(ss.fail()) {
+		value.s = intern(str);
+		value.type = STRING;
+	}
+
+	values.push_back(value);
+}
+
+void imageMetaData::MetaDataStore::sortValues(unsigned int begin) {
+	// Keep the last value of duplicate names, like assigning to a map would
+	std::reverse(values.begin() + begin, values.end());
+	std::stable_sort(values.begin() + begin, values.end(), valueKeyLess);
+	values.erase(std::unique(values.begin() + begin, values.end(), valueKeyEqual), values.end());
+}
+
+void imageMetaData::MetaDataStore::buildIndex() {
+	sortedKeys.resize(strings.size());
+	for(Key k = 0; k < sortedKeys.size(); k++) {
+		sortedKeys[k] = k;
+	}
+	std::sort(sortedKeys.begin(), sortedKeys.end(), KeyLess(strings));
+	internMap.clear();
+}
+
+bool imageMetaData::MetaDataStore::isValid() const {
+	// Every index read from a binary cache must stay within its table
+	if(sortedKeys.size() != strings.size()) {
+		return false;
+	}
+	for(size_t i = 0; i < sortedKeys.size(); i++) {
+		if(sortedKeys[i] >= strings.size()
+				|| (i != 0 && strings[sortedKeys[i]] < strings[sortedKeys[i - 1]])) {
+			return false;
+		}
+	}
+	foreach(const ImageRecord& rec, images) {
+		if(rec.path >= strings.size() || rec.name >= strings.size()
+				|| rec.categoryBegin > rec.categoryEnd || rec.categoryEnd > categories.size()
+				|| rec.propertyBegin > rec.propertyEnd || rec.propertyEnd > values.size()
+				|| rec.objectBegin > rec.objectEnd || rec.objectEnd > objects.size()) {
+			return false;
+		}
+	}
+	for(size_t i = 0; i < categories.size(); i++) {
+		if(categories[i].first >= strings.size() || categories[i].second >= strings.size()) {
+			return false;
+		}
+	}
+	foreach(const Range& range, objects) {
+		if(range.begin > range.end || range.end > values.size()) {
+			return false;
+		}
+	}
+	foreach(const Value& value, values) {
+		if(value.key >= strings.size() || value.type > STRING
+				|| (value.type == STRING && value.s >= strings.size())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void imageMetaData::MetaDataStore::loadXML(const std::string& xmlFile) {
+	using std::string;
+	using boost::property_tree::ptree;
+	using boost::filesystem::path;
+
+	clear();
+
+	std::string base;
+	path xmlPath(xmlFile);
+	if(xmlPath.has_parent_path()) {
+		base = xmlPath.parent_path().string();
+	} else {
+		base = ".";
+	}
+
+	ptree pt;
+	read_xml(xmlFile, pt);
+	foreach(ptree::value_type &img, pt.get_child("metadata")){
+		path imgPath(base + img.second.get<string>("<xmlattr>.path"));
+
+		ImageRecord rec;
+		rec.path = intern(imgPath.string());
+		rec.name = intern(imgPath.filename().string());
+		rec.categoryBegin = categories.size();
+
+		std::vector<const ptree*> objectTrees;
+		foreach(ptree::value_type &img_child, img.second) {
+			if(img_child.first == "category") {
+				categories.push_back(std::make_pair(
+						intern(img_child.second.get<string>("<xmlattr>.name")),
+						intern(img_child.second.get<string>("<xmlattr>.value"))));
+			} else if(img_child.first == "object") {
+				objectTrees.push_back(&img_child.second);
+			}
+		}
+		rec.categoryEnd = categories.size();
+
+		rec.propertyBegin = values.size();
+		foreach(ptree::value_type &img_child, img.second) {
+			if(img_child.first == "property") {
+				addValue(img_child.second.get<string>("<xmlattr>.name"),
+						img_child.second.get<string>("<xmlattr>.value"));
+			}
+		}
+		sortValues(rec.propertyBegin);
+		rec.propertyEnd = values.size();
+
+		rec.objectBegin = objects.size();
+		foreach(const ptree* obj, objectTrees) {
+			Range range;
+			range.begin = values.size();
+			foreach(const ptree::value_type &obj_child, *obj) {
+				if(obj_child.first == "property") {
+					addValue(obj_child.second.get<string>("<xmlattr>.name"),
+							obj_child.second.get<string>("<xmlattr>.value"));
+				}
+			}
+			sortValues(range.begin);
+			range.end = values.size();
+			objects.push_back(range);
+		}
+		rec.objectEnd = objects.size();
+
+		images.push_back(rec);
+	}
+
+	buildIndex();
+}
+
+bool imageMetaData::MetaDataStore::saveBinary(const std::string& path) const {
+	std::ofstream out(path.c_str(), std::ios::binary);
+	if(!out.is_open()) {
+		return false;
+	}
+
+	out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+	XMLStamp stamp = { 0, 0 };
+	out.write(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+
+	// Strings are stored as one blob with end offsets
+	std::vector<boost::uint32_t> offsets;
+	std::string blob;
+	offsets.reserve(strings.size());
+	foreach(const std::string& str, strings) {
+		blob += str;
+		offsets.push_back(blob.size());
+	}
+	writeArray(out, offsets);
+	writeArray(out, std::vector<char>(blob.begin(), blob.end()));
+
+	writeArray(out, sortedKeys);
+	writeArray(out, images);
+	writeArray(out, categories);
+	writeArray(out, objects);
+	writeArray(out, values);
+
+	out.close();
+	return !out.fail();
+}
+
+bool imageMetaData::MetaDataStore::loadBinary(const std::string& path, const std::string& xmlFile) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	if(!in.is_open()) {
+		return false;
+	}
+	in.seekg(0, std::ios::end);
+	std::streamoff fileSize = in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	char magic[sizeof(BINARY_MAGIC)];
+	XMLStamp stamp;
+	in.read(magic, sizeof(magic));
+	in.read(reinterpret_cast<char*>(&stamp), sizeof(stamp));
+	if(in.fail() || memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0) {
+		return false;
+	}
+	if(!xmlFile.empty()) {
+		XMLStamp current = stampOf(xmlFile);
+		if(current.size != stamp.size || current.modified != stamp.modified) {
+			return false;
+		}
+	}
+
+	clear();
+
+	std::vector<boost::uint32_t> offsets;
+	std::vector<char> blob;
+	bool ok = readArray(in, fileSize, offsets) && readArray(in, fileSize, blob)
+			&& readArray(in, fileSize, sortedKeys) && readArray(in, fileSize, images)
+			&& readArray(in, fileSize, categories) && readArray(in, fileSize, objects)
+			&& readArray(in, fileSize, values);
+	if(!ok) {
+		clear();
+		return false;
+	}
+
+	strings.resize(offsets.size());
+	boost::uint32_t begin = 0;
+	for(size_t i = 0; i < offsets.size(); i++) {
+		if(offsets[i] < begin || offsets[i] > blob.size()) {
+			clear();
+			return false;
+		}
+		strings[i].assign(blob.begin() + begin, blob.begin() + offsets[i]);
+		begin = offsets[i];
+	}
+	if(begin != blob.size() || !isValid()) {
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+void imageMetaData::MetaDataStore::load(const std::string& xmlFile, std::string cacheFile) {
+	if(cacheFile.empty()) {
+		cacheFile = xmlFile + ".bin";
+	}
+
+	if(loadBinary(cacheFile, xmlFile)) {
+		return;
+	}
+
+	// Stamp before parsing, so an XML file modified while it is parsed
+	// leaves a cache that is out of date rather than one that looks current
+	XMLStamp stamp = stampOf(xmlFile);
+	loadXML(xmlFile);
+	if(saveBinary(cacheFile)) {
+		// Stamp the cache with the XML file it was created from
+		std::fstream out(cacheFile.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		out.seekp(sizeof(BINARY_MAGIC));
+		out.write(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+	}
+}
+
+imageMetaData::MetaDataStore::Key imageMetaData::MetaDataStore::key(const std::string& name) const {
+	std::vector<Key>::const_iterator it =
+			std::lower_bound(sortedKeys.begin(), sortedKeys.end(), name, KeyLess(strings));
+	return (it != sortedKeys.end() && strings[*it] == name) ? *it : NO_KEY;
+}
+
+std::vector<imageMetaData::ImageMD> imageMetaData::MetaDataStore::toImageMD() const {
+	std::vector<ImageMD> md;
+	md.reserve(images.size());
+	for(size_t i = 0; i < images.size(); i++) {
+		md.push_back(image(i).toImageMD());
+	}
+	return md;
+}
@@ -32,17 +32,25 @@
 //******************************************************************************
 
 #include <unicap_cv_bridge.hpp>
+#include <FrameSource/UnicapSource.h>
+#include <FrameSource/ReplaySource.h>
+#include <FrameSource/FrameRecorder.h>
 #include <CameraCalibration/RectifyImage.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 using namespace cv;
 using namespace std;
 using namespace unicap_cv_bridge;
+using namespace framesource;
+using boost::posix_time::ptime;
 
 void draw_hist(Mat& dest, const Mat& src, int histSize)
 {
@@ -120,88 +128,120 @@ void draw_hist(Mat& dest, const Mat& src, int histSize)
 int main(int argc, char** argv)
 {
 	if(argc < 3) {
-		printf("usage for starting capture: %s device_number format_number [calibration_xml]\ndevices:\n", argv[0]);
+		printf("usage for starting capture: %s device_number format_number [calibration_xml]\n", argv[0]);
+		printf("usage for replaying a recording: %s replay image_directory|video_file [fps|0 for max speed] [calibration_xml]\n", argv[0]);
+		printf("devices:\n");
 		print_devices_inventory();
 
 		return 0;
 	}
 
-	int device_number = atoi(argv[1]);
-	int format_number = atoi(argv[2]);
+	try {
+		std::auto_ptr<FrameSource> source;
+		UnicapSource* unicap = NULL;
+		int calibration_arg;
+		if(!strcmp(argv[1], "replay")) {
+			double rate = argc > 3 ? atof(argv[3]) : ReplaySource::RECORDED_RATE;
+			source.reset(new ReplaySource(argv[2], rate, true));
+			calibration_arg = 4;
+		}
+		else {
+			int device_number = atoi(argv[1]);
+			int format_number = atoi(argv[2]);
+			source.reset(unicap = new UnicapSource(device_number, format_number));
+			calibration_arg = 3;
+		}
+		Size camSize = source->get_size();
 
-	unicap_cv_camera cam(device_number, format_number);
-	Size camSize(cam.get_img_width(), cam.get_img_height());
+		Mat undistorted;
+		RectifyImage rectifier;
+		if(argc > calibration_arg) rectifier.initRectify(argv[calibration_arg], camSize);
 
-	Mat undistorted;
-	RectifyImage rectifier;
-	if(argc > 3) rectifier.initRectify(argv[3], camSize);
+		Mat frame(camSize, source->get_format());
+		Mat hist(600, 900, CV_8UC3);
+		ptime timestamp;
+		std::auto_ptr<FrameRecorder> recorder;
 
-	Mat frame(camSize, cam.get_img_format());
-	Mat hist(600, 900, CV_8UC3);
+		if(unicap) unicap->get_camera().set_auto_white_balance(true);
 
-	cam.set_auto_white_balance(true);
+		int counter = 0;
+		double exposure = 0.015;
+		double blue = 0, red = 0;
+		char key = 0;
+		bool tripmode = false;
+		bool undistort = argc > calibration_arg;
 
-	int counter = 0;
-	double exposure = 0.015;
-	double blue, red;
-	char key = 0;
-	bool tripmode = false;
-	bool undistort = argc > 3;
+		while(key != 'q') {
+			source->get_frame(frame, &timestamp);
 
-	while(key != 'q') {
-		cam.get_frame(&frame);
+			if(undistort) {
+				rectifier.rectify(frame, undistorted);
+				imshow("undistorted", undistorted);
+			}
+			else {
+				imshow("distorted", frame);
+			}
 
-		if(undistort) {
-			rectifier.rectify(frame, undistorted);
-			imshow("undistorted", undistorted);
-		}
-		else {
-			imshow("distorted", frame);
-		}
+			if(recorder.get()) recorder->record(frame, timestamp);
+
+			draw_hist(hist, frame, 128);
+
+			if(unicap) unicap->get_camera().get_white_balance(blue, red);
 
-		draw_hist(hist, frame, 128);
-
-		cam.get_white_balance(blue, red);
-
-		rectangle(hist, Point(10, 5), Point(210, 67), Scalar(100, 100, 100, 50), CV_FILLED, 1, 0);
-
-		stringstream ss;
-		ss << "exposure: " << exposure;
-		cv::putText(hist, ss.str(), cv::Point(20,20), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
-		ss.str("");
-		ss << "blue: " << blue;
-		cv::putText(hist, ss.str(), cv::Point(20, 40), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
-		ss.str("");
-		ss << "red:  " << red;
-		cv::putText(hist, ss.str(), cv::Point(20, 60), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
-
-		imshow("histogram", hist);
-
-		key = waitKey(10);
-		if(key == 'w'){
-			exposure *= 1.125;
-			cam.set_exposure(exposure);
-		}else if(key == 's'){
-			exposure /= 1.125;
-			cam.set_exposure(exposure);
-		}else if(key == 'a'){
-			cam.set_auto_white_balance(true);
-		}else if(key == 'z'){
-			cam.set_auto_white_balance(false);
-		}else if(key == 't'){
-			tripmode = !tripmode;
-			cam.set_trip_mode(tripmode);
-		}else if(key == 'c'){
-			if(argc > 3) undistort = !undistort;
-		}else if(key == 'b'){
+			rectangle(hist, Point(10, 5), Point(210, 67), Scalar(100, 100, 100, 50), CV_FILLED, 1, 0);
+
+			stringstream ss;
+			ss << "exposure: " << exposure;
+			cv::putText(hist, ss.str(), cv::Point(20,20), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
+			ss.str("");
+			ss << "blue: " << blue;
+			cv::putText(hist, ss.str(), cv::Point(20, 40), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
 			ss.str("");
-			ss << "Image" << counter++ << ".jpg";
-			if(undistort) imwrite(ss.str().c_str(), undistorted);
-			else imwrite(ss.str().c_str(), frame);
-			cout << "Image taken: " << ss.str().c_str() << endl;
-			key = 0;	
+			ss << "red:  " << red;
+			cv::putText(hist, ss.str(), cv::Point(20, 60), FONT_HERSHEY_PLAIN, 1, cv::Scalar(255, 255, 255, 0), 1, 1, false);
+
+			imshow("histogram", hist);
+
+			key = waitKey(10);
+			if(key == 'w'){
+				exposure *= 1.125;
+				if(unicap) unicap->get_camera().set_exposure(exposure);
+			}else if(key == 's'){
+				exposure /= 1.125;
+				if(unicap) unicap->get_camera().set_exposure(exposure);
+			}else if(key == 'a'){
+				if(unicap) unicap->get_camera().set_auto_white_balance(true);
+			}else if(key == 'z'){
+				if(unicap) unicap->get_camera().set_auto_white_balance(false);
+			}else if(key == 't'){
+				tripmode = !tripmode;
+				if(unicap) unicap->get_camera().set_trip_mode(tripmode);
+			}else if(key == 'c'){
+				if(argc > calibration_arg) undistort = !undistort;
+			}else if(key == 'b'){
+				ss.str("");
+				ss << "Image" << counter++ << ".jpg";
+				if(undistort) imwrite(ss.str().c_str(), undistorted);
+				else imwrite(ss.str().c_str(), frame);
+				cout << "Image taken: " << ss.str().c_str() << endl;
+				key = 0;	
+			}else if(key == 'r'){
+				if(recorder.get()) {
+					cout << "Recorded " << recorder->get_count() << " frames" << endl;
+					recorder.reset();
+				}
+				else {
+					ss.str("");
+					ss << "Recording" << counter++;
+					recorder.reset(new FrameRecorder(ss.str()));
+					cout << "Recording to: " << ss.str() << endl;
+				}
+			}
+			cout.flush();
 		}
-		cout.flush();
+	} catch(exception& e) {
+		cerr << e.what() << endl;
+		return 1;
 	}
 
 	return 0;
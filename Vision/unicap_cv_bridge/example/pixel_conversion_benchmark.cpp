@@ -0,0 +1,152 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        unicap cv bridge
+// File:           pixel_conversion_benchmark.cpp
+// Description:    measures the cycles per pixel of the frame conversions
+// Author:         agent
+// Notes:          g++ -O2 -mssse3 -Iinclude example/pixel_conversion_benchmark.cpp src/pixel_conversion.cpp
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "pixel_conversion.hpp"
+#include <x86intrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace unicap_cv_bridge;
+
+// the loop new_frame_cb used before the conversion kernels
+void previous_loop(const uint8_t* source, uint8_t* dest, int width, int height, bool tripmode)
+{
+	for (int n = 0; n < width * height * 3; n += 3)
+	{
+		if(tripmode)
+		{
+			dest[n] = (source[n] % 33) * (255 / 33);
+			dest[n + 1] = (source[n + 1] % 40) * (255 / 40);
+			dest[n + 2] = (source[n + 2] % 18) * (255 / 18);
+		}
+		else
+		{
+			dest[n] = source[n + 2];
+			dest[n + 1] = source[n + 1];
+			dest[n + 2] = source[n];
+		}
+	}
+}
+
+// tripmode is read from a global, like the member in new_frame_cb, so the compiler can not hoist it
+volatile bool tripmode = false;
+
+enum conversion
+{
+	PREVIOUS,
+	PREVIOUS_TRIP,
+	PREVIOUS_THEN_GRAY,
+	SCALAR_BGR,
+	SCALAR_GRAY,
+	SCALAR_BGR_GRAY,
+	BGR,
+	GRAY,
+	BGR_GRAY,
+	TRIP
+};
+
+const char* names[] = {
+	"previous loop (bgr)",
+	"previous loop (trip mode)",
+	"previous loop + gray pass",
+	"scalar bgr",
+	"scalar gray",
+	"scalar bgr + gray",
+	"bgr",
+	"gray",
+	"bgr + gray (fused)",
+	"trip mode (table)"
+};
+
+double cycles_per_pixel(conversion conv, int width, int height, int runs)
+{
+	size_t pixels = (size_t)width * height;
+	std::vector<uint8_t> src(pixels * 3), bgr(pixels * 3), gray(pixels);
+	for (size_t i = 0; i < src.size(); i++)
+	{
+		src[i] = rand();
+	}
+
+	unsigned long long best = ~0ull;
+	for (int run = 0; run < runs; run++)
+	{
+		unsigned long long start = __rdtsc();
+		switch (conv)
+		{
+		case PREVIOUS: tripmode = false; previous_loop(&src[0], &bgr[0], width, height, tripmode); break;
+		case PREVIOUS_TRIP: tripmode = true; previous_loop(&src[0], &bgr[0], width, height, tripmode); break;
+		case PREVIOUS_THEN_GRAY:
+			tripmode = false;
+			previous_loop(&src[0], &bgr[0], width, height, tripmode);
+			scalar::rgb_to_gray(&bgr[0], &gray[0], pixels); // stands in for cvtColor(CV_BGR2GRAY)
+			break;
+		case SCALAR_BGR: scalar::rgb_to_bgr(&src[0], &bgr[0], pixels); break;
+		case SCALAR_GRAY: scalar::rgb_to_gray(&src[0], &gray[0], pixels); break;
+		case SCALAR_BGR_GRAY: scalar::rgb_to_bgr_gray(&src[0], &bgr[0], &gray[0], pixels); break;
+		case BGR: rgb_to_bgr(&src[0], &bgr[0], pixels); break;
+		case GRAY: rgb_to_gray(&src[0], &gray[0], pixels); break;
+		case BGR_GRAY: rgb_to_bgr_gray(&src[0], &bgr[0], &gray[0], pixels); break;
+		case TRIP: rgb_to_trip(&src[0], &bgr[0], pixels); break;
+		}
+		unsigned long long cycles = __rdtsc() - start;
+		if (cycles < best)
+		{
+			best = cycles;
+		}
+	}
+	return best / (double)pixels;
+}
+
+int main(int argc, char** argv)
+{
+	int runs = argc > 1 ? atoi(argv[1]) : 20;
+	int sizes[][2] = { { 1280, 960 }, { 2560, 1920 } };
+
+#ifdef __SSSE3__
+	printf("SSSE3 kernels, best of %d runs, cycles per pixel\n", runs);
+#else
+	printf("scalar kernels (compile with -mssse3), best of %d runs, cycles per pixel\n", runs);
+#endif
+	printf("%-28s %12s %12s\n", "", "1280x960", "2560x1920");
+	for (int conv = PREVIOUS; conv <= TRIP; conv++)
+	{
+		printf("%-28s", names[conv]);
+		for (int s = 0; s < 2; s++)
+		{
+			printf(" %12.2f", cycles_per_pixel((conversion)conv, sizes[s][0], sizes[s][1], runs));
+		}
+		printf("\n");
+	}
+	return 0;
+}
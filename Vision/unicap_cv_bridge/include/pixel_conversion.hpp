@@ -0,0 +1,83 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        unicap cv bridge
+// File:           pixel_conversion.hpp
+// Description:    conversion of the packed RGB frames of unicap to the formats used by opencv
+// Author:         agent
+// Notes:          SSSE3 versions are used when compiled with -mssse3
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace unicap_cv_bridge
+{
+	/**
+	 * @brief convert packed RGB to packed BGR
+	 * @param src the RGB pixels
+	 * @param bgr output, the BGR pixels. may not overlap src
+	 * @param pixels the amount of pixels
+	 **/
+	void rgb_to_bgr(const uint8_t* src, uint8_t* bgr, size_t pixels);
+
+	/**
+	 * @brief convert packed RGB to gray, with the same weights and rounding as cv::cvtColor(..., CV_BGR2GRAY)
+	 * @param src the RGB pixels
+	 * @param gray output, one byte per pixel
+	 * @param pixels the amount of pixels
+	 **/
+	void rgb_to_gray(const uint8_t* src, uint8_t* gray, size_t pixels);
+
+	/**
+	 * @brief convert packed RGB to packed BGR and gray in a single pass
+	 * @param src the RGB pixels
+	 * @param bgr output, the BGR pixels. may not overlap src
+	 * @param gray output, one byte per pixel
+	 * @param pixels the amount of pixels
+	 **/
+	void rgb_to_bgr_gray(const uint8_t* src, uint8_t* bgr, uint8_t* gray, size_t pixels);
+
+	/**
+	 * @brief the colour reducing conversion of trip mode. the channel order is kept
+	 * @param src the RGB pixels
+	 * @param dst output, the converted pixels
+	 * @param pixels the amount of pixels
+	 **/
+	void rgb_to_trip(const uint8_t* src, uint8_t* dst, size_t pixels);
+
+	/**
+	 * @brief plain C versions of the conversions, used for the remaining pixels and as reference
+	 **/
+	namespace scalar
+	{
+		void rgb_to_bgr(const uint8_t* src, uint8_t* bgr, size_t pixels);
+		void rgb_to_gray(const uint8_t* src, uint8_t* gray, size_t pixels);
+		void rgb_to_bgr_gray(const uint8_t* src, uint8_t* bgr, uint8_t* gray, size_t pixels);
+	}
+}
@@ -106,6 +106,7 @@ namespace unicap_cv_bridge
 			boost::condition_variable cond;
 			frame_cap_state state;
 			cv::Mat* mat;
+			cv::Mat* gray;
         
 		public:
 			/**
@@ -177,5 +178,16 @@ namespace unicap_cv_bridge
 			 * @param mat the frame is copied into this matrix
 			 **/        
 			void get_frame(cv::Mat* mat);
+
+			/**
+			 * @brief get a frame in the formats the caller needs
+			 *
+			 * this function blocks until a new frame is captured. both outputs are
+			 * converted from the captured frame in a single pass, which is cheaper
+			 * than a cv::cvtColor afterwards.
+			 * @param mat if not NULL, the frame is copied into this matrix (BGR, get_img_format())
+			 * @param gray if not NULL, the frame is converted to gray into this matrix (CV_8UC1)
+			 **/
+			void get_frame(cv::Mat* mat, cv::Mat* gray);
 	};
 }
@@ -0,0 +1,243 @@
+//******************************************************************************
+//
+//                 Low Cost Vision
+//
+//******************************************************************************
+// Project:        unicap cv bridge
+// File:           pixel_conversion.cpp
+// Description:    conversion of the packed RGB frames of unicap to the formats used by opencv
+// Author:         agent
+// Notes:          SSSE3 versions are used when compiled with -mssse3
+//
+// License: newBSD 
+//  
+// Copyright © 2012, HU University of Applied Sciences Utrecht. 
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+// - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+// BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+// GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT 
+// OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//******************************************************************************
+
+#include "pixel_conversion.hpp"
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace unicap_cv_bridge
+{
+// fixed point weights of cv::cvtColor(..., CV_BGR2GRAY)
+static const int GRAY_SHIFT = 14;
+static const int GRAY_R = 4899;
+static const int GRAY_G = 9617;
+static const int GRAY_B = 1868;
+
+static inline uint8_t gray_pixel(int r, int g, int b)
+{
+	return (uint8_t)((r * GRAY_R + g * GRAY_G + b * GRAY_B + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT);
+}
+
+namespace scalar
+{
+void rgb_to_bgr(const uint8_t* src, uint8_t* bgr, size_t pixels)
+{
+	for (size_t i = 0; i < pixels; i++, src += 3, bgr += 3)
+	{
+		bgr[0] = src[2];
+		bgr[1] = src[1];
+		bgr[2] = src[0];
+	}
+}
+
+void rgb_to_gray(const uint8_t* src, uint8_t* gray, size_t pixels)
+{
+	for (size_t i = 0; i < pixels; i++, src += 3)
+	{
+		gray[i] = gray_pixel(src[0], src[1], src[2]);
+	}
+}
+
+void rgb_to_bgr_gray(const uint8_t* src, uint8_t* bgr, uint8_t* gray, size_t pixels)
+{
+	for (size_t i = 0; i < pixels; i++, src += 3, bgr += 3)
+	{
+		bgr[0] = src[2];
+		bgr[1] = src[1];
+		bgr[2] = src[0];
+		gray[i] = gray_pixel(src[0], src[1], src[2]);
+	}
+}
+}
+
+#ifdef __SSSE3__
+// Splits 16 packed RGB pixels (48 bytes) into a vector per channel
+static inline void deinterleave(const uint8_t* src, __m128i& r, __m128i& g, __m128i& b)
+{
+	const __m128i r0 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i r1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+	const __m128i r2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+	const __m128i g0 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i g1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+	const __m128i g2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+	const __m128i b0 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i b1 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+	const __m128i b2 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+
+	__m128i v0 = _mm_loadu_si128((const __m128i*)src);
+	__m128i v1 = _mm_loadu_si128((const __m128i*)(src + 16));
+	__m128i v2 = _mm_loadu_si128((const __m128i*)(src + 32));
+
+	r = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, r0), _mm_shuffle_epi8(v1, r1)), _mm_shuffle_epi8(v2, r2));
+	g = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, g0), _mm_shuffle_epi8(v1, g1)), _mm_shuffle_epi8(v2, g2));
+	b = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(v0, b0), _mm_shuffle_epi8(v1, b1)), _mm_shuffle_epi8(v2, b2));
+}
+
+// Writes 16 pixels as packed BGR (48 bytes)
+static inline void interleave_bgr(uint8_t* dst, __m128i r, __m128i g, __m128i b)
+{
+	const __m128i b0 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+	const __m128i g0 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+	const __m128i r0 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+	const __m128i b1 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+	const __m128i g1 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+	const __m128i r1 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+	const __m128i b2 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+	const __m128i g2 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+	const __m128i r2 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+
+	_mm_storeu_si128((__m128i*)dst,
+		_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(r, r0)));
+	_mm_storeu_si128((__m128i*)(dst + 16),
+		_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(r, r1)));
+	_mm_storeu_si128((__m128i*)(dst + 32),
+		_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b, b2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(r, r2)));
+}
+
+// Gray value of 4 pixels, given as 16 bit channels
+static inline __m128i gray4(__m128i r, __m128i g, __m128i b)
+{
+	const __m128i rg_weights = _mm_setr_epi16(GRAY_R, GRAY_G, GRAY_R, GRAY_G, GRAY_R, GRAY_G, GRAY_R, GRAY_G);
+	const __m128i b_weights = _mm_setr_epi16(GRAY_B, 1, GRAY_B, 1, GRAY_B, 1, GRAY_B, 1);
+	const __m128i round = _mm_set1_epi16(1 << (GRAY_SHIFT - 1));
+
+	// r * GRAY_R + g * GRAY_G and b * GRAY_B + round as 32 bit values
+	__m128i rg = _mm_madd_epi16(_mm_unpacklo_epi16(r, g), rg_weights);
+	__m128i b1 = _mm_madd_epi16(_mm_unpacklo_epi16(b, round), b_weights);
+	return _mm_srli_epi32(_mm_add_epi32(rg, b1), GRAY_SHIFT);
+}
+
+// Gray value of 16 pixels
+static inline __m128i gray16(__m128i r, __m128i g, __m128i b)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i r16 = _mm_unpacklo_epi8(r, zero);
+	__m128i g16 = _mm_unpacklo_epi8(g, zero);
+	__m128i b16 = _mm_unpacklo_epi8(b, zero);
+	__m128i lo = _mm_packs_epi32(gray4(r16, g16, b16),
+		gray4(_mm_unpackhi_epi64(r16, r16), _mm_unpackhi_epi64(g16, g16), _mm_unpackhi_epi64(b16, b16)));
+
+	r16 = _mm_unpackhi_epi8(r, zero);
+	g16 = _mm_unpackhi_epi8(g, zero);
+	b16 = _mm_unpackhi_epi8(b, zero);
+	__m128i hi = _mm_packs_epi32(gray4(r16, g16, b16),
+		gray4(_mm_unpackhi_epi64(r16, r16), _mm_unpackhi_epi64(g16, g16), _mm_unpackhi_epi64(b16, b16)));
+
+	return _mm_packus_epi16(lo, hi);
+}
+
+void rgb_to_bgr(const uint8_t* src, uint8_t* bgr, size_t pixels)
+{
+	// swap R and B of 5 pixels per shuffle. The 16th byte is written
+	// unchanged and overwritten by the next iteration.
+	const __m128i swap = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+
+	size_t i = 0;
+	for (; 3 * i + 16 <= 3 * pixels; i += 5)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+		_mm_storeu_si128((__m128i*)(bgr + 3 * i), _mm_shuffle_epi8(v, swap));
+	}
+	scalar::rgb_to_bgr(src + 3 * i, bgr + 3 * i, pixels - i);
+}
+
+void rgb_to_gray(const uint8_t* src, uint8_t* gray, size_t pixels)
+{
+	size_t i = 0;
+	for (; i + 16 <= pixels; i += 16)
+	{
+		__m128i r, g, b;
+		deinterleave(src + 3 * i, r, g, b);
+		_mm_storeu_si128((__m128i*)(gray + i), gray16(r, g, b));
+	}
+	scalar::rgb_to_gray(src + 3 * i, gray + i, pixels - i);
+}
+
+void rgb_to_bgr_gray(const uint8_t* src, uint8_t* bgr, uint8_t* gray, size_t pixels)
+{
+	size_t i = 0;
+	for (; i + 16 <= pixels; i += 16)
+	{
+		__m128i r, g, b;
+		deinterleave(src + 3 * i, r, g, b);
+		interleave_bgr(bgr + 3 * i, r, g, b);
+		_mm_storeu_si128((__m128i*)(gray + i), gray16(r, g, b));
+	}
+	scalar::rgb_to_bgr_gray(src + 3 * i, bgr + 3 * i, gray + i, pixels - i);
+}
+#else
+void rgb_to_bgr(const uint8_t* src, uint8_t* bgr, size_t pixels)
+{
+	scalar::rgb_to_bgr(src, bgr, pixels);
+}
+
+void rgb_to_gray(const uint8_t* src, uint8_t* gray, size_t pixels)
+{
+	scalar::rgb_to_gray(src, gray, pixels);
+}
+
+void rgb_to_bgr_gray(const uint8_t* src, uint8_t* bgr, uint8_t* gray, size_t pixels)
+{
+	scalar::rgb_to_bgr_gray(src, bgr, gray, pixels);
+}
+#endif
+
+void rgb_to_trip(const uint8_t* src, uint8_t* dst, size_t pixels)
+{
+	// the modulo per channel is replaced by a table lookup
+	static uint8_t table[3][256];
+	static bool initialized = false;
+	if (!initialized)
+	{
+		const int mod[3] = { 33, 40, 18 };
+		for (int c = 0; c < 3; c++)
+		{
+			for (int v = 0; v < 256; v++)
+			{
+				table[c][v] = (v % mod[c]) * (255 / mod[c]);
+			}
+		}
+		initialized = true;
+	}
+
+	for (size_t i = 0; i < pixels; i++, src += 3, dst += 3)
+	{
+		dst[0] = table[0][src[0]];
+		dst[1] = table[1][src[1]];
+		dst[2] = table[2][src[2]];
+	}
+}
+}
@@ -33,6 +33,7 @@
 
 
 #include "unicap_cv_bridge.hpp"
+#include "pixel_conversion.hpp"
 
 #include <cstdio>
 #include <stdint.h>
@@ -208,7 +209,7 @@ static void new_frame_cb(unicap_event_t event, unicap_handle_t handle,
 }
 
 unicap_cv_camera::unicap_cv_camera(int dev, int fmt) :
-	tripmode(false)
+	tripmode(false), state(FCSTATE_DONT_COPY), mat(NULL), gray(NULL)
 {
 	if (!SUCCESS(unicap_enumerate_devices(NULL, &device, dev)))
 	{
@@ -347,26 +348,33 @@ void unicap_cv_camera::new_frame_cb(unicap_data_buffer_t* buffer)
 	boost::unique_lock<boost::mutex> lock(mut);
 	if (state == FCSTATE_COPY)
 	{
-		if (mat->cols == format.size.width && mat->rows == format.size.height
-				&& mat->type() == CV_8UC3)
+		int width = format.size.width;
+		int height = format.size.height;
+		bool mat_ok = mat == NULL || (mat->cols == width && mat->rows == height
+				&& mat->type() == CV_8UC3 && mat->isContinuous());
+		bool gray_ok = gray == NULL || (gray->cols == width && gray->rows == height
+				&& gray->type() == CV_8UC1 && gray->isContinuous());
+
+		if (mat_ok && gray_ok)
 		{
-			uint8_t* dest = mat->ptr();
 			uint8_t* source = buffer->data;
-			//memcpy(dest, source, 3 * (mat->cols * mat->rows));
-			for (int n = 0; n < format.size.width * format.size.height * 3; n += 3)
+			size_t pixels = (size_t)width * height;
+			if (tripmode)
 			{
-				if(tripmode)
-				{
-					dest[n] = (source[n] % 33) * (255 / 33);
-					dest[n + 1] = (source[n + 1] % 40) * (255 / 40);
-					dest[n + 2] = (source[n + 2] % 18) * (255 / 18);
-				}
-				else
-				{
-					dest[n] = source[n + 2];
-					dest[n + 1] = source[n + 1];
-					dest[n + 2] = source[n];
-				}
+				if (mat != NULL) rgb_to_trip(source, mat->ptr(), pixels);
+				if (gray != NULL) rgb_to_gray(source, gray->ptr(), pixels);
+			}
+			else if (mat != NULL && gray != NULL)
+			{
+				rgb_to_bgr_gray(source, mat->ptr(), gray->ptr(), pixels);
+			}
+			else if (mat != NULL)
+			{
+				rgb_to_bgr(source, mat->ptr(), pixels);
+			}
+			else if (gray != NULL)
+			{
+				rgb_to_gray(source, gray->ptr(), pixels);
 			}
 
 			state = FCSTATE_SUCCESS;
@@ -381,11 +389,20 @@ void unicap_cv_camera::new_frame_cb(unicap_data_buffer_t* buffer)
 }
 
 void unicap_cv_camera::get_frame(cv::Mat* mat)
+{
+	get_frame(mat, NULL);
+}
+
+void unicap_cv_camera::get_frame(cv::Mat* mat, cv::Mat* gray)
 {
 	boost::unique_lock<boost::mutex> lock(mut);
 	state = FCSTATE_COPY;
 	this->mat = mat;
-	cond.wait(lock);
+	this->gray = gray;
+	while (state == FCSTATE_COPY)
+	{
+		cond.wait(lock);
+	}
 	frame_cap_state _state = state;
 	state = FCSTATE_DONT_COPY;
 	if (_state == FCSTATE_FAILURE)